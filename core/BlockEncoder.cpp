@@ -0,0 +1,576 @@
+// -----------------------------------------------------------------------------
+//  BlockEncoder.cpp – range and cluster fits, the channel ramps and the
+//  threaded driver
+// -----------------------------------------------------------------------------
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace TextureCodec {
+
+namespace {
+
+int E5(unsigned v) { return int((v << 3) | (v >> 2)); }
+int E6(unsigned v) { return int((v << 2) | (v >> 4)); }
+
+void Put16(unsigned char* p, unsigned v) { p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); }
+void Put32(unsigned char* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i)); }
+
+// -----------------------------------------------------------------------------
+//  Four floats, as one SSE register where there is one
+// -----------------------------------------------------------------------------
+#ifdef BC_SSE2
+struct V4
+{
+    __m128 v;
+    V4() {}
+    explicit V4(__m128 x) : v(x) {}
+    V4(float s) : v(_mm_set1_ps(s)) {}
+    V4(float x, float y, float z, float w = 0) : v(_mm_setr_ps(x, y, z, w)) {}
+};
+inline V4 operator+(V4 a, V4 b) { return V4(_mm_add_ps(a.v, b.v)); }
+inline V4 operator-(V4 a, V4 b) { return V4(_mm_sub_ps(a.v, b.v)); }
+inline V4 operator*(V4 a, V4 b) { return V4(_mm_mul_ps(a.v, b.v)); }
+inline V4 operator/(V4 a, V4 b) { return V4(_mm_div_ps(a.v, b.v)); }
+inline V4 Max(V4 a, V4 b)       { return V4(_mm_max_ps(a.v, b.v)); }
+inline V4 Clamp01(V4 a)         { return V4(_mm_min_ps(_mm_max_ps(a.v, _mm_setzero_ps()), _mm_set1_ps(1))); }
+inline V4 Round(V4 a)           { return V4(_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))); }
+inline V4 Load4(const float* p)   { return V4(_mm_loadu_ps(p)); }
+inline void Store4(V4 a, float* p) { _mm_storeu_ps(p, a.v); }
+#else
+struct V4
+{
+    float x[4];
+    V4() {}
+    V4(float s) { x[0] = x[1] = x[2] = x[3] = s; }
+    V4(float a, float b, float c, float d = 0) { x[0] = a; x[1] = b; x[2] = c; x[3] = d; }
+};
+inline V4 operator+(V4 a, V4 b) { for (int i = 0; i < 4; ++i) a.x[i] += b.x[i]; return a; }
+inline V4 operator-(V4 a, V4 b) { for (int i = 0; i < 4; ++i) a.x[i] -= b.x[i]; return a; }
+inline V4 operator*(V4 a, V4 b) { for (int i = 0; i < 4; ++i) a.x[i] *= b.x[i]; return a; }
+inline V4 operator/(V4 a, V4 b) { for (int i = 0; i < 4; ++i) a.x[i] /= b.x[i]; return a; }
+inline V4 Max(V4 a, V4 b)       { for (int i = 0; i < 4; ++i) a.x[i] = std::max(a.x[i], b.x[i]); return a; }
+inline V4 Clamp01(V4 a)         { for (int i = 0; i < 4; ++i) a.x[i] = std::min(std::max(a.x[i], 0.f), 1.f); return a; }
+inline V4 Round(V4 a)           { for (int i = 0; i < 4; ++i) a.x[i] = float(int(a.x[i] + 0.5f)); return a; }
+inline V4 Load4(const float* p)   { V4 a; for (int i = 0; i < 4; ++i) a.x[i] = p[i]; return a; }
+inline void Store4(V4 a, float* p) { for (int i = 0; i < 4; ++i) p[i] = a.x[i]; }
+#endif
+
+// -----------------------------------------------------------------------------
+//  Colour: one block as channel planes (B, G, R), the decoder's palette
+//  and the index search against it
+// -----------------------------------------------------------------------------
+struct Texels
+{
+    int32_t  c[3][16];                 // B, G, R planes
+    unsigned clear;                    // bit i: texel i is BC1-transparent
+};
+
+struct Candidate
+{
+    unsigned c0, c1;
+    uint32_t bits;
+    int      error;
+};
+
+// The palette as ColourBlock() rebuilds it, fourColour for BC2/BC3; count
+// is how many entries an opaque texel may use
+void Palette(unsigned c0, unsigned c1, bool fourColour, int pal[4][3], int& count)
+{
+    const bool four = fourColour || c0 > c1;
+    const int e0[3] = { E5(c0 & 31), E6((c0 >> 5) & 63), E5(c0 >> 11) };
+    const int e1[3] = { E5(c1 & 31), E6((c1 >> 5) & 63), E5(c1 >> 11) };
+    for (int k = 0; k < 3; ++k) {
+        pal[0][k] = e0[k];
+        pal[1][k] = e1[k];
+        if (four) {
+            pal[2][k] = (2 * e0[k] + e1[k]) / 3;
+            pal[3][k] = (e0[k] + 2 * e1[k]) / 3;
+        } else {
+            pal[2][k] = (e0[k] + e1[k]) / 2;
+            pal[3][k] = 0;
+        }
+    }
+    count = c0 == c1 ? 1 : (four ? 4 : 3);
+}
+
+// Nearest of the first count palette entries for every texel; transparent
+// texels take index 3 and add nothing
+uint32_t Nearest(const Texels& t, const int pal[4][3], int count, int& error)
+{
+    int idx[16], dist[16];
+#ifdef BC_SSE2
+    // Planes hold 0..255 in the low half of each 32-bit lane: a 16-bit
+    // subtract keeps the high half zero, so madd(d, d) is exactly d*d
+    for (int q = 0; q < 16; q += 4) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&t.c[0][q]));
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&t.c[1][q]));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&t.c[2][q]));
+        __m128i best = _mm_set1_epi32(INT_MAX), at = _mm_setzero_si128();
+        for (int k = 0; k < count; ++k) {
+            const __m128i db = _mm_sub_epi16(b, _mm_set1_epi32(pal[k][0]));
+            const __m128i dg = _mm_sub_epi16(g, _mm_set1_epi32(pal[k][1]));
+            const __m128i dr = _mm_sub_epi16(r, _mm_set1_epi32(pal[k][2]));
+            const __m128i d  = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(db, db), _mm_madd_epi16(dg, dg)),
+                                             _mm_madd_epi16(dr, dr));
+            const __m128i less = _mm_cmplt_epi32(d, best);
+            best = _mm_or_si128(_mm_and_si128(less, d), _mm_andnot_si128(less, best));
+            at   = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(k)), _mm_andnot_si128(less, at));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&idx[q]), at);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&dist[q]), best);
+    }
+#else
+    for (int i = 0; i < 16; ++i) {
+        dist[i] = INT_MAX;
+        idx[i]  = 0;
+        for (int k = 0; k < count; ++k) {
+            const int db = t.c[0][i] - pal[k][0], dg = t.c[1][i] - pal[k][1], dr = t.c[2][i] - pal[k][2];
+            const int d  = db * db + dg * dg + dr * dr;
+            if (d < dist[i]) { dist[i] = d; idx[i] = k; }
+        }
+    }
+#endif
+    uint32_t bits = 0;
+    error = 0;
+    for (int i = 15; i >= 0; --i) {
+        const bool clear = (t.clear >> i) & 1;
+        bits = (bits << 2) | unsigned(clear ? 3 : idx[i]);
+        if (!clear) error += dist[i];
+    }
+    return bits;
+}
+
+// Endpoints in the order the mode needs: c0 > c1 for four colours, c0 <= c1
+// for three (and always when the block has transparent texels); only BC1
+// has the three-colour mode
+Candidate Try(const Texels& t, unsigned c0, unsigned c1, bool four, bool bc1)
+{
+    if (four ? c0 < c1 : c0 > c1) std::swap(c0, c1);
+    Candidate c;
+    c.c0 = c0;
+    c.c1 = c1;
+    int pal[4][3], count;
+    Palette(c0, c1, !bc1, pal, count);
+    c.bits = Nearest(t, pal, count, c.error);
+    return c;
+}
+
+unsigned To565(const float bgr[3])
+{
+    auto q = [](float v, int max) {
+        const int i = int(std::min(std::max(v, 0.f), 255.f) * max / 255.f + 0.5f);
+        return unsigned(std::min(i, max));
+    };
+    return (q(bgr[2], 31) << 11) | (q(bgr[1], 63) << 5) | q(bgr[0], 31);
+}
+
+// Mean and principal axis of the used texels (power iteration on the
+// covariance; good enough to order 16 points)
+void PrincipalAxis(const Texels& t, const int* used, int n, float mean[3], float axis[3])
+{
+    mean[0] = mean[1] = mean[2] = 0;
+    for (int i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k) mean[k] += float(t.c[k][used[i]]);
+    for (int k = 0; k < 3; ++k) mean[k] /= float(n);
+
+    float cov[6] = { 0, 0, 0, 0, 0, 0 };   // bb bg br gg gr rr
+    for (int i = 0; i < n; ++i) {
+        const float b = t.c[0][used[i]] - mean[0], g = t.c[1][used[i]] - mean[1], r = t.c[2][used[i]] - mean[2];
+        cov[0] += b * b; cov[1] += b * g; cov[2] += b * r;
+        cov[3] += g * g; cov[4] += g * r; cov[5] += r * r;
+    }
+
+    float v[3] = { 1, 1, 1 };
+    for (int it = 0; it < 8; ++it) {
+        const float x = cov[0] * v[0] + cov[1] * v[1] + cov[2] * v[2];
+        const float y = cov[1] * v[0] + cov[3] * v[1] + cov[4] * v[2];
+        const float z = cov[2] * v[0] + cov[4] * v[1] + cov[5] * v[2];
+        const float m = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (m <= 0) break;
+        v[0] = x / m; v[1] = y / m; v[2] = z / m;
+    }
+    axis[0] = v[0]; axis[1] = v[1]; axis[2] = v[2];
+}
+
+// Least-squares endpoints over every ordered split of the sorted texels
+// into the palette's entries.  Works in 0..1 so the 565 grid is exact.
+// The four lanes are four splits that differ only in their last boundary,
+// so each term of the fit is one vector and the channels are a loop.
+bool ClusterFit(const Texels& t, const int* sorted, int n, bool four, float start[3], float end[3])
+{
+    // Prefix sums per channel, padded so a four-wide load past n is defined
+    float pre[3][20];
+    for (int k = 0; k < 3; ++k) {
+        pre[k][0] = 0;
+        for (int i = 0; i < n; ++i) pre[k][i + 1] = pre[k][i] + t.c[k][sorted[i]] / 255.f;
+        for (int i = n + 1; i < 20; ++i) pre[k][i] = pre[k][n];
+    }
+    const float grid[3] = { 31.f, 63.f, 31.f };
+    const V4 lane(0.f, 1.f, 2.f, 3.f), two(2.f);
+
+    float bestError = FLT_MAX;
+    float bestA[3] = { 0, 0, 0 }, bestB[3] = { 0, 0, 0 };
+    auto consider = [&](const V4 alphax[3], V4 alpha2, V4 beta2, V4 alphabeta, int lanes) {
+        // A split with nothing to solve still scores its (clamped) endpoints
+        // correctly, so a floor on the determinant is enough
+        const V4 factor = V4(1.f) / Max(alpha2 * beta2 - alphabeta * alphabeta, V4(1e-5f));
+        V4 e(0.f), a[3], b[3];
+        for (int k = 0; k < 3; ++k) {
+            const V4 betax = V4(pre[k][n]) - alphax[k];
+            a[k] = Clamp01((alphax[k] * beta2 - betax * alphabeta) * factor);
+            b[k] = Clamp01((betax * alpha2 - alphax[k] * alphabeta) * factor);
+            a[k] = Round(a[k] * V4(grid[k])) * V4(1 / grid[k]);
+            b[k] = Round(b[k] * V4(grid[k])) * V4(1 / grid[k]);
+            // Squared error less the constant sum of x*x
+            e = e + a[k] * (a[k] * alpha2 + two * (b[k] * alphabeta - alphax[k])) +
+                    b[k] * (b[k] * beta2 - two * betax);
+        }
+        float err[4];
+        Store4(e, err);
+        int q = -1;
+        for (int i = 0; i < lanes; ++i)
+            if (err[i] < bestError) { bestError = err[i]; q = i; }
+        if (q < 0) return;
+        for (int k = 0; k < 3; ++k) {
+            float f[4];
+            Store4(a[k], f);
+            bestA[k] = f[q];
+            Store4(b[k], f);
+            bestB[k] = f[q];
+        }
+    };
+
+    V4 alphax[3];
+    if (four) {
+        for (int i = 0; i <= n; ++i)
+            for (int j = 0; i + j <= n; ++j) {
+                float p01[3];
+                for (int c = 0; c < 3; ++c) p01[c] = pre[c][i] + (pre[c][i + j] - pre[c][i]) * (2 / 3.f);
+                for (int k = 0; i + j + k <= n; k += 4) {
+                    const V4 kv = V4(float(k)) + lane;
+                    for (int c = 0; c < 3; ++c)
+                        alphax[c] = V4(p01[c]) + (Load4(&pre[c][i + j + k]) - V4(pre[c][i + j])) * V4(1 / 3.f);
+                    consider(alphax, V4(i + j * (4 / 9.f)) + kv * V4(1 / 9.f),
+                                     V4(n - i - j + j * (1 / 9.f)) - kv * V4(5 / 9.f),
+                                     (V4(float(j)) + kv) * V4(2 / 9.f), std::min(4, n - i - j - k + 1));
+                }
+            }
+    } else {
+        for (int i = 0; i <= n; ++i)
+            for (int j = 0; i + j <= n; j += 4) {
+                const V4 jv = V4(float(j)) + lane;
+                for (int c = 0; c < 3; ++c)
+                    alphax[c] = V4(pre[c][i]) + (Load4(&pre[c][i + j]) - V4(pre[c][i])) * V4(0.5f);
+                consider(alphax, V4(float(i)) + jv * V4(0.25f), V4(float(n - i)) - jv * V4(0.75f),
+                         jv * V4(0.25f), std::min(4, n - i - j + 1));
+            }
+    }
+    if (bestError == FLT_MAX) return false;
+
+    for (int k = 0; k < 3; ++k) {
+        start[k] = bestA[k] * 255.f;
+        end[k]   = bestB[k] * 255.f;
+    }
+    return true;
+}
+
+// BC1 when bc1, else the colour half of BC2/BC3 (four colours only)
+void ColourBlock(const unsigned char* bgra, unsigned char* out, bool bc1, Quality quality)
+{
+    Texels t;
+    t.clear = 0;
+    int used[16], n = 0;
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 3; ++k) t.c[k][i] = bgra[4 * i + k];
+        if (bc1 && bgra[4 * i + 3] < 128)
+            t.clear |= 1u << i;
+        else
+            used[n++] = i;
+    }
+    if (n == 0) {                      // fully transparent
+        Put16(out, 0);
+        Put16(out + 2, 0);
+        Put32(out + 4, 0xFFFFFFFFu);
+        return;
+    }
+    const bool mustThree = t.clear != 0;
+
+    // Range fit: the texels furthest apart along the principal axis
+    float mean[3], axis[3], proj[16];
+    PrincipalAxis(t, used, n, mean, axis);
+    int lo = 0, hi = 0;
+    for (int i = 0; i < n; ++i) {
+        const int s = used[i];
+        proj[i] = (t.c[0][s] - mean[0]) * axis[0] + (t.c[1][s] - mean[1]) * axis[1] +
+                  (t.c[2][s] - mean[2]) * axis[2];
+        if (proj[i] < proj[lo]) lo = i;
+        if (proj[i] > proj[hi]) hi = i;
+    }
+    const float pa[3] = { float(t.c[0][used[hi]]), float(t.c[1][used[hi]]), float(t.c[2][used[hi]]) };
+    const float pb[3] = { float(t.c[0][used[lo]]), float(t.c[1][used[lo]]), float(t.c[2][used[lo]]) };
+    Candidate best = Try(t, To565(pa), To565(pb), !mustThree, bc1);
+
+    if (quality == QUALITY_CLUSTER && n > 1 && best.error > 0) {
+        int sorted[16];
+        std::copy(used, used + n, sorted);
+        std::sort(sorted, sorted + n, [&](int a, int b) {
+            return (t.c[0][a] - t.c[0][b]) * axis[0] + (t.c[1][a] - t.c[1][b]) * axis[1] +
+                   (t.c[2][a] - t.c[2][b]) * axis[2] < 0;
+        });
+        float s[3], e[3];
+        if (!mustThree && ClusterFit(t, sorted, n, true, s, e)) {
+            const Candidate c = Try(t, To565(s), To565(e), true, bc1);
+            if (c.error < best.error) best = c;
+        }
+        if (bc1 && ClusterFit(t, sorted, n, false, s, e)) {
+            const Candidate c = Try(t, To565(s), To565(e), false, bc1);
+            if (c.error < best.error) best = c;
+        }
+    }
+
+    Put16(out, best.c0);
+    Put16(out + 2, best.c1);
+    Put32(out + 4, best.bits);
+}
+
+// -----------------------------------------------------------------------------
+//  One channel on the 8-entry ramp: BC3 alpha, BC4, each half of BC5
+// -----------------------------------------------------------------------------
+
+// Indices against the ramp ChannelBlock() decodes from a0, a1; returns
+// the squared error
+int RampIndices(const unsigned char v[16], int a0, int a1, uint64_t& bits)
+{
+    unsigned char lut[8] = { uint8_t(a0), uint8_t(a1) };
+    if (a0 > a1) {
+        for (int k = 1; k <= 6; ++k) lut[1 + k] = uint8_t(((7 - k) * a0 + k * a1) / 7);
+    } else {
+        for (int k = 1; k <= 4; ++k) lut[1 + k] = uint8_t(((5 - k) * a0 + k * a1) / 5);
+        lut[6] = 0;
+        lut[7] = 255;
+    }
+
+    unsigned char idx[16], dist[16];
+#ifdef BC_SSE2
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v));
+    __m128i best = _mm_set1_epi8(char(0xFF)), at = _mm_setzero_si128();
+    for (int k = 0; k < 8; ++k) {
+        const __m128i l = _mm_set1_epi8(char(lut[k]));
+        const __m128i d = _mm_or_si128(_mm_subs_epu8(x, l), _mm_subs_epu8(l, x));
+        const __m128i m = _mm_min_epu8(d, best);
+        const __m128i less = _mm_andnot_si128(_mm_cmpeq_epi8(m, best), _mm_set1_epi8(char(0xFF)));
+        best = m;
+        at   = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi8(char(k))), _mm_andnot_si128(less, at));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(idx), at);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dist), best);
+    const __m128i lo = _mm_unpacklo_epi8(best, _mm_setzero_si128());
+    const __m128i hi = _mm_unpackhi_epi8(best, _mm_setzero_si128());
+    __m128i sq = _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi));
+    sq = _mm_add_epi32(sq, _mm_shuffle_epi32(sq, _MM_SHUFFLE(1, 0, 3, 2)));
+    sq = _mm_add_epi32(sq, _mm_shuffle_epi32(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    const int error = _mm_cvtsi128_si32(sq);
+#else
+    int error = 0;
+    for (int i = 0; i < 16; ++i) {
+        dist[i] = 255;
+        idx[i]  = 0;
+        for (int k = 0; k < 8; ++k) {
+            const int d = std::abs(int(v[i]) - lut[k]);
+            if (d < dist[i]) { dist[i] = uint8_t(d); idx[i] = uint8_t(k); }
+        }
+        error += dist[i] * dist[i];
+    }
+#endif
+    bits = 0;
+    for (int i = 15; i >= 0; --i) bits = (bits << 3) | idx[i];
+    return error;
+}
+
+void ChannelBlock(const unsigned char v[16], unsigned char* out, Quality quality)
+{
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, int(v[i]));
+        hi = std::max(hi, int(v[i]));
+    }
+
+    int a0 = hi, a1 = lo;
+    uint64_t bits;
+    int best = RampIndices(v, a0, a1, bits);
+
+    if (quality == QUALITY_CLUSTER && best > 0) {
+        // Pulled-in endpoints often fit the inner values better
+        for (int d0 = 0; d0 <= 2; ++d0)
+            for (int d1 = 0; d1 <= 2; ++d1) {
+                const int c0 = hi - d0, c1 = lo + d1;
+                if ((d0 | d1) == 0 || c0 <= c1) continue;
+                uint64_t b;
+                const int e = RampIndices(v, c0, c1, b);
+                if (e < best) { best = e; bits = b; a0 = c0; a1 = c1; }
+            }
+
+        // Six steps between the values that are not 0 or 255, which the
+        // ramp then has exactly
+        int lo6 = 255, hi6 = 0;
+        for (int i = 0; i < 16; ++i)
+            if (v[i] != 0 && v[i] != 255) {
+                lo6 = std::min(lo6, int(v[i]));
+                hi6 = std::max(hi6, int(v[i]));
+            }
+        if (lo6 <= hi6) {
+            uint64_t b;
+            const int e = RampIndices(v, lo6, hi6, b);
+            if (e < best) { best = e; bits = b; a0 = lo6; a1 = hi6; }
+        }
+    }
+
+    out[0] = uint8_t(a0);
+    out[1] = uint8_t(a1);
+    for (int i = 0; i < 6; ++i) out[2 + i] = uint8_t(bits >> (8 * i));
+}
+
+// -----------------------------------------------------------------------------
+
+// The 4x4 block at bx, by as BGRA; edge blocks repeat the last texels
+void LoadBlock(const Source& src, int w, int h, int bx, int by, unsigned char bgra[64])
+{
+    const bool whole = bx * 4 + 4 <= w && by * 4 + 4 <= h;
+    for (int py = 0; py < 4; ++py) {
+        const unsigned char* row = src.data + size_t(std::min(by * 4 + py, h - 1)) * src.stride;
+        unsigned char* d = bgra + py * 16;
+        if (whole) {
+            std::memcpy(d, row + size_t(bx) * 16, 16);
+        } else {
+            for (int px = 0; px < 4; ++px)
+                std::memcpy(d + px * 4, row + size_t(std::min(bx * 4 + px, w - 1)) * 4, 4);
+        }
+    }
+    if (src.order == ORDER_RGBA)
+        for (int i = 0; i < 64; i += 4) std::swap(bgra[i], bgra[i + 2]);
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+void EncodeBlock(Format fmt, const unsigned char bgra[64], unsigned char* out, Quality quality)
+{
+    unsigned char ch[16];
+    switch (fmt) {
+        case FMT_BC1:
+            ColourBlock(bgra, out, true, quality);
+            break;
+        case FMT_BC2:
+            for (int i = 0; i < 8; ++i)
+                out[i] = uint8_t((bgra[8 * i + 3] + 8) / 17 | ((bgra[8 * i + 7] + 8) / 17) << 4);
+            ColourBlock(bgra, out + 8, false, quality);
+            break;
+        case FMT_BC3:
+            for (int i = 0; i < 16; ++i) ch[i] = bgra[4 * i + 3];
+            ChannelBlock(ch, out, quality);
+            ColourBlock(bgra, out + 8, false, quality);
+            break;
+        case FMT_BC4:
+            for (int i = 0; i < 16; ++i) ch[i] = bgra[4 * i + 2];
+            ChannelBlock(ch, out, quality);
+            break;
+        case FMT_BC5:
+            for (int i = 0; i < 16; ++i) ch[i] = bgra[4 * i];
+            ChannelBlock(ch, out, quality);
+            for (int i = 0; i < 16; ++i) ch[i] = bgra[4 * i + 1];
+            ChannelBlock(ch, out + 8, quality);
+            break;
+        default:
+            break;
+    }
+}
+
+Result Encode(Format fmt, const Source& src, int w, int h, unsigned char* dst, size_t dstBytes,
+              Quality quality, int threads, const CancelFn& cancelled)
+{
+    if (!src.data || !dst || w <= 0 || h <= 0 || src.stride < size_t(w) * 4)
+        return ERR_ARGUMENT;
+    const size_t bb = BlockBytes(fmt);
+    if (!bb) return ERR_FORMAT;
+    if (dstBytes < LevelBytes(fmt, w, h)) return ERR_ARGUMENT;
+
+    const int rows = (h + 3) / 4, cols = (w + 3) / 4;
+    if (threads <= 0) threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, rows);
+
+    // Rows are handed out one at a time, so a slow (busy) row does not hold
+    // up a fixed share of the image
+    std::atomic<int>  next(0);
+    std::atomic<bool> stop(false);
+    auto work = [&] {
+        unsigned char bgra[64];
+        for (int by; !stop.load(std::memory_order_relaxed) && (by = next.fetch_add(1)) < rows; ) {
+            if (cancelled && cancelled()) {
+                stop = true;
+                break;
+            }
+            unsigned char* out = dst + size_t(by) * cols * bb;
+            for (int bx = 0; bx < cols; ++bx, out += bb) {
+                LoadBlock(src, w, h, bx, by, bgra);
+                EncodeBlock(fmt, bgra, out, quality);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i) {
+        try {
+            pool.push_back(std::thread(work));
+        } catch (...) {
+            break;                     // fewer threads; this one still works
+        }
+    }
+    work();
+    for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+    return stop ? ERR_CANCELLED : OK;
+}
+
+Result EncodeDDS(Format fmt, const Source& src, int w, int h, std::vector<unsigned char>& out,
+                 Quality quality, int threads, const CancelFn& cancelled)
+{
+    if (!FormatFourCC(fmt)) return ERR_FORMAT;
+    if (w <= 0 || h <= 0) return ERR_ARGUMENT;
+    const size_t bytes = LevelBytes(fmt, w, h);
+
+    DDSHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.magic             = 0x20534444;   // "DDS "
+    hdr.size              = 124;
+    hdr.flags             = 0x81007;      // caps, height, width, pixel format, linear size
+    hdr.width             = unsigned(w);
+    hdr.height            = unsigned(h);
+    hdr.pitchOrLinearSize = unsigned(bytes);
+    hdr.mipMapCount       = 1;
+    hdr.pf.size           = 32;
+    hdr.pf.flags          = 0x4;          // FourCC
+    hdr.pf.fourCC         = FormatFourCC(fmt);
+    hdr.caps              = 0x1000;       // texture
+
+    out.resize(sizeof(hdr) + bytes);
+    std::memcpy(&out[0], &hdr, sizeof(hdr));
+    const Result r = Encode(fmt, src, w, h, &out[sizeof(hdr)], bytes, quality, threads, cancelled);
+    if (r != OK) out.clear();
+    return r;
+}
+
+} // namespace TextureCodec
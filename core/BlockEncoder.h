@@ -0,0 +1,55 @@
+// -----------------------------------------------------------------------------
+//  BlockEncoder.h – BC1-BC5 compression, the inverse of TextureCodec::Decode
+//
+//  Two colour fits:
+//    QUALITY_RANGE    endpoints where the block's principal axis leaves its
+//                     bounding box; one pass, meant for whole folders
+//    QUALITY_CLUSTER  every ordered split of the 16 texels into the palette
+//                     entries, least-squares endpoints for each, best kept;
+//                     several times slower, noticeably cleaner gradients
+//  Alpha, BC4 and BC5 channels always use the 8-value ramp; QUALITY_CLUSTER
+//  also tries the 6-value ramp with 0 / 255 and nudged endpoints.  Indices
+//  are picked against the palette exactly as the decoder rebuilds it, so a
+//  decode reproduces what the error was measured on.
+//
+//  Rows of blocks are shared out over threads (0: one per core), and the
+//  per-block kernels use SSE2 where the compiler targets it.  Input is any
+//  stride and channel order; BC4 takes red and BC5 takes the channel Decode
+//  puts X into, so Encode(Decode(x)) compresses the same data again.
+// -----------------------------------------------------------------------------
+#ifndef BLOCKENCODER_H
+#define BLOCKENCODER_H
+
+#include "TextureCodec.h"
+#include <vector>
+
+namespace TextureCodec {
+
+enum Quality { QUALITY_RANGE, QUALITY_CLUSTER };
+
+struct Source
+{
+    const unsigned char* data;         // top-left texel
+    size_t               stride;       // bytes from one row to the next, >= 4 * w
+    Order                order;
+    Source(const unsigned char* d, size_t s, Order o = ORDER_BGRA) : data(d), stride(s), order(o) {}
+};
+
+// w x h texels of src as fmt (BC1 to BC5) into dst, which holds at least
+// LevelBytes(fmt, w, h).  Partial edge blocks repeat their last row and
+// column.  BC1 turns texels with alpha under 128 transparent.
+Result Encode(Format fmt, const Source& src, int w, int h, unsigned char* dst, size_t dstBytes,
+              Quality quality = QUALITY_RANGE, int threads = 0,
+              const CancelFn& cancelled = CancelFn());
+
+// Encode() wrapped as a one-level DDS file (DXT1/3/5, ATI1/2), replacing out
+Result EncodeDDS(Format fmt, const Source& src, int w, int h, std::vector<unsigned char>& out,
+                 Quality quality = QUALITY_RANGE, int threads = 0,
+                 const CancelFn& cancelled = CancelFn());
+
+// One 4x4 block: 16 texels, BGRA, row by row
+void EncodeBlock(Format fmt, const unsigned char bgra[64], unsigned char* out, Quality quality);
+
+} // namespace TextureCodec
+
+#endif // BLOCKENCODER_H
@@ -0,0 +1,581 @@
+// -----------------------------------------------------------------------------
+//  TextureCodec.cpp – span parsing, Xbox 360 layout and the block decoders
+// -----------------------------------------------------------------------------
+#include "TextureCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace TextureCodec {
+
+namespace {
+
+const uint32_t FOURCC_DDS = 0x20534444;    // "DDS " as read little-endian
+
+uint32_t Fourcc(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 |
+           uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+}
+
+uint16_t Le16(const unsigned char* p) { return uint16_t(p[0] | p[1] << 8); }
+uint32_t Le32(const unsigned char* p) { return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24; }
+uint32_t Be32(const unsigned char* p) { return uint32_t(p[3]) | uint32_t(p[2]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[0]) << 24; }
+
+// 5- and 6-bit channels to 8 bits
+struct Tables
+{
+    unsigned char e5[32], e6[64];
+    Tables() {
+        for (int i = 0; i < 32; ++i) e5[i] = static_cast<unsigned char>((i << 3) | (i >> 2));
+        for (int i = 0; i < 64; ++i) e6[i] = static_cast<unsigned char>((i << 2) | (i >> 4));
+    }
+};
+const Tables LUT;
+
+// -----------------------------------------------------------------------------
+//  One 4x4 block into out (4 rows, stride apart).  B is the byte of blue
+//  in the output order, 2 - B that of red.
+// -----------------------------------------------------------------------------
+
+// BC1 colour, also the colour half of BC2/BC3.  BC1 has three colours and
+// transparent black when c0 <= c1; BC2/BC3 (fourColour) always have four.
+void ColourBlock(const unsigned char* s, int B, unsigned char* out, size_t stride, bool fourColour)
+{
+    const unsigned c0 = Le16(s), c1 = Le16(s + 2);
+    const int e0[3] = { LUT.e5[c0 & 31], LUT.e6[(c0 >> 5) & 63], LUT.e5[c0 >> 11] };
+    const int e1[3] = { LUT.e5[c1 & 31], LUT.e6[(c1 >> 5) & 63], LUT.e5[c1 >> 11] };
+    const int at[3] = { B, 1, 2 - B };
+    const bool four = fourColour || c0 > c1;
+
+    unsigned char clr[4][4];
+    for (int k = 0; k < 3; ++k) {
+        clr[0][at[k]] = static_cast<unsigned char>(e0[k]);
+        clr[1][at[k]] = static_cast<unsigned char>(e1[k]);
+        if (four) {
+            clr[2][at[k]] = static_cast<unsigned char>((2 * e0[k] + e1[k]) / 3);
+            clr[3][at[k]] = static_cast<unsigned char>((e0[k] + 2 * e1[k]) / 3);
+        } else {
+            clr[2][at[k]] = static_cast<unsigned char>((e0[k] + e1[k]) / 2);
+            clr[3][at[k]] = 0;
+        }
+    }
+    clr[0][3] = clr[1][3] = clr[2][3] = 255;
+    clr[3][3] = four ? 255 : 0;
+
+    uint32_t idx = Le32(s + 4);
+    for (int py = 0; py < 4; ++py) {
+        unsigned char* d = out + py * stride;
+        for (int px = 0; px < 4; ++px, idx >>= 2, d += 4)
+            std::memcpy(d, clr[idx & 3], 4);
+    }
+}
+
+// BC3 alpha / BC4 / BC5 channel: 8-entry ramp, 3-bit indices, into byte ch
+void ChannelBlock(const unsigned char* s, int ch, unsigned char* out, size_t stride)
+{
+    const int a0 = s[0], a1 = s[1];
+    unsigned char lut[8] = { s[0], s[1] };
+    if (a0 > a1) {
+        for (int k = 1; k <= 6; ++k) lut[1 + k] = static_cast<unsigned char>(((7 - k) * a0 + k * a1) / 7);
+    } else {
+        for (int k = 1; k <= 4; ++k) lut[1 + k] = static_cast<unsigned char>(((5 - k) * a0 + k * a1) / 5);
+        lut[6] = 0;
+        lut[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) bits |= uint64_t(s[2 + i]) << (8 * i);
+    for (int py = 0; py < 4; ++py) {
+        unsigned char* d = out + py * stride + ch;
+        for (int px = 0; px < 4; ++px, bits >>= 3, d += 4)
+            *d = lut[bits & 7];
+    }
+}
+
+void DecodeBlock(Format fmt, const unsigned char* s, int B, unsigned char* out, size_t stride)
+{
+    switch (fmt) {
+        case FMT_BC1:
+            ColourBlock(s, B, out, stride, false);
+            break;
+        case FMT_BC2:
+            ColourBlock(s + 8, B, out, stride, true);
+            for (int i = 0; i < 16; ++i)
+                out[(i / 4) * stride + (i % 4) * 4 + 3] =
+                    static_cast<unsigned char>(((s[i / 2] >> (4 * (i & 1))) & 15) * 17);
+            break;
+        case FMT_BC3:
+            ColourBlock(s + 8, B, out, stride, true);
+            ChannelBlock(s, 3, out, stride);
+            break;
+        case FMT_BC4:
+            ChannelBlock(s, 0, out, stride);
+            for (int py = 0; py < 4; ++py) {
+                unsigned char* d = out + py * stride;
+                for (int px = 0; px < 4; ++px, d += 4) {
+                    d[1] = d[2] = d[0];
+                    d[3] = 255;
+                }
+            }
+            break;
+        case FMT_BC5:
+            ChannelBlock(s, B, out, stride);
+            ChannelBlock(s + 8, 1, out, stride);
+            for (int py = 0; py < 4; ++py) {
+                unsigned char* d = out + py * stride;
+                for (int px = 0; px < 4; ++px, d += 4) {
+                    d[2 - B] = 127;
+                    d[3] = 255;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  Xbox 360 tiled addressing (adjusted for non-power-of-two sizes)
+// -----------------------------------------------------------------------------
+typedef std::shared_ptr<const std::vector<uint32_t> > TileMap;
+
+uint32_t NextPowerOf2(uint32_t value)
+{
+    if (value == 0) return 1;
+    value--;
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+    return value + 1;
+}
+
+// Macro tiles are 32 blocks wide; narrower levels still span one
+uint32_t MacroPitch(uint32_t widthInBlocks)
+{
+    return std::max<uint32_t>(NextPowerOf2(widthInBlocks) >> 5, 1);
+}
+
+// Blocks along one side of the tiled area: a power of two, and never less
+// than one 32-block macro tile, which the addressing always spans
+uint32_t TiledSide(uint32_t blocks)
+{
+    return std::max<uint32_t>(NextPowerOf2(blocks), 32);
+}
+
+uint32_t TiledX(uint32_t blockOffset, uint32_t widthInBlocks, uint32_t texelBytePitch)
+{
+    const uint32_t logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
+    const uint32_t offsetByte = blockOffset << logBpp;
+    const uint32_t offsetTile = ((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F);
+    const uint32_t offsetMacro = offsetTile >> (7 + logBpp);
+
+    const uint32_t macroX = ((offsetMacro % MacroPitch(widthInBlocks)) << 2);
+    const uint32_t tile = ((((offsetTile >> (5 + logBpp)) & 2) + (offsetByte >> 6)) & 3);
+    const uint32_t macro = (macroX + tile) << 3;
+    const uint32_t micro = (((((offsetTile >> 1) & ~0xF) + (offsetTile & 0xF)) & ((texelBytePitch << 3) - 1))) >> logBpp;
+    return macro + micro;
+}
+
+uint32_t TiledY(uint32_t blockOffset, uint32_t widthInBlocks, uint32_t texelBytePitch)
+{
+    const uint32_t logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
+    const uint32_t offsetByte = blockOffset << logBpp;
+    const uint32_t offsetTile = ((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F);
+    const uint32_t offsetMacro = offsetTile >> (7 + logBpp);
+
+    const uint32_t macroY = ((offsetMacro / MacroPitch(widthInBlocks)) << 2);
+    const uint32_t tile = ((offsetTile >> (6 + logBpp)) & 1) + (((offsetByte & 0x800) >> 10));
+    const uint32_t macro = (macroY + tile) << 3;
+    const uint32_t micro = (((offsetTile & (((texelBytePitch << 6) - 1) & ~0x1F)) + ((offsetTile & 0xF) << 1)) >> (3 + logBpp)) & ~1;
+    return macro + micro + ((offsetTile & 0x10) >> 4);
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+const char* ResultText(Result r)
+{
+    switch (r) {
+        case OK:            return "ok";
+        case ERR_ARGUMENT:  return "bad argument";
+        case ERR_SIGNATURE: return "not a DDS or BCT file";
+        case ERR_HEADER:    return "damaged header";
+        case ERR_TRUNCATED: return "data is truncated";
+        case ERR_FORMAT:    return "unsupported format";
+        case ERR_CANCELLED: return "cancelled";
+    }
+    return "";
+}
+
+size_t BlockBytes(Format fmt)
+{
+    switch (fmt) {
+        case FMT_BC1: case FMT_BC4:                return 8;
+        case FMT_BC2: case FMT_BC3: case FMT_BC5:  return 16;
+        default:                                   return 0;
+    }
+}
+
+size_t LevelBytes(Format fmt, int w, int h)
+{
+    if (w <= 0 || h <= 0) return 0;
+    if (const size_t bb = BlockBytes(fmt))
+        return size_t((w + 3) / 4) * ((h + 3) / 4) * bb;
+    switch (fmt) {
+        case FMT_BGRA8: return size_t(w) * h * 4;
+        case FMT_PAL8:  return 256 * 4 + size_t(w) * h;
+        default:        return 0;
+    }
+}
+
+Result Decode(Format fmt, const Span& src, int w, int h, const Target& dst,
+              const CancelFn& cancelled)
+{
+    if (!src.data || !dst.data || w <= 0 || h <= 0 || dst.stride < size_t(w) * 4)
+        return ERR_ARGUMENT;
+    const size_t need = LevelBytes(fmt, w, h);
+    if (!need) return ERR_FORMAT;
+    if (src.size < need) return ERR_TRUNCATED;
+
+    const int B = dst.order == ORDER_RGBA ? 2 : 0;
+
+    if (const size_t bb = BlockBytes(fmt))
+    {
+        // Whole blocks go straight to dst; edge blocks through a scratch
+        // block so nothing past w x h is touched
+        const unsigned char* s = src.data;
+        unsigned char edge[64];
+        for (int by = 0; by < (h + 3) / 4; ++by)
+        {
+            if (cancelled && cancelled()) return ERR_CANCELLED;
+            const int rows = std::min(4, h - by * 4);
+            unsigned char* row = dst.data + size_t(by) * 4 * dst.stride;
+            for (int bx = 0; bx < (w + 3) / 4; ++bx, s += bb)
+            {
+                const int cols = std::min(4, w - bx * 4);
+                unsigned char* out = row + size_t(bx) * 16;
+                if (rows == 4 && cols == 4) {
+                    DecodeBlock(fmt, s, B, out, dst.stride);
+                } else {
+                    DecodeBlock(fmt, s, B, edge, 16);
+                    for (int r = 0; r < rows; ++r)
+                        std::memcpy(out + r * dst.stride, edge + r * 16, size_t(cols) * 4);
+                }
+            }
+        }
+        return OK;
+    }
+
+    // 32-bit texels are stored BGRA; the palette's entries too
+    const unsigned char* pal = src.data;
+    const unsigned char* s   = fmt == FMT_PAL8 ? src.data + 256 * 4 : src.data;
+    for (int y = 0; y < h; ++y)
+    {
+        if ((y & 63) == 0 && cancelled && cancelled()) return ERR_CANCELLED;
+        unsigned char* d = dst.data + size_t(y) * dst.stride;
+        if (fmt == FMT_BGRA8) {
+            if (B == 0) {
+                std::memcpy(d, s, size_t(w) * 4);
+                s += size_t(w) * 4;
+            } else {
+                for (int x = 0; x < w; ++x, s += 4, d += 4) {
+                    d[0] = s[2]; d[1] = s[1]; d[2] = s[0]; d[3] = s[3];
+                }
+            }
+        } else {
+            for (int x = 0; x < w; ++x, ++s, d += 4) {
+                const unsigned char* c = pal + *s * 4;
+                d[B] = c[0]; d[1] = c[1]; d[2 - B] = c[2]; d[3] = c[3];
+            }
+        }
+    }
+    return OK;
+}
+
+// -----------------------------------------------------------------------------
+
+void FlipByteOrder16(unsigned char* data, size_t bytes)
+{
+    for (size_t i = 0; i + 1 < bytes; i += 2)
+        std::swap(data[i], data[i + 1]);
+}
+
+size_t TiledLevelBytes(size_t blockBytes, int w, int h)
+{
+    return size_t(TiledSide((w + 3) / 4)) * TiledSide((h + 3) / 4) * blockBytes;
+}
+
+TileMap Xbox360TileMap(int w, int h, size_t blockBytes)
+{
+    static std::mutex                  lock;
+    static std::map<uint64_t, TileMap> maps;
+    const size_t MAX_MAPS = 64;        // a few chains' worth of level shapes
+
+    const uint32_t widthInBlocks  = uint32_t(w + 3) / 4;
+    const uint32_t heightInBlocks = uint32_t(h + 3) / 4;
+    const uint64_t key = uint64_t(widthInBlocks) << 32 | uint64_t(heightInBlocks) << 8 | blockBytes;
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        std::map<uint64_t, TileMap>::const_iterator it = maps.find(key);
+        if (it != maps.end()) return it->second;
+    }
+
+    // Built outside the lock; two threads racing on one shape build the
+    // same map and the first to finish is kept
+    const uint32_t pitch = uint32_t(blockBytes);
+    const uint32_t total = TiledSide(widthInBlocks) * TiledSide(heightInBlocks);
+    std::shared_ptr<std::vector<uint32_t> > map(new std::vector<uint32_t>(total, TILE_PADDING));
+    for (uint32_t t = 0; t < total; ++t) {
+        const uint32_t x = TiledX(t, widthInBlocks, pitch);
+        const uint32_t y = TiledY(t, widthInBlocks, pitch);
+        if (x < widthInBlocks && y < heightInBlocks)
+            (*map)[t] = y * widthInBlocks + x;
+    }
+
+    std::lock_guard<std::mutex> hold(lock);
+    if (maps.size() >= MAX_MAPS) maps.clear();
+    return maps.insert(std::make_pair(key, TileMap(map))).first->second;
+}
+
+Result UntileXbox360(const unsigned char* tiled, size_t tiledBytes, unsigned char* linear,
+                     int w, int h, size_t blockBytes)
+{
+    if (!linear || w <= 0 || h <= 0 || (blockBytes != 8 && blockBytes != 16))
+        return ERR_ARGUMENT;
+
+    const TileMap map = Xbox360TileMap(w, h, blockBytes);
+    std::memset(linear, 0, size_t((w + 3) / 4) * ((h + 3) / 4) * blockBytes);
+    const size_t have = tiled ? tiledBytes / blockBytes : 0;   // whole tiled blocks given
+
+    bool whole = true;
+    for (size_t t = 0; t < map->size(); ++t)
+    {
+        const uint32_t to = (*map)[t];
+        if (to == TILE_PADDING) continue;
+        if (t >= have) {
+            whole = false;
+            continue;
+        }
+        std::memcpy(linear + size_t(to) * blockBytes, tiled + t * blockBytes, blockBytes);
+    }
+    return whole ? OK : ERR_TRUNCATED;
+}
+
+Result TileXbox360(const unsigned char* linear, int w, int h, size_t blockBytes,
+                   unsigned char* tiled, size_t tiledBytes)
+{
+    if (!linear || !tiled || w <= 0 || h <= 0 || (blockBytes != 8 && blockBytes != 16))
+        return ERR_ARGUMENT;
+    if (tiledBytes < TiledLevelBytes(blockBytes, w, h))
+        return ERR_ARGUMENT;
+
+    // Written front to back, so the output streams out in one pass
+    const TileMap map = Xbox360TileMap(w, h, blockBytes);
+    for (size_t t = 0; t < map->size(); ++t, tiled += blockBytes)
+    {
+        const uint32_t from = (*map)[t];
+        if (from == TILE_PADDING)
+            std::memset(tiled, 0, blockBytes);
+        else
+            std::memcpy(tiled, linear + size_t(from) * blockBytes, blockBytes);
+    }
+    return OK;
+}
+
+// -----------------------------------------------------------------------------
+
+int BctToDxgi(int bctFormat)
+{
+    switch (bctFormat) {
+        case 0x00: return 28;  // R8G8B8A8_UNORM
+        case 0x08: return 71;  // BC1_UNORM ('DXT1')
+        case 0x0A: return 77;  // BC3_UNORM ('DXT5')
+        case 0x25: return 80;  // BC4_UNORM ('ATI1')
+        case 0x26: return 83;  // BC5_UNORM ('ATI2')
+        case 0x27: return 95;  // BC6H_UF16 (DX10 only)
+        case 0x28: return 98;  // BC7_UNORM (DX10 only)
+        case 0x30: return 71;  // Alias : BC1_UNORM
+        case 0x32: return 77;  // Alias : BC3_UNORM
+        case 0x35: return 28;  // Alias : RGBA8
+        default:   return 0;   // UNKNOWN
+    }
+}
+
+// 0 is what an unknown BCT format maps to; the viewer has always read
+// those as 8-bit palette images
+Format DxgiFormat(int dxgi)
+{
+    switch (dxgi) {
+        case 0:          return FMT_PAL8;
+        case 28:         return FMT_BGRA8;
+        case 71:         return FMT_BC1;
+        case 10: case 77: return FMT_BC3;
+        case 80:         return FMT_BC4;
+        case 83:         return FMT_BC5;
+        default:         return FMT_NONE;
+    }
+}
+
+Format FourCCFormat(uint32_t fourCC, unsigned rgbBitCount)
+{
+    if (fourCC == Fourcc('D','X','T','1')) return FMT_BC1;
+    if (fourCC == Fourcc('D','X','T','3')) return FMT_BC2;
+    if (fourCC == Fourcc('D','X','T','5')) return FMT_BC3;
+    if (fourCC == Fourcc('A','T','I','1')) return FMT_BC4;
+    if (fourCC == Fourcc('A','T','I','2')) return FMT_BC5;
+    return rgbBitCount == 32 ? FMT_BGRA8 : FMT_NONE;
+}
+
+uint32_t FormatFourCC(Format fmt)
+{
+    switch (fmt) {
+        case FMT_BC1: return Fourcc('D','X','T','1');
+        case FMT_BC2: return Fourcc('D','X','T','3');
+        case FMT_BC3: return Fourcc('D','X','T','5');
+        case FMT_BC4: return Fourcc('A','T','I','1');
+        case FMT_BC5: return Fourcc('A','T','I','2');
+        default:      return 0;
+    }
+}
+
+int PickLevel(int w, int h, int count, int minSide, bool blocks, bool console,
+              const std::function<bool(int)>& usable)
+{
+    if (minSide <= 0) return 0;
+    int level = 0;
+    for (int i = 1; i < count && i < 16; ++i)
+    {
+        const int lw = std::max(w >> i, 1), lh = std::max(h >> i, 1);
+        if (std::max(lw, lh) < minSide) break;
+        if (blocks && ((lw | lh) & 3)) break;
+        if (console && std::min(lw, lh) < 32) break;
+        if (usable && !usable(i)) break;
+        level = i;
+    }
+    return level;
+}
+
+// -----------------------------------------------------------------------------
+//  Containers.  A DDS keeps its levels back to back after the 128-byte
+//  header; a BCT has a 20-byte header whose mip table says where each is.
+// -----------------------------------------------------------------------------
+namespace {
+
+Result ParseDDS(const Span& file, int minSide, Level& out)
+{
+    DDSHeader hdr;
+    if (file.size < sizeof(hdr)) return ERR_TRUNCATED;
+    std::memcpy(&hdr, file.data, sizeof(hdr));
+    if (hdr.size != 124 || hdr.pf.size != 32 || !hdr.width || !hdr.height)
+        return ERR_HEADER;
+
+    out.kind   = Level::KIND_DDS;
+    out.width  = int(hdr.width);
+    out.height = int(hdr.height);
+    out.mips   = hdr.mipMapCount ? int(hdr.mipMapCount) : 1;
+    out.format = hdr.pf.fourCC;
+    out.layout = FourCCFormat(hdr.pf.fourCC, hdr.pf.rgbBitCount);
+    if (out.layout == FMT_NONE) return ERR_FORMAT;
+
+    out.level  = PickLevel(out.width, out.height, out.mips, minSide,
+                           BlockBytes(out.layout) != 0, false);
+    out.offset = sizeof(hdr);
+    for (int i = 0; i < out.level; ++i)
+        out.offset += LevelBytes(out.layout, std::max(out.width >> i, 1), std::max(out.height >> i, 1));
+    out.levelW = std::max(out.width  >> out.level, 1);
+    out.levelH = std::max(out.height >> out.level, 1);
+    out.bytes  = LevelBytes(out.layout, out.levelW, out.levelH);
+    return out.offset + out.bytes <= file.size ? OK : ERR_TRUNCATED;
+}
+
+Result ParseBCT(const Span& file, int minSide, Level& out)
+{
+    if (file.size < 20) return ERR_TRUNCATED;
+    const unsigned char* p = file.data;
+
+    // Width, height and the table address are little-endian on PC; an
+    // address beyond 16 MB means the file is a big-endian console one
+    uint32_t infoAddr = Le32(p + 16);
+    out.bigEndian = infoAddr > 16777216;
+    if (out.bigEndian) infoAddr = Be32(p + 16);
+    out.kind   = Level::KIND_BCT;
+    out.width  = out.bigEndian ? (p[4] << 8 | p[5]) : Le16(p + 4);
+    out.height = out.bigEndian ? (p[6] << 8 | p[7]) : Le16(p + 6);
+    out.mips   = p[10];
+    out.format = uint32_t(BctToDxgi(p[8]));
+    out.layout = DxgiFormat(int(out.format));
+    if (!out.width || !out.height) return ERR_HEADER;
+    if (out.layout == FMT_NONE) return ERR_FORMAT;
+
+    // Only mip 0's entry unless a smaller level is asked for
+    const int count = (minSide > 0 && out.mips > 1) ? out.mips : 1;
+    if (infoAddr + size_t(count) * 16 > file.size) return ERR_TRUNCATED;
+    auto entry = [&](int i, size_t& addr, size_t& size) {
+        const unsigned char* e = p + infoAddr + size_t(i) * 16;
+        addr = out.bigEndian ? Be32(e)     : Le32(e);
+        size = out.bigEndian ? Be32(e + 4) : Le32(e + 4);
+        return addr != 0 && size != 0;
+    };
+
+    size_t addr, size;
+    if (!entry(0, addr, size)) return ERR_HEADER;
+    out.level = PickLevel(out.width, out.height, count, minSide, true, out.bigEndian,
+                          [&](int i) { size_t a, s; return entry(i, a, s); });
+    entry(out.level, addr, size);
+    out.levelW = std::max(out.width  >> out.level, 1);
+    out.levelH = std::max(out.height >> out.level, 1);
+
+    // The stored DXT5 size is not to be trusted; console levels are tiled
+    // and padded, as far as the file goes
+    if (p[8] == 0x0A)
+        size = out.bigEndian ? std::min(TiledLevelBytes(16, out.levelW, out.levelH),
+                                        file.size - std::min(addr, file.size))
+                             : LevelBytes(FMT_BC3, out.levelW, out.levelH);
+    out.offset = addr;
+    out.bytes  = size;
+    return addr + size <= file.size ? OK : ERR_TRUNCATED;
+}
+
+} // anon-ns
+
+Result Parse(const Span& file, int minSide, Level& out)
+{
+    out = Level();
+    if (!file.data || file.size < 4) return ERR_ARGUMENT;
+
+    // The signature the browser sniffs, read big-endian
+    const uint32_t sig = Be32(file.data);
+    if (Le32(file.data) == FOURCC_DDS)
+        return ParseDDS(file, minSide, out);
+    if (sig == 0x07010220 || (sig & 0x00FFFF00) == 0x00010100)
+        return ParseBCT(file, minSide, out);
+    return ERR_SIGNATURE;
+}
+
+Result DecodeLevel(const Span& file, const Level& level, const Target& dst,
+                   const CancelFn& cancelled)
+{
+    if (!file.data || level.offset + level.bytes > file.size) return ERR_TRUNCATED;
+    const Span data(file.data + level.offset, level.bytes);
+    const size_t bb = BlockBytes(level.layout);
+    if (!level.bigEndian || !bb)
+        return Decode(level.layout, data, level.levelW, level.levelH, dst, cancelled);
+
+    // Console blocks: swap a copy, then untile it next to it
+    std::vector<unsigned char> work(data.size + LevelBytes(level.layout, level.levelW, level.levelH));
+    std::memcpy(&work[0], data.data, data.size);
+    FlipByteOrder16(&work[0], data.size);
+    unsigned char* linear = &work[0] + data.size;
+    UntileXbox360(&work[0], data.size, linear, level.levelW, level.levelH, bb);   // short: black
+    return Decode(level.layout, Span(linear, work.size() - data.size),
+                  level.levelW, level.levelH, dst, cancelled);
+}
+
+} // namespace TextureCodec
@@ -0,0 +1,162 @@
+// -----------------------------------------------------------------------------
+//  TextureCodec.h – the decode path, with no wxWidgets in it
+//
+//  Everything between "these are the file's bytes" and "these are the
+//  pixels": DDS and BCT headers parsed from a (pointer, size) span, the
+//  Xbox 360 byte swap and untile, and the BC1-BC5, 32-bit and palette
+//  decoders.  The caller owns both ends – the span, and a destination with
+//  its own row stride and channel order – so nothing in here logs, shows
+//  UI or keeps state; every failure is a Result.  Any thread may call any
+//  function at any time.
+//
+//  The viewer's loaders, the batch converter and --bench all decode through
+//  Decode().  BCTCore.cbp builds this directory on its own as a static
+//  library for tools that have no wx; BCTV.cbp compiles it in.
+// -----------------------------------------------------------------------------
+#ifndef TEXTURECODEC_H
+#define TEXTURECODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// -- DDS header as stored (124 bytes after the magic, pre-DX10) ---------------
+#pragma pack(push,1)
+struct DDSPixelFormat
+{
+    unsigned size, flags, fourCC, rgbBitCount;
+    unsigned rMask, gMask, bMask, aMask;
+};
+
+struct DDSHeader
+{
+    unsigned magic;
+    unsigned size;
+    unsigned flags;
+    unsigned height, width;
+    unsigned pitchOrLinearSize;
+    unsigned depth;
+    unsigned mipMapCount;
+    unsigned reserved1[11];
+    DDSPixelFormat pf;
+    unsigned caps, caps2, caps3, caps4, reserved2;
+};
+#pragma pack(pop)
+
+namespace TextureCodec {
+
+enum Result {
+    OK,
+    ERR_ARGUMENT,       // null pointer, empty size, stride shorter than a row
+    ERR_SIGNATURE,      // neither a DDS nor a BCT
+    ERR_HEADER,         // header or mip table makes no sense
+    ERR_TRUNCATED,      // the level runs past the bytes given
+    ERR_FORMAT,         // a format there is no decoder for
+    ERR_CANCELLED
+};
+const char* ResultText(Result r);
+
+// What the bytes of one level are
+enum Format {
+    FMT_NONE,
+    FMT_BC1, FMT_BC2, FMT_BC3, FMT_BC4, FMT_BC5,    // 4x4 blocks
+    FMT_BGRA8,                                      // 4 bytes per texel
+    FMT_PAL8                                        // 256 BGRA entries, then indices
+};
+
+// Output byte order.  BC4 is grey; BC5 puts red in the blue slot and 127 in
+// the red slot (what the normal-map rebuilds expect), so RGBA swaps those.
+enum Order { ORDER_BGRA, ORDER_RGBA };
+
+struct Span
+{
+    const unsigned char* data;
+    size_t               size;
+    Span() : data(NULL), size(0) {}
+    Span(const void* d, size_t n) : data(static_cast<const unsigned char*>(d)), size(n) {}
+};
+
+struct Target
+{
+    unsigned char* data;               // top-left texel
+    size_t         stride;             // bytes from one row to the next, >= 4 * w
+    Order          order;
+    Target(unsigned char* d, size_t s, Order o = ORDER_BGRA) : data(d), stride(s), order(o) {}
+};
+
+// Polled between block rows; true abandons the decode with ERR_CANCELLED
+typedef std::function<bool()> CancelFn;
+
+// -- decoding -------------------------------------------------------------------
+size_t BlockBytes(Format fmt);                       // 8 or 16; 0 unblocked
+size_t LevelBytes(Format fmt, int w, int h);         // linear, as decoded from
+
+// w x h texels of src into dst.  Edge blocks of sizes that are not whole
+// blocks are clipped; nothing outside the w x h rectangle is written.
+Result Decode(Format fmt, const Span& src, int w, int h, const Target& dst,
+              const CancelFn& cancelled = CancelFn());
+
+// -- Xbox 360 layout ------------------------------------------------------------
+void   FlipByteOrder16(unsigned char* data, size_t bytes);
+size_t TiledLevelBytes(size_t blockBytes, int w, int h);   // powers of two, 32 blocks at least
+
+// Tiled blocks to linear: linear must hold LevelBytes of the level and is
+// cleared first, so blocks a short tiled level lacks come out black
+// (ERR_TRUNCATED, the rest is still converted)
+Result UntileXbox360(const unsigned char* tiled, size_t tiledBytes, unsigned char* linear,
+                     int w, int h, size_t blockBytes);
+
+// Linear to tiled, the inverse: tiled must hold TiledLevelBytes; padding
+// blocks are zero.  Byte order is left alone, swap afterwards.
+Result TileXbox360(const unsigned char* linear, int w, int h, size_t blockBytes,
+                   unsigned char* tiled, size_t tiledBytes);
+
+// The permutation both directions walk: entry t is the linear block the
+// t-th tiled block holds, TILE_PADDING where it holds none.  Built once per
+// level shape and kept (a 4k mip chain's maps come to about 5 MB); safe to
+// call from any thread.
+const uint32_t TILE_PADDING = 0xFFFFFFFFu;
+std::shared_ptr<const std::vector<uint32_t> > Xbox360TileMap(int w, int h, size_t blockBytes);
+
+// -- containers -----------------------------------------------------------------
+int    BctToDxgi(int bctFormat);                     // 0 when unknown
+Format DxgiFormat(int dxgi);                         // BCT level layout
+Format FourCCFormat(uint32_t fourCC, unsigned rgbBitCount);
+uint32_t FormatFourCC(Format fmt);                   // 0 for BGRA8 and the rest
+
+// Smallest level of a w x h chain of count whose long edge is still at least
+// minSide.  Block levels stay whole 4x4 blocks and console levels stop above
+// the packed mip tail; usable(i), when given, ends the walk at a bad level.
+int PickLevel(int w, int h, int count, int minSide, bool blocks, bool console,
+              const std::function<bool(int)>& usable = std::function<bool(int)>());
+
+struct Level
+{
+    enum Kind { KIND_NONE, KIND_DDS, KIND_BCT };     // as ImageMeta::Kind
+
+    int      kind;
+    int      width, height, mips;  // mip 0
+    uint32_t format;               // DDS FourCC, or the BCT format as DXGI
+    bool     bigEndian;            // Xbox 360 BCT: swapped and tiled
+    Format   layout;
+    int      level;                // the one Parse() picked
+    int      levelW, levelH;
+    size_t   offset, bytes;        // its data within the file
+
+    Level() : kind(KIND_NONE), width(0), height(0), mips(0), format(0), bigEndian(false),
+              layout(FMT_NONE), level(0), levelW(0), levelH(0), offset(0), bytes(0) {}
+};
+
+// Header of a whole DDS or BCT file in memory; minSide as PickLevel
+Result Parse(const Span& file, int minSide, Level& out);
+
+// The parsed level into dst (levelW x levelH), console levels swapped and
+// untiled on the way
+Result DecodeLevel(const Span& file, const Level& level, const Target& dst,
+                   const CancelFn& cancelled = CancelFn());
+
+} // namespace TextureCodec
+
+#endif // TEXTURECODEC_H
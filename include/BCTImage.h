@@ -30,20 +30,44 @@ struct BCTHeader {
     uint32_t imgInfoAddr;  // Address of the mipmap info structure
     std::vector<uint8_t> unkBuf;    // Unused buffer (changed to std::vector)
     std::vector<dr3BctMip_t> imgInfo;  // Mipmap info (one entry per mipmap)
-    std::vector<std::vector<uint8_t>> data; // Mipmap data
+    std::vector<PooledBytes> data;  // data[0]: the level that was read
+    int mipLevel;          // which level data[0] holds
+    uint16_t mipWidth;     // and its size
+    uint16_t mipHeight;
 
-    bool Read(wxInputStream& in);
+    // Reads mip 0, or with minSide the smallest level whose long edge is
+    // still at least minSide
+    bool Read(wxInputStream& in, int minSide = 0);
+    bool ReadInfo(wxInputStream& in, int minSide = 0);   // header + mip table only
 };
 
 class BCTImage : public ImageBase {
+    friend class Benchmark;            // drives the block loops directly
 public:
     BCTImage();
     ~BCTImage();
 
     bool LoadFromFile(const wxString& filePath) override;
+    bool LoadSmallMip(const wxString& filePath, int minSide) override;
+    static bool Probe(wxInputStream& in, ImageMeta& meta);   // no pixel data read
+
+    // Rewrites the file's mip chain as a DDS without decoding it.  Levels are
+    // streamed to out one at a time; console files are byte-swapped and
+    // untiled in the compressed domain and lose the packed mip tail (levels
+    // under 32 texels).  meta, if given, describes what was written.
+    static bool WriteDDS(const wxString& bctPath, wxOutputStream& out,
+                         ImageMeta* meta = NULL);
+
+    // The levels WriteDDS copies, one at a time, untiled and little-endian:
+    // begin gets the chain (meta.mips levels follow), then each gets every
+    // level in turn.  Either returning false stops the walk.
+    typedef std::function<bool(const ImageMeta& meta)> ChainFn;
+    typedef std::function<bool(int level, int w, int h,
+                               const unsigned char* blocks, size_t bytes)> LevelFn;
+    static bool ReadLevels(const wxString& bctPath, const ChainFn& begin, const LevelFn& each);
     void Free();
 
-    void DecodeToBGRA(wxInputStream& in);  // Decode the image to BGRA format
+    bool DecodeToBGRA(const CancelFn& cancelled = CancelFn());  // Decode the image to BGRA format (no UI, any thread)
     void ApplyNormalRG() override;  // Apply normal map RG
     void ApplyNormalAG() override;  // Apply normal map AG
     void ApplyNormalARG() override; // Apply normal map ARG
@@ -53,27 +77,29 @@ public:
     int Height() const override { return m_h; }
     const unsigned char* Data() const override { return m_pixels; }
 
+    BlockFormat          GetBlockFormat() const override;
+    const unsigned char* Blocks() const override;
+
     // Implement missing functions
+    ImageMeta Meta() const override;
     wxString GetFormat() const override;
     wxString GetSize() const override;
     wxString GetMipCount() const override;
     wxString GetMemoryUsage() const override;
 
+protected:
+    bool DecodePixels(const CancelFn& cancelled) override;
+
 private:
-    void DecodeDXT1Block(const unsigned char* s, int bx, int by);  // Decode DXT1 block
-    void DecodeDXT3Block(const unsigned char* s, int bx, int by);  // Decode DXT3 block
-    void DecodeDXT5Block(const unsigned char* s, int bx, int by);  // Decode DXT5 block
-    void DecodeATI1Block(const unsigned char* s, int bx, int by);  // Decode ATI1 block (if needed)
-    void DecodeATI2Block(const unsigned char* s, int bx, int by);  // Decode ATI2 block (if needed)
-    void Expand565(unsigned c, unsigned char& r, unsigned char& g, unsigned char& b);  // Expand 565 format to RGB
-    unsigned char lerpByte(unsigned char a, unsigned char b, int w2of3);  // Interpolate between two bytes
-
-    unsigned char* m_pixels;  // Image pixel data in BGRA format
+    bool Load(const wxString& filePath, int minSide);
+
+    unsigned char* m_pixels;  // Image pixel data in BGRA format, from BufferPool
     int m_w, m_h;  // Image dimensions
     int m_pitch;  // Image pitch (width * 4 for BGRA)
     int m_format;  // Image format (DXGI format, for example)
 
     BCTHeader m_header;  // BCT header containing metadata and image data
+    PooledBytes m_blocks;  // loaded mip blocks, linear little-endian
 };
 
 
@@ -7,14 +7,31 @@
 #include <wx/colordlg.h>
 #include <wx/dir.h>          // <-- Added for wxDir
 #include <wx/cmdline.h>
-#include <memory>            // for std::auto_ptr
+#include <memory>            // for std::shared_ptr
 #include <wx/icon.h>
+#include <wx/timer.h>
+#include <wx/fswatcher.h>
+#include <map>
 
 // Include ImageBase header for polymorphism
 #include "ImageBase.h" // <-- Add this to use ImageBase and its derived classes
+#include "RenderThread.h"
+#include "TileCache.h"
+#include "DirIndexer.h"
+#include "ImageCache.h"
+#include "Prefetcher.h"
+#include "ThumbCache.h"
+#include "ThumbGrid.h"
+#include "FileList.h"
+#include "FileListCtrl.h"
+#include "TextureQuery.h"
+#include "TextureLibrary.h"
+#include "EncodeThread.h"
+#include "CommandLine.h"
 
 // Forward declaration of BCTVCanvas class
 class BCTVCanvas;
+class wxProgressDialog;
 
 extern "C" { extern const char *APP_ICON; }   // <- name from RC (no .ico)
 
@@ -22,11 +39,13 @@ class BCTVApp : public wxApp
 {
 public:
     wxVector<wxString> m_startupFiles;
+    CommandLine        m_cli;          // batch mode: no frame at all
 
     /* wxApp hooks ---------------------------------------------------- */
     void OnInitCmdLine(wxCmdLineParser& parser) override;
     bool OnCmdLineParsed(wxCmdLineParser& parser) override;
     bool OnInit() override;
+    int  OnRun() override;
 };
 
 class BCTVFrame : public wxFrame {
@@ -50,14 +69,31 @@ public:
     int    GetWheelMode() const       { return m_wheelMode; }
 bool m_manualZoom;
 
+    /* render scheduling ------------------------------------------- */
+    enum {
+        DIRTY_BITMAP = 1 << 0,       // zoom / channel / filter / pp changed
+        DIRTY_WINDOW = 1 << 1,       // window size & placement
+        DIRTY_STATUS = 1 << 2        // status bar fields
+    };
+    void RequestRender(int what);    // coalesced, at most once per frame
+    void FlushRender();              // apply whatever is pending right now
+    void RequestTiles(const std::vector<RenderJob>& tiles);  // canvas → worker
+
     // Core operations
     bool LoadImage(const wxString& path, bool recordDir = true);
-    void RebuildBitmap();             // apply channel masks & post-process
+    void RebuildBitmap();             // queue scale/masks/post-process on the worker
     void UpdateFrameTitle();
     void UpdateWindowForImage();
 
     void StepImage(int step);
     void JumpImage(int idx);
+    void BrowseTo(int idx);           // async unless cached, latest wins
+
+    /* view modes ---------------------------------------------------- */
+    enum ViewMode { VIEW_SINGLE, VIEW_STRIP, VIEW_GRID };
+    void SetViewMode(int mode);       // filmstrip under the canvas, or grid
+    int  GetViewMode() const          { return m_viewMode; }
+    void ShowSideList(bool show);     // file names left of the view
 
     void ShowCursorInfo(int ix, int iy, unsigned char* px);
 
@@ -75,14 +111,31 @@ bool m_manualZoom;
     enum {
         // File
         ID_FILE_OPEN = wxID_HIGHEST+1,
+        ID_FILE_SAVE_DDS,
+        ID_FILE_SAVE_BLOCKS, ID_FILE_ENCODE_BEST,
+        ID_FILE_SAVE_TRACE,
+        ID_FILE_LIB_INDEX, ID_FILE_LIB_FIND,
         ID_FILE_EXIT,
 
+        // View
+        ID_VIEW_SINGLE, ID_VIEW_STRIP, ID_VIEW_GRID, ID_VIEW_LIST,
+
+        // Browse list order / filter (probed headers)
+        ID_LIST_SORT_FOLDER, ID_LIST_SORT_NAME, ID_LIST_SORT_DIMS,
+        ID_LIST_SORT_FORMAT, ID_LIST_SORT_BYTES, ID_LIST_SORT_DESC,
+        ID_LIST_FMT_ANY, ID_LIST_FMT_DXT1, ID_LIST_FMT_DXT3, ID_LIST_FMT_DXT5,
+        ID_LIST_FMT_ATI1, ID_LIST_FMT_ATI2, ID_LIST_FMT_RGBA8,
+        ID_LIST_SIDE_ANY, ID_LIST_SIDE_512, ID_LIST_SIDE_1024, ID_LIST_SIDE_2048,
+        ID_LIST_SIDE_4096,
+        ID_LIST_MEM_ANY, ID_LIST_MEM_1M, ID_LIST_MEM_4M, ID_LIST_MEM_16M,
+        ID_LIST_END_ANY, ID_LIST_END_LITTLE, ID_LIST_END_BIG,
+
         // Channels
         ID_CH_R, ID_CH_G, ID_CH_B, ID_CH_A,
         ID_BG_COLOUR,
 
         // Filter
-        ID_FILT_SHR, ID_FILT_ENL,
+        ID_FILT_SHR, ID_FILT_ENL, ID_FILT_LINEAR,
 
         // Window options
         ID_WIN_CLIP, ID_WIN_CENTER, ID_WIN_TOP,
@@ -93,24 +146,45 @@ bool m_manualZoom;
         // Wrap / Auto-zoom
         ID_WRAP, ID_AUTOZOOM,
 
+        // Memory budget (caches, prefetch, tiles)
+        ID_CACHE_128, ID_CACHE_256, ID_CACHE_512, ID_CACHE_1024,
+
         // Post-process modes
         ID_PP_NONE, ID_PP_RG, ID_PP_AG, ID_PP_ARG,
 
         // Help
-        ID_HELP_ABOUT
+        ID_HELP_MEMORY,
+        ID_HELP_ABOUT,
+
+        // Internal
+        ID_RENDER_TIMER,
+        ID_RENDER_DONE,
+        ID_TILE_DONE,
+        ID_INDEX_BATCH,
+        ID_LOAD_DONE,
+        ID_SETTLE_TIMER,
+        ID_LIBRARY_PROGRESS,
+        ID_ENCODE_PROGRESS
     };
 
+    enum { SETTLE_MS = 300 };          // quiet time before a written file is read
+
 private:
     BCTVCanvas*     m_canvas;
+    ThumbGrid*      m_grid;            // filmstrip / grid over m_fileList
+    FileListCtrl*   m_sideList;        // virtual list left of the canvas
+    int             m_viewMode;
 
-    // Change m_img to ImageBase* to support polymorphism
-    ImageBase*      m_img;  // Changed from DDSImage* to ImageBase*
-
-    wxBitmap        m_bmp;
+    // Shared so the render worker can keep an image alive past a reload
+    std::shared_ptr<ImageBase> m_img;
+    RenderThread*   m_renderThread;
+    unsigned        m_renderSerial;    // last job submitted to the worker
+    unsigned        m_tiledSerial;     // frames older than this are stale
 
     double          m_zoom;
     bool            m_showR, m_showG, m_showB, m_showA;
     bool            m_filtShr, m_filtEnl;
+    bool            m_filtLinear;      // box-filter shrink in linear light
     bool            m_clip, m_center, m_top;
     int             m_wheelMode;
     bool            m_wrap, m_auto;
@@ -119,22 +193,94 @@ private:
     wxColour        m_bgSecondary;     // Canvas background color
     wxStatusBar*    m_statusBar;       // **NEW** Status bar declaration
 
-    wxArrayString   m_fileList;
+    FileList        m_fileList;
     int             m_curIdx;
+    ThumbCache      m_thumbs;          // persistent meta / thumbnails, outlives threads
+    wxString        m_parkedPath;      // opened file the scan has not reached
+    bool            m_parked;          // ... and it is the last list entry
+    DirIndexer*     m_indexer;
+    unsigned        m_indexGen;        // batches from older scans are dropped
+    bool            m_indexing;        // folder scan still running
+    TextureQuery    m_query;           // browse list order / filter
+    std::map<wxString, ImageMeta> m_meta;   // probed facts of the indexed folder
+    std::vector<wxString> m_metaOrder; // ... its paths in folder (arrival) order
+
+    ImageCache      m_cache;           // decoded images, LRU within a budget
+    Prefetcher*     m_prefetch;        // fills m_cache with the neighbours
+    wxString        m_loadPath;        // browse target still loading, if any
+    int             m_browseDir;       // +1 forward, -1 backward
+
+    wxFileSystemWatcher* m_watcher;    // browse folder, created with the event loop
+    wxString        m_watchDir;
+    std::map<wxString, wxLongLong> m_settling;   // path → time of its last event
+    wxTimer         m_settleTimer;
+
+    std::shared_ptr<TextureLibrary> m_library;   // loaded on first use
+    LibraryIndexer* m_libIndexer;      // running "Index folder tree", if any
+    wxString        m_libSearch;       // last library query text
+    bool            m_libList;         // m_fileList holds library results
+    EncodeThread*   m_encoder;         // running "Save as compressed DDS", if any
+    wxProgressDialog* m_encodeDlg;     // ... its progress and Cancel button
+    wxString        m_encodePath;      // ... and where it goes
     int  m_wheelAccum;        // leftover wheel delta (in units of WHEEL_DELTA)
 
+    wxTimer         m_renderTimer;     // one-shot, fires on the next frame slot
+    int             m_dirty;           // DIRTY_* bits waiting for FlushRender
+    wxLongLong      m_lastRender;      // ms timestamp of the last flush
+    int             m_frameMs;         // display refresh interval
+
     // Event handlers
     void OnOpen(wxCommandEvent&);
+    void OnSaveDDS(wxCommandEvent&);
+    void OnSaveBlocks(wxCommandEvent&);
+    void OnSaveTrace(wxCommandEvent&);
     void OnExit(wxCommandEvent&);
+    void OnViewMode(wxCommandEvent&);
+    void OnViewList(wxCommandEvent&);
+    void OnListQuery(wxCommandEvent&);
     void OnToggleChannel(wxCommandEvent&);
     void OnBgColour(wxCommandEvent&);
     void OnFilter(wxCommandEvent&);
     void OnWindowOpt(wxCommandEvent&);
     void OnWheelMode(wxCommandEvent&);
     void OnWrapAuto(wxCommandEvent&);
+    void OnCacheBudget(wxCommandEvent&);
     void OnPostProcess(wxCommandEvent&);
+    void OnMemory(wxCommandEvent&);
     void OnAbout(wxCommandEvent&);
     void OnKey(wxKeyEvent&);
+    void OnRenderTimer(wxTimerEvent&);
+    void OnRenderDone(wxThreadEvent&);
+    void OnTileDone(wxThreadEvent&);
+    void OnIndexBatch(wxThreadEvent&);
+    void OnLoadDone(wxThreadEvent&);
+    void OnFolderChange(wxFileSystemWatcherEvent&);
+    void OnSettleTimer(wxTimerEvent&);
+    void OnLibraryIndex(wxCommandEvent&);
+    void OnLibraryFind(wxCommandEvent&);
+    void OnLibraryProgress(wxThreadEvent&);
+    void OnEncodeProgress(wxThreadEvent&);
+
+    void ParkAndIndex(const wxString& path);
+    void IndexFolder(const wxString& dir);
+    void WatchFolder(const wxString& dir);
+    bool IsWatchedTexture(const wxString& path) const;
+    void FolderFileChanged(const wxString& path);
+    void FolderFileGone(const wxString& path);
+    void ReloadCurrent();
+    void AddIndexed(const std::vector<wxString>& paths,
+                    const std::vector<ImageMeta>& metas, bool done);
+    void NoteMeta(const wxString& path, const ImageMeta& meta);
+    int  ListSlot(const wxString& path) const;
+    void InsertListed(const wxString& path);
+    void ApplyQuery();
+    void SaveEncoded(const wxString& path, TextureCodec::Result r,
+                     const std::vector<unsigned char>& dds, long ms);
+    void EnsureLibrary();
+    bool ShowLibrary(const wxString& text);
+    void PrefetchNeighbours();
+    std::shared_ptr<ImageBase> OpenImage(const wxString& path);
+    void ShowImage(const std::shared_ptr<ImageBase>& img);
 
     DECLARE_EVENT_TABLE()
 };
@@ -143,16 +289,42 @@ class BCTVCanvas : public wxPanel {
 public:
     explicit BCTVCanvas(BCTVFrame* host);
     void RecreateBitmap(const wxBitmap& bmp);
+    wxBitmap TakeSpare();              // the frame shown before, to render into
+
+    /* tiled mode – zoomed image larger than the canvas ----------------- */
+    void SetTiledView(const RenderJob& view);
+    void AddTile(const RenderJob& tile, const wxBitmap& bmp);
+    void ClearTiles();
+    void PanBy(int dx, int dy);
+    bool IsTiled() const              { return m_tiled; }
 
 private:
     BCTVFrame*      m_host;
     wxBitmap        m_bmp;
+    wxBitmap        m_spare;           // replaced frame, kept for the next one
+    MemoryBudget::Charge m_bmpBytes;   // m_bmp's and m_spare's pixels
+
+    bool            m_tiled;
+    RenderJob       m_view;            // full zoomed size, no sub-rectangle
+    uint64_t        m_viewKey;
+    TileCache       m_tiles;
+    int             m_panX, m_panY;    // view origin inside the zoomed image
+    bool            m_dragging;
+    wxPoint         m_dragFrom;
+
+    bool HasImage() const             { return m_tiled || m_bmp.IsOk(); }
+    void ViewOrigin(int& x0, int& y0) const;
+    void ClampPan();
+    void DrawTiles(wxDC& dc, bool requestMissing);
 
     void OnPaint(wxPaintEvent&);
     void OnErase(wxEraseEvent&) {}
     void OnMotion(wxMouseEvent&);
     void OnWheel(wxMouseEvent&);
     void OnLeftDown(wxMouseEvent&);
+    void OnRightDown(wxMouseEvent&);
+    void OnRightUp(wxMouseEvent&);
+    void OnCaptureLost(wxMouseCaptureLostEvent&);
 
     class DropTarget : public wxFileDropTarget {
     public:
@@ -0,0 +1,71 @@
+// -----------------------------------------------------------------------------
+//  BCTWriter.h – BCT output for the PC and the Xbox 360
+//
+//  Writes the layout BCTHeader::Read takes apart: the 20-byte header, the
+//  mip table (16 bytes a level: address, size, 0x80000000, 0) and the
+//  levels.  PC files are little-endian with linear levels.  Xbox 360 files
+//  have the header and table big-endian and every level tiled
+//  (TextureCodec::TileXbox360, padded to powers of two), 16-bit swapped and
+//  on a 4 KB boundary.  Levels under 32 texels, which the console packs into
+//  one shared tail tile, are left out there, as the reader stops above them.
+//
+//  Begin() writes the header and table, which depend on sizes only; each
+//  Level() after it is tiled and swapped into one scratch buffer and
+//  streamed out, so a whole chain is repacked in one pass over its blocks.
+// -----------------------------------------------------------------------------
+#ifndef BCTWRITER_H
+#define BCTWRITER_H
+
+#include "ImageBase.h"
+#include "TextureCodec.h"
+#include <wx/stream.h>
+#include <wx/string.h>
+#include <vector>
+
+class BCTWriter
+{
+public:
+    struct Spec
+    {
+        TextureCodec::Format format;   // BC1, BC3, BC4 or BC5
+        int      width, height;        // mip 0
+        int      mips;                 // levels on offer; Levels() keeps a prefix
+        bool     bigEndian;            // Xbox 360
+        uint32_t hash;                 // imgHash, written as BCTHeader reads it
+
+        Spec() : format(TextureCodec::FMT_NONE), width(0), height(0), mips(1),
+                 bigEndian(false), hash(0) {}
+    };
+
+    explicit BCTWriter(wxOutputStream& out)
+    : m_out(out), m_levels(0), m_next(0), m_at(0) {}
+
+    static int Levels(const Spec& spec);   // 0 if the spec cannot be written
+
+    bool Begin(const Spec& spec);
+
+    // The next level as linear, little-endian blocks (LevelBytes of its
+    // size); levels past Levels() are accepted and dropped
+    bool Level(const unsigned char* blocks, size_t bytes);
+
+    bool Finish();                     // false unless every kept level came
+
+    // The mip chain of a BCT (either platform) or of a DXT1/DXT5/ATI1/ATI2
+    // DDS repacked as a BCT for the platform asked, never decoded.  meta,
+    // if given, describes what was written.
+    static bool Convert(const wxString& srcPath, wxOutputStream& out, bool bigEndian,
+                        ImageMeta* meta = NULL);
+
+private:
+    bool Pad(uint64_t to);             // zeros up to file offset to
+
+    wxOutputStream&            m_out;
+    Spec                       m_spec;
+    int                        m_levels;
+    int                        m_next;
+    uint64_t                   m_at;   // bytes written so far
+    std::vector<uint32_t>      m_addr; // of each kept level
+    std::vector<unsigned char> m_tiled;
+};
+
+#endif // BCTWRITER_H
@@ -0,0 +1,99 @@
+// -----------------------------------------------------------------------------
+//  BatchConvert.h – headless conversion of whole texture trees
+//
+//  A game build pushes tens of thousands of textures through here, so a
+//  conversion is a three-stage pipeline rather than a loop:
+//
+//    read    two reader threads open and parse the inputs (header and
+//            compressed blocks only) ahead of the workers, so the disk stays
+//            busy while the CPUs decode;
+//    decode  one worker per core expands the blocks and encodes the output
+//            into memory.  Readers deal loaded textures round-robin onto the
+//            workers' own queues; a worker that runs dry steals from the back
+//            of the fullest one, so textures queued behind a huge one do not
+//            wait for it;
+//    write   one writer thread creates the folders and writes the files.
+//
+//  The dxt1 / dxt5 / ati1 / ati2 targets re-compress the decoded pixels
+//  (TextureCodec::EncodeDDS) into a one-level DDS.  Each worker encodes its
+//  texture on its own thread; the files are what runs in parallel.
+//
+//  BCT to DDS skips the middle stage: the readers re-container the
+//  compressed mip chain (BCTImage::WriteDDS) and hand it straight to the
+//  writer, so that conversion is bound by the disk alone.  So do the bct
+//  and bct360 targets, which repack any DDS or BCT chain for the PC or the
+//  Xbox 360 (BCTWriter::Convert).
+//
+//  Textures between the reader and the writer are capped, so memory stays
+//  bounded however far the readers get ahead.  Results come back on the
+//  calling thread, in completion order.
+// -----------------------------------------------------------------------------
+#ifndef BATCHCONVERT_H
+#define BATCHCONVERT_H
+
+#include <wx/string.h>
+#include "BlockEncoder.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class BatchConvert
+{
+public:
+    enum Target { TO_PNG, TO_TGA, TO_DDS, TO_DXT1, TO_DXT5, TO_ATI1, TO_ATI2,
+                  TO_BCT, TO_BCT360 };
+    enum { MAX_JOBS = 64 };
+
+    struct Job
+    {
+        wxString in;                   // file or archive member
+        wxString out;
+        uint64_t bytes;                // stored size of the input
+    };
+
+    struct Result
+    {
+        wxString in, out;
+        bool     ok;
+        wxString error;                // why not, when !ok
+        int      width, height;
+        uint64_t inBytes, outBytes;
+        double   ms;                   // all stages of this file
+    };
+
+    struct Totals
+    {
+        size_t   files, failed;
+        uint64_t inBytes, outBytes;
+        double   seconds;              // wall clock
+        double   readMs, decodeMs, encodeMs, writeMs;   // summed over threads
+    };
+
+    typedef std::function<void(const Result&)> ResultFn;
+
+    BatchConvert() : m_target(TO_PNG), m_quality(TextureCodec::QUALITY_RANGE) {}
+
+    static bool     ParseTarget(const wxString& name, Target& target);
+    static wxString Extension(Target target);
+
+    // Colour fit for the block-compressed targets (default: range fit)
+    void SetQuality(TextureCodec::Quality quality) { m_quality = quality; }
+
+    // Lists the textures under in (a folder, searched recursively, or an
+    // archive) and where each goes under out; false if there are none
+    bool Collect(const wxString& in, const wxString& out, Target target);
+    const std::vector<Job>& Jobs() const { return m_jobs; }
+
+    // Converts what Collect() found with jobs workers (0: one per core),
+    // calling each for every file as it finishes; false if any failed
+    bool Run(int jobs, const ResultFn& each);
+    const Totals& GetTotals() const { return m_totals; }
+
+private:
+    std::vector<Job> m_jobs;           // largest first
+    Target           m_target;
+    TextureCodec::Quality m_quality;
+    Totals           m_totals;
+};
+
+#endif // BATCHCONVERT_H
@@ -0,0 +1,52 @@
+// -----------------------------------------------------------------------------
+//  Benchmark.h – timings of the decode and display hot paths
+//
+//  Synthetic block payloads of every format the loaders decode are built in
+//  memory (seeded, so every run sees the same bytes) at a few sizes, and
+//  each stage is timed on its own: the DDS and BCT block loops, the core
+//  decoder writing RGBA into a padded target that clips the edge blocks,
+//  the Xbox 360 byte swap, untiler and tiler, the BC1/BC3/BC4/BC5 encoders in both
+//  fits (decoded again and held to a PSNR floor), premultiply, the normal-map rebuilds, the
+//  RebuildBitmap scalers, a whole load-decode-free cycle, which must be
+//  served from BufferPool without a fresh allocation, a DXT5 file whose
+//  colour endpoints all have c0 < c1 (still four colours, never BC1's
+//  black), and a sparse ZIP64 archive whose members lie past 4 GB, opened
+//  and read back.  A stage runs until it has had a fair share of wall time
+//  and reports its best run, as MB/s of the bytes it reads and as texels/s.
+//
+//  Where a plain scalar reference exists the output is also compared with
+//  it byte for byte, so a faster path that changes the pixels shows up here
+//  before it shows up on screen.  The BC2/BC3 decoders and the reference
+//  are also held to two blocks worked out by hand (c0 < c1 and c0 == c1),
+//  so a rule both share cannot pass as a match.  Any optimisation should
+//  come with the before / after rows of "bctv --bench all".
+// -----------------------------------------------------------------------------
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <wx/string.h>
+#include <functional>
+
+class Benchmark
+{
+public:
+    enum Check { CHECK_NONE, CHECK_OK, CHECK_FAILED };
+
+    struct Row
+    {
+        wxString stage;
+        int      width, height;
+        double   ms;                   // best run
+        double   mbPerSec;             // of the stage's input
+        double   mTexelsPerSec;
+        Check    check;
+        wxString note;                 // where the output first differed, or why
+    };
+    typedef std::function<void(const Row&)> RowFn;
+
+    // Every stage whose name contains filter ("all" or empty: every one);
+    // false if any output differed from its reference
+    static bool Run(const wxString& filter, const RowFn& row);
+};
+
+#endif // BENCHMARK_H
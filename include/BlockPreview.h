@@ -0,0 +1,27 @@
+// -----------------------------------------------------------------------------
+//  BlockPreview.h – one BGRA pixel per 4×4 block, straight from BCn data
+//
+//  At zoom ≤ 1/4 every screen pixel covers at least a whole block, so the
+//  block average is all the box filter would have produced anyway.  The
+//  average falls out of the endpoints and an index histogram (popcount over
+//  the 2-bit index planes for BC1, a 3-bit tally for BC3/4/5 alpha), so
+//  a 4K texture previews without ever being expanded to 64 MB of BGRA.
+// -----------------------------------------------------------------------------
+#ifndef BLOCKPREVIEW_H
+#define BLOCKPREVIEW_H
+
+#include "ImageBase.h"
+#include <vector>
+
+namespace BlockPreview {
+
+// Builds the (w+3)/4 × (h+3)/4 preview of mip 0.  Channel layout matches
+// the full decoders (BC4 grey, BC5 R→byte 0, G→byte 1, 127 in byte 2).
+// With linearLight the colour channels are averaged in linear light.
+bool Build(const unsigned char* blocks, int w, int h,
+           ImageBase::BlockFormat fmt, bool linearLight,
+           std::vector<unsigned char>& out, int& pw, int& ph);
+
+} // namespace BlockPreview
+
+#endif // BLOCKPREVIEW_H
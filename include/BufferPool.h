@@ -0,0 +1,84 @@
+// -----------------------------------------------------------------------------
+//  BufferPool.h – large buffers kept for the next load instead of freed
+//
+//  Stepping through a folder loads one texture after another of mostly the
+//  same few sizes.  Pixel buffers, kept blocks, the BCT read buffer and the
+//  render worker's tiles are taken from here and given back when freed; a
+//  buffer that comes back is parked in its size class and handed to the
+//  next request of that class, so a run of same-sized textures reaches a
+//  steady state without asking the system for memory at all.
+//
+//  Size classes are STEPS per power of two from MIN_POOLED up, so a buffer
+//  is at most 1/STEPS larger than asked for.  Smaller requests go straight
+//  to the heap.  Idle buffers are charged to MemoryBudget::POOL and capped
+//  at Budget() / IDLE_SHARE; beyond that the least useful ones are freed.
+//
+//  With huge pages switched on (--huge-pages) buffers of HUGE_MIN and up
+//  are backed by large pages where the system grants them – on Windows the
+//  account needs the "Lock pages in memory" right – and by normal pages
+//  otherwise.
+// -----------------------------------------------------------------------------
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+class BufferPool
+{
+public:
+    enum { MIN_POOLED = 64 << 10 };    // smaller requests are not pooled
+    enum { STEPS = 4 };                // size classes per power of two
+    enum { HUGE_MIN = 2 << 20 };       // huge pages from this size up
+    enum { IDLE_SHARE = 4 };           // idle buffers: at most budget / this
+
+    static void*  Take(size_t bytes);  // NULL when out of memory
+    static void   Give(void* p);       // NULL is ignored
+    static size_t Capacity(const void* p);
+
+    static bool   SetHugePages(bool on);       // false if the system refuses
+    static bool   HugePages();
+
+    static void   Trim(size_t keepBytes = 0);  // free idle buffers down to it
+    static size_t IdleBytes();
+    static size_t IdleLimit();                 // Budget() / IDLE_SHARE
+    static uint64_t SystemAllocations();       // pooled-size buffers ever made
+
+    // std::vector allocator over Take()/Give().  resize() leaves new bytes
+    // as they were: every user overwrites them, so zeroing is wasted work.
+    template <class T>
+    struct Allocator
+    {
+        typedef T value_type;
+
+        Allocator() {}
+        template <class U> Allocator(const Allocator<U>&) {}
+        template <class U> struct rebind { typedef Allocator<U> other; };
+
+        T* allocate(size_t n)
+        {
+            void* p = Take(n * sizeof(T));
+            if (!p) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+        void deallocate(T* p, size_t) { Give(p); }
+
+        template <class U> void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+        template <class U, class... A> void construct(U* p, A&&... args)
+        {
+            ::new (static_cast<void*>(p)) U(std::forward<A>(args)...);
+        }
+    };
+};
+
+template <class T, class U>
+bool operator==(const BufferPool::Allocator<T>&, const BufferPool::Allocator<U>&) { return true; }
+template <class T, class U>
+bool operator!=(const BufferPool::Allocator<T>&, const BufferPool::Allocator<U>&) { return false; }
+
+typedef std::vector<unsigned char, BufferPool::Allocator<unsigned char> > PooledBytes;
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,103 @@
+// -----------------------------------------------------------------------------
+//  CommandLine.h – batch modes that run without opening a window
+//
+//  "bctv file.dds" still just opens the viewer.  The options below turn the
+//  run into a batch job instead: the app parses them, skips the frame and
+//  returns Run()'s exit code from OnRun().  Output goes to stdout, errors
+//  and progress to stderr.
+//
+//      --index <dir>     walk dir recursively into the texture library
+//      --find <query>    print library entries matching a TextureQuery text
+//      --library <file>  library file (default: the one the viewer uses)
+//      --jobs <n>        threads for --index, decode workers for --convert
+//      --long            --find prints format, size, mips and platform too
+//
+//      --convert <in> <out> [--to png|tga|dds|dxt1|dxt5|ati1|ati2|bct|bct360]
+//                        convert every texture under the folder or archive
+//                        in into out, same tree; one report line per file
+//                        on stdout, the throughput summary on stderr;
+//                        BCT to dds copies the compressed mips, no decode;
+//                        dxt1 .. ati2 re-compress into a one-level DDS;
+//                        bct / bct360 repack the mips for the PC or the
+//                        Xbox 360, no decode either
+//      --quality fast|best
+//                        colour fit for dxt1 / dxt5: range (default) or
+//                        cluster fit
+//
+//      --bench <stages>  time the decode / display hot paths on synthetic
+//                        payloads ("all", or stages whose name contains the
+//                        text) and check them against scalar references
+//
+//      --corpus <dir>    load every texture under dir the way the viewer
+//                        does and report per-stage / per-format throughput,
+//                        p50 / p99 latency and peak RSS
+//      --json <file>     save those metrics
+//      --baseline <file> compare with metrics saved earlier; a regression
+//                        beyond --threshold <percent> (default 10) fails
+//
+//      --trace <file>    after any of the above, save the load stage timings
+//                        as Chrome trace-event JSON (chrome://tracing)
+//
+//      --huge-pages      viewer or batch: back large pooled image buffers
+//                        with huge pages where the system allows it
+// -----------------------------------------------------------------------------
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <wx/cmdline.h>
+#include <wx/string.h>
+
+#include "BatchConvert.h"
+
+class TextureLibrary;
+
+class CommandLine
+{
+public:
+    CommandLine() : m_jobs(0), m_long(false), m_target(BatchConvert::TO_PNG),
+                    m_quality(TextureCodec::QUALITY_RANGE), m_threshold(10) {}
+
+    static void AddOptions(wxCmdLineParser& parser);
+
+    // Picks up the batch options; false if the values make no sense
+    bool Parse(const wxCmdLineParser& parser);
+
+    bool Active() const {
+        return !m_index.IsEmpty() || !m_find.IsEmpty() || !m_convert.IsEmpty() ||
+               !m_bench.IsEmpty() || !m_corpus.IsEmpty();
+    }
+    int  Run();                        // process exit code
+
+private:
+    enum { EXIT_OK = 0, EXIT_FAILED = 1 };
+
+    int  RunIndex(TextureLibrary& lib);
+    int  RunFind(const TextureLibrary& lib);
+    int  RunConvert();
+    int  RunBench();
+    int  RunCorpus();
+    int  RunMode();
+    static void AttachConsole();       // a GUI-subsystem exe has none
+
+    wxString m_index;
+    wxString m_find;
+    wxString m_library;
+    long     m_jobs;
+    bool     m_long;
+
+    wxString             m_convert;
+    wxString             m_convertOut;
+    BatchConvert::Target m_target;
+    TextureCodec::Quality m_quality;
+
+    wxString             m_bench;
+
+    wxString             m_corpus;
+    wxString             m_json;
+    wxString             m_baseline;
+    double               m_threshold;  // percent
+
+    wxString             m_trace;
+};
+
+#endif // COMMANDLINE_H
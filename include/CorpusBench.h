@@ -0,0 +1,87 @@
+// -----------------------------------------------------------------------------
+//  CorpusBench.h – throughput of the full load path over a real texture tree
+//
+//  The micro-benchmarks (Benchmark.h) time one loop on synthetic data; they
+//  cannot see file sizes, the format mix or how much of a dump is console
+//  tiled.  This runs every texture under a folder through the path the
+//  viewer uses, one file at a time so latencies are clean:
+//
+//    sniff   open, read the signature, pick the loader;
+//    load    read and parse the header and mip 0;
+//    swap    16-bit byte swap of a console file's level;
+//    untile  console tiled blocks to linear;
+//    decode  expand the blocks to BGRA.
+//
+//  Swap and untile come from the loader's own Profiler breakdown and are
+//  taken out of the load time, so the cost of console tiling shows on its
+//  own; they count only the files that went through them.
+//
+//  It reports throughput and p50 / p99 per stage, throughput per format
+//  (kind, format, platform), p50 / p99 latency of a whole load and the
+//  process's peak RSS, as a flat set of named metrics.  Those are saved as
+//  JSON and compared with a saved baseline: a metric that got worse by more
+//  than the threshold is a regression.
+// -----------------------------------------------------------------------------
+#ifndef CORPUSBENCH_H
+#define CORPUSBENCH_H
+
+#include <wx/string.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+class CorpusBench
+{
+public:
+    enum Stage { STAGE_SNIFF, STAGE_LOAD, STAGE_SWAP, STAGE_UNTILE, STAGE_DECODE, STAGES };
+
+    struct Group                       // one kind / format / platform
+    {
+        size_t   files;
+        uint64_t bytes;                // on disk
+        uint64_t texels;               // decoded
+        double   ms[STAGES];
+    };
+
+    // name → value; "_per_s" metrics are better higher, the rest lower
+    typedef std::map<wxString, double>                  Metrics;
+    typedef std::function<void(size_t done, size_t total)> ProgressFn;
+    typedef std::function<void(const wxString& name, double base, double now,
+                               bool regressed)>          CompareFn;
+
+    CorpusBench() : m_total(), m_stageBytes(), m_failed(0), m_seconds(0), m_peakRss(0) {}
+
+    // Every texture under root (folders recursively, archives included);
+    // false if there were none
+    bool Run(const wxString& root, const ProgressFn& progress = ProgressFn());
+
+    Metrics GetMetrics() const;
+    const std::map<wxString, Group>& Groups() const { return m_groups; }
+    size_t Files()  const { return m_latency.size() + m_failed; }
+    size_t Failed() const { return m_failed; }
+
+    bool Save(const wxString& file) const;                  // JSON
+    static bool LoadMetrics(const wxString& file, Metrics& out);
+
+    // Calls line for every metric both sides have; false if any regressed
+    // by more than thresholdPct
+    static bool Compare(const Metrics& base, const Metrics& now,
+                        double thresholdPct, const CompareFn& line);
+
+    static uint64_t PeakRss();         // bytes, 0 where unknown
+    static const char* StageName(int stage);
+
+private:
+    wxString                  m_root;
+    std::map<wxString, Group> m_groups;
+    Group                     m_total;
+    std::vector<double>       m_latency;   // ms per loaded file, sorted
+    std::vector<double>       m_stageMs[STAGES];      // per file through the stage, sorted
+    uint64_t                  m_stageBytes[STAGES];   // of those files
+    size_t                    m_failed;
+    double                    m_seconds;
+    uint64_t                  m_peakRss;
+};
+
+#endif // CORPUSBENCH_H
@@ -8,48 +8,35 @@
 #include "ImageBase.h"
 #include <wx/string.h>
 #include <wx/stream.h>
+#include <vector>
 
 #ifdef __WXMSW__
 #include <windows.h>          // <─ add
 #endif
 
-// -- low-level header structs (124-byte header, pre-DX10) ---------------------
-#pragma pack(push,1)
-struct DDSPixelFormat
-{
-    unsigned size, flags, fourCC, rgbBitCount;
-    unsigned rMask, gMask, bMask, aMask;
-};
-
-struct DDSHeader
-{
-    unsigned magic;
-    unsigned size;
-    unsigned flags;
-    unsigned height, width;
-    unsigned pitchOrLinearSize;
-    unsigned depth;
-    unsigned mipMapCount;
-    unsigned reserved1[11];
-    DDSPixelFormat pf;
-    unsigned caps, caps2, caps3, caps4, reserved2;
-};
-#pragma pack(pop)
+// DDSHeader / DDSPixelFormat and the block decoders live in the core
+#include "TextureCodec.h"
 
 // -----------------------------------------------------------------------------
 // DDS Image Class Definition
 // -----------------------------------------------------------------------------
 class DDSImage : public ImageBase
 {
+    friend class Benchmark;            // drives the block loops directly
 public:
     DDSImage();
     ~DDSImage();
 
     bool LoadFromFile(const wxString& filePath) override;
+    bool LoadSmallMip(const wxString& filePath, int minSide) override;
+    static bool Probe(wxInputStream& in, ImageMeta& meta);   // header only
     int  Width() const override { return m_w; }
     int  Height() const override { return m_h; }
     const unsigned char* Data() const override { return m_pixels; }
 
+    BlockFormat          GetBlockFormat() const override;
+    const unsigned char* Blocks() const override;
+
     // -------- optional post-process modes (normal-map rebuild) ---------------
     void ApplyNormalRG();
     void ApplyNormalAG();
@@ -57,29 +44,31 @@ public:
     void PreMultiplyAlpha();
 
     // Added reporting functions
+    ImageMeta Meta() const override;
     wxString GetFormat() const override;
     wxString GetSize() const override;
     wxString GetMipCount() const override;
     wxString GetMemoryUsage() const override;
 
+protected:
+    bool DecodePixels(const CancelFn& cancelled) override;
+
 private:
-    bool ReadHeader(wxInputStream& in, DDSHeader& hdr);
-    bool DecodeToBGRA(wxInputStream& in, const DDSHeader& hdr);
+    bool Load(const wxString& filePath, int minSide);
+    static bool ReadHeader(wxInputStream& in, DDSHeader& hdr);
+    bool ReadPayload(wxInputStream& in, const DDSHeader& hdr);
+    static size_t LevelBytes(const DDSHeader& hdr, int level);
+    static int    PickLevel(const DDSHeader& hdr, int minSide);
 
-    void DecodeDXT1Block(const unsigned char* src, int bx, int by);
-    void DecodeDXT3Block(const unsigned char* src, int bx, int by);
-    void DecodeDXT5Block(const unsigned char* src, int bx, int by);
-    void DecodeATI2Block(const unsigned char* s, int bx, int by);
     void DecodePlain32(const unsigned char* srcRow, int y, int bpp);
 
-    static void Expand565(unsigned c, unsigned char& r,
-                          unsigned char& g, unsigned char& b);
-
     void Free();
 
-    unsigned char* m_pixels;
-    int m_w, m_h;
+    unsigned char* m_pixels;               // BufferPool::Take()
+    PooledBytes    m_blocks;               // loaded mip blocks, kept for previews
+    int m_w, m_h;            // loaded level
     int m_pitch;
+    int m_baseW, m_baseH;    // mip 0
     int m_mipCount;          // Store the mip count from the DDS header
     size_t m_memoryUsed;
     size_t m_memoryTotal;    // Store total memory (based on width, height, and format)
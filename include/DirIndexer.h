@@ -0,0 +1,78 @@
+// -----------------------------------------------------------------------------
+//  DirIndexer.h – background scan of the browse folder
+//
+//  Opening a file used to walk its folder twice and open every candidate
+//  before the first image appeared.  The indexer does the walk on its own
+//  thread instead: one wxDir pass collects the *.dds / *.bct names, then the
+//  signatures are sniffed in batches and each batch is posted back as a
+//  DirBatch, so the browse list grows while the user is already looking at
+//  (and paging through) the first image.  Submitting a new folder abandons
+//  the current scan at the next file.  Files the ThumbCache already knows
+//  (same size and mtime) are taken from it without being opened; the others
+//  have their header probed, so every listed file arrives with its ImageMeta.
+// -----------------------------------------------------------------------------
+#ifndef DIRINDEXER_H
+#define DIRINDEXER_H
+
+#include <wx/thread.h>
+#include <wx/event.h>
+#include <wx/string.h>
+#include <atomic>
+#include <vector>
+
+#include "ImageBase.h"
+
+class ThumbCache;
+
+struct DirBatch
+{
+    unsigned              generation;   // DirIndexer::Submit() token
+    std::vector<wxString> paths;        // verified textures, folder order
+    std::vector<ImageMeta> metas;       // probed header facts, same order
+    bool                  done;         // last batch of this scan
+};
+
+class DirIndexer : public wxThread
+{
+public:
+    enum { BATCH = 256 };               // files sniffed per posted batch
+
+    DirIndexer(wxEvtHandler* sink, int eventId, ThumbCache* thumbs = NULL);
+
+    void Submit(const wxString& dir, unsigned generation);   // latest wins
+    void Quit();                        // call before Wait()
+
+    // Fallback when the thread could not be started: scan inline
+    static void IndexNow(const wxString& dir, std::vector<wxString>& out,
+                         ThumbCache* thumbs = NULL,
+                         std::vector<ImageMeta>* metas = NULL);
+
+    // Reads the first four bytes big-endian; quiet, safe on any thread
+    static bool SniffSignature(const wxString& path, uint32_t& file4CC);
+
+    // True for a DDS / BCT we can show; the probed header is kept in the
+    // ThumbCache and returned through meta
+    static bool Accept(const wxString& path, ThumbCache* thumbs, ImageMeta* meta = NULL);
+
+protected:
+    ExitCode Entry() override;
+
+private:
+    bool Superseded(unsigned generation) const {
+        return m_quit.load() || m_latest.load() != generation;
+    }
+    static void ListCandidates(const wxString& dir, std::vector<wxString>& out);
+
+    wxEvtHandler*         m_sink;
+    int                   m_eventId;
+    ThumbCache*           m_thumbs;     // optional, thread-safe
+
+    wxMutex               m_lock;       // guards m_dir / m_hasJob
+    wxCondition           m_wake;
+    wxString              m_dir;
+    bool                  m_hasJob;
+    std::atomic<unsigned> m_latest;     // newest generation submitted
+    std::atomic<bool>     m_quit;
+};
+
+#endif // DIRINDEXER_H
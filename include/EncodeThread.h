@@ -0,0 +1,57 @@
+// -----------------------------------------------------------------------------
+//  EncodeThread.h – "Save as compressed DDS" off the GUI thread
+//
+//  TextureCodec::EncodeDDS over a loaded image's pixels on a thread of its
+//  own, which shares the block rows out over every core as usual.  Posts an
+//  EncodeProgress each time another percent of the rows has been started,
+//  and a final one (done) carrying the DDS file or why there is none.  The
+//  image is held until then, so a reload meanwhile leaves its pixels be.
+// -----------------------------------------------------------------------------
+#ifndef ENCODETHREAD_H
+#define ENCODETHREAD_H
+
+#include "ImageBase.h"
+#include "BlockEncoder.h"
+
+#include <wx/thread.h>
+#include <wx/event.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct EncodeProgress
+{
+    int                        percent;    // of the block rows started
+    bool                       done;
+    TextureCodec::Result       result;     // on the last one
+    std::vector<unsigned char> dds;        // ... the file, when OK
+    long                       ms;         // ... time spent encoding
+};
+
+class EncodeThread : public wxThread
+{
+public:
+    EncodeThread(wxEvtHandler* sink, int eventId, const std::shared_ptr<const ImageBase>& img,
+                 TextureCodec::Format format, TextureCodec::Quality quality);
+
+    void Cancel() { m_cancel = true; }  // then Wait()
+
+protected:
+    ExitCode Entry() override;
+
+private:
+    bool RowStarted();                  // the encoder's CancelFn
+    void Post(const std::shared_ptr<EncodeProgress>& p);
+
+    wxEvtHandler*                    m_sink;
+    int                              m_eventId;
+    std::shared_ptr<const ImageBase> m_img;
+    TextureCodec::Format             m_format;
+    TextureCodec::Quality            m_quality;
+    int                              m_rows;
+    std::atomic<int>                 m_started;
+    std::atomic<int>                 m_percent;   // last posted
+    std::atomic<bool>                m_cancel;
+};
+
+#endif // ENCODETHREAD_H
@@ -0,0 +1,85 @@
+// -----------------------------------------------------------------------------
+//  FileList.h – the browse list: ordered texture paths with O(1) lookup
+//
+//  A wxArrayString made every "where is this file" a linear string search
+//  and every title update a wxFileName parse.  Here each entry is stored
+//  once as an interned folder (shared by every file in it) plus its display
+//  name, split when the entry is added, and a hash index maps a path to its
+//  entry.  Positions are kept in the entries and renumbered lazily: inserts
+//  and removals only note the first position that moved, and the next
+//  Find() renumbers from there, so a batch of sorted inserts costs one pass.
+//
+//  Paths compare case-insensitively where the file system does.  GUI thread
+//  only; the grid and the side list read it while painting.
+// -----------------------------------------------------------------------------
+#ifndef FILELIST_H
+#define FILELIST_H
+
+#include <wx/string.h>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class FileList
+{
+public:
+    FileList() : m_valid(0) {}
+
+    size_t GetCount() const           { return m_order.size(); }
+    bool   IsEmpty()  const           { return m_order.empty(); }
+
+    wxString        operator[](int idx) const { return Path(idx); }
+    wxString        Path(int idx) const;     // folder + separator + name
+    const wxString& Name(int idx) const       { return m_order[idx]->name; }
+    const wxString& Folder(int idx) const     { return *m_order[idx]->folder; }
+
+    int  Find(const wxString& path) const;   // wxNOT_FOUND if not listed
+
+    void Clear();
+    void Reserve(size_t n)            { m_order.reserve(n); }
+    void Add(const wxString& path)    { Insert(path, m_order.size()); }
+    void Insert(const wxString& path, size_t at);
+    void RemoveAt(size_t at);
+
+private:
+    struct Item
+    {
+        const wxString* folder;        // interned
+        wxString        name;
+        size_t          hash;          // of the folded name
+        mutable size_t  pos;           // valid below m_valid
+    };
+    struct Key                         // an Item, or a path being looked up
+    {
+        const wxString* folder;
+        const wxString* name;
+        size_t          hash;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return k.hash ^ (std::hash<const void*>()(k.folder) * 31);
+        }
+    };
+    struct KeyEqual {
+        bool operator()(const Key& a, const Key& b) const;
+    };
+    struct FoldHash {
+        size_t operator()(const wxString& s) const;
+    };
+    struct FoldEqual {
+        bool operator()(const wxString& a, const wxString& b) const;
+    };
+
+    static void Split(const wxString& path, wxString& folder, wxString& name);
+    const wxString* Intern(const wxString& folder);
+
+    std::unordered_set<wxString, FoldHash, FoldEqual> m_folders;   // stable nodes
+    std::deque<Item>                                  m_items;     // stable; removed
+                                                                   // ones stay until Clear
+    std::vector<const Item*>                          m_order;
+    std::unordered_map<Key, const Item*, KeyHash, KeyEqual> m_index;
+    mutable size_t                                    m_valid;     // pos correct below
+};
+
+#endif // FILELIST_H
@@ -0,0 +1,44 @@
+// -----------------------------------------------------------------------------
+//  FileListCtrl.h – virtual side list over the browse list
+//
+//  A report-mode wxListCtrl in virtual mode: the control only knows the row
+//  count and asks for the text of the rows it paints, which come straight
+//  from the FileList's precomputed names and interned folders.  Nothing is
+//  stored per row, so a folder of 100k textures costs no more than ten.
+//  Clicking a row browses to it; the frame keeps the selection on the
+//  current file.  GUI thread only.
+// -----------------------------------------------------------------------------
+#ifndef FILELISTCTRL_H
+#define FILELISTCTRL_H
+
+#include <wx/listctrl.h>
+
+#include "FileList.h"
+
+class BCTVFrame;
+
+class FileListCtrl : public wxListCtrl
+{
+public:
+    enum { WIDTH = 240 };              // default width beside the canvas
+
+    FileListCtrl(BCTVFrame* host, const FileList& files);
+
+    void SyncList();                   // the file list grew or changed
+    void SetCurrent(int idx);          // select and scroll into view
+
+protected:
+    wxString OnGetItemText(long item, long column) const override;
+
+private:
+    void OnSelected(wxListEvent&);
+
+    BCTVFrame*      m_host;
+    const FileList& m_files;           // the frame's list, read on paint
+    int             m_current;
+    bool            m_selecting;       // our own SetCurrent, not a click
+
+    DECLARE_EVENT_TABLE()
+};
+
+#endif // FILELISTCTRL_H
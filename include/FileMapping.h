@@ -0,0 +1,62 @@
+// -----------------------------------------------------------------------------
+//  FileMapping.h – read-only windows onto a file of any size
+//
+//  The file is opened once; Map() then maps just the byte range asked for,
+//  its start rounded down to the allocation granularity, so a 32-bit build
+//  can read a file far larger than its address space a window at a time.
+//  A View stays valid on its own: closing the mapping, or dropping it,
+//  leaves the views already handed out mapped until they are released.
+//  Map() is thread-safe; Open() and Close() are not.
+// -----------------------------------------------------------------------------
+#ifndef FILEMAPPING_H
+#define FILEMAPPING_H
+
+#include <wx/string.h>
+#include <cstdint>
+#include <memory>
+
+class FileMapping
+{
+public:
+    class View
+    {
+    public:
+        ~View();
+        const unsigned char* Data() const { return m_data; }
+        size_t               Size() const { return m_size; }
+        uint64_t             Offset() const { return m_offset; }   // of Data() in the file
+
+    private:
+        friend class FileMapping;
+        View() : m_base(NULL), m_baseSize(0), m_data(NULL), m_size(0), m_offset(0) {}
+
+        void*                m_base;          // as mapped, granularity-aligned
+        size_t               m_baseSize;
+        const unsigned char* m_data;
+        size_t               m_size;
+        uint64_t             m_offset;
+    };
+
+    FileMapping();
+    ~FileMapping();
+
+    // Quietly false for a missing or empty file
+    bool Open(const wxString& file);
+    void Close();
+    bool     IsOpened() const { return m_handle != NULL || m_fd >= 0; }
+    uint64_t Length() const   { return m_length; }
+
+    // [offset, offset + size) clipped to the file's length at Open(); NULL
+    // if that is empty or the address space has no room for it
+    std::shared_ptr<const View> Map(uint64_t offset, uint64_t size) const;
+
+private:
+    FileMapping(const FileMapping&);
+    FileMapping& operator=(const FileMapping&);
+
+    void*    m_handle;                 // Windows: the file mapping object
+    int      m_fd;                     // elsewhere: the open file
+    uint64_t m_length;
+};
+
+#endif // FILEMAPPING_H
@@ -0,0 +1,50 @@
+// -----------------------------------------------------------------------------
+//  FileSource.h – where a texture's bytes come from
+//
+//  A browse path is either a plain file or a member of a ZIP / pack archive,
+//  written the way wxFileSystem does it: "D:\packs\ui.zip#zip:hud/icons.dds".
+//  Loaders, probes and the indexers open, stat and list through here and do
+//  not care which it is, so archive members sit in the browse list, the
+//  caches and the library like any other file.  Archives are opened once
+//  and shared (a few stay open); one that changes on disk is reopened.
+//  Quiet and thread-safe.
+// -----------------------------------------------------------------------------
+#ifndef FILESOURCE_H
+#define FILESOURCE_H
+
+#include <wx/string.h>
+#include <wx/stream.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ZipArchive;
+
+class FileSource
+{
+public:
+    enum { OPEN_ARCHIVES = 8 };        // indexed archives kept between uses
+
+    static bool     IsMember(const wxString& path);
+    static bool     SplitMember(const wxString& path, wxString& archive, wxString& member);
+    static wxString MemberPath(const wxString& archive, const wxString& member);
+
+    // A ZIP by extension (zip, pk3, pk4) and signature
+    static bool IsArchive(const wxString& path);
+
+    // Caller owns the stream; NULL if it cannot be opened
+    static wxInputStream* Open(const wxString& path);
+
+    // Members report their unpacked size and the archive's mtime
+    static bool Stat(const wxString& path, uint64_t& size, int64_t& mtime);
+
+    // The folder a path is browsed with: the archive, for a member
+    static wxString FolderOf(const wxString& path);
+
+    // *.dds then *.bct members, as member paths, in archive order
+    static bool ListArchive(const wxString& archive, std::vector<wxString>& out);
+
+    static std::shared_ptr<ZipArchive> Archive(const wxString& path);
+};
+
+#endif // FILESOURCE_H
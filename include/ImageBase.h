@@ -3,17 +3,60 @@
 // ============================================================================
 
 #pragma once
+#include "BufferPool.h"
+#include "MemoryBudget.h"
+#include "Profiler.h"
 #include <wx/string.h>
+#include <wx/thread.h>
+#include <functional>
+#include <cstdint>
+
+// Header facts, cheap to keep around (thumbnail cache, browse list)
+struct ImageMeta
+{
+    enum Kind { KIND_NONE, KIND_DDS, KIND_BCT };
+
+    int      kind;
+    int      width, height, mips;
+    uint32_t format;       // DDS FourCC, or the BCT format byte (DXGI)
+    uint32_t hash;         // BCT imgHash, 0 for DDS
+    bool     bigEndian;    // Xbox 360 BCT
+
+    ImageMeta() : kind(KIND_NONE), width(0), height(0), mips(0),
+                  format(0), hash(0), bigEndian(false) {}
+};
 
 class ImageBase
 {
 public:
+    ImageBase() : m_pixelBytes(MemoryBudget::PIXELS), m_blockBytes(MemoryBudget::BLOCKS),
+                  m_decodeState(DECODE_PENDING) {}
     virtual ~ImageBase() = default;
 
+    // Parses the header and keeps mip 0 in memory; block-compressed pixels
+    // are expanded on the first EnsurePixels() so zoomed-out views can stay
+    // in the compressed domain.
     virtual bool LoadFromFile(const wxString& path) = 0;
+
+    // Loads only the smallest stored mip whose long edge is >= minSide, for
+    // thumbnails; Width()/Height() then describe that level, Meta() mip 0.
+    // Formats without a usable mip chain load mip 0.
+    virtual bool LoadSmallMip(const wxString& path, int minSide) { return LoadFromFile(path); }
     virtual int  Width()  const = 0;
     virtual int  Height() const = 0;
-    virtual const unsigned char* Data() const = 0;
+    virtual const unsigned char* Data() const = 0;   // valid after EnsurePixels()
+
+    // Polled between block rows; returning true abandons the decode
+    typedef std::function<bool()> CancelFn;
+
+    // Decodes once (thread-safe); false if the pixels could not be produced
+    // or the decode was cancelled – a cancelled decode is retried next call
+    bool EnsurePixels(const CancelFn& cancelled = CancelFn()) const;
+
+    // Compressed-domain access: the loaded level, linear little-endian blocks
+    enum BlockFormat { BLK_NONE, BLK_BC1, BLK_BC2, BLK_BC3, BLK_BC4, BLK_BC5 };
+    virtual BlockFormat          GetBlockFormat() const { return BLK_NONE; }
+    virtual const unsigned char* Blocks()         const { return NULL; }
 
     virtual void ApplyNormalRG() {}
     virtual void ApplyNormalAG() {}
@@ -21,9 +64,44 @@ public:
 
     virtual void PreMultiplyAlpha() {}
 
+    // What the loaded level cost to open, parse, untile and decode
+    const Profiler::Breakdown& LoadTimes() const { return m_times; }
+
+    // Bytes actually allocated right now (0 pixels until decoded)
+    size_t PixelBytes() const { return m_pixelBytes.Bytes(); }
+    size_t BlockBytes() const { return m_blockBytes.Bytes(); }
+
     // Added reporting functions
+    virtual ImageMeta Meta() const = 0;
     virtual wxString GetFormat() const = 0;
-    virtual wxString GetSize() const;
-    virtual wxString GetMipCount() const;
-    virtual wxString GetMemoryUsage() const;
+    virtual wxString GetSize() const = 0;
+    virtual wxString GetMipCount() const = 0;
+    virtual wxString GetMemoryUsage() const = 0;
+
+protected:
+    virtual bool DecodePixels(const CancelFn& cancelled) = 0;   // blocks → Data()
+    void ResetDecoded() { m_decodeState = DECODE_PENDING; m_times.Reset(); }   // on (re)load
+
+    Profiler::Breakdown  m_times;      // loaders add their stages here
+    MemoryBudget::Charge m_pixelBytes; // set with every Data() (re)allocation
+    MemoryBudget::Charge m_blockBytes; // and every Blocks() one
+
+private:
+    enum { DECODE_PENDING, DECODE_OK, DECODE_FAILED };
+    mutable wxMutex m_decodeLock;
+    mutable int     m_decodeState;
 };
+
+inline bool ImageBase::EnsurePixels(const CancelFn& cancelled) const
+{
+    wxMutexLocker lock(m_decodeLock);
+    if (m_decodeState == DECODE_PENDING) {
+        ImageBase* self = const_cast<ImageBase*>(this);
+        Profiler::Scope timed(Profiler::DECODE, &self->m_times);
+        if (self->DecodePixels(cancelled))
+            m_decodeState = DECODE_OK;
+        else if (!cancelled || !cancelled())
+            m_decodeState = DECODE_FAILED;
+    }
+    return m_decodeState == DECODE_OK;
+}
@@ -0,0 +1,86 @@
+// -----------------------------------------------------------------------------
+//  ImageCache.h – decoded images kept around for quick browsing
+//
+//  Paging back to an image seen a moment ago should not reopen, re-parse and
+//  re-decode it.  Loaded images are kept here, keyed by path (and validated
+//  against the file's modification time), until the byte budget is exceeded;
+//  then the least recently used ones are dropped.  An image still on screen
+//  or in the render worker stays alive through its own shared_ptr.
+//  Over the process-wide MemoryBudget, old images that nobody else holds
+//  are dropped as well, whatever this cache's own budget says.
+//  Thread-safe: the prefetch workers insert while the GUI looks up.
+// -----------------------------------------------------------------------------
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <wx/string.h>
+#include <wx/thread.h>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <ctime>
+
+#include "ImageBase.h"
+
+class ImageCache
+{
+public:
+    explicit ImageCache(size_t budgetBytes = size_t(512) << 20);
+
+    std::shared_ptr<ImageBase> Find(const wxString& path);   // refreshes LRU
+    bool Contains(const wxString& path) const;               // no LRU touch
+    void Insert(const wxString& path, const std::shared_ptr<ImageBase>& img);
+    void Erase(const wxString& path);   // file changed within its mtime tick
+    void Clear();
+    void Relieve();                    // evict while over the MemoryBudget
+
+    void   SetBudget(size_t budgetBytes);
+    size_t Budget() const;
+    size_t Bytes()  const;
+    size_t Count()  const;
+
+    // Opens and fully decodes a texture without any UI (loader / prefetch
+    // workers), at the level FitSide() allows.  Empty on failure or when
+    // cancelled() turned true.
+    static std::shared_ptr<ImageBase> LoadFile(const wxString& path,
+                            const ImageBase::CancelFn& cancelled = ImageBase::CancelFn());
+
+    // Header parsed, blocks read, no pixels yet; always mip 0 (batch tools)
+    static std::shared_ptr<ImageBase> OpenFile(const wxString& path);
+
+    // Long edge to load with LoadSmallMip() so one image stays within
+    // MemoryBudget::SingleImageLimit(); 0 when mip 0 fits
+    static int FitSide(const wxString& path);
+
+    // An empty loader for a sniffed signature; empty if it is neither format
+    static std::shared_ptr<ImageBase> ForSignature(uint32_t file4CC);
+
+    // Resident size once decoded: BGRA pixels plus the kept compressed blocks
+    static size_t Cost(const ImageBase& img);
+    static time_t ModTime(const wxString& path);   // archive members too
+
+private:
+    struct Entry {
+        wxString                   path;
+        std::shared_ptr<ImageBase> img;
+        time_t                     mtime;
+        size_t                     bytes;
+    };
+    typedef std::list<Entry> List;
+
+    struct PathHash {
+        size_t operator()(const wxString& s) const {
+            return std::hash<std::wstring>()(s.ToStdWstring());
+        }
+    };
+
+    void Trim();                       // m_lock held
+
+    mutable wxMutex                                    m_lock;
+    List                                               m_lru;   // front = newest
+    std::unordered_map<wxString, List::iterator, PathHash> m_map;
+    size_t                                             m_bytes;
+    size_t                                             m_budget;
+};
+
+#endif // IMAGECACHE_H
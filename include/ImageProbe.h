@@ -0,0 +1,37 @@
+// -----------------------------------------------------------------------------
+//  ImageProbe.h – header-only facts about a texture file
+//
+//  Width, height, format, mip count and byte order come from the file header
+//  and mip table alone; no pixel memory is allocated and no mip data is read.
+//  Through the ThumbCache a known file costs one stat() and nothing else, so
+//  the browse list can be sorted or filtered on these facts for a whole
+//  folder without opening it again.  Safe on any thread.
+// -----------------------------------------------------------------------------
+#ifndef IMAGEPROBE_H
+#define IMAGEPROBE_H
+
+#include <wx/string.h>
+#include <cstdint>
+
+#include "ImageBase.h"
+
+class ThumbCache;
+
+class ImageProbe
+{
+public:
+    // Sniffs the signature and parses the matching header; quiet
+    static bool Probe(const wxString& path, ImageMeta& meta);
+
+    // Cached facts when size + mtime still match, else Probe() and record
+    // the result (a failed probe is recorded as KIND_NONE)
+    static bool ProbeCached(const wxString& path, ThumbCache* thumbs, ImageMeta& meta);
+
+    // Short name shared by DDS FourCCs and BCT formats: "DXT1", "ATI2", ...
+    static wxString FormatName(const ImageMeta& meta);
+
+    // Bytes of the whole mip chain as stored (0 for unknown formats)
+    static uint64_t StoredBytes(const ImageMeta& meta);
+};
+
+#endif // IMAGEPROBE_H
@@ -0,0 +1,41 @@
+// -----------------------------------------------------------------------------
+//  ImageScale.h – BGRA32 resamplers used by BCTVFrame::RebuildBitmap
+//
+//  Nearest is the plain path.  BoxShrink area-averages when zooming out and
+//  can do so in linear light: sRGB bytes are widened through an 8→16-bit
+//  table, summed as integers and re-encoded through a 16→8-bit table, so no
+//  float ever reaches the inner loop.
+// -----------------------------------------------------------------------------
+#ifndef IMAGESCALE_H
+#define IMAGESCALE_H
+
+#include <cstdint>
+
+namespace ImageScale {
+
+// Nearest-neighbour resample of any size ratio.
+void Nearest(const unsigned char* src, int sw, int sh, int srcPitch,
+             unsigned char* dst, int dw, int dh, int dstPitch);
+
+// Box-filter shrink (dw <= sw, dh <= sh).  With linearLight the B/G/R
+// channels are averaged in linear light, alpha is always averaged as stored.
+void BoxShrink(const unsigned char* src, int sw, int sh, int srcPitch,
+               unsigned char* dst, int dw, int dh, int dstPitch,
+               bool linearLight);
+
+// Region variants: render only the [rx,ry,rw,rh] window of a virtual dw×dh
+// output into dst (rw×rh).  Used by the canvas tile cache while panning.
+void NearestRegion(const unsigned char* src, int sw, int sh, int srcPitch,
+                   unsigned char* dst, int dstPitch, int dw, int dh,
+                   int rx, int ry, int rw, int rh);
+void BoxShrinkRegion(const unsigned char* src, int sw, int sh, int srcPitch,
+                     unsigned char* dst, int dstPitch, int dw, int dh,
+                     int rx, int ry, int rw, int rh, bool linearLight);
+
+// Table lookups behind the linear-light path (exposed for reuse).
+uint16_t      SrgbToLinear16(unsigned char v);
+unsigned char Linear16ToSrgb(uint16_t v);
+
+} // namespace ImageScale
+
+#endif // IMAGESCALE_H
@@ -0,0 +1,72 @@
+// -----------------------------------------------------------------------------
+//  MemoryBudget.h – what the viewer holds in memory, and how much it may
+//
+//  Every large buffer is charged to a category when it is allocated and
+//  released with it: decoded pixels, kept compressed blocks, load-time
+//  staging (raw file bytes, the Xbox 360 untile), the render worker's frames
+//  and previews, the canvas bitmap and its tiles, thumbnails.  The sizes are
+//  the real allocations – vector capacity, new[] length – not estimates, and
+//  the totals are lock-free atomics any thread can read.
+//
+//  One process-wide budget governs the caches that can give memory back:
+//    ImageCache   evicts least-recently-used images while over it;
+//    Prefetcher   does not load neighbours while it is nearly used up;
+//    TileCache    drops canvas tiles down to what covers the window;
+//    image loads  pick a smaller mip when mip 0 alone would take more
+//                 than Budget() / SINGLE_SHARE.
+//  What is on screen is never freed to make room; the budget can be exceeded
+//  by the one image being shown.  Idle BufferPool buffers are shown as POOL
+//  but not held against the budget: the pool caps them itself.
+// -----------------------------------------------------------------------------
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <atomic>
+#include <cstddef>
+
+class MemoryBudget
+{
+public:
+    enum Category {
+        PIXELS,         // decoded BGRA of loaded images
+        BLOCKS,         // compressed levels kept for the block views
+        STAGING,        // file bytes and untile output while a load runs
+        FRAMES,         // render worker frame buffers and block previews
+        BITMAPS,        // canvas bitmap and its tiles
+        THUMBS,         // filmstrip / grid thumbnails
+        POOL,           // idle BufferPool buffers waiting for the next load
+        CATEGORIES
+    };
+    enum { SINGLE_SHARE = 2 };         // one image: at most budget / this
+    enum { PREFETCH_PCT = 85 };        // neighbours load below this fill
+
+    // Charged bytes of one buffer; moves the category total with it
+    class Charge
+    {
+    public:
+        explicit Charge(Category cat, size_t bytes = 0) : m_cat(cat), m_bytes(0) { Set(bytes); }
+        ~Charge() { Set(0); }
+        void   Set(size_t bytes);      // owner thread; others may read
+        size_t Bytes() const           { return m_bytes.load(std::memory_order_relaxed); }
+    private:
+        Charge(const Charge&);
+        Charge& operator=(const Charge&);
+        Category            m_cat;
+        std::atomic<size_t> m_bytes;
+    };
+
+    static size_t Bytes(int cat);
+    static size_t Total();
+    static size_t Peak();              // highest Total() so far
+
+    static void   SetBudget(size_t bytes);
+    static size_t Budget();
+    static size_t Held();                      // Total() less idle POOL
+    static bool   Over(size_t extra = 0);      // Held() + extra > Budget()
+    static bool   Prefetchable();              // under PREFETCH_PCT of it
+    static size_t SingleImageLimit();          // Budget() / SINGLE_SHARE
+
+    static const char* CategoryName(int cat);
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,91 @@
+// -----------------------------------------------------------------------------
+//  Prefetcher.h – latest-wins image loading into the ImageCache
+//
+//  After every image change the frame hands over the next few files in the
+//  browse direction (and one or two behind).  A small pool of workers loads
+//  and decodes them into the cache, nearest first, so holding PageDown finds
+//  each image already decoded.
+//
+//  Browsing to an image that is not cached submits it as the focus, ahead of
+//  its neighbours; when it is ready a LoadResult is posted to the sink.  A new
+//  list replaces whatever has not been started yet, and decodes poll their
+//  file between block rows: one that left the list, or any neighbour while a
+//  focus waits for a worker, is abandoned.  So a burst of wheel steps only
+//  pays the full decode for the image the user lands on.  Neighbours are
+//  skipped while the MemoryBudget is nearly used up.  Every image loaded
+//  here also leaves its header facts and a thumbnail in the ThumbCache.
+// -----------------------------------------------------------------------------
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <wx/thread.h>
+#include <wx/event.h>
+#include <wx/string.h>
+#include <deque>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "ImageBase.h"
+
+class ImageCache;
+class ThumbCache;
+
+struct LoadResult
+{
+    wxString                   path;
+    std::shared_ptr<ImageBase> img;    // empty if the file failed to load
+};
+
+class Prefetcher
+{
+public:
+    enum { AHEAD = 4, BEHIND = 1 };    // neighbours queued per image change
+
+    Prefetcher(ImageCache& cache, wxEvtHandler* sink, int eventId,
+               ThumbCache* thumbs = NULL, int workers = 2);
+    ~Prefetcher();                     // stops and joins the workers
+
+    bool Start();                      // false if no worker could be started
+
+    // Replaces the queue.  With focusFirst, paths[0] is the image the user is
+    // waiting for and its LoadResult is posted to the sink.
+    void Submit(const std::vector<wxString>& paths, bool focusFirst = false);
+
+private:
+    class Worker : public wxThread
+    {
+    public:
+        explicit Worker(Prefetcher* owner)
+        : wxThread(wxTHREAD_JOINABLE), m_owner(owner) {}
+    protected:
+        ExitCode Entry() override;
+    private:
+        Prefetcher* m_owner;
+    };
+
+    bool Next(wxString& path);         // blocks; false on shutdown
+    void Finished(const wxString& path, const std::shared_ptr<ImageBase>& img,
+                  bool cancelled);
+    bool Unwanted(const wxString& path);
+    void PostResult(const wxString& path, const std::shared_ptr<ImageBase>& img);
+    void RecordThumb(const wxString& path, const ImageBase& img);
+
+    ImageCache&          m_cache;
+    wxEvtHandler*        m_sink;
+    int                  m_eventId;
+    ThumbCache*          m_thumbs;     // optional; gets meta + thumbnails
+    int                  m_workerCount;
+    std::vector<Worker*> m_workers;
+
+    wxMutex              m_lock;       // guards everything below
+    wxCondition          m_wake;
+    std::deque<wxString> m_queue;
+    std::set<wxString>   m_inFlight;   // being loaded right now
+    std::set<wxString>   m_wanted;     // last submitted list
+    wxString             m_focus;      // empty when nobody is waiting
+    bool                 m_focusQueued;   // focus not picked up by a worker yet
+    bool                 m_quit;
+};
+
+#endif // PREFETCHER_H
@@ -0,0 +1,86 @@
+// -----------------------------------------------------------------------------
+//  Profiler.h – where the time of one texture load and one frame goes
+//
+//  Scopes around the stages of the load and display path (open, header,
+//  byte swap, untile, decode, post-process, scale, blit) each add one event
+//  to a process-wide ring buffer.  Any thread writes without a lock: a slot
+//  is claimed with one atomic increment and published through its sequence
+//  number, so a reader copying the ring skips the few slots still being
+//  written instead of stalling the loaders.  The newest RING events survive.
+//
+//  A scope can also add its time to a Breakdown – ImageBase keeps one per
+//  image, so the status bar shows what the shown texture cost even when the
+//  prefetch workers have loaded others since.  The ring is written out as
+//  Chrome trace-event JSON (chrome://tracing, Perfetto) on request.
+// -----------------------------------------------------------------------------
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <wx/string.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class Profiler
+{
+public:
+    enum Stage {
+        OPEN,           // file or archive member opened
+        HEADER,         // header parsed and the level's bytes read
+        SWAP,           // Xbox 360 16-bit byte swap
+        UNTILE,         // Xbox 360 tiled blocks to linear
+        DECODE,         // blocks to BGRA
+        POSTPROCESS,    // normal-map rebuild, channel masks
+        SCALE,          // zoom resample of a frame or tile
+        BLIT,           // BGRA frame into a wxBitmap
+        STAGES
+    };
+    enum { RING = 8192 };              // events kept, a power of two
+
+    struct Event
+    {
+        uint64_t startUs;              // since process start
+        uint32_t durUs;
+        uint32_t thread;
+        int      stage;
+    };
+
+    // Per-stage totals that one thread adds to while another reads
+    class Breakdown
+    {
+    public:
+        Breakdown() { Reset(); }
+        void   Reset();
+        void   Add(int stage, uint32_t us);
+        double Ms(int stage) const;
+    private:
+        Breakdown(const Breakdown&);
+        Breakdown& operator=(const Breakdown&);
+        std::atomic<uint32_t> m_us[STAGES];
+    };
+
+    // Times its own lifetime as one event of stage
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage, Breakdown* into = NULL)
+            : m_stage(stage), m_into(into), m_start(NowUs()) {}
+        ~Scope();
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+        Stage      m_stage;
+        Breakdown* m_into;
+        uint64_t   m_start;
+    };
+
+    static uint64_t NowUs();
+    static void     Record(Stage stage, uint64_t startUs, uint64_t endUs);
+
+    static double   LastMs(int stage);                // newest event, any thread
+    static void     Snapshot(std::vector<Event>& out); // oldest first
+    static bool     WriteChromeTrace(const wxString& file);
+    static const char* StageName(int stage);
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,110 @@
+// -----------------------------------------------------------------------------
+//  RenderThread.h – off-GUI-thread scale / channel-mask / post-process pass
+//
+//  The frame submits a RenderJob describing the view; the worker renders it
+//  into one of two BGRA buffers and posts a wxThreadEvent.  Buffers change
+//  hands through an atomic state per buffer, so neither side ever blocks on
+//  the other – the GUI thread only turns the finished buffer into a bitmap.
+// -----------------------------------------------------------------------------
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <wx/thread.h>
+#include <wx/event.h>
+#include <wx/bitmap.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+
+#include "ImageBase.h"
+
+struct RenderJob
+{
+    std::shared_ptr<const ImageBase> img;   // kept alive while rendering
+    int      w, h;                          // output size (already zoomed)
+    int      rx, ry, rw, rh;                // sub-rectangle; rw == 0 → whole
+    double   zoom;
+    bool     showR, showG, showB, showA;
+    bool     filtShr, filtLinear;
+    int      pp;                            // 0 none, 1 RG, 2 AG, 3 ARG
+    unsigned serial;
+
+    RenderJob() : w(0), h(0), rx(0), ry(0), rw(0), rh(0), zoom(1.0),
+                  showR(true), showG(true), showB(true), showA(false),
+                  filtShr(true), filtLinear(false), pp(0), serial(0) {}
+};
+
+struct RenderTile
+{
+    RenderJob                  job;         // job.rx / job.ry locate the tile
+    PooledBytes                bgra;
+    int                        w, h;
+    MemoryBudget::Charge       bytes;       // until the GUI made it a bitmap
+
+    RenderTile() : w(0), h(0), bytes(MemoryBudget::FRAMES) {}
+};
+
+class RenderThread : public wxThread
+{
+public:
+    RenderThread(wxEvtHandler* sink, int frameEventId, int tileEventId);
+
+    void Submit(const RenderJob& job);      // replaces a job not yet started
+    void SubmitTiles(const std::vector<RenderJob>& tiles);  // replaces queue
+    void Quit();                            // call before Wait()
+
+    // GUI thread: take the newest finished frame, if any
+    bool AcquireFrame(wxBitmap& out, unsigned* serial = NULL);
+
+    // Fallback when the thread could not be started: render inline
+    // Both write into out when it is an unshared bitmap of the right size,
+    // so the caller can hand back the frame it no longer shows
+    static bool RenderNow(const RenderJob& job, wxBitmap& out);
+    static bool ToBitmap(const unsigned char* bgra, int w, int h, wxBitmap& out);
+
+protected:
+    ExitCode Entry() override;
+
+private:
+    enum { BUF_FREE, BUF_WRITING, BUF_READY, BUF_READING };
+
+    struct Buffer {
+        std::atomic<int>           state;
+        PooledBytes                bgra;
+        int                        w, h;
+        std::atomic<unsigned>      serial;
+        MemoryBudget::Charge       bytes;
+        Buffer() : state(BUF_FREE), w(0), h(0), serial(0), bytes(MemoryBudget::FRAMES) {}
+    };
+
+    // Block-average preview of the current image (zoom <= 1/4), worker only
+    struct Preview {
+        std::weak_ptr<const ImageBase> img;
+        bool                           linear;
+        std::vector<unsigned char>     bgra;
+        int                            w, h;
+        MemoryBudget::Charge           bytes;
+        Preview() : linear(false), w(0), h(0), bytes(MemoryBudget::FRAMES) {}
+    };
+
+    Buffer* ClaimBack();
+    static void Render(const RenderJob& job, Preview& preview,
+                       PooledBytes& bgra, int& w, int& h);
+
+    wxEvtHandler*   m_sink;
+    int             m_frameEventId;
+    int             m_tileEventId;
+
+    wxMutex         m_lock;                 // guards jobs, tiles and m_quit
+    wxCondition     m_wake;
+    RenderJob       m_job;
+    bool            m_hasJob;
+    std::deque<RenderJob> m_tiles;
+    bool            m_quit;
+
+    Buffer          m_buf[2];
+    Preview         m_preview;
+};
+
+#endif // RENDERTHREAD_H
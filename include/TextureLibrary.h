@@ -0,0 +1,117 @@
+// -----------------------------------------------------------------------------
+//  TextureLibrary.h – header index of whole texture trees
+//
+//  A dump is a deep tree of thousands of folders, while the browse list only
+//  ever knows one of them.  The library walks a root recursively with a pool
+//  of threads: each worker takes a folder off a shared queue, pushes its
+//  subfolders back and probes the *.dds / *.bct headers it holds (members of
+//  ZIP packs included), so many
+//  directory reads and header reads are in flight at once and the disk, not
+//  one thread, sets the pace.  Re-indexing a root reuses every entry whose
+//  size and mtime still match, so only new or changed files are opened.
+//
+//  The index is kept on disk in one compact file (front-coded paths plus a
+//  fixed record of header facts) and searched with a TextureQuery.  It is
+//  not thread-safe; LibraryIndexer builds into a private copy for the viewer.
+// -----------------------------------------------------------------------------
+#ifndef TEXTURELIBRARY_H
+#define TEXTURELIBRARY_H
+
+#include <wx/thread.h>
+#include <wx/event.h>
+#include <wx/string.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ImageBase.h"
+#include "TextureQuery.h"
+
+class TextureLibrary
+{
+public:
+    enum { MAX_JOBS = 64 };
+
+    struct Entry
+    {
+        wxString  path;                // absolute
+        uint64_t  size;
+        int64_t   mtime;
+        ImageMeta meta;
+    };
+
+    struct Progress
+    {
+        size_t dirs;                   // folders read so far
+        size_t files;                  // textures accepted so far
+        size_t probed;                 // of those, headers actually opened
+    };
+    typedef std::function<void(const Progress&)> ProgressFn;
+    typedef std::function<bool()>                CancelFn;
+
+    bool Load(const wxString& file);   // false leaves the library empty
+    bool Save(const wxString& file) const;
+    static wxString DefaultFile();     // in the user's local data dir
+
+    // Threads for Index(): the walk waits on the disk far more than on the
+    // CPU, so a few per core
+    static int DefaultJobs();
+
+    // Replaces every entry under root with a fresh recursive walk.  progress
+    // and cancelled are polled on the calling thread a few times a second;
+    // a cancelled walk leaves the library as it was and returns false.
+    bool Index(const wxString& root, int jobs = 0,
+               const ProgressFn& progress = ProgressFn(),
+               const CancelFn& cancelled = CancelFn());
+
+    // Entries matching the query, in path order or in query order if Sorted()
+    void Find(const TextureQuery& query, std::vector<const Entry*>& out) const;
+
+    const std::vector<Entry>& Entries() const { return m_entries; }
+    size_t Count() const { return m_entries.size(); }
+
+    // Absolute folder path without a trailing separator
+    static wxString NormalizeRoot(const wxString& root);
+
+private:
+    std::vector<Entry> m_entries;      // sorted by path
+};
+
+struct LibraryProgress
+{
+    TextureLibrary::Progress        counts;
+    bool                            done;
+    std::shared_ptr<TextureLibrary> library;   // on the last one; empty if it
+                                               // failed or was cancelled
+};
+
+// Index() + Save() on a thread of its own, for the viewer.  Works on a copy
+// of base, posts a LibraryProgress a few times a second and a final one
+// (done) carrying the new library.
+class LibraryIndexer : public wxThread
+{
+public:
+    LibraryIndexer(wxEvtHandler* sink, int eventId,
+                   const std::shared_ptr<const TextureLibrary>& base,
+                   const wxString& root, const wxString& file);
+
+    void Cancel() { m_cancel = true; }  // then Wait()
+
+protected:
+    ExitCode Entry() override;
+
+private:
+    void Post(const TextureLibrary::Progress& counts, bool done,
+              const std::shared_ptr<TextureLibrary>& library);
+
+    wxEvtHandler*                         m_sink;
+    int                                   m_eventId;
+    std::shared_ptr<const TextureLibrary> m_base;
+    wxString                              m_root;
+    wxString                              m_file;
+    std::atomic<bool>                     m_cancel;
+};
+
+#endif // TEXTURELIBRARY_H
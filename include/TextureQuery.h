@@ -0,0 +1,57 @@
+// -----------------------------------------------------------------------------
+//  TextureQuery.h – sort order and filter for the browse list
+//
+//  Everything here runs on probed header facts (ImageMeta), never on pixels:
+//  a filter such as "ATI2, 2048 and up" is a comparison per file.  The
+//  default query keeps every file in folder order.  The same query drives
+//  the browse list, the texture library search and the command line.
+// -----------------------------------------------------------------------------
+#ifndef TEXTUREQUERY_H
+#define TEXTUREQUERY_H
+
+#include <wx/string.h>
+#include <cstdint>
+
+#include "ImageBase.h"
+
+struct TextureQuery
+{
+    enum SortKey { SORT_FOLDER, SORT_NAME, SORT_DIMENSIONS, SORT_FORMAT, SORT_BYTES };
+    enum Endian  { ENDIAN_ANY, ENDIAN_LITTLE, ENDIAN_BIG };
+
+    int      sort;
+    bool     descending;
+    wxString format;        // ImageProbe::FormatName(); empty = any
+    int      minSide;       // longest edge at least this; 0 = any
+    int      maxSide;       // longest edge at most this; 0 = any
+    int      minMips;       // mip count range; 0 = any
+    int      maxMips;
+    uint64_t minBytes;      // stored mip chain at least this; 0 = any
+    int      endian;
+    wxString name;          // wildcard on the file name (or the path if it
+                            // has a separator), case-insensitive; empty = any
+
+    TextureQuery() : sort(SORT_FOLDER), descending(false), minSide(0), maxSide(0),
+                     minMips(0), maxMips(0), minBytes(0), endian(ENDIAN_ANY) {}
+
+    bool Sorted()   const { return sort != SORT_FOLDER; }
+    bool Filtered() const {
+        return !format.IsEmpty() || minSide > 0 || maxSide > 0 || minMips > 0 ||
+               maxMips > 0 || minBytes > 0 || endian != ENDIAN_ANY || !name.IsEmpty();
+    }
+
+    bool Matches(const wxString& path, const ImageMeta& meta) const;
+
+    // Text form, e.g. "format:ATI2 min:2048 mips:2-13 platform:x360 sort:mem
+    // desc name:*door*"; a bare word is a file-name fragment.  Keys: format,
+    // min, max, mips (N or N-M), mem (bytes, K/M/G suffix), platform (pc |
+    // x360), name, sort (name | dims | format | mem), desc.  False with a
+    // message on the first bad token.
+    bool Parse(const wxString& text, wxString* error = NULL);
+
+    // Strict order for Sorted() queries; ties fall back to the file name
+    bool Less(const wxString& pathA, const ImageMeta& a,
+              const wxString& pathB, const ImageMeta& b) const;
+};
+
+#endif // TEXTUREQUERY_H
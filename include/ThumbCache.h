@@ -0,0 +1,113 @@
+// -----------------------------------------------------------------------------
+//  ThumbCache.h – persistent header / thumbnail cache across sessions
+//
+//  One file per user holds an append-only log of records, each keyed by
+//  path + file size + modification time and carrying the ImageMeta of the
+//  texture and, when known, a small BGRA thumbnail.  The file is scanned
+//  once at start-up, through a mapped window that slides along it, to build
+//  the in-memory index, so a known folder is indexed from stat() calls
+//  alone and its thumbnails are read straight out of a mapped window; no
+//  texture file is opened.
+//
+//  Records written during the session are buffered and appended; a new
+//  thumbnail is held in memory (charged to MemoryBudget::THUMBS) only until
+//  its record is on disk, then read back through the mapping like the rest.
+//  A torn tail from a crash is ignored on the next open.  Open() also
+//  compacts: once superseded records are over half of a log of at least
+//  COMPACT_MIN bytes, or the log passes MAX_FILE, the live records (the
+//  newest of them, down to 3/4 of MAX_FILE) are written to a file aside and
+//  renamed over the log.  Thread-safe.
+// -----------------------------------------------------------------------------
+#ifndef THUMBCACHE_H
+#define THUMBCACHE_H
+
+#include <wx/string.h>
+#include <wx/file.h>
+#include <wx/thread.h>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "ImageBase.h"
+#include "FileMapping.h"
+#include "MemoryBudget.h"
+
+class ThumbCache
+{
+public:
+    enum { THUMB = 64 };               // longest thumbnail side
+    enum { COMPACT_MIN = 8 << 20,      // superseded bytes worth a rewrite
+           MAX_FILE    = 256 << 20 };  // log size that forces one
+
+    ThumbCache();
+    ~ThumbCache();
+
+    // Indexes an existing cache file, compacting it if due, and opens it
+    // for appending; false leaves the cache working in memory only (a file
+    // that could not be read is then left as it is).
+    bool Open(const wxString& cacheFile);
+    static wxString DefaultFile();     // in the user's local data dir
+
+    // Size + mtime of a file (or archive member) without opening it
+    static bool Stat(const wxString& path, uint64_t& size, int64_t& mtime);
+
+    // Hits only if size and mtime still match the record
+    bool Lookup(const wxString& path, uint64_t size, int64_t mtime,
+                ImageMeta& meta) const;
+    bool Thumb(const wxString& path, uint64_t size, int64_t mtime,
+               std::vector<unsigned char>& bgra, int& w, int& h) const;
+    bool HasThumb(const wxString& path, uint64_t size, int64_t mtime) const;
+
+    // Records meta (and optionally a thumbnail); a record that already has
+    // a thumbnail is not replaced by one without
+    void Put(const wxString& path, uint64_t size, int64_t mtime,
+             const ImageMeta& meta,
+             const unsigned char* thumb = NULL, int tw = 0, int th = 0);
+    void Flush();                      // pushes buffered appends to disk
+
+    // Thumbnail of a loaded image: from the block preview when compressed,
+    // else from decoded pixels.  False if neither is available.
+    static bool MakeThumb(const ImageBase& img, std::vector<unsigned char>& bgra,
+                          int& w, int& h);
+
+private:
+    struct Slot {
+        uint64_t             size;
+        int64_t              mtime;
+        ImageMeta            meta;
+        std::vector<unsigned char> owned;   // a new thumb not yet on disk
+        uint64_t             thumbAt;  // else in the log; 0 if none
+        int                  tw, th;
+        uint64_t             recAt;    // the record in the log (where it
+        uint32_t             recLen;   // will go while recLen is 0)
+
+        bool HasThumb() const { return !owned.empty() || thumbAt; }
+    };
+    struct PathHash {
+        size_t operator()(const wxString& s) const {
+            return std::hash<std::wstring>()(s.ToStdWstring());
+        }
+    };
+
+    uint64_t Scan();                   // indexes records, returns good end; 0 if unreadable
+    uint64_t Compact(const wxString& cacheFile, uint64_t liveBytes);   // new end; 0 if not done
+    const unsigned char* ThumbBytes(const Slot& s) const;   // NULL if unreadable
+    void WritePending();               // appends m_pending, then maps what it wrote
+    void Disown(Slot& s);              // frees s.owned and its charge
+
+    mutable wxMutex                                m_lock;
+    std::unordered_map<wxString, Slot, PathHash>   m_index;
+    size_t                                         m_ownedBytes;
+    MemoryBudget::Charge                           m_charge;  // owned thumbs + m_pending
+
+    wxString                                       m_path;
+    wxFile                                         m_out;     // append handle
+    uint64_t                                       m_end;     // where m_pending goes
+    std::vector<unsigned char>                     m_pending; // unflushed records
+    std::vector< std::pair<wxString, uint64_t> >   m_pendingRecs;   // path, log offset
+
+    FileMapping                                    m_file;    // the log, mapped again per append
+    mutable std::shared_ptr<const FileMapping::View> m_window;  // last thumbnails read
+};
+
+#endif // THUMBCACHE_H
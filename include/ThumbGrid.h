@@ -0,0 +1,83 @@
+// -----------------------------------------------------------------------------
+//  ThumbGrid.h – virtualized thumbnail grid / filmstrip over the browse list
+//
+//  Shows the frame's file list either as a scrolling grid (in place of the
+//  canvas) or as a one-row filmstrip under it.  Nothing is created per file:
+//  cells are painted from the visible range only, thumbnails are requested
+//  for that range from a ThumbLoader pool, and the bitmaps live in a fixed-
+//  size LRU keyed by path, so memory stays flat however long the folder is.
+//  GUI thread only.
+// -----------------------------------------------------------------------------
+#ifndef THUMBGRID_H
+#define THUMBGRID_H
+
+#include <wx/vscroll.h>
+#include <set>
+
+#include "TileCache.h"
+#include "ThumbCache.h"
+#include "FileList.h"
+
+class BCTVFrame;
+class ThumbLoader;
+
+class ThumbGrid : public wxHVScrolledWindow
+{
+public:
+    enum {
+        PAD         = 6,                              // around each thumbnail
+        CELL        = ThumbCache::THUMB + 2 * PAD,
+        LABEL       = 16,                             // file name, grid only
+        MAX_BITMAPS = 1024                            // ~16 MB of thumbnails
+    };
+
+    ThumbGrid(BCTVFrame* host, const FileList& files, ThumbCache* thumbs);
+    ~ThumbGrid();                      // joins the loader pool
+
+    void SetStrip(bool strip);         // one row under the canvas, or a grid
+    bool IsStrip() const              { return m_strip; }
+    int  RowStride() const            { return m_strip ? 1 : m_cols; }   // files per row
+    int  StripHeight() const;          // client height the filmstrip needs
+
+    void SyncList();                   // the file list grew or changed
+    void Invalidate(const wxString& path);   // file rewritten: drop its bitmap
+    void SetCurrent(int idx);          // highlight and scroll into view
+
+protected:
+    wxCoord OnGetRowHeight(size_t row) const override;
+    wxCoord OnGetColumnWidth(size_t col) const override;
+
+private:
+    enum { ID_THUMB_DONE = wxID_HIGHEST + 1 };
+
+    int      Columns() const;
+    wxRect   CellRect(int idx) const;  // client coordinates
+    int      HitTest(const wxPoint& pt) const;
+    void     Relayout();
+    void     RequestVisible(int first, int last);
+    void     AddThumb(const wxString& path, const unsigned char* bgra, int w, int h);
+    static uint64_t PathKey(const wxString& path);
+
+    void OnPaint(wxPaintEvent&);
+    void OnErase(wxEraseEvent&) {}
+    void OnSize(wxSizeEvent&);
+    void OnLeftDown(wxMouseEvent&);
+    void OnLeftDClick(wxMouseEvent&);
+    void OnThumbDone(wxThreadEvent&);
+
+    BCTVFrame*           m_host;
+    const FileList&      m_files;      // the frame's list, read on paint
+    ThumbCache*          m_thumbs;
+    ThumbLoader*         m_loader;     // NULL: thumbnails load inline
+
+    bool                 m_strip;
+    int                  m_cols;
+    int                  m_current;
+    TileCache            m_bitmaps;    // view = path key, tx = ty = 0
+    std::set<wxString>   m_failed;     // no thumbnail, do not ask again
+    int                  m_reqFirst, m_reqLast;   // range last submitted
+
+    DECLARE_EVENT_TABLE()
+};
+
+#endif // THUMBGRID_H
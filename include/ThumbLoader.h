@@ -0,0 +1,77 @@
+// -----------------------------------------------------------------------------
+//  ThumbLoader.h – worker pool producing thumbnails for the browse grid
+//
+//  The grid submits the files of its visible cells after every scroll or
+//  resize; the list replaces whatever has not been started yet, so a fling
+//  through thousands of textures only loads the rows it comes to rest on.
+//  A thumbnail comes from the ThumbCache when it has one, else from the
+//  smallest stored mip that still covers it (LoadSmallMip) – the full image
+//  is never read or decoded.  New thumbnails are written back to the cache.
+//  Each result is posted to the sink as a ThumbResult.
+// -----------------------------------------------------------------------------
+#ifndef THUMBLOADER_H
+#define THUMBLOADER_H
+
+#include <wx/thread.h>
+#include <wx/event.h>
+#include <wx/string.h>
+#include <deque>
+#include <set>
+#include <vector>
+
+#include "ThumbCache.h"
+
+struct ThumbResult
+{
+    wxString                   path;
+    std::vector<unsigned char> bgra;   // empty if the file has no thumbnail
+    int                        w, h;
+};
+
+class ThumbLoader
+{
+public:
+    // Mip asked for: one preview pixel per 4x4 block still fills THUMB
+    enum { SOURCE_SIDE = ThumbCache::THUMB * 4 };
+
+    ThumbLoader(ThumbCache* thumbs, wxEvtHandler* sink, int eventId, int workers = 2);
+    ~ThumbLoader();                    // stops and joins the workers
+
+    bool Start();                      // false if no worker could be started
+
+    // Replaces the queue, first path first
+    void Submit(const std::vector<wxString>& paths);
+
+    // Cache hit or small-mip load, on the calling thread
+    static bool Load(const wxString& path, ThumbCache* thumbs,
+                     std::vector<unsigned char>& bgra, int& w, int& h);
+
+private:
+    class Worker : public wxThread
+    {
+    public:
+        explicit Worker(ThumbLoader* owner)
+        : wxThread(wxTHREAD_JOINABLE), m_owner(owner) {}
+    protected:
+        ExitCode Entry() override;
+    private:
+        ThumbLoader* m_owner;
+    };
+
+    bool Next(wxString& path);         // blocks; false on shutdown
+    void Finished(const wxString& path);
+
+    ThumbCache*          m_thumbs;
+    wxEvtHandler*        m_sink;
+    int                  m_eventId;
+    int                  m_workerCount;
+    std::vector<Worker*> m_workers;
+
+    wxMutex              m_lock;       // guards everything below
+    wxCondition          m_wake;
+    std::deque<wxString> m_queue;
+    std::set<wxString>   m_inFlight;
+    bool                 m_quit;
+};
+
+#endif // THUMBLOADER_H
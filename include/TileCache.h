@@ -0,0 +1,76 @@
+// -----------------------------------------------------------------------------
+//  TileCache.h – LRU of rendered canvas tiles
+//
+//  When the zoomed image is larger than the canvas it is drawn as TILE×TILE
+//  bitmaps.  Tiles are keyed by the view parameters (image, zoom, channel
+//  masks, filters, post-process) plus tile coordinates, so panning only has
+//  to render the newly exposed strips and toggling a channel back on finds
+//  the old tiles again.  The bitmaps are charged to a MemoryBudget category;
+//  over the budget the cache shrinks to its floor (what covers the window),
+//  never below.  GUI thread only.
+// -----------------------------------------------------------------------------
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <wx/bitmap.h>
+#include "MemoryBudget.h"
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+struct RenderJob;
+
+class TileCache
+{
+public:
+    enum { TILE = 256 };
+
+    explicit TileCache(size_t maxTiles = 192,
+                       MemoryBudget::Category cat = MemoryBudget::BITMAPS);
+
+    static uint64_t ViewKey(const RenderJob& view);
+    static size_t   BitmapBytes(const wxBitmap& bmp);     // what it is charged
+
+    wxBitmap* Find(uint64_t view, int tx, int ty);         // refreshes LRU
+    void      Insert(uint64_t view, int tx, int ty, const wxBitmap& bmp);
+    void      Erase(uint64_t view, int tx, int ty);
+    void      Clear();
+
+    size_t    Count() const    { return m_lru.size(); }
+    void      SetCapacity(size_t maxTiles);
+    void      SetFloor(size_t minTiles);   // kept over budget; default: all
+
+private:
+    struct Key {
+        uint64_t view;
+        int      tx, ty;
+        bool operator==(const Key& o) const {
+            return view == o.view && tx == o.tx && ty == o.ty;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = k.view ^ (uint64_t(uint32_t(k.tx)) << 32 | uint32_t(k.ty));
+            h ^= h >> 33; h *= 0xff51afd7ed558ccdULL; h ^= h >> 33;
+            return size_t(h);
+        }
+    };
+    struct Entry {
+        Key      key;
+        wxBitmap bmp;
+        size_t   bytes;
+    };
+    typedef std::list<Entry> List;
+
+    void Trim();
+    void PopOldest();
+
+    List                                          m_lru;    // front = newest
+    std::unordered_map<Key, List::iterator, KeyHash> m_map;
+    size_t                                        m_max;
+    size_t                                        m_floor;
+    size_t                                        m_sum;    // bytes of m_lru
+    MemoryBudget::Charge                          m_charge;
+};
+
+#endif // TILECACHE_H
@@ -0,0 +1,82 @@
+// -----------------------------------------------------------------------------
+//  ZipArchive.h – textures read straight out of ZIP / pack archives
+//
+//  Only the tail and the central directory (ZIP64 included) are mapped, and
+//  only while the archive is indexed when it is opened; after that a member
+//  is found by name in a hash map and never extracted to disk.  OpenMember()
+//  maps a window over just that member's local header and packed bytes, so
+//  a multi-GB pack opens on a 32-bit build, and hands out a wxInputStream
+//  the loaders read like a file:
+//
+//    - stored members are a wxMemoryInputStream over the window itself, so
+//      the only copy is the one the decoder makes into its own buffer;
+//    - deflated members are inflated as they are read.  Seeks are lazy and
+//      forward seeks skip by inflating, so "seek to end for the size, seek
+//      back" costs nothing and skipping large mips never buffers them.
+//
+//  A member the address space has no room for is read with positioned reads
+//  of the file instead.  An opened archive is immutable and shared; streams
+//  keep their own window alive.  Encrypted members and methods other than
+//  stored / deflate are listed as unreadable.  Thread-safe.
+// -----------------------------------------------------------------------------
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include "FileMapping.h"
+
+#include <wx/string.h>
+#include <wx/stream.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class ZipArchive
+{
+public:
+    struct Member
+    {
+        wxString name;                 // as stored, '/' separated
+        uint64_t headerOffset;         // local file header
+        uint64_t packedSize;
+        uint64_t size;
+        uint16_t method;               // 0 stored, 8 deflate
+        bool     readable;
+    };
+
+    ~ZipArchive();
+
+    // Indexes the archive; NULL if it is not a readable ZIP
+    static std::shared_ptr<ZipArchive> Open(const wxString& path);
+
+    const wxString&            Path() const    { return m_path; }
+    const std::vector<Member>& Members() const { return m_members; }
+    const Member*              Find(const wxString& name) const;
+
+    // Caller owns the stream; NULL if the member cannot be read
+    wxInputStream* OpenMember(const Member& m) const;
+
+    static bool LooksLikeZip(const wxString& path);   // signature only, quiet
+
+private:
+    ZipArchive();
+
+    // Where a member's packed bytes start, and the window over them (NULL
+    // if it could not be mapped); false if the local header is not there
+    struct Window
+    {
+        std::shared_ptr<const FileMapping::View> view;
+        const unsigned char*                     data;    // in view
+        uint64_t                                 dataAt;  // in the file
+    };
+    bool ReadDirectory();
+    bool Locate(const Member& m, Window& w) const;
+
+    wxString                              m_path;
+    std::vector<Member>                   m_members;
+    std::unordered_map<std::wstring, size_t> m_byName;
+
+    FileMapping                           m_file;
+};
+
+#endif // ZIPARCHIVE_H
@@ -1,19 +1,29 @@
 #include "BCTV.h"
 #include "DDSImage.h"
 #include "BCTImage.h"
+#include "BufferPool.h"
+#include "FileSource.h"
+#include "Profiler.h"
+#include "BlockEncoder.h"
 
 #include "ImageBase.h"  // Assuming ImageBase.h is included here
 
 #include <wx/dcbuffer.h>
+#include <wx/dcmemory.h>
 #include <wx/filedlg.h>
 #include <wx/msgdlg.h>
 #include <wx/clipbrd.h>
 #include <wx/rawbmp.h>
 #include <wx/wfstream.h>
+#include <wx/stopwatch.h>
+#include <wx/dirdlg.h>
+#include <wx/textdlg.h>
+#include <wx/progdlg.h>
 
 #include <wx/display.h>
 #include <wx/dir.h>
 #include <memory>
+#include <algorithm>
 #include <wx/icon.h>
 
 IMPLEMENT_APP(BCTVApp)
@@ -101,13 +111,14 @@ void BCTVApp::OnInitCmdLine(wxCmdLineParser& parser)
         { wxCMD_LINE_NONE }
     };
     parser.SetDesc(desc);
+    CommandLine::AddOptions(parser);
 }
 
 bool BCTVApp::OnCmdLineParsed(wxCmdLineParser& parser)
 {
     for (size_t i = 0; i < parser.GetParamCount(); ++i)
         m_startupFiles.push_back(parser.GetParam(i));
-    return true;                                   // keep launching
+    return m_cli.Parse(parser);                    // keep launching
 }
 
 /* ---------------------------------------------------------------------------
@@ -119,6 +130,8 @@ bool BCTVApp::OnInit()
         in turn invokes OnInitCmdLine and OnCmdLineParsed   */
     if ( !wxApp::OnInit() )
         return false;            // parsing said “abort”, etc.
+    if (m_cli.Active())
+        return true;             // OnRun() does the batch job instead
 
     wxInitAllImageHandlers();
 
@@ -135,6 +148,14 @@ bool BCTVApp::OnInit()
 }
 
 
+int BCTVApp::OnRun()
+{
+    if (m_cli.Active())
+        return m_cli.Run();
+    return wxApp::OnRun();
+}
+
+
 //bool BCTVApp::OnInit() {
 //wxInitAllImageHandlers();
 //BCTVFrame* frame = new BCTVFrame();
@@ -144,18 +165,38 @@ bool BCTVApp::OnInit()
 
 BEGIN_EVENT_TABLE(BCTVFrame, wxFrame)
 EVT_MENU(ID_FILE_OPEN, BCTVFrame::OnOpen)
+EVT_MENU(ID_FILE_SAVE_DDS, BCTVFrame::OnSaveDDS)
+EVT_MENU(ID_FILE_SAVE_BLOCKS, BCTVFrame::OnSaveBlocks)
+EVT_MENU(ID_FILE_SAVE_TRACE, BCTVFrame::OnSaveTrace)
+EVT_MENU(ID_FILE_LIB_INDEX, BCTVFrame::OnLibraryIndex)
+EVT_MENU(ID_FILE_LIB_FIND, BCTVFrame::OnLibraryFind)
 EVT_MENU(ID_FILE_EXIT, BCTVFrame::OnExit)
+EVT_MENU_RANGE(ID_VIEW_SINGLE, ID_VIEW_GRID, BCTVFrame::OnViewMode)
+EVT_MENU(ID_VIEW_LIST, BCTVFrame::OnViewList)
+EVT_MENU_RANGE(ID_LIST_SORT_FOLDER, ID_LIST_END_BIG, BCTVFrame::OnListQuery)
 EVT_MENU_RANGE(ID_CH_R, ID_CH_A, BCTVFrame::OnToggleChannel)
 EVT_MENU(ID_BG_COLOUR, BCTVFrame::OnBgColour)
 EVT_MENU(ID_FILT_SHR, BCTVFrame::OnFilter)
 EVT_MENU(ID_FILT_ENL, BCTVFrame::OnFilter)
+EVT_MENU(ID_FILT_LINEAR, BCTVFrame::OnFilter)
 EVT_MENU_RANGE(ID_WIN_CLIP, ID_WIN_TOP, BCTVFrame::OnWindowOpt)
 EVT_MENU_RANGE(ID_WHEEL_CYCLE, ID_WHEEL_50, BCTVFrame::OnWheelMode)
 EVT_MENU(ID_WRAP, BCTVFrame::OnWrapAuto)
 EVT_MENU(ID_AUTOZOOM, BCTVFrame::OnWrapAuto)
+EVT_MENU_RANGE(ID_CACHE_128, ID_CACHE_1024, BCTVFrame::OnCacheBudget)
 EVT_MENU_RANGE(ID_PP_NONE, ID_PP_ARG, BCTVFrame::OnPostProcess)
+EVT_MENU(ID_HELP_MEMORY, BCTVFrame::OnMemory)
 EVT_MENU(ID_HELP_ABOUT, BCTVFrame::OnAbout)
 EVT_CHAR_HOOK( BCTVFrame::OnKey)
+EVT_TIMER(ID_RENDER_TIMER, BCTVFrame::OnRenderTimer)
+EVT_THREAD(ID_RENDER_DONE, BCTVFrame::OnRenderDone)
+EVT_THREAD(ID_TILE_DONE, BCTVFrame::OnTileDone)
+EVT_THREAD(ID_INDEX_BATCH, BCTVFrame::OnIndexBatch)
+EVT_THREAD(ID_LOAD_DONE, BCTVFrame::OnLoadDone)
+EVT_FSWATCHER(wxID_ANY, BCTVFrame::OnFolderChange)
+EVT_TIMER(ID_SETTLE_TIMER, BCTVFrame::OnSettleTimer)
+EVT_THREAD(ID_LIBRARY_PROGRESS, BCTVFrame::OnLibraryProgress)
+EVT_THREAD(ID_ENCODE_PROGRESS, BCTVFrame::OnEncodeProgress)
 END_EVENT_TABLE()
 
 BEGIN_EVENT_TABLE(BCTVCanvas, wxPanel)
@@ -164,31 +205,92 @@ EVT_ERASE_BACKGROUND(BCTVCanvas::OnErase)
 EVT_MOTION (BCTVCanvas::OnMotion)
 EVT_MOUSEWHEEL (BCTVCanvas::OnWheel)
 EVT_LEFT_DOWN (BCTVCanvas::OnLeftDown)
+EVT_RIGHT_DOWN (BCTVCanvas::OnRightDown)
+EVT_RIGHT_UP (BCTVCanvas::OnRightUp)
+EVT_MOUSE_CAPTURE_LOST (BCTVCanvas::OnCaptureLost)
 END_EVENT_TABLE()
 
 BCTVFrame::BCTVFrame()
 : wxFrame(nullptr, wxID_ANY, "BCTV", wxDefaultPosition, wxSize(636,478),
           wxDEFAULT_FRAME_STYLE &~(wxRESIZE_BORDER|wxMAXIMIZE_BOX)),
-  m_canvas(new BCTVCanvas(this)),
-  m_img(NULL), m_zoom(1.0),
+  m_canvas(new BCTVCanvas(this)), m_grid(NULL), m_sideList(NULL), m_viewMode(VIEW_SINGLE),
+  m_img(), m_renderThread(NULL), m_renderSerial(0), m_tiledSerial(0), m_zoom(1.0),
   m_showR(true), m_showG(true), m_showB(true), m_showA(false),
-  m_filtShr(true), m_filtEnl(false),
+  m_filtShr(true), m_filtEnl(false), m_filtLinear(false),
   m_clip(true), m_center(true), m_top(false),
   m_wheelMode(0), m_wrap(true), m_auto(true), m_pp(0),
-  m_bg(*wxLIGHT_GREY), m_bgSecondary(wxColour(255, 0, 255)), m_curIdx(-1), m_wheelAccum(0), m_manualZoom(false)
+  m_bg(*wxLIGHT_GREY), m_bgSecondary(wxColour(255, 0, 255)), m_curIdx(-1),
+  m_parked(false), m_indexer(NULL), m_indexGen(0), m_indexing(false),
+  m_cache(size_t(512) << 20), m_prefetch(NULL), m_browseDir(1),
+  m_watcher(NULL), m_settleTimer(this, ID_SETTLE_TIMER),
+  m_libIndexer(NULL), m_libList(false), m_encoder(NULL), m_encodeDlg(NULL),
+  m_wheelAccum(0), m_manualZoom(false),
+  m_renderTimer(this, ID_RENDER_TIMER), m_dirty(0), m_lastRender(0), m_frameMs(16)
 {
-    // Initialize the status bar with 5 fields
-    m_statusBar = CreateStatusBar(5);
-    m_statusBar->SetStatusWidths(5, new int[5]{100, 100, 100, 200, 200});
+    // Index, format, size, mips, memory and the stage timings
+    static const int fieldWidths[6] = {100, 100, 100, 100, 330, -1};
+    m_statusBar = CreateStatusBar(6);
+    m_statusBar->SetStatusWidths(6, fieldWidths);
 
     wxMenuBar* mb = new wxMenuBar;
 
     wxMenu* mf = new wxMenu;
     mf->Append(ID_FILE_OPEN, "Open...\tO");
+    mf->Append(ID_FILE_SAVE_DDS, "Save BCT as DDS...\tCtrl+S");
+    mf->Append(ID_FILE_SAVE_BLOCKS, "Save as compressed DDS...\tCtrl+Shift+S");
+    mf->AppendCheckItem(ID_FILE_ENCODE_BEST, "Best compression quality (slower)");
+    mf->Append(ID_FILE_SAVE_TRACE, "Save timing trace...");
+    mf->AppendSeparator();
+    mf->Append(ID_FILE_LIB_INDEX, "Index folder tree...\tCtrl+I");
+    mf->Append(ID_FILE_LIB_FIND,  "Search library...\tCtrl+L");
     mf->AppendSeparator();
     mf->Append(ID_FILE_EXIT, "Exit\tESC");
     mb->Append(mf, "File");
 
+    wxMenu* mv = new wxMenu;
+    mv->AppendRadioItem(ID_VIEW_SINGLE, "Single image");
+    mv->AppendRadioItem(ID_VIEW_STRIP,  "Filmstrip\tF");
+    mv->AppendRadioItem(ID_VIEW_GRID,   "Thumbnail grid\tT");
+    mv->AppendSeparator();
+    mv->AppendCheckItem(ID_VIEW_LIST,   "File list\tS");
+    mv->AppendSeparator();
+
+    wxMenu* msort = new wxMenu;
+    msort->AppendRadioItem(ID_LIST_SORT_FOLDER, "Folder order");
+    msort->AppendRadioItem(ID_LIST_SORT_NAME,   "Name");
+    msort->AppendRadioItem(ID_LIST_SORT_DIMS,   "Dimensions");
+    msort->AppendRadioItem(ID_LIST_SORT_FORMAT, "Format");
+    msort->AppendRadioItem(ID_LIST_SORT_BYTES,  "Memory size");
+    msort->AppendSeparator();
+    msort->AppendCheckItem(ID_LIST_SORT_DESC,   "Descending");
+    mv->AppendSubMenu(msort, "Sort files by");
+
+    wxMenu* mshow = new wxMenu;
+    mshow->AppendRadioItem(ID_LIST_FMT_ANY,   "Any format");
+    mshow->AppendRadioItem(ID_LIST_FMT_DXT1,  "DXT1");
+    mshow->AppendRadioItem(ID_LIST_FMT_DXT3,  "DXT3");
+    mshow->AppendRadioItem(ID_LIST_FMT_DXT5,  "DXT5");
+    mshow->AppendRadioItem(ID_LIST_FMT_ATI1,  "ATI1");
+    mshow->AppendRadioItem(ID_LIST_FMT_ATI2,  "ATI2");
+    mshow->AppendRadioItem(ID_LIST_FMT_RGBA8, "RGBA8");
+    mshow->AppendSeparator();
+    mshow->AppendRadioItem(ID_LIST_SIDE_ANY,  "Any size");
+    mshow->AppendRadioItem(ID_LIST_SIDE_512,  "512 and up");
+    mshow->AppendRadioItem(ID_LIST_SIDE_1024, "1024 and up");
+    mshow->AppendRadioItem(ID_LIST_SIDE_2048, "2048 and up");
+    mshow->AppendRadioItem(ID_LIST_SIDE_4096, "4096 and up");
+    mshow->AppendSeparator();
+    mshow->AppendRadioItem(ID_LIST_MEM_ANY,   "Any memory size");
+    mshow->AppendRadioItem(ID_LIST_MEM_1M,    "1 MB and up");
+    mshow->AppendRadioItem(ID_LIST_MEM_4M,    "4 MB and up");
+    mshow->AppendRadioItem(ID_LIST_MEM_16M,   "16 MB and up");
+    mshow->AppendSeparator();
+    mshow->AppendRadioItem(ID_LIST_END_ANY,    "PC and Xbox 360");
+    mshow->AppendRadioItem(ID_LIST_END_LITTLE, "PC only (little-endian)");
+    mshow->AppendRadioItem(ID_LIST_END_BIG,    "Xbox 360 only (big-endian)");
+    mv->AppendSubMenu(mshow, "Show files");
+    mb->Append(mv, "View");
+
     wxMenu* mo = new wxMenu;
     mo->AppendCheckItem(ID_CH_R, "Show Red\tR");
     mo->AppendCheckItem(ID_CH_G, "Show Green\tG");
@@ -200,6 +302,8 @@ BCTVFrame::BCTVFrame()
     wxMenu* mfilt = new wxMenu;
     mfilt->AppendCheckItem(ID_FILT_SHR, "When Shrinking");
     mfilt->AppendCheckItem(ID_FILT_ENL, "When Enlarging");
+    mfilt->AppendSeparator();
+    mfilt->AppendCheckItem(ID_FILT_LINEAR, "Linear light (sRGB)");
     mo->AppendSubMenu(mfilt, "Filter Image");
 
     wxMenu* mwnd = new wxMenu;
@@ -220,6 +324,13 @@ BCTVFrame::BCTVFrame()
     mo->AppendCheckItem(ID_WRAP, "Wrap around while changing files");
     mo->AppendCheckItem(ID_AUTOZOOM, "Auto Zoom");
 
+    wxMenu* mcache = new wxMenu;
+    mcache->AppendRadioItem(ID_CACHE_128,  "128 MB");
+    mcache->AppendRadioItem(ID_CACHE_256,  "256 MB");
+    mcache->AppendRadioItem(ID_CACHE_512,  "512 MB");
+    mcache->AppendRadioItem(ID_CACHE_1024, "1 GB");
+    mo->AppendSubMenu(mcache, "Memory budget");
+
     wxMenu* mpp = new wxMenu;
     mpp->AppendRadioItem(ID_PP_NONE, "0: None");
     mpp->AppendRadioItem(ID_PP_RG, "1: Normal map RG");
@@ -230,23 +341,32 @@ BCTVFrame::BCTVFrame()
     mb->Append(mo, "Options");
 
     wxMenu* mh = new wxMenu;
+    mh->Append(ID_HELP_MEMORY, "Memory usage...");
     mh->Append(ID_HELP_ABOUT, "About");
     mb->Append(mh, "Help");
 
     SetMenuBar(mb);
 
+    mb->Check(ID_VIEW_SINGLE, true);
+    mb->Check(ID_LIST_SORT_FOLDER, true);
+    mb->Check(ID_LIST_FMT_ANY, true);
+    mb->Check(ID_LIST_SIDE_ANY, true);
+    mb->Check(ID_LIST_MEM_ANY, true);
+    mb->Check(ID_LIST_END_ANY, true);
     mb->Check(ID_CH_R, true);
     mb->Check(ID_CH_G, true);
     mb->Check(ID_CH_B, true);
     mb->Check(ID_CH_A, false);
     mb->Check(ID_FILT_SHR, true);
     mb->Check(ID_FILT_ENL, false);
+    mb->Check(ID_FILT_LINEAR, false);
     mb->Check(ID_WIN_CLIP, true);
     mb->Check(ID_WIN_CENTER, true);
     mb->Check(ID_WIN_TOP, false);
     mb->Check(ID_WHEEL_CYCLE, true);
     mb->Check(ID_WRAP, true);
     mb->Check(ID_AUTOZOOM, true);
+    mb->Check(ID_CACHE_512, true);
     mb->Check(ID_PP_NONE, true);
 
     //SetPrimaryBackgroundColor(*wxLIGHT_GREY);
@@ -255,10 +375,73 @@ BCTVFrame::BCTVFrame()
     SetBackgroundColour(m_bg);                 // frame stays grey
     m_canvas->SetBackgroundColour(m_bgSecondary); // canvas shows pink
     SetIcon(wxICON(APP_ICON));
+
+    // Pace renders to the monitor we start on (falls back to 60 Hz)
+    const int hz = wxDisplay(this).GetCurrentMode().refresh;
+    m_frameMs = (hz > 0) ? std::max(1, 1000 / hz) : 16;
+
+    m_renderThread = new RenderThread(this, ID_RENDER_DONE, ID_TILE_DONE);
+    if (m_renderThread->Run() != wxTHREAD_NO_ERROR) {
+        delete m_renderThread;
+        m_renderThread = NULL;         // RebuildBitmap renders inline instead
+    }
+
+    // Persistent header / thumbnail cache; in-memory only if it cannot open
+    m_thumbs.Open(ThumbCache::DefaultFile());
+
+    m_indexer = new DirIndexer(this, ID_INDEX_BATCH, &m_thumbs);
+    if (m_indexer->Run() != wxTHREAD_NO_ERROR) {
+        delete m_indexer;
+        m_indexer = NULL;              // IndexFolder scans inline instead
+    }
+
+    m_prefetch = new Prefetcher(m_cache, this, ID_LOAD_DONE, &m_thumbs);
+    if (!m_prefetch->Start()) {
+        delete m_prefetch;
+        m_prefetch = NULL;             // browse loads inline; the cache still helps
+    }
+
+    // Canvas on top, filmstrip (or the whole grid) below; hidden until asked
+    // The side list, when shown, sits left of both
+    m_grid = new ThumbGrid(this, m_fileList, &m_thumbs);
+    m_grid->Hide();
+    m_sideList = new FileListCtrl(this, m_fileList);
+    m_sideList->Hide();
+    wxBoxSizer* view = new wxBoxSizer(wxVERTICAL);
+    view->Add(m_canvas, 1, wxEXPAND);
+    view->Add(m_grid,   0, wxEXPAND);
+    wxBoxSizer* sizer = new wxBoxSizer(wxHORIZONTAL);
+    sizer->Add(m_sideList, 0, wxEXPAND);
+    sizer->Add(view,       1, wxEXPAND);
+    SetSizer(sizer);
 }
 
 BCTVFrame::~BCTVFrame() {
-delete m_img;
+m_renderTimer.Stop();
+m_settleTimer.Stop();
+delete m_watcher;
+if (m_libIndexer) {
+    m_libIndexer->Cancel();
+    m_libIndexer->Wait();
+    delete m_libIndexer;
+}
+if (m_encoder) {
+    m_encoder->Cancel();
+    m_encoder->Wait();
+    delete m_encoder;
+}
+if (m_renderThread) {
+    m_renderThread->Quit();
+    m_renderThread->Wait();
+    delete m_renderThread;
+}
+if (m_indexer) {
+    m_indexer->Quit();
+    m_indexer->Wait();
+    delete m_indexer;
+}
+delete m_prefetch;                     // joins its workers
+delete m_grid;                         // joins its loaders before m_thumbs goes
 }
 
 void BCTVFrame::UpdateStatusBar() {
@@ -272,35 +455,44 @@ return;
 
 
 
-wxString index = wxString::Format("%d / %d", m_curIdx + 1, m_fileList.GetCount());
+wxString index = wxString::Format(m_indexing ? "%d / %d+" : "%d / %d",
+                                  m_curIdx + 1, (int)m_fileList.GetCount());
 wxString format = wxString::Format("Format: %s", m_img->GetFormat());
-
-
-//wxString mips = wxString::Format("Mips: %d/%d", 1, m_img->GetMipCount());
-//wxString memory = wxString::Format("Mem: %dKB/%dKB", m_img->GetMemoryUsage(), m_img->GetMemoryUsage());
-
-//wxString format = wxT("Format: DXT1");
 wxString size = wxString::Format("Size: %dx%d", m_img->Width(), m_img->Height());
-wxString mips = wxString::Format("Mips: %d/%d", 1, 9);
-wxString memory = wxString::Format("Mem: %.1fKB/%.1fKB", 32.0, 42.7);
-
-int fieldWidths[5] = {100, 100, 100, 150, 250};
+wxString mips = m_img->GetMipCount();
+wxString memory = m_img->GetMemoryUsage() +
+                  wxString::Format("  (all %.0f of %.0f MB)",
+                                   MemoryBudget::Held() / double(1 << 20),
+                                   MemoryBudget::Budget() / double(1 << 20));
+
+// Load stages as this image recorded them (PC files skip swap / untile),
+// then the newest frame's; every figure in ms
+const Profiler::Breakdown& load = m_img->LoadTimes();
+wxString times;
+for (int s = Profiler::OPEN; s <= Profiler::DECODE; ++s) {
+    if ((s == Profiler::SWAP || s == Profiler::UNTILE) && load.Ms(s) == 0) continue;
+    times << Profiler::StageName(s) << wxString::Format(" %.1f  ", load.Ms(s));
+}
+times << "|";
+for (int s = Profiler::POSTPROCESS; s <= Profiler::BLIT; ++s)
+    times << "  " << Profiler::StageName(s) << wxString::Format(" %.1f", Profiler::LastMs(s));
 
-m_statusBar->SetStatusWidths(5, fieldWidths);
 m_statusBar->SetStatusText(index, 0);
 m_statusBar->SetStatusText(format, 1);
 m_statusBar->SetStatusText(size, 2);
 m_statusBar->SetStatusText(mips, 3);
 m_statusBar->SetStatusText(memory, 4);
+m_statusBar->SetStatusText(times + " ms", 5);
 }
 
 // Function to check 4CC of the file header
 bool Check4CC(const wxString& path, uint32_t& file4CC) {
-    wxFileInputStream in(path);
-    if (!in.IsOk()) {
+    std::unique_ptr<wxInputStream> stream(FileSource::Open(path));
+    if (!stream) {
         wxLogError("Failed to open file %s", path.c_str());
         return false;
     }
+    wxInputStream& in = *stream;
 
     // Read the first 4 bytes of the file to check the 4CC signature
     uint8_t buffer[4];
@@ -316,18 +508,19 @@ bool Check4CC(const wxString& path, uint32_t& file4CC) {
 }
 
 
-bool BCTVFrame::LoadImage(const wxString& path, bool recordDir)
+// Sniffs, constructs and parses one file; errors are logged
+std::shared_ptr<ImageBase> BCTVFrame::OpenImage(const wxString& path)
 {
     uint32_t file4CC;
     if (!Check4CC(path, file4CC)) {
         wxLogError("Failed to read 4CC for file %s", path.c_str());
-        return false;
+        return std::shared_ptr<ImageBase>();
     }
 
     wxLogDebug("Read 4CC: 0x%08X", file4CC);
 
     // Polymorphic ImageBase pointer
-    std::auto_ptr<ImageBase> tmp;
+    std::shared_ptr<ImageBase> tmp;
 
     // Check for .bct or .dds based on 4CC
     if ((file4CC == 0x07010220) || ((file4CC & 0x00FFFF00) == 0x00010100)) {  // BCT file signature (adjust as necessary)
@@ -338,184 +531,652 @@ bool BCTVFrame::LoadImage(const wxString& path, bool recordDir)
     }
     else {
         wxLogError("Unsupported file format for %s (4CC: 0x%08X)", path.c_str(), file4CC);
-        return false;
+        return std::shared_ptr<ImageBase>();
     }
 
-    // Load the image data
-    if (!tmp->LoadFromFile(path)) {
+    // Load the image data, a smaller mip if mip 0 would not fit the budget
+    const int side = ImageCache::FitSide(path);
+    if (!(side ? tmp->LoadSmallMip(path, side) : tmp->LoadFromFile(path))) {
         wxLogError("Failed to load %s", path.c_str());
-        return false;
+        return std::shared_ptr<ImageBase>();
     }
+    return tmp;
+}
 
-    // Free previous image
-    delete m_img;
+bool BCTVFrame::LoadImage(const wxString& path, bool recordDir)
+{
+    // An archive opens at its first texture, with all of them listed
+    if (FileSource::IsArchive(path)) {
+        std::vector<wxString> members;
+        if (!FileSource::ListArchive(path, members) || members.empty()) {
+            wxLogError("No textures found in %s", path.c_str());
+            return false;
+        }
+        return LoadImage(members[0], recordDir);
+    }
 
-    // Transfer ownership of the loaded image
-    m_img = tmp.release();  // Transfers ownership of the ImageBase object
+    // Seen recently or prefetched: no reopen, no re-decode
+    std::shared_ptr<ImageBase> tmp = m_cache.Find(path);
+    if (!tmp) {
+        tmp = OpenImage(path);
+        if (!tmp) return false;
+        m_cache.Insert(path, tmp);
+    }
+    m_loadPath.clear();                // a pending browse load is stale now
 
-    // Record the file in the list if required
+    // Show the file straight away; its folder is indexed in the background
     if (recordDir) {
-        wxFileName fn(path);
-        m_fileList.Clear();
-
-        // Single directory traversal to find both DDS and BCT files
-        wxDir dir(fn.GetPath());
-        if (dir.IsOpened()) {
-            wxString filename;
-            bool cont = dir.GetFirst(&filename, "*.dds", wxDIR_FILES);
-            while (cont) {
-                uint32_t file4CC;
-                if (Check4CC(fn.GetPath() + "\\" + filename, file4CC)) {
-                    if (file4CC == 0x44445320) {  // DDS file signature ('DDS ' 0x44445320)
-                        m_fileList.Add(fn.GetPath() + "\\" + filename);
-                    }
-                }
-                cont = dir.GetNext(&filename);
-            }
-
-            cont = dir.GetFirst(&filename, "*.bct", wxDIR_FILES);
-            while (cont) {
-                uint32_t file4CC;
-                if (Check4CC(fn.GetPath() + "\\" + filename, file4CC)) {
-                    if (file4CC == 0x07010220 || ((file4CC & 0x00FFFF00) == 0x00010100)) {  // BCT file signature
-                        m_fileList.Add(fn.GetPath() + "\\" + filename);
-                    }
-                }
-                cont = dir.GetNext(&filename);
-            }
+        ParkAndIndex(path);
+    } else {
+        // Get the current file index and add it to the list if needed
+        int idx = m_fileList.Find(path);
+        if (idx == wxNOT_FOUND) {
+            NoteMeta(path, tmp->Meta());
+            idx = ListSlot(path);
+            m_fileList.Insert(path, idx);
         }
+        m_curIdx = idx;
     }
+    m_grid->SyncList();
+    m_sideList->SyncList();
+
+    ShowImage(tmp);
+    return true;
+}
 
-    // Get the current file index and add it to the list if needed
-    int idx = m_fileList.Index(path);
-    if (idx == wxNOT_FOUND) {
-        m_fileList.Add(path);
-        idx = m_fileList.GetCount() - 1;
+void BCTVFrame::ShowImage(const std::shared_ptr<ImageBase>& img)
+{
+    // Replace the previous image; a frame still rendering keeps its own ref
+    m_img = img;
+    m_canvas->ClearTiles();
+    m_cache.Relieve();                 // the old image may be evictable now
+
+    m_zoom = 1.0;
+    RequestRender(DIRTY_BITMAP | DIRTY_STATUS | (m_auto ? DIRTY_WINDOW : 0));
+    m_grid->SetCurrent(m_curIdx);
+    m_sideList->SetCurrent(m_curIdx);
+    PrefetchNeighbours();
+}
+
+// Browse within the list: cached images show at once, anything else loads on
+// the prefetch workers and is shown when it lands.  Stepping on before then
+// supersedes it, so a fast wheel spin only decodes where it stops.
+void BCTVFrame::BrowseTo(int idx)
+{
+    const wxString path = m_fileList[idx];
+    if (!m_prefetch) {
+        LoadImage(path, false);
+        return;
     }
+
     m_curIdx = idx;
+    std::shared_ptr<ImageBase> img = m_cache.Find(path);
+    if (img) {
+        m_loadPath.clear();
+        ShowImage(img);
+        return;
+    }
 
-    m_zoom = 1.0;
-    if (m_auto) {
-        UpdateWindowForImage();
+    m_loadPath = path;                 // shown by OnLoadDone
+    m_grid->SetCurrent(m_curIdx);
+    m_sideList->SetCurrent(m_curIdx);
+    PrefetchNeighbours();
+    UpdateFrameTitle();
+    RequestRender(DIRTY_STATUS);
+}
+
+void BCTVFrame::OnLoadDone(wxThreadEvent& e)
+{
+    const std::shared_ptr<LoadResult> res = e.GetPayload< std::shared_ptr<LoadResult> >();
+    if (!res || m_loadPath.IsEmpty() || res->path != m_loadPath)
+        return;                        // the user has moved on since
+    m_loadPath.clear();
+
+    if (!res->img) {
+        wxLogError("Failed to load %s", res->path.c_str());
+        return;
     }
+    ShowImage(res->img);
+}
 
-    RebuildBitmap();
 
-    UpdateStatusBar();
 
-    return true;
+// Lists just this file and indexes its folder behind it
+void BCTVFrame::ParkAndIndex(const wxString& path)
+{
+    m_fileList.Clear();
+    m_fileList.Add(path);
+    m_curIdx     = 0;
+    m_parkedPath = path;
+    m_parked     = true;
+    IndexFolder(FileSource::FolderOf(path));
 }
 
+void BCTVFrame::IndexFolder(const wxString& dir)
+{
+    ++m_indexGen;                      // orphan batches of the previous scan
+    m_indexing = true;
+    m_libList  = false;
+    m_meta.clear();
+    m_metaOrder.clear();
+    CallAfter(&BCTVFrame::WatchFolder, dir);   // needs a running event loop
+
+    if (m_indexer) {
+        m_indexer->Submit(dir, m_indexGen);
+        return;
+    }
+    std::vector<wxString>  paths;
+    std::vector<ImageMeta> metas;
+    DirIndexer::IndexNow(dir, paths, &m_thumbs, &metas);
+    AddIndexed(paths, metas, true);
+}
 
+void BCTVFrame::OnIndexBatch(wxThreadEvent& e)
+{
+    const std::shared_ptr<DirBatch> batch = e.GetPayload< std::shared_ptr<DirBatch> >();
+    if (!batch || batch->generation != m_indexGen)
+        return;                        // a newer folder was opened since
+    AddIndexed(batch->paths, batch->metas, batch->done);
+}
 
-void BCTVFrame::RebuildBitmap() {
-    if (!m_img) return;
+// Adds a batch: in folder order, or each file at its sorted slot, leaving
+// out what the filter rejects.  Until the scan reaches the opened file it is
+// parked at the end of the list, so paging works on what is known so far;
+// it stays listed even when the filter would reject it.
+void BCTVFrame::AddIndexed(const std::vector<wxString>& paths,
+                           const std::vector<ImageMeta>& metas, bool done)
+{
+    for (size_t i = 0; i < paths.size(); ++i) {
+        const ImageMeta meta = (i < metas.size()) ? metas[i] : ImageMeta();
+        NoteMeta(paths[i], meta);
+
+        if (m_parked && paths[i] == m_parkedPath) {
+            // reached it – it takes its real slot
+            const int  last     = m_fileList.GetCount() - 1;
+            const bool onParked = (m_curIdx == last);
+            m_fileList.RemoveAt(last);
+            m_parked = false;
+
+            const int at = ListSlot(paths[i]);
+            m_fileList.Insert(paths[i], at);
+            if (onParked)           m_curIdx = at;
+            else if (m_curIdx >= at) ++m_curIdx;
+            continue;
+        }
+        if (m_query.Matches(paths[i], meta))
+            InsertListed(paths[i]);
+    }
 
-    const int orig_w = m_img->Width(), orig_h = m_img->Height();
+    if (done) {
+        m_indexing = false;
+        m_parked   = false;            // not in the folder scan: keep it last
+    }
+    m_grid->SyncList();
+    m_sideList->SyncList();
+    m_grid->SetCurrent(m_curIdx);
+    m_sideList->SetCurrent(m_curIdx);
+    PrefetchNeighbours();              // the list may have grown past us
 
-    // Calculate scaled dimensions
-    const int w = static_cast<int>(orig_w * m_zoom);
-    const int h = static_cast<int>(orig_h * m_zoom);
+    RequestRender(DIRTY_STATUS);
+}
 
-    // Prevent creation of invalid (zero or negative) bitmap sizes
-    if (w <= 0 || h <= 0) return;
+// Probed facts of a listed or listable file; a new one goes last in folder
+// order
+void BCTVFrame::NoteMeta(const wxString& path, const ImageMeta& meta)
+{
+    const std::pair<std::map<wxString, ImageMeta>::iterator, bool> at =
+        m_meta.insert(std::make_pair(path, meta));
+    if (at.second) m_metaOrder.push_back(path);
+    else           at.first->second = meta;
+}
 
-    // Create a new bitmap with scaled dimensions, 32 bits per pixel
-    wxBitmap bmp(w, h, 32);
+// Where a watcher or indexer arrival goes: appended in folder order, else
+// at its sorted slot (binary search on the probed facts).  A parked entry
+// stays last.
+int BCTVFrame::ListSlot(const wxString& path) const
+{
+    const int end = m_fileList.GetCount() - (m_parked ? 1 : 0);
+    if (!m_query.Sorted()) return end;
 
-    // Initialize alpha channel based on wxWidgets version
-#if wxCHECK_VERSION(3,1,0)
-    bmp.UseAlpha();
-#else
-    bmp.InitAlpha();
-#endif
+    auto metaOf = [this](const wxString& p) {
+        std::map<wxString, ImageMeta>::const_iterator it = m_meta.find(p);
+        return it != m_meta.end() ? it->second : ImageMeta();
+    };
+    const ImageMeta meta = metaOf(path);
+    int lo = 0, hi = end;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (m_query.Less(m_fileList[mid], metaOf(m_fileList[mid]), path, meta))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
 
-    // Access the bitmap's pixel data
-    wxAlphaPixelData dst(bmp);
-    if (!dst) return;
-
-    // Get the source image data (assumed to be in BGRA format)
-    const unsigned char* src = m_img->Data();
-
-    // Compute inverse zoom factor once for efficiency
-    double inv_zoom = 1.0 / m_zoom;
-
-    // Iterate over each pixel in the scaled bitmap
-    for (int y = 0; y < h; ++y) {
-        // Calculate the source y-coordinate using nearest-neighbor interpolation
-        int src_y = static_cast<int>(y * inv_zoom);
-
-        // Initialize pixel iterator for the current row
-        wxAlphaPixelData::Iterator p(dst);
-        p.MoveTo(dst, 0, y);
-
-        for (int x = 0; x < w; ++x, ++p) {
-            // Calculate source x-coordinate
-            int src_x = static_cast<int>(x * inv_zoom);
-
-            // Compute the index in the source data (4 bytes per pixel: B, G, R, A)
-            int src_index = (src_y * orig_w + src_x) * 4;
-
-            // Extract BGRA components from the source image
-            unsigned char b = src[src_index + 0];
-            unsigned char g = src[src_index + 1];
-            unsigned char r = src[src_index + 2];
-            unsigned char a = src[src_index + 3];
-
-            // Apply channel toggles
-            if (!m_showB) b = 0;
-            if (!m_showG) g = 0;
-            if (!m_showR) r = 0;
-
-            // Handle alpha premultiplication
-            if (m_showA) {
-                // Pre-multiply RGB by alpha for transparency effect
-                r = static_cast<unsigned char>((r * a) / 255);
-                g = static_cast<unsigned char>((g * a) / 255);
-                b = static_cast<unsigned char>((b * a) / 255);
-            } else {
-                // Ignore alpha, set to fully opaque
-                a = 255;
-            }
+void BCTVFrame::InsertListed(const wxString& path)
+{
+    const int at = ListSlot(path);
+    m_fileList.Insert(path, at);
+    if (m_curIdx >= at) ++m_curIdx;
+}
+
+// A new order or filter: the list is rebuilt in one pass from the probed
+// facts already held, filtered and stable-sorted, rather than indexed again.
+// The current file stays current and listed even if the filter rejects it;
+// a parked one stays last.  A scan still running adds the rest by ListSlot.
+void BCTVFrame::ApplyQuery()
+{
+    if (m_libList && ShowLibrary(m_libSearch))
+        return;
+    const int count = m_fileList.GetCount();
+    const wxString current = (m_curIdx >= 0 && m_curIdx < count) ? m_fileList[m_curIdx] : wxString();
+    const wxString parked  = (m_parked && count > 0) ? m_fileList[count - 1] : wxString();
+
+    typedef std::map<wxString, ImageMeta>::const_iterator Known;
+    std::vector<Known> listed;
+    listed.reserve(m_metaOrder.size());
+    for (size_t i = 0; i < m_metaOrder.size(); ++i) {
+        const Known it = m_meta.find(m_metaOrder[i]);
+        if (it != m_meta.end() && (it->first == current || m_query.Matches(it->first, it->second)))
+            listed.push_back(it);
+    }
+    if (m_query.Sorted())
+        std::stable_sort(listed.begin(), listed.end(), [this](const Known& a, const Known& b) {
+            return m_query.Less(a->first, a->second, b->first, b->second);
+        });
+
+    m_fileList.Clear();
+    m_fileList.Reserve(listed.size() + 1);
+    m_curIdx = -1;
+    for (size_t i = 0; i < listed.size(); ++i) {
+        if (listed[i]->first == current) m_curIdx = int(i);
+        m_fileList.Add(listed[i]->first);
+    }
+    if (!parked.IsEmpty()) {
+        if (parked == current) m_curIdx = m_fileList.GetCount();
+        m_fileList.Add(parked);
+    }
+
+    m_grid->SyncList();
+    m_sideList->SyncList();
+    m_grid->SetCurrent(m_curIdx);
+    m_sideList->SetCurrent(m_curIdx);
+    PrefetchNeighbours();
+    RequestRender(DIRTY_STATUS);
+}
+
+void BCTVFrame::OnListQuery(wxCommandEvent& e)
+{
+    static const char* const formats[] = { "", "DXT1", "DXT3", "DXT5", "ATI1", "ATI2", "RGBA8" };
+    static const int         sides[]   = { 0, 512, 1024, 2048, 4096 };
+    static const int         megs[]    = { 0, 1, 4, 16 };
+
+    const int id = e.GetId();
+    if (id <= ID_LIST_SORT_BYTES)
+        m_query.sort = id - ID_LIST_SORT_FOLDER;
+    else if (id == ID_LIST_SORT_DESC)
+        m_query.descending = e.IsChecked();
+    else if (id <= ID_LIST_FMT_RGBA8)
+        m_query.format = formats[id - ID_LIST_FMT_ANY];
+    else if (id <= ID_LIST_SIDE_4096)
+        m_query.minSide = sides[id - ID_LIST_SIDE_ANY];
+    else if (id <= ID_LIST_MEM_16M)
+        m_query.minBytes = uint64_t(megs[id - ID_LIST_MEM_ANY]) << 20;
+    else
+        m_query.endian = TextureQuery::ENDIAN_ANY + (id - ID_LIST_END_ANY);
+    ApplyQuery();
+}
+
+// Queue the next AHEAD files in the browse direction, then BEHIND the other
+// way, nearest first.  Honours wrap-around like StepImage does.  A browse
+// target still loading goes first, as the focus.
+void BCTVFrame::PrefetchNeighbours()
+{
+    const int n = m_fileList.GetCount();
+    if (!m_prefetch || m_curIdx < 0 || m_curIdx >= n) return;
+
+    std::vector<wxString> paths;
+    const bool focus = !m_loadPath.IsEmpty();
+    if (focus) paths.push_back(m_loadPath);
+
+    auto queue = [&](int step) {
+        int idx = m_curIdx + step;
+        if (m_wrap) idx = (idx % n + n) % n;
+        if (idx < 0 || idx >= n || idx == m_curIdx) return;
+        for (size_t i = 0; i < paths.size(); ++i)
+            if (paths[i] == m_fileList[idx]) return;
+        paths.push_back(m_fileList[idx]);
+    };
+    for (int k = 1; k <= Prefetcher::AHEAD;  ++k) queue( m_browseDir * k);
+    for (int k = 1; k <= Prefetcher::BEHIND; ++k) queue(-m_browseDir * k);
+
+    m_prefetch->Submit(paths, focus);
+}
+
+// ---------------------------------------------------------------------------
+//  Folder watch – the browse folder is watched (inotify on Linux, directory
+//  change notifications on Windows) so textures written into it show up, go
+//  away or refresh without a rescan.  Writers produce a burst of events per
+//  file; a path is only read once it has been quiet for SETTLE_MS.
+// ---------------------------------------------------------------------------
+void BCTVFrame::WatchFolder(const wxString& dir)
+{
+    if (!m_watcher) {
+        m_watcher = new wxFileSystemWatcher;
+        m_watcher->SetOwner(this);
+    }
+    m_watcher->RemoveAll();
+    m_settling.clear();
+    m_settleTimer.Stop();
+
+    m_watchDir = dir;
+    if (FileSource::IsArchive(dir)) return;     // members change with the archive
+    m_watcher->Add(wxFileName::DirName(dir),
+                   wxFSW_EVENT_CREATE | wxFSW_EVENT_DELETE |
+                   wxFSW_EVENT_RENAME | wxFSW_EVENT_MODIFY);
+}
+
+bool BCTVFrame::IsWatchedTexture(const wxString& path) const
+{
+    const wxFileName fn(path);
+    const wxString   ext = fn.GetExt().Lower();
+    return (ext == "dds" || ext == "bct") &&
+           wxFileName::DirName(fn.GetPath()).SameAs(wxFileName::DirName(m_watchDir));
+}
+
+void BCTVFrame::OnFolderChange(wxFileSystemWatcherEvent& e)
+{
+    const int type = e.GetChangeType();
+    if (type == wxFSW_EVENT_WARNING) {
+        // the kernel queue overflowed: events were lost, take stock again
+        if (e.GetWarningType() == wxFSW_WARNING_OVERFLOW && !m_watchDir.IsEmpty()) {
+            if (m_curIdx >= 0) ParkAndIndex(m_fileList[m_curIdx]);
+            else               IndexFolder(m_watchDir);
+            m_grid->SyncList();
+            m_sideList->SyncList();
+        }
+        return;
+    }
+
+    wxString path;
+    if (type & (wxFSW_EVENT_DELETE | wxFSW_EVENT_RENAME)) {
+        if (IsWatchedTexture(e.GetPath().GetFullPath()))
+            FolderFileGone(e.GetPath().GetFullPath());
+        if (type & wxFSW_EVENT_RENAME) path = e.GetNewPath().GetFullPath();
+    } else if (type & (wxFSW_EVENT_CREATE | wxFSW_EVENT_MODIFY)) {
+        path = e.GetPath().GetFullPath();
+    }
+    if (path.IsEmpty() || !IsWatchedTexture(path)) return;
+
+    m_settling[path] = wxGetLocalTimeMillis();
+    if (!m_settleTimer.IsRunning())
+        m_settleTimer.Start(SETTLE_MS / 2);
+}
+
+void BCTVFrame::OnSettleTimer(wxTimerEvent&)
+{
+    const wxLongLong now = wxGetLocalTimeMillis();
+    for (auto it = m_settling.begin(); it != m_settling.end(); )
+    {
+        // while a scan runs it may list the file itself; wait for it
+        if (m_indexing || now - it->second < SETTLE_MS) { ++it; continue; }
+        const wxString path = it->first;
+        it = m_settling.erase(it);
+        FolderFileChanged(path);
+    }
+    if (m_settling.empty()) m_settleTimer.Stop();
+}
+
+// A file finished being written: new ones join the list, known ones drop
+// their cached decode and thumbnail, and the one on screen is reloaded.
+void BCTVFrame::FolderFileChanged(const wxString& path)
+{
+    m_cache.Erase(path);               // the mtime may not have ticked
+    m_grid->Invalidate(path);
+
+    ImageMeta meta;
+    const bool texture = DirIndexer::Accept(path, &m_thumbs, &meta);
+    if (texture) NoteMeta(path, meta);
+
+    const int idx = m_fileList.Find(path);
+    if (idx != wxNOT_FOUND) {
+        if (idx == m_curIdx && m_loadPath.IsEmpty()) ReloadCurrent();
+        else                                        PrefetchNeighbours();
+        return;
+    }
+
+    if (!texture || !m_query.Matches(path, meta))
+        return;                        // not a texture (yet), or filtered out
+    InsertListed(path);
 
-            // Set the pixel values in the destination bitmap
-            p.Blue()  = b;
-            p.Green() = g;
-            p.Red()   = r;
-            p.Alpha() = a;
+    m_grid->SyncList();
+
+    m_sideList->SyncList();
+    m_grid->SetCurrent(m_curIdx);
+    m_sideList->SetCurrent(m_curIdx);
+    PrefetchNeighbours();
+    RequestRender(DIRTY_STATUS);
+}
+
+void BCTVFrame::FolderFileGone(const wxString& path)
+{
+    m_settling.erase(path);
+    if (m_meta.erase(path))
+        m_metaOrder.erase(std::find(m_metaOrder.begin(), m_metaOrder.end(), path));
+    m_cache.Erase(path);
+    m_grid->Invalidate(path);
+
+    const int idx = m_fileList.Find(path);
+    if (idx == wxNOT_FOUND) return;
+    if (m_parked && idx == (int)m_fileList.GetCount() - 1)
+        m_parked = false;              // the scan will not find it now either
+    m_fileList.RemoveAt(idx);
+    m_grid->SyncList();
+    m_sideList->SyncList();
+
+    if (idx < m_curIdx) {
+        --m_curIdx;
+    } else if (idx == m_curIdx) {
+        // the shown file went away: show its successor, or nothing
+        if (m_fileList.IsEmpty()) {
+            m_curIdx = -1;
+            m_img.reset();
+            m_loadPath.clear();
+            m_canvas->ClearTiles();
+            m_canvas->RecreateBitmap(wxBitmap());
+            UpdateFrameTitle();
+            RequestRender(DIRTY_STATUS);
+            return;
         }
+        BrowseTo(std::min(idx, (int)m_fileList.GetCount() - 1));
+        return;
     }
+    m_grid->SetCurrent(m_curIdx);
+    m_sideList->SetCurrent(m_curIdx);
+    PrefetchNeighbours();
+    RequestRender(DIRTY_STATUS);
+}
+
+// The shown file was rewritten: swap in the new pixels, keep zoom and pan
+void BCTVFrame::ReloadCurrent()
+{
+    const wxString path = m_fileList[m_curIdx];
+    std::shared_ptr<ImageBase> img;
+    {
+        wxLogNull quiet;               // a half-written file just keeps the old one
+        img = OpenImage(path);
+    }
+    if (!img) return;
+    m_cache.Insert(path, img);
+
+    const bool resized = !m_img || img->Width()  != m_img->Width()
+                                || img->Height() != m_img->Height();
+    m_img = img;
+    m_canvas->ClearTiles();
+    RequestRender(DIRTY_BITMAP | DIRTY_STATUS | (resized && m_auto ? DIRTY_WINDOW : 0));
+}
+
+void BCTVFrame::RebuildBitmap() {
+    if (!m_img || m_viewMode == VIEW_GRID) return;   // canvas is hidden
+
+    // Describe the view; the worker does the scaling, masking and
+    // post-process and posts ID_RENDER_DONE when the frame is ready.
+    RenderJob job;
+    job.img        = m_img;
+    job.zoom       = m_zoom;
+    job.w          = static_cast<int>(m_img->Width()  * m_zoom);
+    job.h          = static_cast<int>(m_img->Height() * m_zoom);
+    job.showR      = m_showR;
+    job.showG      = m_showG;
+    job.showB      = m_showB;
+    job.showA      = m_showA;
+    job.filtShr    = m_filtShr;
+    job.filtLinear = m_filtLinear;
+    job.pp         = m_pp;
+    job.serial     = ++m_renderSerial;
+
+    // Prevent creation of invalid (zero or negative) bitmap sizes
+    if (job.w <= 0 || job.h <= 0) return;
+
+    // Larger than the canvas: draw from cached tiles so panning only
+    // renders the strips it exposes.  Whole frames still in flight are stale.
+    const wxSize cs = m_canvas->GetClientSize();
+    if (job.w > cs.GetWidth() || job.h > cs.GetHeight()) {
+        m_tiledSerial = job.serial;
+        m_canvas->SetTiledView(job);
+        UpdateFrameTitle();
+        return;
+    }
+
+    if (m_renderThread) {
+        m_renderThread->Submit(job);
+    } else {
+        wxThreadEvent ev(wxEVT_THREAD, ID_RENDER_DONE);
+        ev.SetPayload(job);
+        OnRenderDone(ev);
+    }
+}
+
+void BCTVFrame::OnRenderDone(wxThreadEvent& e)
+{
+    wxBitmap bmp = m_canvas->TakeSpare();      // same size: drawn into, not reallocated
+    unsigned serial = 0;
+    if (m_renderThread) {
+        if (!m_renderThread->AcquireFrame(bmp, &serial))
+            return;                            // superseded by a newer frame
+    } else {
+        const RenderJob job = e.GetPayload<RenderJob>();
+        if (!RenderThread::RenderNow(job, bmp)) return;
+        serial = job.serial;
+    }
+    if (serial <= m_tiledSerial)
+        return;                                // canvas switched to tiles since
 
     // Assign the scaled bitmap and update the canvas and title
-    m_bmp = bmp;
-    m_canvas->RecreateBitmap(m_bmp);
+    m_canvas->RecreateBitmap(bmp);
     UpdateFrameTitle();
+    RequestRender(DIRTY_STATUS);               // decode / scale timings are in
+}
+
+void BCTVFrame::RequestTiles(const std::vector<RenderJob>& tiles)
+{
+    if (m_renderThread) {
+        m_renderThread->SubmitTiles(tiles);
+        return;
+    }
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        wxBitmap bmp;
+        if (RenderThread::RenderNow(tiles[i], bmp))
+            m_canvas->AddTile(tiles[i], bmp);
+    }
+}
+
+void BCTVFrame::OnTileDone(wxThreadEvent& e)
+{
+    std::shared_ptr<RenderTile> t = e.GetPayload< std::shared_ptr<RenderTile> >();
+    wxBitmap bmp;
+    if (t && RenderThread::ToBitmap(t->w > 0 ? &t->bgra[0] : NULL, t->w, t->h, bmp)) {
+        m_canvas->AddTile(t->job, bmp);
+        RequestRender(DIRTY_STATUS);
+    }
 }
 
 void BCTVCanvas::RecreateBitmap(const wxBitmap& bmp) {
+    m_tiled = false;
+    m_spare = bmp.IsOk() && !bmp.IsSameAs(m_bmp) ? m_bmp : wxNullBitmap;
     m_bmp = bmp;
+    m_bmpBytes.Set(TileCache::BitmapBytes(m_bmp) + TileCache::BitmapBytes(m_spare));
     Refresh();  // Forces the canvas to be redrawn
 }
 
+wxBitmap BCTVCanvas::TakeSpare() {
+    wxBitmap spare = m_spare;
+    m_spare = wxNullBitmap;
+    m_bmpBytes.Set(TileCache::BitmapBytes(m_bmp));
+    return spare;
+}
+
 
 void BCTVFrame::ChangeZoom(double factor)
 {
+m_manualZoom = true;
 m_zoom *= factor;
-UpdateWindowForImage();
+RequestRender(DIRTY_BITMAP | DIRTY_WINDOW);
+}
+
+// ---------------------------------------------------------------------------
+//  Render scheduling – input handlers only mark what is stale; the timer
+//  flushes at most once per display frame, so a burst of wheel notches or
+//  key repeats collapses into a single rebuild of the final state.
+// ---------------------------------------------------------------------------
+void BCTVFrame::RequestRender(int what)
+{
+    m_dirty |= what;
+    if (m_renderTimer.IsRunning())
+        return;                               // already queued for this frame
+
+    const wxLongLong since = wxGetLocalTimeMillis() - m_lastRender;
+    const long wait = (since >= m_frameMs) ? 1 : long(m_frameMs - since.ToLong());
+    m_renderTimer.StartOnce(int(wait));
+}
+
+void BCTVFrame::FlushRender()
+{
+    const int what = m_dirty;
+    m_dirty = 0;
+    if (!what) return;
+
+    m_renderTimer.Stop();
+    m_lastRender = wxGetLocalTimeMillis();
+
+    // window first: auto-zoom may change m_zoom before the bitmap is built
+    if (what & DIRTY_WINDOW) UpdateWindowForImage();
+    if (what & DIRTY_BITMAP) RebuildBitmap();
+    if (what & DIRTY_STATUS) UpdateStatusBar();
+}
+
+void BCTVFrame::OnRenderTimer(wxTimerEvent&)
+{
+    FlushRender();
 }
 
 void BCTVFrame::UpdateFrameTitle() {
 wxString title = "BCTV";
-if (m_img) {
-wxFileName fn(m_fileList[m_curIdx]);
-title << " - [" << fn.GetFullName() << "] Zoom:"
+if (m_img && m_curIdx >= 0) {
+title << " - [" << m_fileList.Name(m_curIdx) << "] Zoom:"
 << int(m_zoom*100+0.5) << "%";
 }
 SetTitle(title);
 }
 
 void BCTVFrame::UpdateWindowForImage() {
-    if (!m_img) return;
+    if (!m_img || m_viewMode == VIEW_GRID) return;   // grid keeps the window size
+
+    // The filmstrip sits under the canvas and the side list beside it; both
+    // take from the image's room
+    const int strip = (m_viewMode == VIEW_STRIP) ? m_grid->StripHeight() : 0;
+    const int side  = m_sideList->IsShown() ? m_sideList->GetSize().GetWidth() : 0;
 
     wxDisplay disp(this);
     wxRect screenRect = disp.GetClientArea();
@@ -529,8 +1190,8 @@ void BCTVFrame::UpdateWindowForImage() {
     int imgHeight = m_img->Height();
 
     // Calculate the available space in the window
-    int availableWidth = maxWidth - windowWidth + GetClientSize().GetWidth();
-    int availableHeight = maxHeight - windowHeight + GetClientSize().GetHeight();
+    int availableWidth = maxWidth - windowWidth + GetClientSize().GetWidth() - side;
+    int availableHeight = maxHeight - windowHeight + GetClientSize().GetHeight() - strip;
 
     // Apply auto-scaling only if m_auto is true and avoid changing manual zoom
     if (m_auto && !m_manualZoom) {
@@ -555,9 +1216,15 @@ void BCTVFrame::UpdateWindowForImage() {
     if (newWidth < minWidth) newWidth = minWidth;
     if (newHeight < minHeight) newHeight = minHeight;
 
+    // Clip to the monitor; a larger image is then panned in tiled mode
+    if (m_clip) {
+        if (newWidth > availableWidth) newWidth = availableWidth;
+        if (newHeight > availableHeight) newHeight = availableHeight;
+    }
+
     // Adjust window size only if auto-scaling is active or the window needs resizing
-    if (newWidth != windowWidth || newHeight != windowHeight) {
-        SetClientSize(newWidth, newHeight);  // Resize the window
+    if (newWidth + side != windowWidth || newHeight + strip != windowHeight) {
+        SetClientSize(newWidth + side, newHeight + strip);  // Resize the window
     }
 
     // Optionally center the window
@@ -585,6 +1252,7 @@ if (m_fileList.IsEmpty()) return;
 
 const int n = m_fileList.GetCount();
 int idx = m_curIdx + delta;
+if (delta) m_browseDir = (delta < 0) ? -1 : 1;
 
 if (m_wrap)
 idx = (idx % n + n) % n;
@@ -592,12 +1260,12 @@ else
 idx = std::min(std::max(idx,0), n-1);
 
 if (idx != m_curIdx)
-LoadImage(m_fileList[idx], false);
+BrowseTo(idx);
 }
 
 void BCTVFrame::JumpImage(int idx) {
-if (0 <= idx && idx < m_fileList.GetCount())
-LoadImage(m_fileList[idx], false);
+if (0 <= idx && idx < (int)m_fileList.GetCount())
+BrowseTo(idx);
 }
 
 void BCTVFrame::ShowCursorInfo(int ix,int iy,unsigned char* p) {
@@ -612,7 +1280,7 @@ SetTitle(base);
 void BCTVFrame::OnOpen(wxCommandEvent&) {
     // Update the file dialog to support DDS and BCT files together
     wxFileDialog dlg(this, "Open DDS or BCT", "", "",
-                     "All supported files (*.dds;*.bct)|*.dds;*.bct|DDS files (*.dds)|*.dds|BCT files (*.bct)|*.bct",  // Filter for both DDS and BCT
+                     "All supported files (*.dds;*.bct;*.zip;*.pk3;*.pk4)|*.dds;*.bct;*.zip;*.pk3;*.pk4|DDS files (*.dds)|*.dds|BCT files (*.bct)|*.bct|Archives (*.zip;*.pk3;*.pk4)|*.zip;*.pk3;*.pk4",  // Filter for both DDS and BCT
                      wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 
     if (dlg.ShowModal() == wxID_OK) {
@@ -623,8 +1291,318 @@ void BCTVFrame::OnOpen(wxCommandEvent&) {
 
 
 
+// The current BCT's mip chain re-containered, not decoded: the DDS holds
+// the same compressed blocks
+void BCTVFrame::OnSaveDDS(wxCommandEvent&) {
+    if (m_curIdx < 0 || m_fileList.Name(m_curIdx).AfterLast('.').Lower() != "bct") {
+        SetStatusText("Save as DDS works on BCT textures", 0);
+        return;
+    }
+    const wxString src = m_fileList[m_curIdx];
+    wxFileDialog dlg(this, "Save as DDS",
+                     FileSource::IsMember(src) ? wxString() : wxPathOnly(src),
+                     m_fileList.Name(m_curIdx).BeforeLast('.') + ".dds",
+                     "DDS files (*.dds)|*.dds", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (dlg.ShowModal() != wxID_OK) return;
+
+    bool ok;
+    {
+        wxFileOutputStream out(dlg.GetPath());
+        ok = out.IsOk() && BCTImage::WriteDDS(src, out) && out.Close();
+    }
+    if (!ok) {
+        wxRemoveFile(dlg.GetPath());
+        return;                        // the reason was logged
+    }
+    SetStatusText("Saved " + dlg.GetPath(), 0);
+}
+
+// The current image's pixels compressed again, as the dialog's filter picks;
+// it offers the format the texture was loaded in first.  Saves the level
+// that is loaded, without the view's post-process.  The encode runs on an
+// EncodeThread behind a progress dialog whose Cancel button stops it.
+void BCTVFrame::OnSaveBlocks(wxCommandEvent&) {
+    if (m_encoder) {
+        SetStatusText("A texture is still being compressed", 0);
+        return;
+    }
+    if (m_curIdx < 0 || !m_img || !m_img->EnsurePixels()) {
+        SetStatusText("No image to save", 0);
+        return;
+    }
+    static const TextureCodec::Format formats[] = {
+        TextureCodec::FMT_BC1, TextureCodec::FMT_BC3, TextureCodec::FMT_BC4, TextureCodec::FMT_BC5
+    };
+    int filter;
+    switch (m_img->GetBlockFormat()) {
+        case ImageBase::BLK_BC1: filter = 0; break;
+        case ImageBase::BLK_BC4: filter = 2; break;
+        case ImageBase::BLK_BC5: filter = 3; break;
+        default:                 filter = 1; break;
+    }
+
+    const wxString src = m_fileList[m_curIdx];
+    wxFileDialog dlg(this, "Save as compressed DDS",
+                     FileSource::IsMember(src) ? wxString() : wxPathOnly(src),
+                     m_fileList.Name(m_curIdx).BeforeLast('.') + ".dds",
+                     "DXT1 / BC1 (*.dds)|*.dds|DXT5 / BC3 (*.dds)|*.dds|"
+                     "ATI1 / BC4 (*.dds)|*.dds|ATI2 / BC5 (*.dds)|*.dds",
+                     wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    dlg.SetFilterIndex(filter);
+    if (dlg.ShowModal() != wxID_OK) return;
+
+    const TextureCodec::Quality quality = GetMenuBar()->IsChecked(ID_FILE_ENCODE_BEST)
+                                        ? TextureCodec::QUALITY_CLUSTER
+                                        : TextureCodec::QUALITY_RANGE;
+    const TextureCodec::Format format = formats[dlg.GetFilterIndex()];
+    m_encodePath = dlg.GetPath();
+    m_encoder = new EncodeThread(this, ID_ENCODE_PROGRESS, m_img, format, quality);
+    if (m_encoder->Run() == wxTHREAD_NO_ERROR) {
+        m_encodeDlg = new wxProgressDialog("Save as compressed DDS",
+                                           "Compressing " + wxFileNameFromPath(m_encodePath),
+                                           100, this,
+                                           wxPD_APP_MODAL | wxPD_CAN_ABORT |
+                                           wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME);
+        return;
+    }
+
+    delete m_encoder;
+    m_encoder = NULL;                  // compress inline instead
+
+    std::vector<unsigned char> dds;
+    wxStopWatch sw;
+    TextureCodec::Result r;
+    {
+        wxBusyCursor busy;
+        const TextureCodec::Source pixels(m_img->Data(), size_t(m_img->Width()) * 4);
+        r = TextureCodec::EncodeDDS(format, pixels, m_img->Width(), m_img->Height(), dds, quality);
+    }
+    SaveEncoded(m_encodePath, r, dds, sw.Time());
+}
+
+void BCTVFrame::OnEncodeProgress(wxThreadEvent& e)
+{
+    const std::shared_ptr<EncodeProgress> p = e.GetPayload< std::shared_ptr<EncodeProgress> >();
+    if (!p) return;
+    if (!p->done) {
+        if (m_encodeDlg && !m_encodeDlg->Update(p->percent) && m_encoder)
+            m_encoder->Cancel();       // the encoder stops at its next row
+        return;
+    }
+
+    if (m_encoder) {
+        m_encoder->Wait();
+        delete m_encoder;
+        m_encoder = NULL;
+    }
+    delete m_encodeDlg;
+    m_encodeDlg = NULL;
+    SaveEncoded(m_encodePath, p->result, p->dds, p->ms);
+}
+
+void BCTVFrame::SaveEncoded(const wxString& path, TextureCodec::Result r,
+                            const std::vector<unsigned char>& dds, long ms)
+{
+    if (r == TextureCodec::ERR_CANCELLED) {
+        SetStatusText("Compression cancelled", 0);
+        return;
+    }
+    if (r != TextureCodec::OK) {
+        wxLogError("Cannot compress %s: %s", path, TextureCodec::ResultText(r));
+        return;
+    }
+
+    bool ok;
+    {
+        wxFileOutputStream out(path);
+        ok = out.IsOk() && out.Write(&dds[0], dds.size()).IsOk() && out.Close();
+    }
+    if (!ok) {
+        wxRemoveFile(path);
+        wxLogError("Cannot write %s", path);
+        return;
+    }
+    SetStatusText(wxString::Format("Saved %s (compressed in %ld ms)", path, ms), 0);
+}
+
+// The newest stage events of every thread, for chrome://tracing or Perfetto
+void BCTVFrame::OnSaveTrace(wxCommandEvent&) {
+    wxFileDialog dlg(this, "Save timing trace", wxEmptyString, "bctv-trace.json",
+                     "Trace files (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (dlg.ShowModal() != wxID_OK) return;
+    if (Profiler::WriteChromeTrace(dlg.GetPath()))
+        SetStatusText("Saved " + dlg.GetPath(), 0);
+}
+
 void BCTVFrame::OnExit(wxCommandEvent&) { Close(); }
 
+// ---------------------------------------------------------------------------
+//  Texture library – whole dump trees indexed once (TextureLibrary), then
+//  searched; the results become the browse list, across folders.
+// ---------------------------------------------------------------------------
+void BCTVFrame::EnsureLibrary()
+{
+    if (m_library) return;
+    m_library.reset(new TextureLibrary);
+    m_library->Load(TextureLibrary::DefaultFile());   // none yet: empty
+}
+
+void BCTVFrame::OnLibraryIndex(wxCommandEvent&)
+{
+    if (m_libIndexer) {
+        SetStatusText("The library is still being indexed", 0);
+        return;
+    }
+    wxDirDialog dlg(this, "Folder tree to index", m_watchDir,
+                    wxDD_DEFAULT_STYLE | wxDD_DIR_MUST_EXIST);
+    if (dlg.ShowModal() != wxID_OK) return;
+
+    EnsureLibrary();
+    m_libIndexer = new LibraryIndexer(this, ID_LIBRARY_PROGRESS, m_library,
+                                      dlg.GetPath(), TextureLibrary::DefaultFile());
+    if (m_libIndexer->Run() == wxTHREAD_NO_ERROR) return;
+
+    delete m_libIndexer;
+    m_libIndexer = NULL;               // index inline instead
+
+    wxBusyCursor busy;
+    std::shared_ptr<TextureLibrary> lib(new TextureLibrary(*m_library));
+    if (lib->Index(dlg.GetPath()) && lib->Save(TextureLibrary::DefaultFile()))
+        m_library = lib;
+    SetStatusText(wxString::Format("Library: %lu textures",
+                                   (unsigned long)m_library->Count()), 0);
+}
+
+void BCTVFrame::OnLibraryProgress(wxThreadEvent& e)
+{
+    const std::shared_ptr<LibraryProgress> p = e.GetPayload< std::shared_ptr<LibraryProgress> >();
+    if (!p) return;
+    if (!p->done) {
+        SetStatusText(wxString::Format("Indexing: %lu folders, %lu textures",
+                                       (unsigned long)p->counts.dirs,
+                                       (unsigned long)p->counts.files), 0);
+        return;
+    }
+
+    if (m_libIndexer) {
+        m_libIndexer->Wait();
+        delete m_libIndexer;
+        m_libIndexer = NULL;
+    }
+    if (p->library) m_library = p->library;
+    SetStatusText(wxString::Format("Library: %lu textures",
+                                   (unsigned long)m_library->Count()), 0);
+}
+
+void BCTVFrame::OnLibraryFind(wxCommandEvent&)
+{
+    EnsureLibrary();
+    if (m_library->Count() == 0) {
+        wxLogMessage("The texture library is empty; index a folder tree first.");
+        return;
+    }
+    wxTextEntryDialog dlg(this,
+        "format:ATI2  min:2048  max:4096  mips:2-13  mem:4M\n"
+        "platform:pc|x360  name:*door*  sort:name|dims|format|mem  desc",
+        "Search texture library", m_libSearch);
+    if (dlg.ShowModal() != wxID_OK) return;
+    ShowLibrary(dlg.GetValue());
+}
+
+// Replaces the browse list with the library entries matching text; without
+// a sort term the View menu order applies.  The current file stays current
+// if it is among them.  Folder scan and folder watch stop meanwhile.
+bool BCTVFrame::ShowLibrary(const wxString& text)
+{
+    TextureQuery query;
+    wxString error;
+    if (!query.Parse(text, &error)) {
+        wxLogError("%s", error);
+        return false;
+    }
+    if (!query.Sorted()) {
+        query.sort       = m_query.sort;
+        query.descending = m_query.descending;
+    }
+
+    std::vector<const TextureLibrary::Entry*> hits;
+    m_library->Find(query, hits);
+    if (hits.empty()) {
+        SetStatusText("No library texture matches", 0);
+        return false;
+    }
+
+    const wxString current = (m_curIdx >= 0 && m_curIdx < (int)m_fileList.GetCount())
+                           ? m_fileList[m_curIdx] : wxString();
+    ++m_indexGen;                      // a folder scan in flight is orphaned
+    m_indexing = false;
+    m_parked   = false;
+    m_loadPath.clear();
+    if (m_watcher) m_watcher->RemoveAll();
+    m_watchDir.clear();
+    m_settling.clear();
+    m_settleTimer.Stop();
+
+    m_meta.clear();
+    m_metaOrder.clear();
+    m_fileList.Clear();
+    m_fileList.Reserve(hits.size());
+    int at = 0;
+    for (size_t i = 0; i < hits.size(); ++i) {
+        m_fileList.Add(hits[i]->path);
+        NoteMeta(hits[i]->path, hits[i]->meta);
+        if (hits[i]->path == current) at = int(i);
+    }
+    m_libSearch = text;
+    m_libList   = true;
+
+    m_grid->SyncList();
+
+    m_sideList->SyncList();
+    BrowseTo(at);
+    return true;
+}
+
+void BCTVFrame::OnViewMode(wxCommandEvent& e) {
+SetViewMode(e.GetId() - ID_VIEW_SINGLE);
+}
+
+// The grid replaces the canvas; the filmstrip shares the frame with it
+void BCTVFrame::SetViewMode(int mode)
+{
+    if (mode == m_viewMode) return;
+    m_viewMode = mode;
+
+    m_grid->SetStrip(mode == VIEW_STRIP);
+    m_grid->SetMinSize(wxSize(-1, mode == VIEW_STRIP ? m_grid->StripHeight() : -1));
+    GetSizer()->GetItem(m_grid, true)->SetProportion(mode == VIEW_GRID ? 1 : 0);
+    m_canvas->Show(mode != VIEW_GRID);
+    m_grid->Show(mode != VIEW_SINGLE);
+    Layout();
+    m_grid->SetCurrent(m_curIdx);
+
+    GetMenuBar()->Check(ID_VIEW_SINGLE + mode, true);
+    if (mode == VIEW_GRID) m_grid->SetFocus();
+    RequestRender(DIRTY_BITMAP | DIRTY_WINDOW);
+}
+
+void BCTVFrame::OnViewList(wxCommandEvent& e) {
+ShowSideList(e.IsChecked());
+}
+
+void BCTVFrame::ShowSideList(bool show)
+{
+    if (show == m_sideList->IsShown()) return;
+    m_sideList->Show(show);
+    if (show) {
+        m_sideList->SyncList();
+        m_sideList->SetCurrent(m_curIdx);
+    }
+    Layout();
+    GetMenuBar()->Check(ID_VIEW_LIST, show);
+    RequestRender(DIRTY_BITMAP | DIRTY_WINDOW);
+}
+
 void BCTVFrame::OnToggleChannel(wxCommandEvent& e) {
 switch (e.GetId()) {
 case ID_CH_R: m_showR = !m_showR; break;
@@ -632,7 +1610,7 @@ case ID_CH_G: m_showG = !m_showG; break;
 case ID_CH_B: m_showB = !m_showB; break;
 case ID_CH_A: m_showA = !m_showA; break;
 }
-RebuildBitmap();
+RequestRender(DIRTY_BITMAP);
 }
 
 void BCTVFrame::OnBgColour(wxCommandEvent&)
@@ -662,7 +1640,9 @@ m_bgSecondary = color;
 
 void BCTVFrame::OnFilter(wxCommandEvent& e) {
 if (e.GetId()==ID_FILT_SHR) m_filtShr = !m_filtShr;
+else if (e.GetId()==ID_FILT_LINEAR) m_filtLinear = !m_filtLinear;
 else m_filtEnl = !m_filtEnl;
+RequestRender(DIRTY_BITMAP);
 }
 
 void BCTVFrame::OnWindowOpt(wxCommandEvent& e) {
@@ -686,9 +1666,36 @@ if (e.GetId()==ID_WRAP) m_wrap = !m_wrap;
 if (e.GetId()==ID_AUTOZOOM) m_auto = !m_auto;
 }
 
+// One budget for everything that can give memory back: the image cache,
+// the prefetcher and the canvas tiles (MemoryBudget.h)
+void BCTVFrame::OnCacheBudget(wxCommandEvent& e) {
+static const size_t mb[] = { 128, 256, 512, 1024 };
+MemoryBudget::SetBudget(mb[e.GetId() - ID_CACHE_128] << 20);
+m_cache.SetBudget(mb[e.GetId() - ID_CACHE_128] << 20);
+BufferPool::Trim(BufferPool::IdleLimit());
+RequestRender(DIRTY_STATUS);
+}
+
 void BCTVFrame::OnPostProcess(wxCommandEvent& e) {
 m_pp = e.GetId() - ID_PP_NONE;
-RebuildBitmap();
+RequestRender(DIRTY_BITMAP);
+}
+
+void BCTVFrame::OnMemory(wxCommandEvent&) {
+const double MB = double(1 << 20);
+wxString text;
+for (int c = 0; c < MemoryBudget::CATEGORIES; ++c)
+    text << wxString::Format("%-10s %8.1f MB\n", MemoryBudget::CategoryName(c),
+                             MemoryBudget::Bytes(c) / MB);
+text << wxString::Format("\ntotal      %8.1f MB\npeak       %8.1f MB\nbudget     %8.1f MB\n"
+                         "\n%lu images cached (%.1f MB)\n"
+                         "%lu pooled buffers allocated, huge pages %s",
+                         MemoryBudget::Total() / MB, MemoryBudget::Peak() / MB,
+                         MemoryBudget::Budget() / MB,
+                         (unsigned long)m_cache.Count(), m_cache.Bytes() / MB,
+                         (unsigned long)BufferPool::SystemAllocations(),
+                         BufferPool::HugePages() ? "on" : "off");
+wxMessageBox(text, "Memory usage", wxOK | wxICON_INFORMATION, this);
 }
 
 void BCTVFrame::OnAbout(wxCommandEvent&) {
@@ -722,35 +1729,62 @@ void BCTVFrame::OnKey(wxKeyEvent& k) {
         bool shift = k.ShiftDown();
         if (shift) m_showG = m_showB = m_showA = false;
         m_showR = !m_showR;
-        RebuildBitmap();
+        RequestRender(DIRTY_BITMAP);
         return;
     }
     case 'G': case 'g': {
         bool shift = k.ShiftDown();
         if (shift) m_showR = m_showB = m_showA = false;
         m_showG = !m_showG;
-        RebuildBitmap();
+        RequestRender(DIRTY_BITMAP);
         return;
     }
     case 'B': case 'b': {
         bool shift = k.ShiftDown();
         if (shift) m_showR = m_showG = m_showA = false;
         m_showB = !m_showB;
-        RebuildBitmap();
+        RequestRender(DIRTY_BITMAP);
         return;
     }
     case 'A': case 'a': {
         bool shift = k.ShiftDown();
         if (shift) m_showR = m_showG = m_showB = false;
         m_showA = !m_showA;
-        RebuildBitmap();
+        RequestRender(DIRTY_BITMAP);
         return;
     }
 
+    case 'T': case 't':
+        SetViewMode(m_viewMode == VIEW_GRID ? VIEW_SINGLE : VIEW_GRID);
+        return;
+    case 'F': case 'f':
+        SetViewMode(m_viewMode == VIEW_STRIP ? VIEW_SINGLE : VIEW_STRIP);
+        return;
+    case 'S': case 's':
+        ShowSideList(!m_sideList->IsShown());
+        return;
+    case WXK_RETURN: case WXK_NUMPAD_ENTER:
+        if (m_viewMode == VIEW_GRID) SetViewMode(VIEW_SINGLE);
+        else k.Skip();
+        return;
     case 'L': case 'l':
         Centre();
         return;
 
+    case WXK_LEFT: case WXK_RIGHT: case WXK_UP: case WXK_DOWN: {
+        if (m_viewMode == VIEW_GRID || (m_viewMode == VIEW_STRIP && !m_canvas->IsTiled())) {
+            const int row = m_grid->RowStride();   // walk the thumbnails
+            StepImage(code == WXK_LEFT ? -1 : code == WXK_RIGHT ? 1 :
+                      code == WXK_UP   ? -row : row);
+            return;
+        }
+        if (!m_canvas->IsTiled()) { k.Skip(); return; }
+        const int step = k.ShiftDown() ? 256 : 64;   // pan the tiled view
+        m_canvas->PanBy(code == WXK_LEFT ? -step : code == WXK_RIGHT ? step : 0,
+                        code == WXK_UP   ? -step : code == WXK_DOWN  ? step : 0);
+        return;
+    }
+
     case WXK_PAGEUP:
         StepImage(-1);
         return;
@@ -762,20 +1796,19 @@ void BCTVFrame::OnKey(wxKeyEvent& k) {
     case WXK_ADD: case WXK_NUMPAD_ADD: case '+': case '=':
             m_manualZoom = true;  // Flag that the user is manually zooming
         m_zoom *= 1.25; // Zoom in
-        RebuildBitmap();  // Apply zoom
-        UpdateWindowForImage();  // Adjust window size and update the image
+        RequestRender(DIRTY_BITMAP | DIRTY_WINDOW);  // Apply zoom on the next frame
         return;
 
     case WXK_SUBTRACT: case WXK_NUMPAD_SUBTRACT: case '-':
             m_manualZoom = true;  // Flag that the user is manually zooming
         m_zoom /= 1.25; // Zoom out
-        RebuildBitmap();  // Apply zoom
-        UpdateWindowForImage();  // Adjust window size and update the image
+        RequestRender(DIRTY_BITMAP | DIRTY_WINDOW);  // Apply zoom on the next frame
         return;
 
     case 'N': case 'n':
         m_filtShr = !m_filtShr;
         m_filtEnl = !m_filtEnl;
+        RequestRender(DIRTY_BITMAP);
         return;
 
     case WXK_HOME:
@@ -797,7 +1830,8 @@ void BCTVFrame::OnKey(wxKeyEvent& k) {
 BCTVCanvas::BCTVCanvas(BCTVFrame* host)
 : wxPanel(host, wxID_ANY, wxDefaultPosition, wxDefaultSize,
 wxBORDER_NONE | wxWANTS_CHARS),
-m_host(host)
+m_host(host), m_bmpBytes(MemoryBudget::BITMAPS),
+m_tiled(false), m_viewKey(0), m_panX(0), m_panY(0), m_dragging(false)
 {
 SetBackgroundStyle(wxBG_STYLE_PAINT);
 //SetBackgroundColour( wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW) );
@@ -815,49 +1849,189 @@ void BCTVCanvas::OnPaint(wxPaintEvent&)
     dc.SetBackground(m_host->GetBackgroundColour());
     dc.Clear();
 
+    // 2) tiled view: blit what is cached, queue only the missing tiles
+    if (m_tiled) {
+        DrawTiles(dc, true);
+        return;
+    }
+
     if (!m_bmp.IsOk())
         return;
 
-    // 2) Apply the zoom factor here for drawing the image with the updated zoom
-    double z = m_host->GetZoom();
+    // 3) m_bmp is already rebuilt at the current zoom – just centre it.
+    //    (Scaling the DC as well would apply the zoom twice.)
     int bw = m_bmp.GetWidth(), bh = m_bmp.GetHeight();
     wxSize cs = GetClientSize();
-    int dw = int(bw * z + .5), dh = int(bh * z + .5);
-    int x0 = (cs.GetWidth()  - dw) / 2;
-    int y0 = (cs.GetHeight() - dh) / 2;
+    int x0 = (cs.GetWidth()  - bw) / 2;
+    int y0 = (cs.GetHeight() - bh) / 2;
+
+    // 4) Finally, draw the bitmap with transparency (or normal)
+    dc.DrawBitmap(m_bmp, x0, y0, true);
+}
+
+// ---------------------------------------------------------------------------
+//  Tiled mode
+// ---------------------------------------------------------------------------
+void BCTVCanvas::SetTiledView(const RenderJob& view)
+{
+    const wxSize cs = GetClientSize();
+
+    // keep the point under the canvas centre when the zoom changes
+    if (m_tiled && m_view.w > 0 && m_view.h > 0) {
+        const double cx = (m_panX + cs.GetWidth()  / 2.0) / m_view.w;
+        const double cy = (m_panY + cs.GetHeight() / 2.0) / m_view.h;
+        m_panX = int(cx * view.w - cs.GetWidth()  / 2.0);
+        m_panY = int(cy * view.h - cs.GetHeight() / 2.0);
+    } else {
+        m_panX = (view.w - cs.GetWidth())  / 2;
+        m_panY = (view.h - cs.GetHeight()) / 2;
+    }
+
+    m_view = view;
+    m_view.rx = m_view.ry = m_view.rw = m_view.rh = 0;
+    m_viewKey = TileCache::ViewKey(m_view);
+    m_tiled = true;
+    m_bmp = wxNullBitmap;
+    m_spare = wxNullBitmap;
+    m_bmpBytes.Set(0);
+
+    // Over the memory budget the cache may shrink, but not below one
+    // window of tiles plus a border row and column being panned in
+    const int T = TileCache::TILE;
+    m_tiles.SetFloor(size_t(cs.GetWidth() / T + 2) * (cs.GetHeight() / T + 2));
+
+    ClampPan();
+    Refresh();
+}
 
-    // 3) Finally, draw the bitmap with transparency (or normal)
-    dc.SetUserScale(z, z);
-    dc.DrawBitmap(m_bmp, int(x0 / z), int(y0 / z), true);
-    dc.SetUserScale(1, 1);
+void BCTVCanvas::AddTile(const RenderJob& tile, const wxBitmap& bmp)
+{
+    // tiles of a previous image may still be in flight after a reload
+    if (!m_tiled || tile.img != m_view.img) return;
+
+    const uint64_t key = TileCache::ViewKey(tile);
+    m_tiles.Insert(key, tile.rx / TileCache::TILE, tile.ry / TileCache::TILE, bmp);
+    if (key == m_viewKey)
+        Refresh(false);
+}
+
+void BCTVCanvas::ClearTiles()
+{
+    m_tiles.Clear();
+}
+
+void BCTVCanvas::PanBy(int dx, int dy)
+{
+    if (!m_tiled) return;
+    const int ox = m_panX, oy = m_panY;
+    m_panX += dx;
+    m_panY += dy;
+    ClampPan();
+    if (m_panX != ox || m_panY != oy)
+        Refresh(false);
+}
+
+void BCTVCanvas::ClampPan()
+{
+    const wxSize cs = GetClientSize();
+    m_panX = std::max(0, std::min(m_panX, m_view.w - cs.GetWidth()));
+    m_panY = std::max(0, std::min(m_panY, m_view.h - cs.GetHeight()));
+}
+
+// screen position of the zoomed image's top-left corner
+void BCTVCanvas::ViewOrigin(int& x0, int& y0) const
+{
+    const wxSize cs = GetClientSize();
+    x0 = (m_view.w < cs.GetWidth())  ? (cs.GetWidth()  - m_view.w) / 2 : -m_panX;
+    y0 = (m_view.h < cs.GetHeight()) ? (cs.GetHeight() - m_view.h) / 2 : -m_panY;
+}
+
+void BCTVCanvas::DrawTiles(wxDC& dc, bool requestMissing)
+{
+    const int T = TileCache::TILE;
+    const wxSize cs = GetClientSize();
+    int x0, y0;
+    ViewOrigin(x0, y0);
+
+    // visible tile range (inclusive)
+    const int tx0 = std::max(0, -x0) / T;
+    const int ty0 = std::max(0, -y0) / T;
+    const int tx1 = (std::min(m_view.w, cs.GetWidth()  - x0) - 1) / T;
+    const int ty1 = (std::min(m_view.h, cs.GetHeight() - y0) - 1) / T;
+
+    std::vector<RenderJob> missing;
+    for (int ty = ty0; ty <= ty1; ++ty)
+        for (int tx = tx0; tx <= tx1; ++tx)
+        {
+            if (wxBitmap* bmp = m_tiles.Find(m_viewKey, tx, ty)) {
+                dc.DrawBitmap(*bmp, x0 + tx * T, y0 + ty * T, true);
+            } else if (requestMissing) {
+                RenderJob j = m_view;
+                j.rx = tx * T;
+                j.ry = ty * T;
+                j.rw = std::min(T, m_view.w - j.rx);
+                j.rh = std::min(T, m_view.h - j.ry);
+                missing.push_back(j);
+            }
+        }
+
+    // replaces the worker's queue, so tiles panned out of view are dropped
+    if (requestMissing)
+        m_host->RequestTiles(missing);
 }
 
 void BCTVCanvas::OnMotion(wxMouseEvent& e)
 {
-if (!m_bmp.IsOk()) { e.Skip(); return; }
+if (m_dragging && e.RightIsDown()) {
+    const wxPoint pos = e.GetPosition();
+    PanBy(m_dragFrom.x - pos.x, m_dragFrom.y - pos.y);
+    m_dragFrom = pos;
+    return;
+}
+
+if (!HasImage()) { e.Skip(); return; }
 
 double z = m_host->GetZoom();
-int bw = m_bmp.GetWidth();
-int bh = m_bmp.GetHeight();
+int bw, bh, x0, y0;
 wxSize cs = GetClientSize();
 
-int x0 = (cs.GetWidth() - int(bw*z)) / 2;
-int y0 = (cs.GetHeight() - int(bh*z)) / 2;
+if (m_tiled) {
+bw = m_view.w;
+bh = m_view.h;
+ViewOrigin(x0, y0);
+} else {
+bw = m_bmp.GetWidth();
+bh = m_bmp.GetHeight();
+x0 = (cs.GetWidth() - bw) / 2;
+y0 = (cs.GetHeight() - bh) / 2;
+}
 
-int ix = int((e.GetX() - x0) / z);
-int iy = int((e.GetY() - y0) / z);
+// zoomed-image pixel under the cursor, then the texel it was sampled from
+int bx = e.GetX() - x0;
+int by = e.GetY() - y0;
 
-if (ix < 0 || ix >= bw || iy < 0 || iy >= bh)
+if (bx < 0 || bx >= bw || by < 0 || by >= bh)
 {
 e.Skip();
 return;
 }
 
-wxAlphaPixelData pd(m_bmp);
+int ix = int(bx / z);
+int iy = int(by / z);
+
+wxBitmap* src = &m_bmp;
+if (m_tiled) {
+src = m_tiles.Find(m_viewKey, bx / TileCache::TILE, by / TileCache::TILE);
+if (!src) { e.Skip(); return; }       // tile still rendering
+bx %= TileCache::TILE;
+by %= TileCache::TILE;
+}
+
+wxAlphaPixelData pd(*src);
 if (!pd) { e.Skip(); return; }
 
 wxAlphaPixelData::Iterator it(pd);
-it.MoveTo(pd, ix, iy);
+it.MoveTo(pd, bx, by);
 
 unsigned char px[4] =
 {
@@ -873,7 +2047,7 @@ e.Skip();
 
 void BCTVCanvas::OnWheel(wxMouseEvent& e)
 {
-if (!m_bmp.IsOk()) { e.Skip(); return; }
+if (!HasImage()) { e.Skip(); return; }
 
 const int wheelDelta = 120;
 m_host->AddWheelAccum(e.GetWheelRotation());
@@ -898,15 +2072,48 @@ m_host->GetWheelMode()==3 ? 1.0/1.25 : 1.0/1.5 );
 
 void BCTVCanvas::OnLeftDown(wxMouseEvent&)
 {
-if (!m_bmp.IsOk())
+if (!HasImage())
 return;
 
+// tiled: copy what is on screen rather than rendering the whole image
+wxBitmap shot = m_bmp;
+if (m_tiled) {
+    const wxSize cs = GetClientSize();
+    shot = wxBitmap(cs.GetWidth(), cs.GetHeight());
+    wxMemoryDC mdc(shot);
+    mdc.SetBackground(m_host->GetBackgroundColour());
+    mdc.Clear();
+    DrawTiles(mdc, false);
+    mdc.SelectObject(wxNullBitmap);
+}
+
 if (wxTheClipboard->Open())
 {
 wxBitmapDataObject* dobj = new wxBitmapDataObject;
-dobj->SetBitmap(m_bmp);
+dobj->SetBitmap(shot);
 wxTheClipboard->SetData(dobj);
 wxTheClipboard->Close();
 }
 }
 
+void BCTVCanvas::OnRightDown(wxMouseEvent& e)
+{
+if (!m_tiled) { e.Skip(); return; }
+m_dragging = true;
+m_dragFrom = e.GetPosition();
+CaptureMouse();
+}
+
+void BCTVCanvas::OnRightUp(wxMouseEvent& e)
+{
+if (m_dragging) {
+    m_dragging = false;
+    if (HasCapture()) ReleaseMouse();
+}
+e.Skip();
+}
+
+void BCTVCanvas::OnCaptureLost(wxMouseCaptureLostEvent&)
+{
+m_dragging = false;
+}
@@ -0,0 +1,254 @@
+// -----------------------------------------------------------------------------
+//  BCTWriter.cpp – BCT output for the PC and the Xbox 360
+// -----------------------------------------------------------------------------
+#include "BCTWriter.h"
+#include "BCTImage.h"
+#include "FileSource.h"
+
+#include <wx/log.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const unsigned char SIGNATURE[4] = { 0x07, 0x01, 0x02, 0x20 };   // as the browser sniffs it
+const uint32_t TABLE_ADDR    = 32;     // header, padded, then the mip table
+const uint32_t PC_ALIGN      = 128;
+const uint32_t X360_ALIGN    = 4096;   // a tiled level starts on a page
+const int      X360_MIN_SIDE = 32;     // smaller levels live in the packed tail
+
+// The BCT format byte BctToDxgi() maps back to fmt; 0 when there is none
+uint8_t BctFormat(TextureCodec::Format fmt)
+{
+    switch (fmt) {
+        case TextureCodec::FMT_BC1: return 0x08;
+        case TextureCodec::FMT_BC3: return 0x0A;
+        case TextureCodec::FMT_BC4: return 0x25;
+        case TextureCodec::FMT_BC5: return 0x26;
+        default:                    return 0;
+    }
+}
+
+void Put16(unsigned char* p, unsigned v, bool bigEndian)
+{
+    p[bigEndian ? 1 : 0] = uint8_t(v);
+    p[bigEndian ? 0 : 1] = uint8_t(v >> 8);
+}
+
+void Put32(unsigned char* p, uint32_t v, bool bigEndian)
+{
+    for (int i = 0; i < 4; ++i)
+        p[bigEndian ? 3 - i : i] = uint8_t(v >> (8 * i));
+}
+
+uint64_t Align(uint64_t v, uint32_t to) { return (v + to - 1) / to * to; }
+
+int LevelW(const BCTWriter::Spec& s, int i) { return std::max(s.width >> i, 1); }
+int LevelH(const BCTWriter::Spec& s, int i) { return std::max(s.height >> i, 1); }
+
+// Bytes level i takes in the file
+size_t StoredBytes(const BCTWriter::Spec& s, int i)
+{
+    return s.bigEndian
+         ? TextureCodec::TiledLevelBytes(TextureCodec::BlockBytes(s.format), LevelW(s, i), LevelH(s, i))
+         : TextureCodec::LevelBytes(s.format, LevelW(s, i), LevelH(s, i));
+}
+
+// A DDS's levels are stored one after the other, linear
+bool ConvertDDS(const wxString& path, BCTWriter& writer, BCTWriter::Spec& spec)
+{
+    std::unique_ptr<wxInputStream> in(FileSource::Open(path));
+    if (!in) {
+        wxLogError("Failed to open file: %s", path);
+        return false;
+    }
+    DDSHeader hdr;
+    if (in->Read(&hdr, sizeof(hdr)).LastRead() != sizeof(hdr) || hdr.magic != 0x20534444) {
+        wxLogError("%s is not a DDS file", path);
+        return false;
+    }
+    spec.format = TextureCodec::FourCCFormat(hdr.pf.fourCC, hdr.pf.rgbBitCount);
+    spec.width  = int(std::min(hdr.width,  0x10000u));
+    spec.height = int(std::min(hdr.height, 0x10000u));
+    spec.mips   = int(std::max(std::min(hdr.mipMapCount, 255u), 1u));
+    if (!writer.Begin(spec)) return false;
+
+    std::vector<unsigned char> level;
+    for (int i = 0; i < BCTWriter::Levels(spec); ++i) {
+        level.resize(TextureCodec::LevelBytes(spec.format, LevelW(spec, i), LevelH(spec, i)));
+        if (in->Read(&level[0], level.size()).LastRead() != level.size()) {
+            wxLogError("%s: mip %d is truncated", path, i);
+            return false;
+        }
+        if (!writer.Level(&level[0], level.size())) return false;
+    }
+    return true;
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+int BCTWriter::Levels(const Spec& spec)
+{
+    if (!BctFormat(spec.format) || spec.width <= 0 || spec.height <= 0 ||
+        spec.width > 0xFFFF || spec.height > 0xFFFF || spec.mips <= 0)
+        return 0;
+
+    int levels = 1;
+    for (; levels < std::min(spec.mips, 255); ++levels) {
+        if ((spec.width >> levels) == 0 && (spec.height >> levels) == 0) break;   // past 1x1
+        if (spec.bigEndian && std::min(LevelW(spec, levels), LevelH(spec, levels)) < X360_MIN_SIDE)
+            break;
+    }
+    return levels;
+}
+
+bool BCTWriter::Begin(const Spec& spec)
+{
+    m_spec   = spec;
+    m_levels = Levels(spec);
+    m_next   = 0;
+    m_at     = 0;
+    if (!m_levels) {
+        wxLogError("A BCT cannot hold a %dx%d texture in this format", spec.width, spec.height);
+        return false;
+    }
+
+    // Every level's place is known from the sizes alone
+    const bool be = spec.bigEndian;
+    std::vector<unsigned char> head(TABLE_ADDR + size_t(m_levels) * 16, 0);
+    m_addr.resize(m_levels);
+    uint64_t at = head.size();
+    for (int i = 0; i < m_levels; ++i) {
+        at = Align(at, be ? X360_ALIGN : PC_ALIGN);
+        m_addr[i] = uint32_t(at);
+        at += StoredBytes(spec, i);
+
+        unsigned char* e = &head[TABLE_ADDR + size_t(i) * 16];
+        Put32(e,      m_addr[i], be);
+        Put32(e + 4,  uint32_t(StoredBytes(spec, i)), be);
+        Put32(e + 8,  0x80000000u, be);
+        Put32(e + 12, 0, be);
+    }
+    if (at > 0xFFFFFFFFu) {
+        wxLogError("A %dx%d texture is too large for a BCT", spec.width, spec.height);
+        return false;
+    }
+
+    std::memcpy(&head[0], SIGNATURE, sizeof(SIGNATURE));
+    Put16(&head[4], unsigned(spec.width), be);
+    Put16(&head[6], unsigned(spec.height), be);
+    head[8]  = BctFormat(spec.format);
+    head[9]  = 0;                                          // version
+    head[10] = uint8_t(m_levels);
+    head[11] = TextureCodec::BlockBytes(spec.format) == 8 ? 4 : 8;   // bits per texel
+    Put32(&head[12], spec.hash, false);                    // read little-endian on both
+    Put32(&head[16], TABLE_ADDR, be);
+
+    m_out.Write(&head[0], head.size());
+    m_at = head.size();
+    if (!m_out.IsOk()) {
+        wxLogError("Failed to write the BCT header");
+        return false;
+    }
+    return true;
+}
+
+bool BCTWriter::Level(const unsigned char* blocks, size_t bytes)
+{
+    if (m_next >= m_levels) {
+        ++m_next;
+        return true;
+    }
+    const int    w  = LevelW(m_spec, m_next), h = LevelH(m_spec, m_next);
+    const size_t bb = TextureCodec::BlockBytes(m_spec.format);
+    const size_t linear = TextureCodec::LevelBytes(m_spec.format, w, h);
+    if (!blocks || bytes < linear) {
+        wxLogError("BCT mip %d needs %lu bytes, got %lu", m_next,
+                   (unsigned long)linear, (unsigned long)bytes);
+        return false;
+    }
+    if (!Pad(m_addr[m_next])) return false;
+
+    // One scratch buffer, sized by mip 0, serves the whole chain
+    if (m_spec.bigEndian) {
+        const size_t tiled = TextureCodec::TiledLevelBytes(bb, w, h);
+        if (m_tiled.size() < tiled) m_tiled.resize(tiled);
+        TextureCodec::TileXbox360(blocks, w, h, bb, &m_tiled[0], tiled);
+        TextureCodec::FlipByteOrder16(&m_tiled[0], tiled);
+        m_out.Write(&m_tiled[0], tiled);
+        m_at += tiled;
+    } else {
+        m_out.Write(blocks, linear);
+        m_at += linear;
+    }
+    if (!m_out.IsOk()) {
+        wxLogError("Failed to write BCT mip %d", m_next);
+        return false;
+    }
+    ++m_next;
+    return true;
+}
+
+bool BCTWriter::Finish()
+{
+    if (m_next < m_levels) {
+        wxLogError("The BCT got %d of its %d mips", m_next, m_levels);
+        return false;
+    }
+    return m_out.IsOk();
+}
+
+bool BCTWriter::Pad(uint64_t to)
+{
+    static const unsigned char zeros[X360_ALIGN] = { 0 };
+    while (m_at < to && m_out.IsOk()) {
+        const size_t n = size_t(std::min<uint64_t>(to - m_at, sizeof(zeros)));
+        m_out.Write(zeros, n);
+        m_at += n;
+    }
+    return m_out.IsOk();
+}
+
+bool BCTWriter::Convert(const wxString& srcPath, wxOutputStream& out, bool bigEndian,
+                        ImageMeta* meta)
+{
+    BCTWriter writer(out);
+    Spec spec;
+    spec.bigEndian = bigEndian;
+
+    bool ok;
+    if (srcPath.AfterLast('.').Lower() == "bct") {
+        auto begin = [&](const ImageMeta& m) {
+            spec.format = TextureCodec::DxgiFormat(int(m.format));
+            spec.width  = m.width;
+            spec.height = m.height;
+            spec.mips   = m.mips;
+            spec.hash   = m.hash;
+            return writer.Begin(spec);
+        };
+        auto each = [&writer](int, int, int, const unsigned char* blocks, size_t bytes) {
+            return writer.Level(blocks, bytes);
+        };
+        ok = BCTImage::ReadLevels(srcPath, begin, each);
+    } else {
+        ok = ConvertDDS(srcPath, writer, spec);
+    }
+    if (!ok || !writer.Finish()) {
+        wxLogError("Cannot repack %s as a BCT", srcPath);
+        return false;
+    }
+
+    if (meta) {
+        meta->kind      = ImageMeta::KIND_BCT;
+        meta->width     = spec.width;
+        meta->height    = spec.height;
+        meta->mips      = Levels(spec);
+        meta->format    = uint32_t(TextureCodec::BctToDxgi(BctFormat(spec.format)));
+        meta->hash      = spec.hash;
+        meta->bigEndian = bigEndian;
+    }
+    return true;
+}
@@ -0,0 +1,679 @@
+// -----------------------------------------------------------------------------
+//  BatchConvert.cpp – headless conversion of whole texture trees
+// -----------------------------------------------------------------------------
+#include "BatchConvert.h"
+#include "BCTImage.h"
+#include "BCTWriter.h"
+#include "DDSImage.h"
+#include "FileSource.h"
+#include "ImageCache.h"
+#include "TextureLibrary.h"
+
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/image.h>
+#include <wx/log.h>
+#include <wx/mstream.h>
+#include <wx/stopwatch.h>
+#include <wx/thread.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+
+namespace {
+
+const int    READERS          = 2;
+const int    POLL_MS          = 100;
+const size_t IN_FLIGHT_PER_WORKER = 4;   // read, not yet written
+
+enum Stage { STAGE_READ, STAGE_DECODE, STAGE_ENCODE, STAGE_WRITE, STAGES };
+
+struct Task
+{
+    std::shared_ptr<ImageBase> img;
+    std::vector<unsigned char> out;    // the encoded file
+    BatchConvert::Result       result;
+};
+
+// -----------------------------------------------------------------------------
+//  Encoders – the decoders hand out tightly packed BGRA rows, top row first
+// -----------------------------------------------------------------------------
+
+// 32-bit true-colour TGA with a top-left origin: the rows as they are
+bool EncodeTGA(const ImageBase& img, std::vector<unsigned char>& out)
+{
+    const int w = img.Width(), h = img.Height();
+    if (w > 0xFFFF || h > 0xFFFF) return false;
+
+    const unsigned char head[18] = {
+        0, 0, 2,                       // no id, no palette, uncompressed
+        0, 0, 0, 0, 0,
+        0, 0, 0, 0,                    // origin
+        (unsigned char)(w & 0xFF), (unsigned char)(w >> 8),
+        (unsigned char)(h & 0xFF), (unsigned char)(h >> 8),
+        32, 0x28                       // 8 alpha bits, top-left
+    };
+    const size_t bytes = size_t(w) * h * 4;
+    out.reserve(sizeof(head) + bytes);
+    out.assign(head, head + sizeof(head));
+    out.insert(out.end(), img.Data(), img.Data() + bytes);
+    return true;
+}
+
+// Uncompressed A8R8G8B8 DDS, one level – the layout DDSImage reads back
+bool EncodeDDS(const ImageBase& img, std::vector<unsigned char>& out)
+{
+    DDSHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.magic             = 0x20534444;   // "DDS "
+    hdr.size              = 124;
+    hdr.flags             = 0x100F;       // caps, height, width, pitch, pixel format
+    hdr.width             = img.Width();
+    hdr.height            = img.Height();
+    hdr.pitchOrLinearSize = img.Width() * 4;
+    hdr.pf.size           = 32;
+    hdr.pf.flags          = 0x41;         // RGB with alpha
+    hdr.pf.rgbBitCount    = 32;
+    hdr.pf.rMask          = 0x00FF0000;
+    hdr.pf.gMask          = 0x0000FF00;
+    hdr.pf.bMask          = 0x000000FF;
+    hdr.pf.aMask          = 0xFF000000;
+    hdr.caps              = 0x1000;       // texture
+
+    const size_t bytes = size_t(img.Width()) * img.Height() * 4;
+    out.resize(sizeof(hdr) + bytes);
+    std::memcpy(&out[0], &hdr, sizeof(hdr));
+    std::memcpy(&out[sizeof(hdr)], img.Data(), bytes);
+    return true;
+}
+
+// Block-compressed DDS, one level, encoded on the calling thread
+bool EncodeBlocks(const ImageBase& img, TextureCodec::Format fmt, TextureCodec::Quality quality,
+                  std::vector<unsigned char>& out)
+{
+    const TextureCodec::Source src(img.Data(), size_t(img.Width()) * 4);
+    return TextureCodec::EncodeDDS(fmt, src, img.Width(), img.Height(), out, quality, 1) ==
+           TextureCodec::OK;
+}
+
+bool EncodePNG(const ImageBase& img, std::vector<unsigned char>& out)
+{
+    const int w = img.Width(), h = img.Height();
+    wxImage image(w, h, false);
+    if (!image.IsOk()) return false;
+    image.SetAlpha();
+
+    unsigned char*       rgb   = image.GetData();
+    unsigned char*       alpha = image.GetAlpha();
+    const unsigned char* src   = img.Data();
+    for (size_t i = 0, n = size_t(w) * h; i < n; ++i, src += 4, rgb += 3) {
+        rgb[0]   = src[2];
+        rgb[1]   = src[1];
+        rgb[2]   = src[0];
+        alpha[i] = src[3];
+    }
+
+    wxMemoryOutputStream mem;
+    if (!image.SaveFile(mem, wxBITMAP_TYPE_PNG)) return false;
+    out.resize(mem.GetSize());
+    return !out.empty() && mem.CopyTo(&out[0], out.size()) == out.size();
+}
+
+// -----------------------------------------------------------------------------
+//  Pipeline – the threads and queues of one Run()
+// -----------------------------------------------------------------------------
+class Pipeline
+{
+public:
+    Pipeline(const std::vector<BatchConvert::Job>& jobs, BatchConvert::Target target,
+             TextureCodec::Quality quality, int workers)
+    : m_jobs(jobs), m_target(target), m_quality(quality),
+      m_space(m_lock), m_work(m_lock), m_writable(m_lock), m_finishedCond(m_lock),
+      m_next(0), m_inFlight(0), m_limit(size_t(workers) * IN_FLIGHT_PER_WORKER),
+      m_dealt(0), m_queued(0), m_readersLeft(READERS), m_workersLeft(workers),
+      m_writerDone(false)
+    {
+        for (int i = 0; i < workers; ++i)
+            m_lanes.push_back(std::unique_ptr<Lane>(new Lane));
+        for (int s = 0; s < STAGES; ++s)
+            m_us[s] = 0;
+    }
+
+    ~Pipeline()
+    {
+        for (size_t i = 0; i < m_finished.size(); ++i)
+            delete m_finished[i];
+    }
+
+    // All threads or none: false means run Inline() instead
+    bool Start()
+    {
+        for (int i = 0; i < READERS; ++i)
+            m_threads.push_back(new StageThread([this] { Read(); }));
+        for (size_t i = 0; i < m_lanes.size(); ++i)
+            m_threads.push_back(new StageThread([this, i] { Work(i); }));
+        m_threads.push_back(new StageThread([this] { Write(); }));
+
+        for (size_t i = 0; i < m_threads.size(); ++i)
+            if (m_threads[i]->Create() != wxTHREAD_NO_ERROR) {
+                for (size_t j = 0; j < m_threads.size(); ++j)
+                    delete m_threads[j];
+                m_threads.clear();
+                return false;
+            }
+        for (size_t i = 0; i < m_threads.size(); ++i)
+            m_threads[i]->Run();
+        return true;
+    }
+
+    void Join()
+    {
+        for (size_t i = 0; i < m_threads.size(); ++i) {
+            m_threads[i]->Wait();
+            delete m_threads[i];
+        }
+        m_threads.clear();
+    }
+
+    // Caller side: hands over the files finished since the last call, after
+    // waiting at most ms for one; true once every file is through
+    bool Drain(int ms, std::vector<Task*>& out)
+    {
+        out.clear();
+        wxMutexLocker lock(m_lock);
+        if (m_finished.empty() && !m_writerDone)
+            m_finishedCond.WaitTimeout(ms);
+        out.swap(m_finished);
+        return m_writerDone;
+    }
+
+    // No threads: one file at a time, all stages in turn
+    Task* Inline(size_t job)
+    {
+        Task* t = NewTask(job);
+        if (Load(*t) && (!t->img || Encode(*t))) Save(*t);
+        t->img.reset();
+        std::vector<unsigned char>().swap(t->out);
+        return t;
+    }
+
+    double StageMs(Stage s) const { return m_us[s].load() / 1000.0; }
+
+private:
+    class StageThread : public wxThread
+    {
+    public:
+        explicit StageThread(const std::function<void()>& body)
+        : wxThread(wxTHREAD_JOINABLE), m_body(body) {}
+    protected:
+        ExitCode Entry() override { m_body(); return 0; }
+    private:
+        std::function<void()> m_body;
+    };
+
+    struct Lane                        // one worker's own queue
+    {
+        wxMutex           lock;
+        std::deque<Task*> tasks;
+    };
+
+    Task* NewTask(size_t job) const
+    {
+        Task* t = new Task;
+        BatchConvert::Result& r = t->result;
+        r.in       = m_jobs[job].in;
+        r.out      = m_jobs[job].out;
+        r.ok       = false;
+        r.width    = r.height = 0;
+        r.inBytes  = m_jobs[job].bytes;
+        r.outBytes = 0;
+        r.ms       = 0;
+        return t;
+    }
+
+    // -- stages: false (with result.error set) if the file failed -----------
+    double Timed(Stage s, const wxStopWatch& sw)
+    {
+        const wxLongLong us = sw.TimeInMicro();
+        m_us[s] += uint64_t(us.GetValue());
+        return us.ToDouble() / 1000.0;
+    }
+
+    static bool Fail(Task& t, const char* why)
+    {
+        t.result.error = why;
+        return false;
+    }
+
+    // BCT to DDS and anything to BCT are re-containers, done right here:
+    // the output is ready for the writer and there is no image for the
+    // workers
+    bool Load(Task& t)
+    {
+        wxStopWatch sw;
+        if (m_target == BatchConvert::TO_BCT || m_target == BatchConvert::TO_BCT360)
+        {
+            wxLogNull quiet;
+            wxMemoryOutputStream mem;
+            ImageMeta meta;
+            const bool ok = BCTWriter::Convert(t.result.in, mem,
+                                               m_target == BatchConvert::TO_BCT360, &meta);
+            if (ok) {
+                t.out.resize(mem.GetSize());
+                mem.CopyTo(&t.out[0], t.out.size());
+                t.result.width  = meta.width;
+                t.result.height = meta.height;
+            }
+            t.result.ms += Timed(STAGE_READ, sw);
+            return ok || Fail(t, "cannot repack the texture as a BCT");
+        }
+        if (m_target == BatchConvert::TO_DDS && t.result.in.AfterLast('.').Lower() == "bct")
+        {
+            wxLogNull quiet;
+            wxMemoryOutputStream mem;
+            ImageMeta meta;
+            const bool ok = BCTImage::WriteDDS(t.result.in, mem, &meta);
+            if (ok) {
+                t.out.resize(mem.GetSize());
+                mem.CopyTo(&t.out[0], t.out.size());
+                t.result.width  = meta.width;
+                t.result.height = meta.height;
+            }
+            t.result.ms += Timed(STAGE_READ, sw);
+            return ok || Fail(t, "cannot re-container the BCT as a DDS");
+        }
+
+        t.img = ImageCache::OpenFile(t.result.in);
+        t.result.ms += Timed(STAGE_READ, sw);
+        if (!t.img) return Fail(t, "not a readable DDS or BCT texture");
+        t.result.width  = t.img->Width();
+        t.result.height = t.img->Height();
+        return true;
+    }
+
+    bool Encode(Task& t)
+    {
+        wxStopWatch sw;
+        const bool decoded = t.img->EnsurePixels();
+        t.result.ms += Timed(STAGE_DECODE, sw);
+        if (!decoded) return Fail(t, "cannot decode the pixels");
+
+        sw.Start();
+        bool ok = false;
+        switch (m_target) {
+            case BatchConvert::TO_PNG: ok = EncodePNG(*t.img, t.out); break;
+            case BatchConvert::TO_TGA: ok = EncodeTGA(*t.img, t.out); break;
+            case BatchConvert::TO_DDS: ok = EncodeDDS(*t.img, t.out); break;
+            case BatchConvert::TO_DXT1:
+                ok = EncodeBlocks(*t.img, TextureCodec::FMT_BC1, m_quality, t.out);
+                break;
+            case BatchConvert::TO_DXT5:
+                ok = EncodeBlocks(*t.img, TextureCodec::FMT_BC3, m_quality, t.out);
+                break;
+            case BatchConvert::TO_ATI1:
+                ok = EncodeBlocks(*t.img, TextureCodec::FMT_BC4, m_quality, t.out);
+                break;
+            case BatchConvert::TO_ATI2:
+                ok = EncodeBlocks(*t.img, TextureCodec::FMT_BC5, m_quality, t.out);
+                break;
+            case BatchConvert::TO_BCT:
+            case BatchConvert::TO_BCT360:
+                break;                  // repacked by the readers
+        }
+        t.result.ms += Timed(STAGE_ENCODE, sw);
+        if (!ok) return Fail(t, "cannot encode the output");
+        return true;
+    }
+
+    // Only the writer creates folders, so there is no race on them
+    bool Save(Task& t)
+    {
+        wxStopWatch sw;
+        wxLogNull quiet;
+        const wxString dir = wxFileName(t.result.out).GetPath();
+        bool ok = wxFileName::DirExists(dir) ||
+                  wxFileName::Mkdir(dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+        if (ok) {
+            wxFile f;
+            ok = f.Create(t.result.out, true) &&
+                 f.Write(&t.out[0], t.out.size()) == t.out.size() && f.Close();
+            if (!ok && wxFileExists(t.result.out))
+                wxRemoveFile(t.result.out);   // no half-written files
+        }
+        t.result.ms += Timed(STAGE_WRITE, sw);
+        if (!ok) return Fail(t, "cannot write the output");
+
+        t.result.outBytes = t.out.size();
+        t.result.ok       = true;
+        return true;
+    }
+
+    // -- thread bodies ------------------------------------------------------
+    void Read()
+    {
+        for (;;)
+        {
+            size_t job;
+            {
+                wxMutexLocker lock(m_lock);
+                while (m_inFlight >= m_limit && m_next < m_jobs.size())
+                    m_space.Wait();
+                if (m_next >= m_jobs.size()) break;
+                job = m_next++;
+                ++m_inFlight;
+            }
+            Task* t = NewTask(job);
+            if (!Load(*t))   Finish(t);
+            else if (t->img) Deal(t);
+            else             ToWrite(t);   // re-containered
+        }
+        wxMutexLocker lock(m_lock);
+        --m_readersLeft;
+        m_work.Broadcast();
+    }
+
+    void Work(size_t self)
+    {
+        for (;;)
+        {
+            Task* t = Take(self);
+            if (!t) {
+                wxMutexLocker lock(m_lock);
+                if (m_queued <= 0 && m_readersLeft == 0) break;
+                if (m_queued <= 0) m_work.Wait();
+                continue;
+            }
+
+            const bool ok = Encode(*t);
+            t->img.reset();             // the writer only needs the buffer
+            if (ok) ToWrite(t);
+            else    Finish(t);
+        }
+        wxMutexLocker lock(m_lock);
+        --m_workersLeft;
+        m_writable.Signal();
+    }
+
+    void Write()
+    {
+        for (;;)
+        {
+            Task* t;
+            {
+                wxMutexLocker lock(m_lock);
+                while (m_toWrite.empty() && m_workersLeft > 0)
+                    m_writable.Wait();
+                if (m_toWrite.empty()) break;
+                t = m_toWrite.front();
+                m_toWrite.pop_front();
+            }
+            Save(*t);
+            Finish(t);
+        }
+        wxMutexLocker lock(m_lock);
+        m_writerDone = true;
+        m_finishedCond.Signal();
+    }
+
+    // -- queues -------------------------------------------------------------
+    void Deal(Task* t)
+    {
+        size_t lane;
+        {
+            wxMutexLocker lock(m_lock);
+            lane = m_dealt++ % m_lanes.size();
+        }
+        {
+            wxMutexLocker lock(m_lanes[lane]->lock);
+            m_lanes[lane]->tasks.push_back(t);
+        }
+        wxMutexLocker lock(m_lock);
+        ++m_queued;
+        m_work.Signal();
+    }
+
+    // Own queue from the front; otherwise steal from the back of the fullest
+    Task* Take(size_t self)
+    {
+        Task* t = NULL;
+        {
+            Lane& own = *m_lanes[self];
+            wxMutexLocker lock(own.lock);
+            if (!own.tasks.empty()) {
+                t = own.tasks.front();
+                own.tasks.pop_front();
+            }
+        }
+        if (!t) {
+            size_t victim = self, most = 0;
+            for (size_t i = 0; i < m_lanes.size(); ++i) {
+                if (i == self) continue;
+                wxMutexLocker lock(m_lanes[i]->lock);
+                if (m_lanes[i]->tasks.size() > most) {
+                    most   = m_lanes[i]->tasks.size();
+                    victim = i;
+                }
+            }
+            if (most > 0) {
+                Lane& other = *m_lanes[victim];
+                wxMutexLocker lock(other.lock);
+                if (!other.tasks.empty()) {
+                    t = other.tasks.back();
+                    other.tasks.pop_back();
+                }
+            }
+        }
+        if (t) {
+            wxMutexLocker lock(m_lock);
+            --m_queued;
+        }
+        return t;
+    }
+
+    void ToWrite(Task* t)
+    {
+        wxMutexLocker lock(m_lock);
+        m_toWrite.push_back(t);
+        m_writable.Signal();
+    }
+
+    void Finish(Task* t)
+    {
+        t->img.reset();
+        std::vector<unsigned char>().swap(t->out);
+        wxMutexLocker lock(m_lock);
+        m_finished.push_back(t);
+        --m_inFlight;
+        m_space.Signal();
+        m_finishedCond.Signal();
+    }
+
+    const std::vector<BatchConvert::Job>& m_jobs;
+    const BatchConvert::Target            m_target;
+    const TextureCodec::Quality           m_quality;
+
+    wxMutex             m_lock;         // everything below but the lanes
+    wxCondition         m_space;        // readers: in-flight dropped below the cap
+    wxCondition         m_work;         // workers: something was dealt
+    wxCondition         m_writable;     // writer: something was encoded
+    wxCondition         m_finishedCond; // caller: something finished
+    size_t              m_next;         // next job to read
+    size_t              m_inFlight;
+    const size_t        m_limit;
+    size_t              m_dealt;
+    int                 m_queued;       // on the lanes; dips below 0 briefly
+    int                 m_readersLeft;
+    int                 m_workersLeft;
+    bool                m_writerDone;
+    std::deque<Task*>   m_toWrite;
+    std::vector<Task*>  m_finished;
+
+    std::vector<std::unique_ptr<Lane>> m_lanes;
+    std::vector<StageThread*>          m_threads;
+    std::atomic<uint64_t>              m_us[STAGES];
+};
+
+bool IsTexture(const wxString& path)
+{
+    const wxString ext = path.AfterLast('.').Lower();
+    return ext == "dds" || ext == "bct";
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+bool BatchConvert::ParseTarget(const wxString& name, Target& target)
+{
+    const wxString n = name.Lower();
+    if      (n == "png") target = TO_PNG;
+    else if (n == "tga") target = TO_TGA;
+    else if (n == "dds") target = TO_DDS;
+    else if (n == "dxt1") target = TO_DXT1;
+    else if (n == "dxt5") target = TO_DXT5;
+    else if (n == "ati1") target = TO_ATI1;
+    else if (n == "ati2") target = TO_ATI2;
+    else if (n == "bct") target = TO_BCT;
+    else if (n == "bct360") target = TO_BCT360;
+    else return false;
+    return true;
+}
+
+wxString BatchConvert::Extension(Target target)
+{
+    switch (target) {
+        case TO_TGA: return "tga";
+        case TO_DDS:
+        case TO_DXT1:
+        case TO_DXT5:
+        case TO_ATI1:
+        case TO_ATI2: return "dds";
+        case TO_BCT:
+        case TO_BCT360: return "bct";
+        default:     return "png";
+    }
+}
+
+bool BatchConvert::Collect(const wxString& in, const wxString& out, Target target)
+{
+    m_jobs.clear();
+    m_target = target;
+
+    const wxString outRoot = TextureLibrary::NormalizeRoot(out);
+    const wxString ext     = Extension(target);
+    std::unordered_set<std::wstring> taken;   // folded output paths
+
+    // rel is the input's path below the input root, extension included
+    auto add = [&](const wxString& path, const wxString& rel) {
+        Job job;
+        job.in = path;
+        int64_t mtime;
+        if (!FileSource::Stat(path, job.bytes, mtime)) return;
+
+        wxString stem = rel.BeforeLast('.');
+        stem.Replace("/", wxString(wxFILE_SEP_PATH));
+        job.out = outRoot + wxFILE_SEP_PATH + stem + "." + ext;
+        // a.dds and a.bct side by side must not land on the same file
+        if (!taken.insert(job.out.Lower().ToStdWstring()).second)
+            job.out = outRoot + wxFILE_SEP_PATH + stem + "_" +
+                      rel.AfterLast('.').Lower() + "." + ext;
+        taken.insert(job.out.Lower().ToStdWstring());
+        m_jobs.push_back(job);
+    };
+
+    // an archive's members go into a folder named after it
+    auto addArchive = [&](const wxString& archive, const wxString& rel) {
+        std::vector<wxString> members;
+        FileSource::ListArchive(archive, members);
+        wxString a, member;
+        for (size_t i = 0; i < members.size(); ++i)
+            if (FileSource::SplitMember(members[i], a, member))
+                add(members[i], rel + member);
+    };
+
+    if (FileSource::IsArchive(in)) {
+        addArchive(in, wxEmptyString);
+    } else {
+        const wxString root = TextureLibrary::NormalizeRoot(in);
+        if (!wxFileName::DirExists(root)) {
+            wxLogError("Folder not found: %s", root);
+            return false;
+        }
+        wxArrayString files;
+        {
+            wxLogNull quiet;            // unreadable folders are skipped
+            wxDir::GetAllFiles(root, &files, wxEmptyString,
+                               wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN);
+        }
+        files.Sort();
+
+        const size_t cut = root.length() +
+                           (wxFileName::IsPathSeparator(root.Last()) ? 0 : 1);
+        for (size_t i = 0; i < files.size(); ++i) {
+            const wxString rel = files[i].Mid(cut);
+            if (FileSource::IsArchive(files[i]))
+                addArchive(files[i], rel.BeforeLast('.') + wxFILE_SEP_PATH);
+            else if (IsTexture(files[i]))
+                add(files[i], rel);
+        }
+    }
+
+    if (m_jobs.empty()) {
+        wxLogError("No DDS or BCT textures in %s", in);
+        return false;
+    }
+    // largest first, so no big texture starts last and holds up the end
+    std::stable_sort(m_jobs.begin(), m_jobs.end(), [](const Job& a, const Job& b) {
+        return a.bytes > b.bytes;
+    });
+    return true;
+}
+
+bool BatchConvert::Run(int jobs, const ResultFn& each)
+{
+    m_totals = Totals();
+    m_totals.files = m_jobs.size();
+
+    if (m_target == TO_PNG && !wxImage::FindHandler(wxBITMAP_TYPE_PNG))
+        wxImage::AddHandler(new wxPNGHandler);
+
+    const int cpus    = std::max(1, wxThread::GetCPUCount());
+    const int workers = std::min<int>(MAX_JOBS, jobs > 0 ? jobs : cpus);
+
+    wxStopWatch clock;
+    Pipeline pipe(m_jobs, m_target, m_quality, workers);
+
+    auto report = [this, &each](Task* t) {
+        const Result& r = t->result;
+        if (!r.ok) ++m_totals.failed;
+        m_totals.inBytes  += r.inBytes;
+        m_totals.outBytes += r.outBytes;
+        if (each) each(r);
+        delete t;
+    };
+
+    if (!pipe.Start()) {
+        for (size_t i = 0; i < m_jobs.size(); ++i)   // no threads: convert inline
+            report(pipe.Inline(i));
+    } else {
+        std::vector<Task*> done;
+        bool over;
+        do {
+            over = pipe.Drain(POLL_MS, done);
+            for (size_t i = 0; i < done.size(); ++i)
+                report(done[i]);
+        } while (!over);
+        pipe.Join();
+    }
+
+    m_totals.seconds  = clock.Time() / 1000.0;
+    m_totals.readMs   = pipe.StageMs(STAGE_READ);
+    m_totals.decodeMs = pipe.StageMs(STAGE_DECODE);
+    m_totals.encodeMs = pipe.StageMs(STAGE_ENCODE);
+    m_totals.writeMs  = pipe.StageMs(STAGE_WRITE);
+    return m_totals.failed == 0;
+}
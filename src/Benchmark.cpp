@@ -0,0 +1,871 @@
+// -----------------------------------------------------------------------------
+//  Benchmark.cpp – timings of the decode and display hot paths
+// -----------------------------------------------------------------------------
+#include "Benchmark.h"
+#include "BCTImage.h"
+#include "BufferPool.h"
+#include "DDSImage.h"
+#include "ImageScale.h"
+#include "TextureCodec.h"
+#include "BlockEncoder.h"
+#include "ZipArchive.h"
+
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/mstream.h>
+#include <wx/stopwatch.h>
+#include <wx/zstream.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef __WXMSW__
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <winioctl.h>
+#include <io.h>
+#endif
+
+namespace {
+
+const int    SIZES[]  = { 256, 1024, 4096 };
+const double MIN_MS   = 250;           // wall time per stage and size
+const int    MIN_RUNS = 3;
+const int    MAX_RUNS = 1000;
+
+typedef std::vector<unsigned char> Bytes;
+
+// xorshift32 – the same payload on every run and every machine
+Bytes Noise(size_t n, const wxString& name, int size)
+{
+    uint32_t x = 2166136261u ^ uint32_t(size);
+    for (size_t i = 0; i < name.length(); ++i)
+        x = (x ^ uint32_t(name[i])) * 16777619u;
+    if (!x) x = 1;
+
+    Bytes v(n);
+    for (size_t i = 0; i < n; ++i) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        v[i] = static_cast<unsigned char>(x >> 24);
+    }
+    return v;
+}
+
+// Best of several runs; prep() is not timed
+double Time(const std::function<void()>& prep, const std::function<void()>& op)
+{
+    double best = 1e30, total = 0;
+    for (int runs = 0; runs < MIN_RUNS || (total < MIN_MS && runs < MAX_RUNS); ++runs) {
+        if (prep) prep();
+        wxStopWatch sw;
+        op();
+        const double ms = sw.TimeInMicro().ToDouble() / 1000.0;
+        best   = std::min(best, ms);
+        total += ms;
+    }
+    return best;
+}
+
+// First differing pixel of two w-wide BGRA images
+bool Same(const Bytes& got, const Bytes& want, int w, wxString& note)
+{
+    if (got.size() != want.size()) {
+        note = "output size differs";
+        return false;
+    }
+    for (size_t i = 0; i < got.size(); ++i)
+        if (got[i] != want[i]) {
+            const size_t px = i / 4;
+            note.Printf("differs at %d,%d", int(px % w), int(px / w));
+            return false;
+        }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  Scalar references – one texel at a time, straight from the block layouts,
+//  in the loaders' output convention: BGRA, BC4 as grey, BC5 red in B and
+//  green in G with R = 127
+// -----------------------------------------------------------------------------
+enum RefFormat { REF_BC1, REF_BC2, REF_BC3, REF_BC4, REF_BC5 };
+
+int Expand5(unsigned v) { return int((v << 3) | (v >> 2)); }
+int Expand6(unsigned v) { return int((v << 2) | (v >> 4)); }
+
+// The colour block's endpoints, expanded to 8 bits (B, G, R), and texel i's
+// 2-bit index
+unsigned RefEndpoints(const unsigned char* s, int i, unsigned& c0, unsigned& c1,
+                      int e0[3], int e1[3])
+{
+    c0 = s[0] | (s[1] << 8);
+    c1 = s[2] | (s[3] << 8);
+    const unsigned v[2] = { c0, c1 };
+    int* e[2] = { e0, e1 };
+    for (int j = 0; j < 2; ++j) {
+        e[j][0] = Expand5(v[j] & 31);
+        e[j][1] = Expand6((v[j] >> 5) & 63);
+        e[j][2] = Expand5(v[j] >> 11);
+    }
+    return (s[4 + i / 4] >> (2 * (i % 4))) & 3;
+}
+
+// BC2/BC3 colour: always colour 0, colour 1 and the two colours a third and
+// two thirds of the way between; the order of c0 and c1 means nothing here
+void RefColour4(const unsigned char* s, int i, unsigned char out[4])
+{
+    unsigned c0, c1;
+    int e0[3], e1[3];
+    const unsigned sel = RefEndpoints(s, i, c0, c1, e0, e1);
+    for (int k = 0; k < 3; ++k) {
+        const int third[4] = { 0, 3, 1, 2 };       // thirds of the way to colour 1
+        out[k] = static_cast<unsigned char>(((3 - third[sel]) * e0[k] + third[sel] * e1[k]) / 3);
+    }
+    out[3] = 255;
+}
+
+// BC1 colour: the BC2/BC3 palette when c0 > c1; otherwise colour 0,
+// colour 1, their midpoint and transparent black
+void RefColourBC1(const unsigned char* s, int i, unsigned char out[4])
+{
+    unsigned c0, c1;
+    int e0[3], e1[3];
+    const unsigned sel = RefEndpoints(s, i, c0, c1, e0, e1);
+    if (c0 > c1) {
+        RefColour4(s, i, out);
+        return;
+    }
+    for (int k = 0; k < 3; ++k) {
+        const int v[4] = { e0[k], e1[k], (e0[k] + e1[k]) / 2, 0 };
+        out[k] = static_cast<unsigned char>(v[sel]);
+    }
+    out[3] = sel == 3 ? 0 : 255;
+}
+
+// One channel of a BC3 alpha / BC4 / BC5 block
+unsigned char RefChannel(const unsigned char* s, int i)
+{
+    const int a0 = s[0], a1 = s[1];
+    unsigned sel = 0;
+    for (int b = 0; b < 3; ++b) {
+        const int at = 3 * i + b;
+        sel |= unsigned((s[2 + at / 8] >> (at % 8)) & 1) << b;
+    }
+    int v;
+    if      (sel == 0) v = a0;
+    else if (sel == 1) v = a1;
+    else if (a0 > a1)  v = ((8 - sel) * a0 + (sel - 1) * a1) / 7;
+    else if (sel == 6) v = 0;
+    else if (sel == 7) v = 255;
+    else               v = ((6 - sel) * a0 + (sel - 1) * a1) / 5;
+    return static_cast<unsigned char>(v);
+}
+
+void RefDecode(RefFormat fmt, const unsigned char* blocks, int w, int h, Bytes& out)
+{
+    const int blockBytes = (fmt == REF_BC1 || fmt == REF_BC4) ? 8 : 16;
+    out.assign(size_t(w) * h * 4, 0);
+
+    const unsigned char* s = blocks;
+    for (int by = 0; by < (h + 3) / 4; ++by)
+        for (int bx = 0; bx < (w + 3) / 4; ++bx, s += blockBytes)
+            for (int i = 0; i < 16; ++i)
+            {
+                const int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x >= w || y >= h) continue;
+                unsigned char* p = &out[(size_t(y) * w + x) * 4];
+                switch (fmt) {
+                    case REF_BC1:
+                        RefColourBC1(s, i, p);
+                        break;
+                    case REF_BC2:
+                        RefColour4(s + 8, i, p);
+                        p[3] = static_cast<unsigned char>(((s[i / 2] >> (4 * (i & 1))) & 15) * 17);
+                        break;
+                    case REF_BC3:
+                        RefColour4(s + 8, i, p);
+                        p[3] = RefChannel(s, i);
+                        break;
+                    case REF_BC4:
+                        p[0] = p[1] = p[2] = RefChannel(s, i);
+                        p[3] = 255;
+                        break;
+                    case REF_BC5:
+                        p[0] = RefChannel(s, i);
+                        p[1] = RefChannel(s + 8, i);
+                        p[2] = 127;
+                        p[3] = 255;
+                        break;
+                }
+            }
+}
+
+void RefPremultiply(Bytes& px)
+{
+    for (size_t i = 0; i < px.size(); i += 4) {
+        const unsigned a = px[i + 3];
+        if (a == 255) continue;
+        for (int k = 0; k < 3; ++k)
+            px[i + k] = static_cast<unsigned char>(px[i + k] * a / 255);
+    }
+}
+
+void RefNearest(const Bytes& src, int sw, int sh, Bytes& dst, int dw, int dh)
+{
+    dst.resize(size_t(dw) * dh * 4);
+    for (int y = 0; y < dh; ++y)
+        for (int x = 0; x < dw; ++x) {
+            const size_t sx = size_t((long long)x * sw / dw);
+            const size_t sy = size_t((long long)y * sh / dh);
+            std::memcpy(&dst[(size_t(y) * dw + x) * 4], &src[(sy * sw + sx) * 4], 4);
+        }
+}
+
+void RefBox(const Bytes& src, int sw, int sh, Bytes& dst, int dw, int dh, bool linear)
+{
+    dst.resize(size_t(dw) * dh * 4);
+    for (int y = 0; y < dh; ++y)
+        for (int x = 0; x < dw; ++x)
+        {
+            const int x0 = int((long long)x * sw / dw), x1 = int((long long)(x + 1) * sw / dw);
+            const int y0 = int((long long)y * sh / dh), y1 = int((long long)(y + 1) * sh / dh);
+            unsigned long long sum[4] = { 0, 0, 0, 0 };
+            for (int sy = y0; sy < y1; ++sy)
+                for (int sx = x0; sx < x1; ++sx) {
+                    const unsigned char* p = &src[(size_t(sy) * sw + sx) * 4];
+                    for (int k = 0; k < 3; ++k)
+                        sum[k] += linear ? ImageScale::SrgbToLinear16(p[k]) : p[k];
+                    sum[3] += p[3];
+                }
+            const unsigned long long n = (unsigned long long)(x1 - x0) * (y1 - y0);
+            unsigned char* out = &dst[(size_t(y) * dw + x) * 4];
+            for (int k = 0; k < 4; ++k) {
+                const unsigned long long v = (sum[k] + n / 2) / n;
+                out[k] = (linear && k < 3) ? ImageScale::Linear16ToSrgb(uint16_t(v))
+                                           : static_cast<unsigned char>(v);
+            }
+        }
+}
+
+struct Decoder
+{
+    const char* name;
+    bool        bct;
+    unsigned    code;                  // DDS FourCC, or BCT (DXGI-mapped) format
+    RefFormat   ref;
+    unsigned    blockBytes;
+};
+
+// What the encoder stages compress, and which BGRA bytes of the reference
+// decode carry the result
+struct Encoder
+{
+    const char*          name;
+    TextureCodec::Format fmt;
+    RefFormat            ref;
+    unsigned             channels;     // bit k: byte k
+    double               minPsnr;      // dB, range fit
+};
+
+const Encoder ENCODERS[] = {
+    { "bc1", TextureCodec::FMT_BC1, REF_BC1, 0x7, 36 },
+    { "bc3", TextureCodec::FMT_BC3, REF_BC3, 0xF, 36 },
+    { "bc4", TextureCodec::FMT_BC4, REF_BC4, 0x4, 44 },
+    { "bc5", TextureCodec::FMT_BC5, REF_BC5, 0x3, 44 },
+};
+const int CLUSTER_MAX_SIDE = 1024;     // the cluster fit is far slower
+
+// Gradients in every channel with a little grain on top: the kind of
+// content block compression is judged on
+Bytes Smooth(int n)
+{
+    const Bytes grain = Noise(size_t(n) * n, "smooth", n);
+    Bytes v(size_t(n) * n * 4);
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            const size_t i = size_t(y) * n + x;
+            const int    g = (grain[i] & 7) - 4;
+            unsigned char* p = &v[i * 4];
+            p[0] = static_cast<unsigned char>(std::min(255, std::max(0, x * 255 / n + g)));
+            p[1] = static_cast<unsigned char>(std::min(255, std::max(0, y * 255 / n - g)));
+            p[2] = static_cast<unsigned char>(std::min(255, std::max(0, (x + y) * 255 / (2 * n) + g)));
+            p[3] = static_cast<unsigned char>(255 - x * 127 / n);   // BC1 stays opaque
+        }
+    return v;
+}
+
+double Psnr(const Bytes& a, const Bytes& b, unsigned channels)
+{
+    double se = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        if ((channels >> (i % 4)) & 1) {
+            const double d = double(a[i]) - b[i];
+            se += d * d;
+            ++count;
+        }
+    return se > 0 ? 10 * std::log10(255.0 * 255.0 * count / se) : 99;
+}
+
+// -----------------------------------------------------------------------------
+//  A ZIP64 archive whose members start past 4 GB: a stored member of that
+//  size, left as a hole in a sparse file, then one stored and one deflated
+//  member.  No CRCs; the reader does not check them.
+// -----------------------------------------------------------------------------
+const uint64_t ZIP64_PAD = (uint64_t(4) << 30) + 4099;
+
+void Le(Bytes& v, uint64_t x, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) v.push_back(static_cast<unsigned char>(x >> (8 * i)));
+}
+
+struct ZipEntry
+{
+    const char* name;
+    uint16_t    method;
+    uint64_t    packed, size, at;
+};
+
+// Sizes and offsets always as ZIP64: 0xFFFFFFFF and the extra field
+void ZipHeader(Bytes& v, const ZipEntry& e, bool central)
+{
+    const size_t nameLen = std::strlen(e.name);
+    Le(v, central ? 0x02014b50 : 0x04034b50, 4);
+    if (central) Le(v, 45, 2);                  // made by
+    Le(v, 45, 2);                               // needed
+    Le(v, 0, 2);                                // flags
+    Le(v, e.method, 2);
+    Le(v, 0, 4);                                // time, date
+    Le(v, 0, 4);                                // CRC
+    Le(v, 0xFFFFFFFF, 4);
+    Le(v, 0xFFFFFFFF, 4);
+    Le(v, nameLen, 2);
+    Le(v, central ? 28 : 20, 2);                // extra
+    if (central) {
+        Le(v, 0, 2 + 2 + 2);                    // comment, disk, internal attributes
+        Le(v, 0, 4);                            // external attributes
+        Le(v, 0xFFFFFFFF, 4);
+    }
+    v.insert(v.end(), e.name, e.name + nameLen);
+    Le(v, 1, 2);
+    Le(v, central ? 24 : 16, 2);
+    Le(v, e.size, 8);
+    Le(v, e.packed, 8);
+    if (central) Le(v, e.at, 8);
+}
+
+bool WriteZip64(const wxString& path, const Bytes& stored, const Bytes& packed, size_t inflated)
+{
+    wxFile f(path, wxFile::write);
+    if (!f.IsOpened()) return false;
+#ifdef __WXMSW__
+    DWORD got;                                  // else NTFS writes out the 4 GB
+    ::DeviceIoControl(reinterpret_cast<HANDLE>(_get_osfhandle(f.fd())), FSCTL_SET_SPARSE,
+                      NULL, 0, NULL, 0, &got, NULL);
+#endif
+    ZipEntry e[3] = {
+        { "pad.bin",     0, ZIP64_PAD,     ZIP64_PAD,  0 },
+        { "stored.bin",  0, stored.size(), stored.size(), 0 },
+        { "deflate.bin", 8, packed.size(), inflated,   0 },
+    };
+    const Bytes* data[3] = { NULL, &stored, &packed };
+
+    uint64_t at = 0;
+    for (int i = 0; i < 3; ++i) {
+        Bytes head;
+        ZipHeader(head, e[i], false);
+        e[i].at = at;
+        if (f.Seek(wxFileOffset(at)) == wxInvalidOffset ||
+            f.Write(&head[0], head.size()) != head.size())
+            return false;
+        at += head.size() + e[i].packed;
+        if (data[i] && f.Write(&(*data[i])[0], data[i]->size()) != data[i]->size())
+            return false;
+    }
+
+    Bytes tail;
+    for (int i = 0; i < 3; ++i) ZipHeader(tail, e[i], true);
+    const uint64_t cdSize = tail.size(), eocd64 = at + cdSize;
+    Le(tail, 0x06064b50, 4); Le(tail, 44, 8); Le(tail, 45, 2); Le(tail, 45, 2);
+    Le(tail, 0, 8);          Le(tail, 3, 8);  Le(tail, 3, 8);
+    Le(tail, cdSize, 8);     Le(tail, at, 8);
+    Le(tail, 0x07064b50, 4); Le(tail, 0, 4);  Le(tail, eocd64, 8); Le(tail, 1, 4);
+    Le(tail, 0x06054b50, 4); Le(tail, 0, 4);  Le(tail, 0xFFFF, 2); Le(tail, 0xFFFF, 2);
+    Le(tail, 0xFFFFFFFF, 4); Le(tail, 0xFFFFFFFF, 4); Le(tail, 0, 2);
+    return f.Seek(wxFileOffset(at)) != wxInvalidOffset &&
+           f.Write(&tail[0], tail.size()) == tail.size() && f.Close();
+}
+
+// A one-level DXT5 DDS of n x n texels
+bool WriteDXT5(const wxString& path, int n, const Bytes& blocks)
+{
+    DDSHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.magic             = 0x20534444;
+    hdr.size              = 124;
+    hdr.flags             = 0x81007;           // caps, height, width, pixel format, linear size
+    hdr.width             = hdr.height = unsigned(n);
+    hdr.pitchOrLinearSize = unsigned(blocks.size());
+    hdr.mipMapCount       = 1;
+    hdr.pf.size           = 32;
+    hdr.pf.flags          = 0x4;               // fourCC
+    hdr.pf.fourCC         = 0x35545844;
+    hdr.caps              = 0x1000;
+    wxFile f(path, wxFile::write);
+    return f.IsOpened() && f.Write(&hdr, sizeof(hdr)) == sizeof(hdr) &&
+           f.Write(&blocks[0], blocks.size()) == blocks.size() && f.Close();
+}
+
+// Reads a whole member; empty if it cannot be opened
+Bytes ReadMember(const ZipArchive& zip, const char* name)
+{
+    const ZipArchive::Member* m = zip.Find(name);
+    std::unique_ptr<wxInputStream> in(m ? zip.OpenMember(*m) : NULL);
+    Bytes v;
+    if (!in) return v;
+    v.resize(size_t(m->size));
+    in->Read(&v[0], v.size());
+    v.resize(in->LastRead());
+    return v;
+}
+
+const Decoder DECODERS[] = {
+    { "dds.dxt1", false, 0x31545844, REF_BC1, 8  },
+    { "dds.dxt3", false, 0x33545844, REF_BC2, 16 },
+    { "dds.dxt5", false, 0x35545844, REF_BC3, 16 },
+    { "dds.ati2", false, 0x32495441, REF_BC5, 16 },
+    { "bct.dxt1", true,  0x47,       REF_BC1, 8  },
+    { "bct.dxt5", true,  0x4D,       REF_BC3, 16 },
+    { "bct.ati1", true,  0x50,       REF_BC4, 8  },
+    { "bct.ati2", true,  0x53,       REF_BC5, 16 },
+};
+
+// An 8x4 image of two BC2/BC3 colour blocks, decoded by hand from the
+// format so a rule the decoders and the reference share cannot pass as a
+// match: blue c0 below red c1 with indices 0 1 2 3 along every row, then
+// c0 == c1 (green) with every index 3 – the cases BC1 reads as three
+// colours and black
+const unsigned char KNOWN_COLOUR[2][8] = {
+    { 0x1F, 0x00, 0x00, 0xF8, 0xE4, 0xE4, 0xE4, 0xE4 },
+    { 0xE0, 0x07, 0xE0, 0x07, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+const unsigned char KNOWN_ROW[8][4] = {              // BGRA, every row alike
+    { 255, 0, 0, 255 }, { 0, 0, 255, 255 }, { 170, 0, 85, 255 }, { 85, 0, 170, 255 },
+    { 0, 255, 0, 255 }, { 0, 255, 0, 255 }, { 0, 255, 0, 255 }, { 0, 255, 0, 255 },
+};
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+bool Benchmark::Run(const wxString& filterIn, const RowFn& row)
+{
+    const wxString filter = filterIn.Lower() == "all" ? wxString() : filterIn.Lower();
+    auto wanted = [&filter](const wxString& stage) {
+        return filter.IsEmpty() || stage.Contains(filter);
+    };
+
+    bool same = true;
+    auto emit = [&](const wxString& stage, int w, int h, double ms, size_t inBytes,
+                    Check check, const wxString& note) {
+        Row r;
+        r.stage         = stage;
+        r.width         = w;
+        r.height        = h;
+        r.ms            = ms;
+        r.mbPerSec      = ms > 0 ? inBytes / double(1 << 20) / (ms / 1000) : 0;
+        r.mTexelsPerSec = ms > 0 ? double(w) * h / 1e6 / (ms / 1000) : 0;
+        r.check         = check;
+        r.note          = note;
+        if (check == CHECK_FAILED) same = false;
+        row(r);
+    };
+
+    for (size_t si = 0; si < WXSIZEOF(SIZES); ++si)
+    {
+        const int    n  = SIZES[si];
+        const size_t px = size_t(n) * n;
+
+        // -- block decoders, through DecodePixels() as the viewer calls them --
+        for (size_t d = 0; d < WXSIZEOF(DECODERS); ++d)
+        {
+            const Decoder& dec = DECODERS[d];
+            if (!wanted(dec.name)) continue;
+
+            const Bytes blocks = Noise(px / 16 * dec.blockBytes, dec.name, n);
+            Bytes got;
+            double ms;
+            if (dec.bct) {
+                BCTImage img;
+                img.m_w = img.m_h = n;
+                img.m_pitch  = n * 4;
+                img.m_format = int(dec.code);
+                img.m_blocks.assign(blocks.begin(), blocks.end());
+                ms = Time([&img] { BufferPool::Give(img.m_pixels); img.m_pixels = NULL; },
+                          [&img] { img.DecodePixels(ImageBase::CancelFn()); });
+                if (img.m_pixels) got.assign(img.m_pixels, img.m_pixels + px * 4);
+            } else {
+                DDSImage img;
+                img.m_w = img.m_h = n;
+                img.m_pitch  = n * 4;
+                img.m_fourCC = dec.code;
+                img.m_blocks.assign(blocks.begin(), blocks.end());
+                ms = Time([&img] { BufferPool::Give(img.m_pixels); img.m_pixels = NULL; },
+                          [&img] { img.DecodePixels(ImageBase::CancelFn()); });
+                if (img.m_pixels) got.assign(img.m_pixels, img.m_pixels + px * 4);
+            }
+
+            Bytes want;
+            RefDecode(dec.ref, &blocks[0], n, n, want);
+            wxString note;
+            const bool ok = Same(got, want, n, note);
+            emit(dec.name, n, n, ms, blocks.size(), ok ? CHECK_OK : CHECK_FAILED, note);
+        }
+
+        // -- the core API as the batch tools use it: RGBA, a stride wider than
+        //    the row, and a size that cuts the last blocks --------------------
+        if (wanted("codec.bc3.rgba")) {
+            const int    w = n - 2, stride = n * 4 + 64;
+            const Bytes  blocks = Noise(px, "codec.bc3.rgba", n);
+            Bytes        out(size_t(stride) * w);
+            TextureCodec::Result r = TextureCodec::OK;
+            const double ms = Time(std::function<void()>(), [&] {
+                r = TextureCodec::Decode(TextureCodec::FMT_BC3, TextureCodec::Span(&blocks[0], blocks.size()),
+                                         w, w, TextureCodec::Target(&out[0], stride, TextureCodec::ORDER_RGBA));
+            });
+
+            Bytes want, got(size_t(w) * w * 4);
+            RefDecode(REF_BC3, &blocks[0], w, w, want);
+            for (size_t i = 0; i < want.size(); i += 4)
+                std::swap(want[i], want[i + 2]);
+            for (int y = 0; y < w; ++y)
+                std::memcpy(&got[size_t(y) * w * 4], &out[size_t(y) * stride], size_t(w) * 4);
+            wxString note = r == TextureCodec::OK ? wxString() : wxString(TextureCodec::ResultText(r));
+            const bool ok = note.IsEmpty() && Same(got, want, w, note);
+            emit("codec.bc3.rgba", w, w, ms, blocks.size(), ok ? CHECK_OK : CHECK_FAILED, note);
+        }
+
+        // -- the encoder, on a smooth image, decoded again by the references:
+        //    a PSNR floor, and the cluster fit no worse than the range fit ---
+        for (size_t e = 0; e < WXSIZEOF(ENCODERS); ++e)
+        {
+            const Encoder& enc = ENCODERS[e];
+            const wxString range   = wxString("encode.") + enc.name + ".range";
+            const wxString cluster = wxString("encode.") + enc.name + ".cluster";
+            const bool doCluster   = wanted(cluster) && n <= CLUSTER_MAX_SIDE;
+            if (!wanted(range) && !doCluster) continue;
+
+            const Bytes image = Smooth(n);
+            Bytes blocks(TextureCodec::LevelBytes(enc.fmt, n, n));
+            double rangePsnr = 0;
+            for (int q = 0; q < 2; ++q)
+            {
+                const TextureCodec::Quality quality = q ? TextureCodec::QUALITY_CLUSTER
+                                                        : TextureCodec::QUALITY_RANGE;
+                if (q ? !doCluster : !wanted(range)) continue;
+
+                TextureCodec::Result r = TextureCodec::OK;
+                const double ms = Time(std::function<void()>(), [&] {
+                    r = TextureCodec::Encode(enc.fmt, TextureCodec::Source(&image[0], size_t(n) * 4),
+                                             n, n, &blocks[0], blocks.size(), quality);
+                });
+
+                Bytes got;
+                RefDecode(enc.ref, &blocks[0], n, n, got);
+                const double psnr = Psnr(got, image, enc.channels);
+                wxString note;
+                bool ok = r == TextureCodec::OK;
+                if (!ok)
+                    note = TextureCodec::ResultText(r);
+                else if (q == 0) {
+                    rangePsnr = psnr;
+                    ok = psnr >= enc.minPsnr;
+                    note.Printf("PSNR %.2f dB%s", psnr, ok ? "" : " (below the floor)");
+                } else {
+                    ok = psnr >= rangePsnr;
+                    note.Printf("PSNR %.2f dB%s", psnr, ok ? "" : " (worse than the range fit)");
+                }
+                emit(q ? cluster : range, n, n, ms, image.size(), ok ? CHECK_OK : CHECK_FAILED, note);
+            }
+        }
+
+        // -- steady state: image after same-sized image, nothing new allocated --
+        if (wanted("pool.reuse")) {
+            const Bytes blocks = Noise(px / 2, "pool.reuse", n);     // DXT1
+            auto cycle = [&blocks, n] {
+                DDSImage img;
+                img.m_w = img.m_h = n;
+                img.m_pitch  = n * 4;
+                img.m_fourCC = 0x31545844;
+                img.m_blocks.assign(blocks.begin(), blocks.end());
+                img.DecodePixels(ImageBase::CancelFn());
+            };
+            cycle();                                        // fills the pool
+            const uint64_t before = BufferPool::SystemAllocations();
+            const double ms = Time(std::function<void()>(), cycle);
+            const uint64_t fresh = BufferPool::SystemAllocations() - before;
+            wxString note;
+            if (fresh) note.Printf("%lu fresh allocations", (unsigned long)fresh);
+            emit("pool.reuse", n, n, ms, blocks.size(), fresh ? CHECK_FAILED : CHECK_OK, note);
+        }
+
+        // -- Xbox 360 layout ----------------------------------------------------
+        if (wanted("x360.flip16")) {
+            const Bytes payload = Noise(px, "x360.flip16", n);   // BC3-sized
+            Bytes data;
+            const double ms = Time([&] { data = payload; },
+                                   [&] { TextureCodec::FlipByteOrder16(&data[0], data.size()); });
+            Bytes want = payload;
+            for (size_t i = 0; i + 1 < want.size(); i += 2)
+                std::swap(want[i], want[i + 1]);
+            emit("x360.flip16", n, n, ms, payload.size(),
+                 data == want ? CHECK_OK : CHECK_FAILED,
+                 data == want ? wxString() : wxString("bytes differ"));
+        }
+
+        // The untiler must move every block exactly once: each tiled block
+        // carries its own index, and the linear result has to hold each once
+        for (int bytes = 8; bytes <= 16; bytes += 8)
+        {
+            const wxString stage = bytes == 8 ? "x360.untile.bc1" : "x360.untile.bc3";
+            if (!wanted(stage)) continue;
+
+            const size_t blocks = px / 16;
+            Bytes tiled(blocks * bytes, 0);
+            for (size_t b = 0; b < blocks; ++b)
+                std::memcpy(&tiled[b * bytes], &b, std::min(sizeof(b), size_t(bytes)));
+
+            Bytes linear(tiled.size());
+            const double ms = Time(std::function<void()>(), [&] {
+                TextureCodec::UntileXbox360(&tiled[0], tiled.size(), &linear[0], n, n, bytes);
+            });
+
+            wxString note;
+            std::vector<bool> seen(blocks, false);
+            for (size_t b = 0; b < blocks && note.IsEmpty(); ++b) {
+                size_t id = 0;
+                std::memcpy(&id, &linear[b * bytes], std::min(sizeof(id), size_t(bytes)));
+                if (id >= blocks || seen[id])
+                    note.Printf("block %lu misplaced", (unsigned long)b);
+                else
+                    seen[id] = true;
+            }
+            emit(stage, n, n, ms, tiled.size(),
+                 note.IsEmpty() ? CHECK_OK : CHECK_FAILED, note);
+        }
+
+        // The tiler, as the BCT writer drives it, is checked by untiling its
+        // output back to what went in
+        for (int bytes = 8; bytes <= 16; bytes += 8)
+        {
+            const wxString stage = bytes == 8 ? "x360.tile.bc1" : "x360.tile.bc3";
+            if (!wanted(stage)) continue;
+
+            const Bytes linear = Noise(px / 16 * bytes, stage, n);
+            Bytes tiled(TextureCodec::TiledLevelBytes(bytes, n, n));
+            const double ms = Time(std::function<void()>(), [&] {
+                TextureCodec::TileXbox360(&linear[0], n, n, bytes, &tiled[0], tiled.size());
+            });
+
+            Bytes back(linear.size());
+            TextureCodec::UntileXbox360(&tiled[0], tiled.size(), &back[0], n, n, bytes);
+            wxString note;
+            for (size_t b = 0; b < linear.size() / bytes && note.IsEmpty(); ++b)
+                if (std::memcmp(&back[b * bytes], &linear[b * bytes], bytes) != 0)
+                    note.Printf("block %lu lost", (unsigned long)b);
+            emit(stage, n, n, ms, linear.size(), note.IsEmpty() ? CHECK_OK : CHECK_FAILED, note);
+        }
+
+        // -- passes over decoded pixels -------------------------------------------
+        const Bytes pixels = Noise(px * 4, "pixels", n);
+        static const char* const PASSES[] = { "premultiply", "normal.rg", "normal.ag", "normal.arg" };
+        for (size_t p = 0; p < WXSIZEOF(PASSES); ++p)
+        {
+            if (!wanted(PASSES[p])) continue;
+            DDSImage img;
+            img.m_w = img.m_h = n;
+            img.m_pitch  = n * 4;
+            img.m_pixels = static_cast<unsigned char*>(BufferPool::Take(px * 4));
+            const double ms = Time([&] { std::memcpy(img.m_pixels, &pixels[0], px * 4); },
+                                   [&] {
+                switch (p) {
+                    case 0:  img.PreMultiplyAlpha(); break;
+                    case 1:  img.ApplyNormalRG();    break;
+                    case 2:  img.ApplyNormalAG();    break;
+                    default: img.ApplyNormalARG();   break;
+                }
+            });
+
+            if (p == 0) {                  // only premultiply has a reference
+                Bytes got(img.m_pixels, img.m_pixels + px * 4), want = pixels;
+                RefPremultiply(want);
+                wxString note;
+                const bool ok = Same(got, want, n, note);
+                emit(PASSES[p], n, n, ms, px * 4, ok ? CHECK_OK : CHECK_FAILED, note);
+            } else {
+                emit(PASSES[p], n, n, ms, px * 4, CHECK_NONE, wxString());
+            }
+        }
+
+        // -- RebuildBitmap scalers: zoomed out to 3/8 ------------------------------
+        const int dn = n * 3 / 8;
+        static const char* const SCALERS[] = { "scale.nearest", "scale.box", "scale.box.linear" };
+        for (int k = 0; k < 3; ++k)
+        {
+            if (!wanted(SCALERS[k])) continue;
+            Bytes got(size_t(dn) * dn * 4), want;
+            const double ms = Time(std::function<void()>(), [&] {
+                if (k == 0)
+                    ImageScale::Nearest(&pixels[0], n, n, n * 4, &got[0], dn, dn, dn * 4);
+                else
+                    ImageScale::BoxShrink(&pixels[0], n, n, n * 4, &got[0], dn, dn, dn * 4, k == 2);
+            });
+            if (k == 0) RefNearest(pixels, n, n, want, dn, dn);
+            else        RefBox(pixels, n, n, want, dn, dn, k == 2);
+            wxString note;
+            const bool ok = Same(got, want, dn, note);
+            emit(SCALERS[k], n, n, ms, px * 4, ok ? CHECK_OK : CHECK_FAILED, note);
+        }
+    }
+
+    // -- BC2/BC3 colour against the hand-worked blocks, reference included --
+    // One DecodePixels() through the decoder's loader (a lambda, as only
+    // Benchmark may drive the loaders' block loops)
+    auto decodeOnce = [](const Decoder& dec, const Bytes& blocks, int w, int h) {
+        Bytes got;
+        if (dec.bct) {
+            BCTImage img;
+            img.m_w = w;
+            img.m_h = h;
+            img.m_pitch  = w * 4;
+            img.m_format = int(dec.code);
+            img.m_blocks.assign(blocks.begin(), blocks.end());
+            if (img.DecodePixels(ImageBase::CancelFn()))
+                got.assign(img.m_pixels, img.m_pixels + size_t(w) * h * 4);
+        } else {
+            DDSImage img;
+            img.m_w = w;
+            img.m_h = h;
+            img.m_pitch  = w * 4;
+            img.m_fourCC = dec.code;
+            img.m_blocks.assign(blocks.begin(), blocks.end());
+            if (img.DecodePixels(ImageBase::CancelFn()))
+                got.assign(img.m_pixels, img.m_pixels + size_t(w) * h * 4);
+        }
+        return got;
+    };
+    for (size_t d = 0; d < WXSIZEOF(DECODERS); ++d)
+    {
+        const Decoder& dec = DECODERS[d];
+        const wxString stage = wxString(dec.name) + ".known";
+        if ((dec.ref != REF_BC2 && dec.ref != REF_BC3) || !wanted(stage)) continue;
+
+        // Alpha all 255: DXT3 nibbles of 15, DXT5 a0 = a1 = 255
+        Bytes blocks(32, 0);
+        for (int b = 0; b < 2; ++b) {
+            std::memset(&blocks[b * 16], dec.ref == REF_BC2 ? 0xFF : 0, 8);
+            if (dec.ref == REF_BC3) blocks[b * 16] = blocks[b * 16 + 1] = 255;
+            std::memcpy(&blocks[b * 16 + 8], KNOWN_COLOUR[b], 8);
+        }
+        Bytes want;
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 8; ++x) want.insert(want.end(), KNOWN_ROW[x], KNOWN_ROW[x] + 4);
+
+        Bytes ref;
+        RefDecode(dec.ref, &blocks[0], 8, 4, ref);
+        wxString note;
+        if (!Same(ref, want, 8, note))
+            note = "reference " + note;
+        else if (!Same(decodeOnce(dec, blocks, 8, 4), want, 8, note))
+            note = "decoder " + note;
+        emit(stage, 8, 4, 0, blocks.size(), note.IsEmpty() ? CHECK_OK : CHECK_FAILED, note);
+    }
+
+    // -- a DXT5 file whose colour endpoints all have c0 < c1, which BC1
+    //    would read as three colours and black: BC3 colour is always four --
+    if (wanted("dds.dxt5.fourcolour")) {
+        const int n = 256;
+        Bytes blocks = Noise(size_t(n) * n, "dds.dxt5.fourcolour", n);
+        for (size_t b = 0; b < blocks.size(); b += 16) {
+            unsigned char* s = &blocks[b + 8];
+            unsigned c0 = s[0] | (s[1] << 8), c1 = s[2] | (s[3] << 8);
+            if (c0 > c1) std::swap(c0, c1);
+            if (c0 == c1) {
+                if (c0) --c0;
+                else    ++c1;
+            }
+            s[0] = uint8_t(c0); s[1] = uint8_t(c0 >> 8);
+            s[2] = uint8_t(c1); s[3] = uint8_t(c1 >> 8);
+        }
+
+        const wxString path = wxFileName::CreateTempFileName("bctv");
+        if (path.IsEmpty() || !WriteDXT5(path, n, blocks)) {
+            emit("dds.dxt5.fourcolour", n, n, 0, 0, CHECK_NONE, "cannot write a temporary DDS");
+        } else {
+            Bytes got;
+            const double ms = Time(std::function<void()>(), [&] {
+                DDSImage img;
+                if (!img.LoadFromFile(path) || !img.EnsurePixels() || img.Width() != n) return;
+                got.resize(size_t(n) * n * 4);
+                for (int y = 0; y < n; ++y)
+                    std::memcpy(&got[size_t(y) * n * 4], img.Data() + size_t(y) * img.m_pitch, size_t(n) * 4);
+            });
+
+            // c1 > 0, so index 3 – (e0 + 2 e1) / 3 – is never black
+            wxString note;
+            if (got.empty()) note = "file not decoded";
+            for (size_t i = 0; note.IsEmpty() && i < got.size(); i += 4) {
+                const int x = int(i / 4 % n), y = int(i / 4 / n);
+                const unsigned char* s = &blocks[(size_t(y / 4) * (n / 4) + x / 4) * 16 + 8];
+                if (((s[4 + y % 4] >> (2 * (x % 4))) & 3) == 3 && !(got[i] | got[i + 1] | got[i + 2]))
+                    note.Printf("index 3 black at %d,%d", x, y);
+            }
+            if (note.IsEmpty()) {
+                Bytes want;
+                RefDecode(REF_BC3, &blocks[0], n, n, want);
+                Same(got, want, n, note);
+            }
+            emit("dds.dxt5.fourcolour", n, n, ms, blocks.size(),
+                 note.IsEmpty() ? CHECK_OK : CHECK_FAILED, note);
+        }
+        if (!path.IsEmpty()) wxRemoveFile(path);
+    }
+
+    // -- an archive past 4 GB, as a multi-GB pack is browsed: opened, and a
+    //    stored and a deflated member read from beyond the 32-bit offsets ---
+    if (wanted("zip.zip64")) {
+        const int   n = 512;
+        const Bytes stored = Noise(size_t(n) * n * 4, "zip.zip64", n);
+        const Bytes smooth = Smooth(n);
+        wxMemoryOutputStream packedOut;
+        {
+            wxZlibOutputStream z(packedOut, wxZ_DEFAULT_COMPRESSION, wxZLIB_NO_HEADER);
+            z.Write(&smooth[0], smooth.size());
+        }
+        Bytes packed(size_t(packedOut.GetSize()));
+        packedOut.CopyTo(&packed[0], packed.size());
+
+        const wxString path = wxFileName::CreateTempFileName("bctv");
+        if (path.IsEmpty() || !WriteZip64(path, stored, packed, smooth.size())) {
+            emit("zip.zip64", n, n, 0, 0, CHECK_NONE, "no room for a sparse 4 GB archive");
+        } else {
+            Bytes gotStored, gotDeflated;
+            const double ms = Time(std::function<void()>(), [&] {
+                const std::shared_ptr<ZipArchive> zip = ZipArchive::Open(path);
+                if (!zip) return;
+                gotStored   = ReadMember(*zip, "stored.bin");
+                gotDeflated = ReadMember(*zip, "deflate.bin");
+            });
+            wxString note;
+            if (gotStored.empty() && gotDeflated.empty()) note = "archive not opened";
+            else if (Same(gotStored, stored, n, note)) {
+                if (!Same(gotDeflated, smooth, n, note)) note = "deflated member " + note;
+            } else note = "stored member " + note;
+            emit("zip.zip64", n, n, ms, stored.size() + smooth.size(),
+                 note.IsEmpty() ? CHECK_OK : CHECK_FAILED, note);
+        }
+        if (!path.IsEmpty()) wxRemoveFile(path);
+    }
+    return same;
+}
@@ -0,0 +1,167 @@
+// -----------------------------------------------------------------------------
+//  BlockPreview.cpp – compressed-domain block averages
+// -----------------------------------------------------------------------------
+#include "BlockPreview.h"
+#include "ImageScale.h"
+
+#include <cstddef>
+#include <new>
+
+namespace {
+
+inline unsigned popcount32(uint32_t v)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcount(v));
+#else
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return (((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#endif
+}
+
+inline void expand565(unsigned c, unsigned v[3])     // → B, G, R
+{
+    const unsigned r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    v[0] = (b << 3) | (b >> 2);
+    v[1] = (g << 2) | (g >> 4);
+    v[2] = (r << 3) | (r >> 2);
+}
+
+/* Per-channel accumulator: plain bytes or 16-bit linear light. */
+struct Acc
+{
+    bool     linear;
+    uint32_t sum[3];
+
+    explicit Acc(bool lin) : linear(lin) { sum[0] = sum[1] = sum[2] = 0; }
+
+    void add(const unsigned v[3], unsigned n) {
+        if (!n) return;
+        for (int c = 0; c < 3; ++c)
+            sum[c] += n * (linear ? ImageScale::SrgbToLinear16(static_cast<unsigned char>(v[c]))
+                                  : v[c]);
+    }
+    unsigned char get(int c) const {               // average over 16 texels
+        const uint32_t m = (sum[c] + 8) >> 4;
+        return linear ? ImageScale::Linear16ToSrgb(static_cast<uint16_t>(m))
+                      : static_cast<unsigned char>(m);
+    }
+};
+
+/* BC1 colour half.  Writes B,G,R and returns the punch-through alpha. */
+unsigned char colourBlock(const unsigned char* s, bool fourColour, bool linear,
+                          unsigned char* dst)
+{
+    const unsigned c0 = s[0] | (s[1] << 8);
+    const unsigned c1 = s[2] | (s[3] << 8);
+    const uint32_t idx = s[4] | (s[5] << 8) | (s[6] << 16) | (uint32_t(s[7]) << 24);
+
+    // index histogram from the low/high bit planes
+    const uint32_t lo = idx & 0x55555555u, hi = (idx >> 1) & 0x55555555u;
+    const unsigned n3 = popcount32(lo & hi);
+    const unsigned n1 = popcount32(lo & ~hi);
+    const unsigned n2 = popcount32(hi & ~lo);
+    const unsigned n0 = 16 - n1 - n2 - n3;
+
+    unsigned p[4][3];
+    expand565(c0, p[0]);
+    expand565(c1, p[1]);
+
+    bool punch = false;
+    if (fourColour || c0 > c1) {
+        for (int c = 0; c < 3; ++c) {
+            p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+            p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+        }
+    } else {
+        for (int c = 0; c < 3; ++c) {
+            p[2][c] = (p[0][c] + p[1][c]) / 2;
+            p[3][c] = 0;                            // transparent black
+        }
+        punch = true;
+    }
+
+    Acc acc(linear);
+    acc.add(p[0], n0); acc.add(p[1], n1); acc.add(p[2], n2); acc.add(p[3], n3);
+    dst[0] = acc.get(0); dst[1] = acc.get(1); dst[2] = acc.get(2);
+
+    return punch ? static_cast<unsigned char>((255 * (16 - n3) + 8) / 16) : 255;
+}
+
+/* BC3/BC4/BC5 interpolated channel: 3-bit index tally dotted with the lut. */
+unsigned char alphaBlock(const unsigned char* q)
+{
+    const unsigned a0 = q[0], a1 = q[1];
+    unsigned lut[8] = { a0, a1 };
+    if (a0 > a1) {
+        for (int k = 1; k <= 6; ++k) lut[1 + k] = ((7 - k) * a0 + k * a1) / 7;
+    } else {
+        for (int k = 1; k <= 4; ++k) lut[1 + k] = ((5 - k) * a0 + k * a1) / 5;
+        lut[6] = 0;  lut[7] = 255;
+    }
+
+    unsigned long long bits = 0;
+    for (int i = 0; i < 6; ++i) bits |= static_cast<unsigned long long>(q[2 + i]) << (8 * i);
+
+    unsigned n[8] = { 0 };
+    for (int i = 0; i < 16; ++i, bits >>= 3) ++n[bits & 7];
+
+    unsigned sum = 0;
+    for (int k = 0; k < 8; ++k) sum += n[k] * lut[k];
+    return static_cast<unsigned char>((sum + 8) >> 4);
+}
+
+} // anon-ns
+
+bool BlockPreview::Build(const unsigned char* blocks, int w, int h,
+                         ImageBase::BlockFormat fmt, bool linearLight,
+                         std::vector<unsigned char>& out, int& pw, int& ph)
+{
+    pw = ph = 0;
+    if (!blocks || w <= 0 || h <= 0 || fmt == ImageBase::BLK_NONE) return false;
+
+    const int bw = (w + 3) >> 2, bh = (h + 3) >> 2;
+    const size_t blkLen = (fmt == ImageBase::BLK_BC1 || fmt == ImageBase::BLK_BC4) ? 8 : 16;
+
+    try { out.resize(size_t(bw) * bh * 4); }
+    catch (const std::bad_alloc&) { return false; }
+
+    const unsigned char* s = blocks;
+    unsigned char*       d = &out[0];
+    for (size_t i = 0, n = size_t(bw) * bh; i < n; ++i, s += blkLen, d += 4)
+    {
+        switch (fmt) {
+            case ImageBase::BLK_BC1:
+                d[3] = colourBlock(s, false, linearLight, d);
+                break;
+            case ImageBase::BLK_BC2: {
+                unsigned a = 0;
+                for (int k = 0; k < 8; ++k) a += (s[k] & 0x0F) + (s[k] >> 4);
+                colourBlock(s + 8, true, linearLight, d);
+                d[3] = static_cast<unsigned char>((a * 17 + 8) >> 4);
+                break;
+            }
+            case ImageBase::BLK_BC3:
+                colourBlock(s + 8, true, linearLight, d);
+                d[3] = alphaBlock(s);
+                break;
+            case ImageBase::BLK_BC4:
+                d[0] = d[1] = d[2] = alphaBlock(s);
+                d[3] = 255;
+                break;
+            case ImageBase::BLK_BC5:
+                d[0] = alphaBlock(s);               // R stays in byte 0, as decoded
+                d[1] = alphaBlock(s + 8);
+                d[2] = 127;
+                d[3] = 255;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    pw = bw;
+    ph = bh;
+    return true;
+}
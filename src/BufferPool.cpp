@@ -0,0 +1,260 @@
+// -----------------------------------------------------------------------------
+//  BufferPool.cpp – size-class free lists and the huge-page allocator
+// -----------------------------------------------------------------------------
+#include "BufferPool.h"
+#include "MemoryBudget.h"
+
+#include <wx/log.h>
+#include <wx/thread.h>
+#include <atomic>
+#include <cstdlib>
+
+#ifdef __WXMSW__
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Every buffer starts with its header; the payload follows one cache line in
+struct Header
+{
+    size_t capacity;                   // payload bytes
+    size_t mapped;                     // bytes mapped for huge pages, else 0
+    int    cls;                        // size class, -1 when not pooled
+};
+const size_t HEADER = 64;
+
+const int MIN_LOG = 16;                // log2(MIN_POOLED)
+const int OCTAVES = 18;                // classes up to 16 GB
+const int CLASSES = OCTAVES * BufferPool::STEPS;
+
+struct Pool
+{
+    wxMutex              lock;
+    std::vector<Header*> idle[CLASSES];
+    size_t               idleBytes;
+    MemoryBudget::Charge charge;
+    Pool() : idleBytes(0), charge(MemoryBudget::POOL) {}
+};
+
+// Never destroyed: images in static caches give their buffers back after
+// main() returns
+Pool& ThePool()
+{
+    static Pool* pool = new Pool;
+    return *pool;
+}
+
+std::atomic<bool>     s_huge(false);
+std::atomic<uint64_t> s_fresh(0);
+
+unsigned char* Payload(Header* h)        { return reinterpret_cast<unsigned char*>(h) + HEADER; }
+Header*        HeaderOf(const void* p)
+{
+    return reinterpret_cast<Header*>(const_cast<unsigned char*>(static_cast<const unsigned char*>(p)) - HEADER);
+}
+
+// Size class of a request and the capacity it is rounded up to
+int ClassOf(size_t bytes, size_t& capacity)
+{
+    capacity = bytes;
+    if (bytes < BufferPool::MIN_POOLED) return -1;
+
+    int k = 0;
+    while ((bytes >> k) > 1) ++k;                      // 2^k <= bytes < 2^(k+1)
+    const size_t base = size_t(1) << k;
+    const size_t step = base / BufferPool::STEPS;
+    const size_t sub  = (bytes - base + step - 1) / step;   // 0 .. STEPS
+
+    const int cls = (k - MIN_LOG) * BufferPool::STEPS + int(sub);
+    if (cls >= CLASSES) return -1;
+    capacity = base + sub * step;
+    return cls;
+}
+
+#ifdef __WXMSW__
+bool EnableLockMemory()
+{
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+    TOKEN_PRIVILEGES tp;
+    tp.PrivilegeCount = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    // AdjustTokenPrivileges succeeds with ERROR_NOT_ALL_ASSIGNED when the
+    // account simply does not have the right
+    const bool ok = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+                    AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL) &&
+                    GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return ok;
+}
+#endif
+
+// Large pages when enabled and granted; the heap otherwise
+Header* Allocate(size_t capacity, int cls)
+{
+    Header* h = NULL;
+    size_t mapped = 0;
+
+    if (s_huge.load(std::memory_order_relaxed) && capacity >= size_t(BufferPool::HUGE_MIN)) {
+#ifdef __WXMSW__
+        const size_t page = GetLargePageMinimum();
+        if (page) {
+            mapped = (capacity + HEADER + page - 1) / page * page;
+            h = static_cast<Header*>(VirtualAlloc(NULL, mapped,
+                    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+        }
+#else
+        const size_t page = size_t(BufferPool::HUGE_MIN);
+        mapped = (capacity + HEADER + page - 1) / page * page;
+        void* p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            madvise(p, mapped, MADV_HUGEPAGE);
+#endif
+            h = static_cast<Header*>(p);
+        }
+#endif
+        if (!h) mapped = 0;            // no large pages free: normal ones
+    }
+    if (!h) h = static_cast<Header*>(std::malloc(capacity + HEADER));
+    if (!h) return NULL;
+
+    h->capacity = capacity;
+    h->mapped   = mapped;
+    h->cls      = cls;
+    if (cls >= 0) s_fresh.fetch_add(1, std::memory_order_relaxed);
+    return h;
+}
+
+void Release(Header* h)
+{
+    if (!h->mapped) {
+        std::free(h);
+        return;
+    }
+#ifdef __WXMSW__
+    VirtualFree(h, 0, MEM_RELEASE);
+#else
+    munmap(h, h->mapped);
+#endif
+}
+
+// Frees idle buffers, largest classes first, until at most keep bytes idle;
+// the caller holds the lock
+void TrimLocked(Pool& pool, size_t keep, int spare)
+{
+    for (int c = CLASSES - 1; c >= 0 && pool.idleBytes > keep; --c) {
+        if (c == spare) continue;
+        std::vector<Header*>& list = pool.idle[c];
+        while (!list.empty() && pool.idleBytes > keep) {
+            pool.idleBytes -= list.back()->capacity;
+            Release(list.back());
+            list.pop_back();
+        }
+    }
+    pool.charge.Set(pool.idleBytes);
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+void* BufferPool::Take(size_t bytes)
+{
+    size_t capacity;
+    const int cls = ClassOf(bytes, capacity);
+    if (cls >= 0) {
+        Pool& pool = ThePool();
+        wxMutexLocker lock(pool.lock);
+        std::vector<Header*>& list = pool.idle[cls];
+        if (!list.empty()) {
+            Header* h = list.back();
+            list.pop_back();
+            pool.idleBytes -= h->capacity;
+            pool.charge.Set(pool.idleBytes);
+            return Payload(h);
+        }
+    }
+    Header* h = Allocate(capacity, cls);
+    return h ? Payload(h) : NULL;
+}
+
+void BufferPool::Give(void* p)
+{
+    if (!p) return;
+    Header* h = HeaderOf(p);
+    if (h->cls < 0) {
+        Release(h);
+        return;
+    }
+
+    // Room is made from other classes first: the one just returned is the
+    // size most likely asked for next
+    Pool& pool = ThePool();
+    wxMutexLocker lock(pool.lock);
+    const size_t limit = IdleLimit();
+    if (h->capacity > limit) {
+        Release(h);
+        return;
+    }
+    if (pool.idleBytes + h->capacity > limit)
+        TrimLocked(pool, limit - h->capacity, h->cls);
+    if (pool.idleBytes + h->capacity > limit) {
+        Release(h);
+        return;
+    }
+    pool.idle[h->cls].push_back(h);
+    pool.idleBytes += h->capacity;
+    pool.charge.Set(pool.idleBytes);
+}
+
+size_t BufferPool::Capacity(const void* p)
+{
+    return p ? HeaderOf(p)->capacity : 0;
+}
+
+bool BufferPool::SetHugePages(bool on)
+{
+#ifdef __WXMSW__
+    if (on && (!GetLargePageMinimum() || !EnableLockMemory())) {
+        wxLogWarning("Huge pages need the \"Lock pages in memory\" right; using normal pages");
+        on = false;
+    }
+#elif !defined(MADV_HUGEPAGE)
+    if (on) {
+        wxLogWarning("Huge pages are not available on this system; using normal pages");
+        on = false;
+    }
+#endif
+    s_huge.store(on, std::memory_order_relaxed);
+    return on;
+}
+
+bool BufferPool::HugePages() { return s_huge.load(std::memory_order_relaxed); }
+
+void BufferPool::Trim(size_t keepBytes)
+{
+    Pool& pool = ThePool();
+    wxMutexLocker lock(pool.lock);
+    TrimLocked(pool, keepBytes, -1);
+}
+
+size_t BufferPool::IdleBytes()
+{
+    return MemoryBudget::Bytes(MemoryBudget::POOL);
+}
+
+size_t BufferPool::IdleLimit()
+{
+    return MemoryBudget::Budget() / IDLE_SHARE;
+}
+
+uint64_t BufferPool::SystemAllocations()
+{
+    return s_fresh.load(std::memory_order_relaxed);
+}
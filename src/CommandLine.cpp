@@ -0,0 +1,300 @@
+// -----------------------------------------------------------------------------
+//  CommandLine.cpp – batch modes that run without opening a window
+// -----------------------------------------------------------------------------
+#include "CommandLine.h"
+#include "TextureLibrary.h"
+#include "TextureQuery.h"
+#include "ImageProbe.h"
+#include "Benchmark.h"
+#include "CorpusBench.h"
+#include "Profiler.h"
+#include "BufferPool.h"
+
+#include <wx/crt.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __WXMSW__
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+void CommandLine::AddOptions(wxCmdLineParser& parser)
+{
+    parser.AddOption(wxEmptyString, "index", "index a folder tree into the texture library");
+    parser.AddOption(wxEmptyString, "find", "list library textures matching a query, "
+                     "e.g. \"format:ATI2 min:2048 platform:x360 name:*door*\"");
+    parser.AddOption(wxEmptyString, "library", "texture library file to use");
+    parser.AddOption(wxEmptyString, "jobs", "threads for --index, workers for --convert "
+                     "(0, the default: auto)",
+                     wxCMD_LINE_VAL_NUMBER);
+    parser.AddSwitch(wxEmptyString, "long", "--find prints the header facts too");
+    parser.AddOption(wxEmptyString, "convert", "convert the textures under a folder or "
+                     "archive into the folder given after it: --convert <in> <out>");
+    parser.AddOption(wxEmptyString, "to", "--convert output format: png (default), tga, dds, "
+                     "dxt1, dxt5, ati1, ati2 to re-compress, or bct / bct360 to repack");
+    parser.AddOption(wxEmptyString, "quality", "--convert to dxt1 .. ati2: fast (default) or best");
+    parser.AddOption(wxEmptyString, "bench", "time the hot paths: \"all\", or the stages "
+                     "whose name contains the text, e.g. dxt1, x360, scale");
+    parser.AddOption(wxEmptyString, "corpus", "time the full load path over a folder tree");
+    parser.AddOption(wxEmptyString, "json", "--corpus: save the metrics to this file");
+    parser.AddOption(wxEmptyString, "baseline", "--corpus: compare with metrics saved earlier");
+    parser.AddOption(wxEmptyString, "threshold", "--corpus: regression threshold in percent "
+                     "(default 10)", wxCMD_LINE_VAL_DOUBLE);
+    parser.AddOption(wxEmptyString, "trace", "save the stage timings as Chrome trace JSON");
+    parser.AddSwitch(wxEmptyString, "huge-pages", "back large image buffers with huge pages");
+}
+
+bool CommandLine::Parse(const wxCmdLineParser& parser)
+{
+    parser.Found("index", &m_index);
+    parser.Found("find", &m_find);
+    parser.Found("library", &m_library);
+    parser.Found("jobs", &m_jobs);
+    m_long = parser.Found("long");
+    parser.Found("convert", &m_convert);
+    parser.Found("bench", &m_bench);
+    parser.Found("corpus", &m_corpus);
+    parser.Found("json", &m_json);
+    parser.Found("baseline", &m_baseline);
+    parser.Found("threshold", &m_threshold);
+    parser.Found("trace", &m_trace);
+    if (parser.Found("huge-pages"))
+        BufferPool::SetHugePages(true);        // warns and carries on if refused
+    if (m_threshold < 0) {
+        wxLogError("--threshold must not be negative");
+        return false;
+    }
+
+    if (!m_convert.IsEmpty()) {
+        if (parser.GetParamCount() != 1) {
+            wxLogError("--convert needs an output folder: --convert <in> <out> "
+                       "--to png|tga|dds|dxt1|dxt5|ati1|ati2|bct|bct360");
+            return false;
+        }
+        m_convertOut = parser.GetParam(0);
+
+        wxString to = "png";
+        parser.Found("to", &to);
+        if (!BatchConvert::ParseTarget(to, m_target)) {
+            wxLogError("--to must be png, tga, dds, dxt1, dxt5, ati1, ati2, bct or bct360");
+            return false;
+        }
+
+        wxString quality = "fast";
+        parser.Found("quality", &quality);
+        if (quality.Lower() == "fast")
+            m_quality = TextureCodec::QUALITY_RANGE;
+        else if (quality.Lower() == "best")
+            m_quality = TextureCodec::QUALITY_CLUSTER;
+        else {
+            wxLogError("--quality must be fast or best");
+            return false;
+        }
+    }
+
+    if (m_library.IsEmpty() && Active())
+        m_library = TextureLibrary::DefaultFile();
+
+    if (m_jobs < 0 || m_jobs > TextureLibrary::MAX_JOBS) {
+        wxLogError("--jobs must be 0 (auto) or between 1 and %d", int(TextureLibrary::MAX_JOBS));
+        return false;
+    }
+    return true;
+}
+
+void CommandLine::AttachConsole()
+{
+#ifdef __WXMSW__
+    if (::AttachConsole(ATTACH_PARENT_PROCESS)) {
+        std::freopen("CONOUT$", "w", stdout);
+        std::freopen("CONOUT$", "w", stderr);
+    }
+#endif
+}
+
+int CommandLine::Run()
+{
+    AttachConsole();
+    delete wxLog::SetActiveTarget(new wxLogStderr);   // no message boxes
+
+    int rc = RunMode();
+    if (!m_trace.IsEmpty() && !Profiler::WriteChromeTrace(m_trace))
+        rc = EXIT_FAILED;
+    return rc;
+}
+
+int CommandLine::RunMode()
+{
+    if (!m_convert.IsEmpty())
+        return RunConvert();
+    if (!m_bench.IsEmpty())
+        return RunBench();
+    if (!m_corpus.IsEmpty())
+        return RunCorpus();
+
+    TextureLibrary lib;
+    if (!lib.Load(m_library) && m_index.IsEmpty()) {
+        wxLogError("No texture library at %s; build one with --index <dir>", m_library);
+        return EXIT_FAILED;
+    }
+
+    if (!m_index.IsEmpty()) {
+        const int rc = RunIndex(lib);
+        if (rc != EXIT_OK) return rc;
+    }
+    return m_find.IsEmpty() ? EXIT_OK : RunFind(lib);
+}
+
+int CommandLine::RunIndex(TextureLibrary& lib)
+{
+    const wxString root = TextureLibrary::NormalizeRoot(m_index);
+    TextureLibrary::Progress last = { 0, 0, 0 };
+
+    const bool ok = lib.Index(root, int(m_jobs),
+        [&last](const TextureLibrary::Progress& p) {
+            wxFprintf(stderr, "\r%lu folders, %lu textures, %lu headers read",
+                      (unsigned long)p.dirs, (unsigned long)p.files,
+                      (unsigned long)p.probed);
+            std::fflush(stderr);
+            last = p;
+        });
+    wxFprintf(stderr, "\n");
+    if (!ok) return EXIT_FAILED;
+
+    if (!lib.Save(m_library)) return EXIT_FAILED;
+    wxFprintf(stderr, "%s: %lu textures (%lu in library)\n",
+              root, (unsigned long)last.files, (unsigned long)lib.Count());
+    return EXIT_OK;
+}
+
+int CommandLine::RunFind(const TextureLibrary& lib)
+{
+    TextureQuery query;
+    wxString error;
+    if (!query.Parse(m_find, &error)) {
+        wxLogError("%s", error);
+        return EXIT_FAILED;
+    }
+
+    std::vector<const TextureLibrary::Entry*> hits;
+    lib.Find(query, hits);
+    for (size_t i = 0; i < hits.size(); ++i)
+    {
+        const TextureLibrary::Entry& e = *hits[i];
+        if (!m_long) {
+            wxPrintf("%s\n", e.path);
+            continue;
+        }
+        wxPrintf("%s\t%s\t%dx%d\t%d\t%s\t%llu\n", e.path,
+                 ImageProbe::FormatName(e.meta), e.meta.width, e.meta.height,
+                 e.meta.mips, e.meta.bigEndian ? "x360" : "pc",
+                 (unsigned long long)ImageProbe::StoredBytes(e.meta));
+    }
+    std::fflush(stdout);
+    return EXIT_OK;
+}
+
+int CommandLine::RunConvert()
+{
+    BatchConvert batch;
+    batch.SetQuality(m_quality);
+    if (!batch.Collect(m_convert, m_convertOut, m_target))
+        return EXIT_FAILED;
+    wxFprintf(stderr, "%lu textures to convert\n", (unsigned long)batch.Jobs().size());
+
+    const bool ok = batch.Run(int(m_jobs), [](const BatchConvert::Result& r) {
+        if (r.ok)
+            wxPrintf("ok\t%s\t%s\t%dx%d\t%.1f ms\n", r.in, r.out, r.width, r.height, r.ms);
+        else
+            wxPrintf("FAILED\t%s\t%s\n", r.in, r.error);
+    });
+    std::fflush(stdout);
+
+    const BatchConvert::Totals& t = batch.GetTotals();
+    const double secs = std::max(t.seconds, 0.001);
+    wxFprintf(stderr, "%lu converted, %lu failed in %.2f s: %.1f files/s, "
+              "%.1f MB/s in, %.1f MB out\n",
+              (unsigned long)(t.files - t.failed), (unsigned long)t.failed, t.seconds,
+              t.files / secs, t.inBytes / secs / (1 << 20), t.outBytes / double(1 << 20));
+    wxFprintf(stderr, "thread time: read %.1f s, decode %.1f s, encode %.1f s, write %.1f s\n",
+              t.readMs / 1000, t.decodeMs / 1000, t.encodeMs / 1000, t.writeMs / 1000);
+    return ok ? EXIT_OK : EXIT_FAILED;
+}
+
+int CommandLine::RunBench()
+{
+    wxPrintf("%-18s %11s %10s %10s %10s  %s\n",
+             "stage", "size", "ms", "MB/s", "Mtexel/s", "check");
+    const bool same = Benchmark::Run(m_bench, [](const Benchmark::Row& r) {
+        const char* check = r.check == Benchmark::CHECK_OK     ? "ok"
+                          : r.check == Benchmark::CHECK_FAILED ? "MISMATCH"
+                          :                                      "-";
+        wxPrintf("%-18s %5dx%-5d %10.3f %10.1f %10.1f  %s %s\n", r.stage, r.width, r.height,
+                 r.ms, r.mbPerSec, r.mTexelsPerSec, check, r.note);
+        std::fflush(stdout);
+    });
+    return same ? EXIT_OK : EXIT_FAILED;
+}
+
+int CommandLine::RunCorpus()
+{
+    // Read the baseline first: a typo should not cost a whole corpus run
+    CorpusBench::Metrics base;
+    if (!m_baseline.IsEmpty() && !CorpusBench::LoadMetrics(m_baseline, base))
+        return EXIT_FAILED;
+
+    CorpusBench bench;
+    const bool ran = bench.Run(m_corpus, [](size_t done, size_t total) {
+        if (done % 64 && done != total) return;
+        wxFprintf(stderr, "\r%lu / %lu textures", (unsigned long)done, (unsigned long)total);
+        std::fflush(stderr);
+    });
+    wxFprintf(stderr, "\n");
+    if (!ran) return EXIT_FAILED;
+
+    wxPrintf("%-22s %7s %9s", "format", "files", "MB");
+    for (int s = 0; s < CorpusBench::STAGES; ++s)
+        wxPrintf(" %9s", wxString(CorpusBench::StageName(s)) + " ms");
+    wxPrintf(" %9s %9s\n", "MB/s", "Mtexel/s");
+    const double MB = double(1 << 20);
+    for (std::map<wxString, CorpusBench::Group>::const_iterator it = bench.Groups().begin();
+         it != bench.Groups().end(); ++it)
+    {
+        const CorpusBench::Group& g = it->second;
+        wxPrintf("%-22s %7lu %9.1f", it->first, (unsigned long)g.files, g.bytes / MB);
+        double ms = 0;
+        for (int s = 0; s < CorpusBench::STAGES; ++s) {
+            wxPrintf(" %9.1f", g.ms[s]);
+            ms += g.ms[s];
+        }
+        ms = std::max(ms, 1e-3);
+        wxPrintf(" %9.1f %9.1f\n", g.bytes / MB / (ms / 1000), g.texels / 1e6 / (ms / 1000));
+    }
+
+    const CorpusBench::Metrics now = bench.GetMetrics();
+    wxPrintf("\n%lu textures, %lu failed to load\n",
+             (unsigned long)bench.Files(), (unsigned long)bench.Failed());
+    for (CorpusBench::Metrics::const_iterator it = now.begin(); it != now.end(); ++it)
+        if (!it->first.StartsWith("format."))
+            wxPrintf("%-28s %12.2f\n", it->first, it->second);
+    std::fflush(stdout);
+
+    if (!m_json.IsEmpty() && !bench.Save(m_json))
+        return EXIT_FAILED;
+    if (m_baseline.IsEmpty())
+        return EXIT_OK;
+
+    wxPrintf("\n%-34s %12s %12s %8s\n", "against baseline", "base", "now", "change");
+    const bool ok = CorpusBench::Compare(base, now, m_threshold,
+        [](const wxString& name, double b, double n, bool regressed) {
+            const double pct = b != 0 ? (n - b) / b * 100 : 0;
+            wxPrintf("%-34s %12.2f %12.2f %+7.1f%%%s\n", name, b, n, pct,
+                     regressed ? "  REGRESSED" : "");
+        });
+    std::fflush(stdout);
+    if (!ok)
+        wxFprintf(stderr, "Regressions beyond %.1f%% against %s\n", m_threshold, m_baseline);
+    return ok ? EXIT_OK : EXIT_FAILED;
+}
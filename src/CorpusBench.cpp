@@ -0,0 +1,351 @@
+// -----------------------------------------------------------------------------
+//  CorpusBench.cpp – throughput of the full load path over a real texture tree
+// -----------------------------------------------------------------------------
+#include "CorpusBench.h"
+#include "DirIndexer.h"
+#include "FileSource.h"
+#include "ImageCache.h"
+#include "ImageProbe.h"
+#include "Profiler.h"
+#include "TextureLibrary.h"
+
+#include <wx/datetime.h>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/stopwatch.h>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#ifdef __WXMSW__
+#define WIN32_LEAN_AND_MEAN
+#define PSAPI_VERSION 2                // K32GetProcessMemoryInfo: kernel32, no psapi.lib
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const char* const STAGE_NAMES[CorpusBench::STAGES] = { "sniff", "load", "swap", "untile", "decode" };
+
+double Ms(const wxStopWatch& sw) { return sw.TimeInMicro().ToDouble() / 1000.0; }
+
+bool IsTexture(const wxString& path)
+{
+    const wxString ext = path.AfterLast('.').Lower();
+    return ext == "dds" || ext == "bct";
+}
+
+// "bct.DXT5.x360" – kind, format, platform
+wxString GroupName(const ImageMeta& meta)
+{
+    return wxString(meta.kind == ImageMeta::KIND_BCT ? "bct." : "dds.") +
+           ImageProbe::FormatName(meta) + (meta.bigEndian ? ".x360" : ".pc");
+}
+
+void Add(CorpusBench::Group& g, uint64_t bytes, uint64_t texels, const double ms[])
+{
+    ++g.files;
+    g.bytes  += bytes;
+    g.texels += texels;
+    for (int s = 0; s < CorpusBench::STAGES; ++s)
+        g.ms[s] += ms[s];
+}
+
+double Rate(double amount, double ms)
+{
+    return amount / (std::max(ms, 1e-3) / 1000.0);
+}
+
+// Nearest rank of a sorted sample
+double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    const size_t rank = size_t(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank ? rank - 1 : 0)];
+}
+
+wxString JsonString(const wxString& s)
+{
+    wxString out = "\"";
+    for (wxString::const_iterator it = s.begin(); it != s.end(); ++it) {
+        const wxUniChar c = *it;
+        if      (c == '"')  out += "\\\"";
+        else if (c == '\\') out += "\\\\";
+        else if (c < 0x20)  out += wxString::Format("\\u%04x", int(c.GetValue()));
+        else                out += c;
+    }
+    return out + "\"";
+}
+
+wxString JsonNumber(double v)
+{
+    return wxString::FromCDouble(v, 4);   // never a locale comma
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+const char* CorpusBench::StageName(int stage)
+{
+    return (stage >= 0 && stage < STAGES) ? STAGE_NAMES[stage] : "";
+}
+
+uint64_t CorpusBench::PeakRss()
+{
+#ifdef __WXMSW__
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return uint64_t(ru.ru_maxrss);            // bytes
+#else
+    return uint64_t(ru.ru_maxrss) * 1024;     // kilobytes
+#endif
+#endif
+}
+
+bool CorpusBench::Run(const wxString& root, const ProgressFn& progress)
+{
+    m_groups.clear();
+    m_total = Group();
+    m_latency.clear();
+    for (int s = 0; s < STAGES; ++s) {
+        m_stageMs[s].clear();
+        m_stageBytes[s] = 0;
+    }
+    m_failed = 0;
+
+    std::vector<wxString> files;
+    if (FileSource::IsArchive(root)) {
+        m_root = root;
+        FileSource::ListArchive(root, files);
+    } else {
+        m_root = TextureLibrary::NormalizeRoot(root);
+        if (!wxFileName::DirExists(m_root)) {
+            wxLogError("Folder not found: %s", m_root);
+            return false;
+        }
+        wxArrayString all;
+        {
+            wxLogNull quiet;            // unreadable folders are skipped
+            wxDir::GetAllFiles(m_root, &all, wxEmptyString,
+                               wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN);
+        }
+        all.Sort();
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (FileSource::IsArchive(all[i]))
+                FileSource::ListArchive(all[i], files);
+            else if (IsTexture(all[i]))
+                files.push_back(all[i]);
+        }
+    }
+    if (files.empty()) {
+        wxLogError("No DDS or BCT textures in %s", m_root);
+        return false;
+    }
+
+    wxLogNull quiet;                    // broken files are counted, not shown
+    wxStopWatch clock;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        double ms[STAGES] = { 0, 0, 0, 0, 0 };
+        bool ok = false;
+
+        wxStopWatch sw;
+        uint32_t file4CC = 0;
+        std::shared_ptr<ImageBase> img;
+        if (DirIndexer::SniffSignature(files[i], file4CC))
+            img = ImageCache::ForSignature(file4CC);
+        ms[STAGE_SNIFF] = Ms(sw);
+
+        if (img) {
+            sw.Start();
+            ok = img->LoadFromFile(files[i]);
+            const Profiler::Breakdown& load = img->LoadTimes();
+            ms[STAGE_SWAP]   = load.Ms(Profiler::SWAP);
+            ms[STAGE_UNTILE] = load.Ms(Profiler::UNTILE);
+            ms[STAGE_LOAD]   = std::max(Ms(sw) - ms[STAGE_SWAP] - ms[STAGE_UNTILE], 0.0);
+        }
+        if (ok) {
+            sw.Start();
+            ok = img->EnsurePixels();
+            ms[STAGE_DECODE] = Ms(sw);
+        }
+        if (progress) progress(i + 1, files.size());
+        if (!ok) {
+            ++m_failed;
+            continue;
+        }
+
+        uint64_t size = 0;
+        int64_t  mtime;
+        FileSource::Stat(files[i], size, mtime);
+        const uint64_t texels = uint64_t(img->Width()) * img->Height();
+        Add(m_groups[GroupName(img->Meta())], size, texels, ms);
+        Add(m_total, size, texels, ms);
+
+        // Swap and untile only count for the console files that had them
+        double whole = 0;
+        for (int s = 0; s < STAGES; ++s) {
+            whole += ms[s];
+            if ((s == STAGE_SWAP || s == STAGE_UNTILE) && !img->Meta().bigEndian) continue;
+            m_stageMs[s].push_back(ms[s]);
+            m_stageBytes[s] += size;
+        }
+        m_latency.push_back(whole);
+    }
+    std::sort(m_latency.begin(), m_latency.end());
+    for (int s = 0; s < STAGES; ++s)
+        std::sort(m_stageMs[s].begin(), m_stageMs[s].end());
+    m_seconds = clock.Time() / 1000.0;
+    m_peakRss = PeakRss();
+    return true;
+}
+
+CorpusBench::Metrics CorpusBench::GetMetrics() const
+{
+    const double MB = double(1 << 20);
+    Metrics m;
+
+    double totalMs = 0;
+    for (int s = 0; s < STAGES; ++s) totalMs += m_total.ms[s];
+    m["total.files_per_s"]   = Rate(double(m_total.files), totalMs);
+    m["total.mb_per_s"]      = Rate(m_total.bytes / MB, totalMs);
+    m["total.mtexel_per_s"]  = Rate(m_total.texels / 1e6, totalMs);
+    m["latency.p50_ms"]      = Percentile(m_latency, 0.50);
+    m["latency.p99_ms"]      = Percentile(m_latency, 0.99);
+    m["memory.peak_rss_mb"]  = m_peakRss / MB;
+
+    for (int s = 0; s < STAGES; ++s) {
+        if (m_stageMs[s].empty()) continue;     // no console files: no swap or untile
+        const wxString name = wxString("stage.") + STAGE_NAMES[s];
+        m[name + ".mb_per_s"] = Rate(m_stageBytes[s] / MB, m_total.ms[s]);
+        m[name + ".p50_ms"]   = Percentile(m_stageMs[s], 0.50);
+        m[name + ".p99_ms"]   = Percentile(m_stageMs[s], 0.99);
+    }
+
+    for (std::map<wxString, Group>::const_iterator it = m_groups.begin(); it != m_groups.end(); ++it) {
+        const Group& g = it->second;
+        double ms = 0;
+        for (int s = 0; s < STAGES; ++s) ms += g.ms[s];
+        m["format." + it->first + ".mb_per_s"]     = Rate(g.bytes / MB, ms);
+        m["format." + it->first + ".mtexel_per_s"] = Rate(g.texels / 1e6, ms);
+    }
+    return m;
+}
+
+// -----------------------------------------------------------------------------
+//  JSON – written for people and diff tools; LoadMetrics() reads back only
+//  the flat "metrics" object
+// -----------------------------------------------------------------------------
+bool CorpusBench::Save(const wxString& file) const
+{
+    wxString j;
+    j << "{\n"
+      << "  \"tool\": \"bctv --corpus\",\n"
+      << "  \"root\": " << JsonString(m_root) << ",\n"
+      << "  \"date\": " << JsonString(wxDateTime::Now().FormatISOCombined(' ')) << ",\n"
+      << "  \"files\": " << (unsigned long)Files() << ",\n"
+      << "  \"failed\": " << (unsigned long)m_failed << ",\n"
+      << "  \"seconds\": " << JsonNumber(m_seconds) << ",\n"
+      << "  \"metrics\": {\n";
+
+    const Metrics m = GetMetrics();
+    for (Metrics::const_iterator it = m.begin(); it != m.end(); ++it)
+        j << "    " << JsonString(it->first) << ": " << JsonNumber(it->second)
+          << (std::next(it) == m.end() ? "\n" : ",\n");
+
+    j << "  },\n  \"formats\": {\n";
+    for (std::map<wxString, Group>::const_iterator it = m_groups.begin(); it != m_groups.end(); ++it) {
+        const Group& g = it->second;
+        j << "    " << JsonString(it->first) << ": { \"files\": " << (unsigned long)g.files
+          << ", \"bytes\": " << wxULongLong(g.bytes).ToString()
+          << ", \"texels\": " << wxULongLong(g.texels).ToString();
+        for (int s = 0; s < STAGES; ++s)
+            j << ", \"" << STAGE_NAMES[s] << "_ms\": " << JsonNumber(g.ms[s]);
+        j << (std::next(it) == m_groups.end() ? " }\n" : " },\n");
+    }
+    j << "  }\n}\n";
+
+    wxFile out;
+    const wxScopedCharBuffer utf8 = j.utf8_str();
+    if (!out.Create(file, true) || !out.Write(utf8.data(), utf8.length())) {
+        wxLogError("Cannot write %s", file);
+        return false;
+    }
+    return true;
+}
+
+bool CorpusBench::LoadMetrics(const wxString& file, Metrics& out)
+{
+    out.clear();
+    wxFile in;
+    wxString text;
+    if (!wxFileName::FileExists(file) || !in.Open(file) || !in.ReadAll(&text, wxConvUTF8)) {
+        wxLogError("Cannot read %s", file);
+        return false;
+    }
+
+    size_t at = text.find("\"metrics\"");
+    if (at != wxString::npos) at = text.find('{', at);
+    if (at == wxString::npos) {
+        wxLogError("%s has no metrics", file);
+        return false;
+    }
+
+    // "name": number pairs up to the closing brace
+    ++at;
+    for (;;)
+    {
+        const size_t open = text.find_first_of("\"}", at);
+        if (open == wxString::npos || text[open] == '}') break;
+        const size_t close = text.find('"', open + 1);
+        const size_t colon = close == wxString::npos ? close : text.find(':', close);
+        if (colon == wxString::npos) break;
+
+        size_t end = text.find_first_of(",}", colon);
+        if (end == wxString::npos) end = text.length();
+        double value;
+        if (text.substr(colon + 1, end - colon - 1).Strip(wxString::both).ToCDouble(&value))
+            out[text.substr(open + 1, close - open - 1)] = value;
+        at = end;
+        if (at < text.length() && text[at] == ',') ++at;
+    }
+    if (out.empty()) {
+        wxLogError("%s has no metrics", file);
+        return false;
+    }
+    return true;
+}
+
+bool CorpusBench::Compare(const Metrics& base, const Metrics& now,
+                          double thresholdPct, const CompareFn& line)
+{
+    bool ok = true;
+    for (Metrics::const_iterator it = now.begin(); it != now.end(); ++it)
+    {
+        const Metrics::const_iterator b = base.find(it->first);
+        if (b == base.end()) continue;
+
+        bool regressed = false;
+        if (b->second > 0) {
+            const bool higherBetter = it->first.EndsWith("_per_s");
+            const double worsePct = (higherBetter ? b->second - it->second
+                                                  : it->second - b->second) / b->second * 100;
+            regressed = worsePct > thresholdPct;
+        }
+        if (line) line(it->first, b->second, it->second, regressed);
+        ok = ok && !regressed;
+    }
+    return ok;
+}
@@ -1,10 +1,14 @@
 // DDSImage.cpp – faster standalone DDS decoder  (DXT1/3/5 + BGRA)
 #include "DDSImage.h"
+#include "FileSource.h"
+#include "ImageProbe.h"
+#include "TextureCodec.h"
 #include <wx/wfstream.h>
 #include <vector>
 #include <cstring>
 #include <cmath>
 #include <algorithm>
+#include <new>
 
 #define FOURCC(a,b,c,d) ( unsigned(a) | (unsigned(b)<<8) | \
                           (unsigned(c)<<16) | (unsigned(d)<<24) )
@@ -13,43 +17,23 @@ static const unsigned FOURCC_DDS  = FOURCC('D','D','S',' ');
 static const unsigned FOURCC_DXT1 = FOURCC('D','X','T','1');
 static const unsigned FOURCC_DXT3 = FOURCC('D','X','T','3');
 static const unsigned FOURCC_DXT5 = FOURCC('D','X','T','5');
+static const unsigned FOURCC_ATI1 = FOURCC('A','T','I','1');
 static const unsigned FOURCC_ATI2 = FOURCC('A','T','I','2');   //  ⬅ NEW
 
-/* ──────────────────────────────────────────────────────────────────── */
-/*  Small helpers & tables                                             */
-/* ──────────────────────────────────────────────────────────────────── */
-namespace {
-
-inline unsigned char lerpByte(unsigned char a,unsigned char b,int w2of3)
-{
-    /* w2of3 = 0 → ½, 1 → ⅓  (c0>c1) */
-    return (w2of3==0) ? static_cast<unsigned char>((a+b)>>1)
-                      : static_cast<unsigned char>((2*a + b) / 3);
-}
-
-/* 5-bit and 6-bit to 8-bit LUTs (generated once, thread-safe C++03)  */
-struct Tables {
-    unsigned char r5[32];   // 0-31 → 0-255
-    unsigned char g6[64];   // 0-63 → 0-255
-    Tables() {
-        for (int i=0;i<32;++i) r5[i] = static_cast<unsigned char>((i<<3)|(i>>2));
-        for (int i=0;i<64;++i) g6[i] = static_cast<unsigned char>((i<<2)|(i>>4));
-    }
-};
-static const Tables LUT;     // zero-overhead Meyers singleton
-
-} // anon-ns
-
 /* ──────────────────────────────────────────────────────────────────── */
 /*                         ctor / dtor / reset                         */
 /* ──────────────────────────────────────────────────────────────────── */
-DDSImage::DDSImage() : m_pixels(NULL), m_w(0), m_h(0), m_pitch(0) {}
+DDSImage::DDSImage() : m_pixels(NULL), m_w(0), m_h(0), m_pitch(0), m_baseW(0), m_baseH(0),
+                       m_mipCount(0), m_memoryUsed(0), m_memoryTotal(0), m_fourCC(0) {}
 DDSImage::~DDSImage(){ Free(); }
 
 void DDSImage::Free()
 {
-    delete [] m_pixels;
+    BufferPool::Give(m_pixels);
     m_pixels = NULL;
+    PooledBytes().swap(m_blocks);
+    m_pixelBytes.Set(0);
+    m_blockBytes.Set(0);
     m_w = m_h = m_pitch = 0;
 }
 
@@ -57,16 +41,33 @@ void DDSImage::Free()
 /*                               public API                            */
 /* ──────────────────────────────────────────────────────────────────── */
 bool DDSImage::LoadFromFile(const wxString& filePath)
+{
+    return Load(filePath, 0);
+}
+
+bool DDSImage::LoadSmallMip(const wxString& filePath, int minSide)
+{
+    return Load(filePath, minSide);
+}
+
+bool DDSImage::Load(const wxString& filePath, int minSide)
 {
     // Free previous data before loading new data
     Free();
+    ResetDecoded();
 
-    // Open the file for reading
-    wxFileInputStream in(filePath);
-    if (!in.IsOk()) {
+    // Open the file (or archive member) for reading
+    std::unique_ptr<wxInputStream> stream;
+    {
+        Profiler::Scope timed(Profiler::OPEN, &m_times);
+        stream.reset(FileSource::Open(filePath));
+    }
+    if (!stream) {
         // File could not be opened
         return false;
     }
+    wxInputStream& in = *stream;
+    Profiler::Scope timed(Profiler::HEADER, &m_times);   // through the payload read
 
     DDSHeader hdr;
 
@@ -77,29 +78,26 @@ bool DDSImage::LoadFromFile(const wxString& filePath)
     }
 
     // Set width, height, and pitch based on header data
-    m_w = static_cast<int>(hdr.width);
-    m_h = static_cast<int>(hdr.height);
+    m_baseW = static_cast<int>(hdr.width);
+    m_baseH = static_cast<int>(hdr.height);
+    m_fourCC = hdr.pf.fourCC;
+    m_mipCount = hdr.mipMapCount ? static_cast<int>(hdr.mipMapCount) : 1;
+
+    // Walk the chain past the levels that are bigger than needed
+    const int level = (minSide > 0) ? PickLevel(hdr, minSide) : 0;
+    for (int i = 0; i < level; ++i)
+        if (in.SeekI(static_cast<wxFileOffset>(LevelBytes(hdr, i)), wxFromCurrent) == wxInvalidOffset)
+            return false;
+
+    m_w = std::max(m_baseW >> level, 1);
+    m_h = std::max(m_baseH >> level, 1);
     m_pitch = m_w * 4;  // Assuming 4 bytes per pixel (BGRA format)
 
-    // Calculate the total size required for pixel data
-    const size_t bytes = size_t(m_pitch) * m_h;
-
-    // Allocate memory for the pixel data
-    m_pixels = new unsigned char[bytes];
-    if (!m_pixels) {
-        // Memory allocation failed
+    // Keep the blocks (or read plain pixels); block decode is deferred
+    if (!ReadPayload(in, hdr)) {
         return false;
     }
 
-    // Zero out the allocated memory
-    std::memset(m_pixels, 0, bytes);
-
-    // Decode the image into the pixel buffer
-    bool ok = DecodeToBGRA(in, hdr);
-    if (!ok) {
-        // Decoding failed
-        return false;
-    }
     // Determine the format based on FOURCC code
     switch (hdr.pf.fourCC) {
         case FOURCC_DXT1:
@@ -111,6 +109,9 @@ bool DDSImage::LoadFromFile(const wxString& filePath)
         case FOURCC_DXT5:
             m_format = wxT("DXT5");
             break;
+        case FOURCC_ATI1:
+            m_format = wxT("ATI1");
+            break;
         case FOURCC_ATI2:
             m_format = wxT("ATI2");
             break;
@@ -125,6 +126,21 @@ bool DDSImage::LoadFromFile(const wxString& filePath)
 }
 
 
+/* ──────────────────────────────────────────────────────────────────── */
+/*  The 128-byte header says everything the browse list needs          */
+bool DDSImage::Probe(wxInputStream& in, ImageMeta& meta)
+{
+    DDSHeader hdr;
+    if (!ReadHeader(in, hdr)) return false;
+
+    meta.kind   = ImageMeta::KIND_DDS;
+    meta.width  = static_cast<int>(hdr.width);
+    meta.height = static_cast<int>(hdr.height);
+    meta.mips   = hdr.mipMapCount ? static_cast<int>(hdr.mipMapCount) : 1;
+    meta.format = hdr.pf.fourCC;
+    return true;
+}
+
 /* ──────────────────────────────────────────────────────────────────── */
 bool DDSImage::ReadHeader(wxInputStream& in, DDSHeader& hdr)
 {
@@ -134,148 +150,103 @@ bool DDSImage::ReadHeader(wxInputStream& in, DDSHeader& hdr)
 }
 
 /* ──────────────────────────────────────────────────────────────────── */
-bool DDSImage::DecodeToBGRA(wxInputStream& in, const DDSHeader& hdr)
+/*  Mip chain: levels follow mip 0 back to back, each half the size    */
+size_t DDSImage::LevelBytes(const DDSHeader& hdr, int level)
+{
+    return TextureCodec::LevelBytes(TextureCodec::FourCCFormat(hdr.pf.fourCC, hdr.pf.rgbBitCount),
+                                    std::max(int(hdr.width  >> level), 1),
+                                    std::max(int(hdr.height >> level), 1));
+}
+
+/*  Smallest level whose long edge is still >= minSide; block levels  */
+/*  must stay whole 4x4 blocks                                         */
+int DDSImage::PickLevel(const DDSHeader& hdr, int minSide)
+{
+    const int count = hdr.mipMapCount ? static_cast<int>(hdr.mipMapCount) : 1;
+    const TextureCodec::Format fmt = TextureCodec::FourCCFormat(hdr.pf.fourCC, hdr.pf.rgbBitCount);
+    return TextureCodec::PickLevel(int(hdr.width), int(hdr.height), count, minSide,
+                                   TextureCodec::BlockBytes(fmt) != 0, false);
+}
+
+/* ──────────────────────────────────────────────────────────────────── */
+bool DDSImage::ReadPayload(wxInputStream& in, const DDSHeader& hdr)
 {
-    const unsigned fmt = hdr.pf.fourCC;
+    const TextureCodec::Format fmt = TextureCodec::FourCCFormat(hdr.pf.fourCC, hdr.pf.rgbBitCount);
 
-    // block formats ----------------------------------------------------------
-    if (fmt==FOURCC_DXT1 || fmt==FOURCC_DXT3 || fmt==FOURCC_DXT5 ||
-        fmt==FOURCC_ATI2)                                                   //  NEW
+    // block formats – keep compressed until pixels are asked for ------------
+    if (TextureCodec::BlockBytes(fmt))
     {
-        const unsigned blkLen = (fmt==FOURCC_DXT1) ? 8 : 16;
-        const int bw = (m_w + 3) >> 2,  bh = (m_h + 3) >> 2;
-        const size_t bytesNeeded = size_t(bw) * bh * blkLen;
-
-        std::vector<unsigned char> img(bytesNeeded);
-        if (in.Read(&img[0], bytesNeeded).LastRead() != bytesNeeded) return false;
-
-        const unsigned char* src = &img[0];
-        for (int by=0; by<bh; ++by)
-            for (int bx=0; bx<bw; ++bx, src+=blkLen)
-            {
-                switch (fmt) {
-                    case FOURCC_DXT1: DecodeDXT1Block(src,bx,by); break;
-                    case FOURCC_DXT3: DecodeDXT3Block(src,bx,by); break;
-                    case FOURCC_DXT5: DecodeDXT5Block(src,bx,by); break;
-                    case FOURCC_ATI2: DecodeATI2Block(src,bx,by); break; //  NEW
-                }
-            }
-        return true;
+        const size_t bytesNeeded = TextureCodec::LevelBytes(fmt, m_w, m_h);
+
+        m_blocks.resize(bytesNeeded);
+        m_blockBytes.Set(m_blocks.capacity());
+        return in.Read(&m_blocks[0], bytesNeeded).LastRead() == bytesNeeded;
     }
 
-    // 32-bit uncompressed path ----------------------------------------------
-    if (hdr.pf.rgbBitCount == 32)
+    // 32-bit uncompressed path – nothing to defer ---------------------------
+    if (fmt == TextureCodec::FMT_BGRA8)
     {
         const size_t n = size_t(m_pitch)*m_h;
+        m_pixels = static_cast<unsigned char*>(BufferPool::Take(n));
+        if (!m_pixels) return false;
+        m_pixelBytes.Set(n);
         return in.Read(m_pixels, n).LastRead() == n;
     }
 
     return false;   // unsupported
 }
 
-
-/* ──────────────────────────────────────────────────────────────────── */
-/*            helpers  – 565 expand & copy raw pixels                  */
 /* ──────────────────────────────────────────────────────────────────── */
-void DDSImage::Expand565(unsigned c, unsigned char& r,
-                         unsigned char& g, unsigned char& b)
+bool DDSImage::DecodePixels(const CancelFn& cancelled)
 {
-    r = LUT.r5[(c>>11)&0x1F];
-    g = LUT.g6[(c>> 5)&0x3F];
-    b = LUT.r5[(c    )&0x1F];   // reuse 5-bit table for blue
-}
+    if (m_pixels) return true;              // plain 32-bit, read at load
+    if (m_blocks.empty()) return false;
 
-/* (DecodePlain32 is no longer used, kept for compatibility) */
-void DDSImage::DecodePlain32(const unsigned char* srcRow,int y,int bpp)
-{
-    std::memcpy(m_pixels + y*m_pitch, srcRow, m_pitch);
+    // Calculate the total size required for pixel data
+    const size_t bytes = size_t(m_pitch) * m_h;
+    m_pixels = static_cast<unsigned char*>(BufferPool::Take(bytes));
+    if (!m_pixels) return false;
+    m_pixelBytes.Set(bytes);
+
+    // Edge blocks are clipped, so every byte is written and none past the
+    // image; cancelled (a newer load won) or bad data drops the work
+    const TextureCodec::Result r =
+        TextureCodec::Decode(TextureCodec::FourCCFormat(m_fourCC, 0),
+                             TextureCodec::Span(m_blocks.data(), m_blocks.size()), m_w, m_h,
+                             TextureCodec::Target(m_pixels, m_pitch), cancelled);
+    if (r != TextureCodec::OK) {
+        BufferPool::Give(m_pixels);
+        m_pixels = NULL;
+        m_pixelBytes.Set(0);
+        return false;
+    }
+    return true;
 }
 
-/* ──────────────────────────────────────────────────────────────────── */
-/*                       DXT1 decoder (8 bytes)                        */
-/* ──────────────────────────────────────────────────────────────────── */
-void DDSImage::DecodeDXT1Block(const unsigned char* s,int bx,int by)
+ImageBase::BlockFormat DDSImage::GetBlockFormat() const
 {
-    const unsigned c0 = s[0] | (s[1]<<8);
-    const unsigned c1 = s[2] | (s[3]<<8);
-
-    unsigned char r0,g0,b0, r1,g1,b1;
-    Expand565(c0,r0,g0,b0);  Expand565(c1,r1,g1,b1);
-
-    const bool opaque = (c0>c1);
-    unsigned char clr[4][4]={
-        {b0,g0,r0,255},
-        {b1,g1,r1,255},
-        {lerpByte(b0,b1,1), lerpByte(g0,g1,1), lerpByte(r0,r1,1), 255},
-        {lerpByte(b0,b1,0), lerpByte(g0,g1,0), lerpByte(r0,r1,0), static_cast<unsigned char>(opaque?255:0)}
-    };
-
-    unsigned idx = s[4] | (s[5]<<8) | (s[6]<<16) | (s[7]<<24);
-    const int xBase = bx<<2, yBase = by<<2;
-
-    for (int py=0; py<4; ++py)
-    {
-        unsigned char* dst = m_pixels + (yBase+py)*m_pitch + (xBase<<2);
-        for (int px=0; px<4; px+=2, idx>>=4)
-        {
-            /* unroll two texels (saves >5 %) */
-            const unsigned char* c0p = clr[idx & 3];
-            dst[0]=c0p[0]; dst[1]=c0p[1]; dst[2]=c0p[2]; dst[3]=c0p[3];
-            const unsigned char* c1p = clr[(idx>>2) & 3];
-            dst[4]=c1p[0]; dst[5]=c1p[1]; dst[6]=c1p[2]; dst[7]=c1p[3];
-            dst += 8;
-        }
+    if (m_blocks.empty()) return BLK_NONE;
+    switch (m_fourCC) {
+        case FOURCC_DXT1: return BLK_BC1;
+        case FOURCC_DXT3: return BLK_BC2;
+        case FOURCC_DXT5: return BLK_BC3;
+        case FOURCC_ATI1: return BLK_BC4;
+        case FOURCC_ATI2: return BLK_BC5;
+        default:          return BLK_NONE;
     }
 }
 
-/* ──────────────────────────────────────────────────────────────────── */
-void DDSImage::DecodeDXT3Block(const unsigned char* s,int bx,int by)
+const unsigned char* DDSImage::Blocks() const
 {
-    unsigned char alpha[16];
-    for (int i=0;i<8;++i){
-        unsigned v=s[i];
-        alpha[i*2  ]=(unsigned char)((v & 0x0F)*17);
-        alpha[i*2+1]=(unsigned char)(((v>>4)&0x0F)*17);
-    }
-    DecodeDXT1Block(s+8,bx,by);
-
-    const int xBase = bx<<2, yBase = by<<2;
-    for(int py=0;py<4;++py){
-        unsigned char* dst=m_pixels+(yBase+py)*m_pitch+(xBase<<2);
-        for(int px=0;px<4;++px)
-            dst[px*4+3]=alpha[py*4+px];
-    }
+    return m_blocks.empty() ? NULL : &m_blocks[0];
 }
 
+
 /* ──────────────────────────────────────────────────────────────────── */
-void DDSImage::DecodeDXT5Block(const unsigned char* s,int bx,int by)
+/* (DecodePlain32 is no longer used, kept for compatibility) */
+void DDSImage::DecodePlain32(const unsigned char* srcRow,int y,int bpp)
 {
-    const unsigned a0=s[0], a1=s[1];
-    const unsigned char* abits=s+2;
-    const unsigned char* colour=s+8;
-
-    unsigned char lut[8]={a0,a1};
-    if (a0>a1){
-        for(int k=1;k<=6;++k) lut[1+k]=(unsigned char)(((7-k)*a0+k*a1)/7);
-    }else{
-        for(int k=1;k<=4;++k) lut[1+k]=(unsigned char)(((5-k)*a0+k*a1)/5);
-        lut[6]=0; lut[7]=255;
-    }
-
-    unsigned long long bits=0;
-    for(int i=0;i<6;++i) bits|=(unsigned long long)abits[i]<<(8*i);
-
-    unsigned char alpha[16];
-    for(int i=0;i<16;++i) alpha[i]=lut[(bits>>(3*i))&7];
-
-    DecodeDXT1Block(colour,bx,by);
-
-    const int xBase = bx<<2, yBase = by<<2;
-    for(int py=0;py<4;++py){
-        unsigned char* dst=m_pixels+(yBase+py)*m_pitch+(xBase<<2);
-        for(int px=0;px<4;++px)
-            dst[px*4+3]=alpha[py*4+px];
-    }
+    std::memcpy(m_pixels + y*m_pitch, srcRow, m_pitch);
 }
 
 /* ──────────────────────────────────────────────────────────────────── */
@@ -392,68 +363,21 @@ void DDSImage::PreMultiplyAlpha()
     }
 }
 
-// -----------------------------------------------------------------------------
-//  DecodeATI2Block – two alpha-style blocks (R & G) -> BGRA32
-// -----------------------------------------------------------------------------
-void DDSImage::DecodeATI2Block(const unsigned char* s, int bx, int by)
+ImageMeta DDSImage::Meta() const
 {
-    // The layout is identical to two DXT5 alpha blocks back-to-back:
-    // bytes 0-7 : red channel,  bytes 8-15 : green channel.
-    auto expandChannel = [](const unsigned char* q, unsigned char out[16])
-    {
-        const unsigned a0 = q[0], a1 = q[1];
-        unsigned char lut[8] = { a0, a1 };
-
-        if (a0 > a1) {
-            for(int k=1;k<=6;++k) lut[1+k] = static_cast<unsigned char>(( (7-k)*a0 + k*a1 ) / 7);
-        } else {
-            for(int k=1;k<=4;++k) lut[1+k] = static_cast<unsigned char>(( (5-k)*a0 + k*a1 ) / 5);
-            lut[6] = 0;  lut[7] = 255;
-        }
-
-        unsigned long long bits = 0;
-        for(int i=0;i<6;++i) bits |= static_cast<unsigned long long>(q[2+i]) << (8*i);
-
-        for(int i=0;i<16;++i)
-            out[i] = lut[(bits >> (3*i)) & 7];
-    };
-
-    unsigned char red[16], green[16];
-    expandChannel(s,      red);
-    expandChannel(s + 8,  green);
-
-    const int xBase = bx << 2,  yBase = by << 2;
-    for(int py=0; py<4; ++py)
-    {
-        unsigned char* dst = m_pixels + (yBase+py)*m_pitch + (xBase<<2);
-        for(int px=0; px<4; ++px)
-        {
-            const int idx = py*4 + px;
-            dst[2] = 127;                 // default B, will be fixed later
-            dst[1] = green[idx];          // G → G
-            dst[0] = red  [idx];          // R → B  (stays in byte 0 for later fixup)
-            dst[3] = 255;                 // opaque alpha
-            dst += 4;
-        }
-    }
+    ImageMeta m;
+    m.kind   = ImageMeta::KIND_DDS;
+    m.width  = m_baseW;         // mip 0, whichever level is loaded
+    m.height = m_baseH;
+    m.mips   = m_mipCount;
+    m.format = m_fourCC;
+    return m;
 }
 
-
 wxString DDSImage::GetFormat() const
 {
-    // Determine the image format from the DDS header's fourCC value
-    switch (m_fourCC) {
-        case FOURCC_DXT1:
-            return wxString("DXT1");
-        case FOURCC_DXT3:
-            return wxString("DXT3");
-        case FOURCC_DXT5:
-            return wxString("DXT5");
-        case FOURCC_ATI2:
-            return wxString("ATI2");
-        default:
-            return wxString("Unknown Format");
-    }
+    // Same names as the browse list and the library
+    return ImageProbe::FormatName(Meta());
 }
 
 wxString DDSImage::GetSize() const
@@ -464,25 +388,19 @@ wxString DDSImage::GetSize() const
 
 wxString DDSImage::GetMipCount() const
 {
-    // Report the actual mip count from the DDS header
-    return wxString::Format("Mips: %d/%d", m_mipCount, m_mipCount); // m_mipCount is set during header read
+    // The loaded level (1-based) of the chain in the header
+    int level = 0;
+    while (level + 1 < m_mipCount && std::max(m_baseW >> level, 1) > m_w)
+        ++level;
+    return wxString::Format("Mips: %d/%d", level + 1, m_mipCount);
 }
 
 wxString DDSImage::GetMemoryUsage() const
 {
-    // If it's a compressed texture, calculate compressed memory usage based on format.
-    if (m_fourCC == FOURCC_DXT1 || m_fourCC == FOURCC_DXT3 || m_fourCC == FOURCC_DXT5) {
-        // Each block is 8 bytes for DXT1 and 16 bytes for DXT3/5.
-        int blockSize = (m_fourCC == FOURCC_DXT1) ? 8 : 16;
-        int widthBlocks = (m_w + 3) / 4;
-        int heightBlocks = (m_h + 3) / 4;
-        size_t compressedSize = widthBlocks * heightBlocks * blockSize;
-
-        // Convert compressed size to KB
-        return wxString::Format("Mem: %.1fKB/%.1fKB", compressedSize / 1024.0, compressedSize / 1024.0);
-    } else {
-        // For uncompressed textures (32-bit RGBA)
-        size_t rawSize = m_w * m_h * 4;  // 4 bytes per pixel
-        return wxString::Format("Mem: %.1fKB/%.1fKB", rawSize / 1024.0, rawSize / 1024.0);
-    }
+    // Allocated now: blocks kept for the compressed-domain views, and the
+    // BGRA once something has asked for pixels
+    if (!BlockBytes())
+        return wxString::Format("Mem: %.1fKB BGRA", PixelBytes() / 1024.0);
+    return wxString::Format("Mem: %.1fKB blocks / %.1fKB BGRA",
+                            BlockBytes() / 1024.0, PixelBytes() / 1024.0);
 }
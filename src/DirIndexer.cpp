@@ -0,0 +1,163 @@
+// -----------------------------------------------------------------------------
+//  DirIndexer.cpp – background scan of the browse folder
+// -----------------------------------------------------------------------------
+#include "DirIndexer.h"
+#include "ThumbCache.h"
+#include "ImageProbe.h"
+#include "FileSource.h"
+
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <memory>
+
+DirIndexer::DirIndexer(wxEvtHandler* sink, int eventId, ThumbCache* thumbs)
+: wxThread(wxTHREAD_JOINABLE),
+  m_sink(sink), m_eventId(eventId), m_thumbs(thumbs),
+  m_wake(m_lock), m_hasJob(false), m_latest(0), m_quit(false)
+{
+}
+
+void DirIndexer::Submit(const wxString& dir, unsigned generation)
+{
+    wxMutexLocker lock(m_lock);
+    m_dir    = dir.Clone();             // deep copy, handed to another thread
+    m_hasJob = true;
+    m_latest = generation;              // a scan in flight notices and stops
+    m_wake.Signal();
+}
+
+void DirIndexer::Quit()
+{
+    wxMutexLocker lock(m_lock);
+    m_quit = true;
+    m_wake.Signal();
+}
+
+bool DirIndexer::SniffSignature(const wxString& path, uint32_t& file4CC)
+{
+    wxLogNull quiet;                    // unreadable files are simply skipped
+    unsigned char buffer[4];
+    if (FileSource::IsMember(path)) {
+        std::unique_ptr<wxInputStream> in(FileSource::Open(path));
+        if (!in || in->Read(buffer, sizeof(buffer)).LastRead() != sizeof(buffer))
+            return false;
+    } else {
+        wxFile f(path);
+        if (!f.IsOpened() ||
+            f.Read(buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)))
+            return false;
+    }
+
+    file4CC = (buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
+    return true;
+}
+
+// Same rule the old synchronous scan used: the extension picks the format
+// and the signature has to agree with it.  The probed header is remembered
+// in the thumbnail cache, so the next session only has to stat() the file.
+bool DirIndexer::Accept(const wxString& path, ThumbCache* thumbs, ImageMeta* meta)
+{
+    ImageMeta probed;
+    if (!ImageProbe::ProbeCached(path, thumbs, probed))
+        return false;
+
+    const bool isDDS = path.Lower().EndsWith(".dds");
+    if (probed.kind != (isDDS ? ImageMeta::KIND_DDS : ImageMeta::KIND_BCT))
+        return false;
+    if (meta) *meta = probed;
+    return true;
+}
+
+// One pass over the folder; *.dds first, then *.bct, as before.  An archive
+// is browsed as one folder holding all of its texture members.
+void DirIndexer::ListCandidates(const wxString& dir, std::vector<wxString>& out)
+{
+    out.clear();
+    if (FileSource::IsArchive(dir)) {
+        FileSource::ListArchive(dir, out);
+        return;
+    }
+
+    wxLogNull quiet;
+    wxDir d(dir);
+    if (!d.IsOpened()) return;
+
+    std::vector<wxString> bct;
+    wxString name;
+    for (bool cont = d.GetFirst(&name, wxEmptyString, wxDIR_FILES); cont;
+         cont = d.GetNext(&name))
+    {
+        const wxString ext = name.AfterLast('.').Lower();
+        if (ext == "dds")      out.push_back(dir + wxFILE_SEP_PATH + name);
+        else if (ext == "bct") bct.push_back(dir + wxFILE_SEP_PATH + name);
+    }
+    out.insert(out.end(), bct.begin(), bct.end());
+}
+
+void DirIndexer::IndexNow(const wxString& dir, std::vector<wxString>& out,
+                          ThumbCache* thumbs, std::vector<ImageMeta>* metas)
+{
+    std::vector<wxString> names;
+    ListCandidates(dir, names);
+
+    out.clear();
+    if (metas) metas->clear();
+    for (size_t i = 0; i < names.size(); ++i) {
+        ImageMeta meta;
+        if (!Accept(names[i], thumbs, &meta)) continue;
+        out.push_back(names[i]);
+        if (metas) metas->push_back(meta);
+    }
+    if (thumbs) thumbs->Flush();
+}
+
+wxThread::ExitCode DirIndexer::Entry()
+{
+    for (;;)
+    {
+        wxString dir;
+        unsigned gen;
+        {
+            wxMutexLocker lock(m_lock);
+            while (!m_hasJob && !m_quit)
+                m_wake.Wait();
+            if (m_quit) break;
+
+            dir      = m_dir;
+            m_dir.clear();
+            m_hasJob = false;
+            gen      = m_latest;
+        }
+
+        std::vector<wxString> names;
+        ListCandidates(dir, names);
+
+        // Sniff in batches; each batch goes to the GUI as soon as it is full
+        size_t i = 0;
+        do {
+            std::shared_ptr<DirBatch> batch(new DirBatch);
+            batch->generation = gen;
+            batch->paths.reserve(BATCH);
+            batch->metas.reserve(BATCH);
+
+            const size_t end = std::min(names.size(), i + size_t(BATCH));
+            for (; i < end && !Superseded(gen); ++i) {
+                ImageMeta meta;
+                if (!Accept(names[i], m_thumbs, &meta)) continue;
+                batch->paths.push_back(names[i]);
+                batch->metas.push_back(meta);
+            }
+            if (m_thumbs) m_thumbs->Flush();
+
+            if (Superseded(gen)) break;     // newer folder or shutting down
+            batch->done = (i == names.size());
+
+            wxThreadEvent* ev = new wxThreadEvent(wxEVT_THREAD, m_eventId);
+            ev->SetPayload(batch);
+            wxQueueEvent(m_sink, ev);
+        } while (i < names.size());
+    }
+    return 0;
+}
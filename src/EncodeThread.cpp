@@ -0,0 +1,56 @@
+// -----------------------------------------------------------------------------
+//  EncodeThread.cpp – "Save as compressed DDS" off the GUI thread
+// -----------------------------------------------------------------------------
+#include "EncodeThread.h"
+
+#include <wx/stopwatch.h>
+#include <algorithm>
+
+EncodeThread::EncodeThread(wxEvtHandler* sink, int eventId,
+                           const std::shared_ptr<const ImageBase>& img,
+                           TextureCodec::Format format, TextureCodec::Quality quality)
+: wxThread(wxTHREAD_JOINABLE), m_sink(sink), m_eventId(eventId), m_img(img),
+  m_format(format), m_quality(quality), m_rows(std::max(1, (img->Height() + 3) / 4)),
+  m_started(0), m_percent(0), m_cancel(false)
+{
+}
+
+void EncodeThread::Post(const std::shared_ptr<EncodeProgress>& p)
+{
+    wxThreadEvent* ev = new wxThreadEvent(wxEVT_THREAD, m_eventId);
+    ev->SetPayload(p);
+    wxQueueEvent(m_sink, ev);
+}
+
+// Called by every encoding thread before each row; posts whole percents
+// only, the last one held back for the done event
+bool EncodeThread::RowStarted()
+{
+    const int percent = std::min(99, ++m_started * 100 / m_rows);
+    int last = m_percent.load();
+    if (percent > last && m_percent.compare_exchange_strong(last, percent)) {
+        std::shared_ptr<EncodeProgress> p(new EncodeProgress);
+        p->percent = percent;
+        p->done    = false;
+        p->result  = TextureCodec::OK;
+        p->ms      = 0;
+        Post(p);
+    }
+    return m_cancel.load();
+}
+
+wxThread::ExitCode EncodeThread::Entry()
+{
+    std::shared_ptr<EncodeProgress> p(new EncodeProgress);
+    EncodeThread* self = this;
+    wxStopWatch sw;
+    const TextureCodec::Source pixels(m_img->Data(), size_t(m_img->Width()) * 4);
+    p->result  = TextureCodec::EncodeDDS(m_format, pixels, m_img->Width(), m_img->Height(),
+                                         p->dds, m_quality, 0,
+                                         [self]() { return self->RowStarted(); });
+    p->ms      = sw.Time();
+    p->percent = 100;
+    p->done    = true;
+    Post(p);
+    return 0;
+}
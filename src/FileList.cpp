@@ -0,0 +1,122 @@
+// -----------------------------------------------------------------------------
+//  FileList.cpp – the browse list: ordered texture paths with O(1) lookup
+// -----------------------------------------------------------------------------
+#include "FileList.h"
+
+#include <wx/filename.h>
+
+namespace {
+
+const bool CASE_SENSITIVE = wxFileName::IsCaseSensitive();
+
+size_t hashFolded(const wxString& s)
+{
+    return std::hash<std::wstring>()(CASE_SENSITIVE ? s.ToStdWstring()
+                                                    : s.Lower().ToStdWstring());
+}
+
+bool equalFolded(const wxString& a, const wxString& b)
+{
+    return CASE_SENSITIVE ? a == b : a.CmpNoCase(b) == 0;
+}
+
+} // anon-ns
+
+size_t FileList::FoldHash::operator()(const wxString& s) const { return hashFolded(s); }
+bool FileList::FoldEqual::operator()(const wxString& a, const wxString& b) const
+{
+    return equalFolded(a, b);
+}
+
+bool FileList::KeyEqual::operator()(const Key& a, const Key& b) const
+{
+    return a.folder == b.folder && a.hash == b.hash && equalFolded(*a.name, *b.name);
+}
+
+// The folder keeps its trailing separator, so folder + name gives back the
+// path exactly as it was added, whichever separator it used.
+void FileList::Split(const wxString& path, wxString& folder, wxString& name)
+{
+    const size_t cut = path.find_last_of(wxFileName::GetPathSeparators());
+    if (cut == wxString::npos) {
+        folder.clear();
+        name = path;
+    } else {
+        folder = path.substr(0, cut + 1);
+        name   = path.substr(cut + 1);
+    }
+}
+
+const wxString* FileList::Intern(const wxString& folder)
+{
+    return &*m_folders.insert(folder).first;
+}
+
+wxString FileList::Path(int idx) const
+{
+    const Item* it = m_order[idx];
+    return *it->folder + it->name;
+}
+
+int FileList::Find(const wxString& path) const
+{
+    wxString folder, name;
+    Split(path, folder, name);
+    const auto f = m_folders.find(folder);
+    if (f == m_folders.end()) return wxNOT_FOUND;
+
+    const Key key = { &*f, &name, hashFolded(name) };
+    const auto it = m_index.find(key);
+    if (it == m_index.end()) return wxNOT_FOUND;
+
+    if (it->second->pos >= m_valid) {
+        // something moved since the last lookup: renumber from there on
+        for (size_t i = m_valid; i < m_order.size(); ++i)
+            m_order[i]->pos = i;
+        m_valid = m_order.size();
+    }
+    return int(it->second->pos);
+}
+
+void FileList::Clear()
+{
+    m_index.clear();
+    m_order.clear();
+    m_items.clear();
+    m_folders.clear();
+    m_valid = 0;
+}
+
+void FileList::Insert(const wxString& path, size_t at)
+{
+    wxString folder, name;
+    Split(path, folder, name);
+
+    Item item;
+    item.folder = Intern(folder);
+    item.name   = name;
+    item.hash   = hashFolded(name);
+    item.pos    = at;
+    m_items.push_back(item);
+
+    const Item* p = &m_items.back();
+    const Key key = { p->folder, &p->name, p->hash };
+    m_index[key] = p;
+
+    const bool append = (at == m_order.size());
+    m_order.insert(m_order.begin() + at, p);
+    if (append && m_valid == at) ++m_valid;        // still all numbered
+    else if (at < m_valid)       m_valid = at;
+}
+
+void FileList::RemoveAt(size_t at)
+{
+    const Item* p = m_order[at];
+    const Key key = { p->folder, &p->name, p->hash };
+    const auto it = m_index.find(key);
+    if (it != m_index.end() && it->second == p)
+        m_index.erase(it);
+
+    m_order.erase(m_order.begin() + at);
+    if (at < m_valid) m_valid = at;
+}
@@ -0,0 +1,55 @@
+// -----------------------------------------------------------------------------
+//  FileListCtrl.cpp – virtual side list over the browse list
+// -----------------------------------------------------------------------------
+#include "FileListCtrl.h"
+#include "BCTV.h"
+
+BEGIN_EVENT_TABLE(FileListCtrl, wxListCtrl)
+EVT_LIST_ITEM_SELECTED(wxID_ANY, FileListCtrl::OnSelected)
+END_EVENT_TABLE()
+
+FileListCtrl::FileListCtrl(BCTVFrame* host, const FileList& files)
+: wxListCtrl(host, wxID_ANY, wxDefaultPosition, wxSize(WIDTH, -1),
+             wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxBORDER_NONE),
+  m_host(host), m_files(files), m_current(-1), m_selecting(false)
+{
+    AppendColumn("Name",   wxLIST_FORMAT_LEFT, WIDTH - 20);
+    AppendColumn("Folder", wxLIST_FORMAT_LEFT, 2 * WIDTH);
+}
+
+wxString FileListCtrl::OnGetItemText(long item, long column) const
+{
+    if (item < 0 || item >= (long)m_files.GetCount()) return wxEmptyString;
+    return column == 0 ? m_files.Name(item) : m_files.Folder(item);
+}
+
+void FileListCtrl::SyncList()
+{
+    const long n = m_files.GetCount();
+    if (GetItemCount() != n) SetItemCount(n);
+    if (m_current >= n) m_current = -1;
+    if (IsShown()) Refresh();          // rows may have shifted under the view
+}
+
+void FileListCtrl::SetCurrent(int idx)
+{
+    const long n = GetItemCount();
+    m_selecting = true;
+    if (m_current >= 0 && m_current < n && m_current != idx)
+        SetItemState(m_current, 0, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED);
+    m_current = idx;
+    if (idx >= 0 && idx < n) {
+        SetItemState(idx, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED,
+                          wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED);
+        if (IsShown()) EnsureVisible(idx);
+    }
+    m_selecting = false;
+}
+
+void FileListCtrl::OnSelected(wxListEvent& e)
+{
+    const int idx = e.GetIndex();
+    if (m_selecting || idx == m_current) return;
+    m_current = idx;
+    m_host->JumpImage(idx);
+}
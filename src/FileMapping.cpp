@@ -0,0 +1,128 @@
+// -----------------------------------------------------------------------------
+//  FileMapping.cpp – read-only windows onto a file of any size
+// -----------------------------------------------------------------------------
+#include "FileMapping.h"
+
+#include <algorithm>
+
+#ifdef __WXMSW__
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// What a view's file offset has to be a multiple of
+uint64_t Granularity()
+{
+    static const uint64_t g = [] {
+#ifdef __WXMSW__
+        SYSTEM_INFO si;
+        ::GetSystemInfo(&si);
+        return uint64_t(si.dwAllocationGranularity);
+#else
+        const long page = ::sysconf(_SC_PAGESIZE);
+        return uint64_t(page > 0 ? page : 4096);
+#endif
+    }();
+    return g;
+}
+
+} // anon-ns
+
+FileMapping::View::~View()
+{
+    if (!m_base) return;
+#ifdef __WXMSW__
+    ::UnmapViewOfFile(m_base);
+#else
+    ::munmap(m_base, m_baseSize);
+#endif
+}
+
+FileMapping::FileMapping()
+: m_handle(NULL), m_fd(-1), m_length(0)
+{
+}
+
+FileMapping::~FileMapping()
+{
+    Close();
+}
+
+bool FileMapping::Open(const wxString& file)
+{
+    Close();
+#ifdef __WXMSW__
+    HANDLE f = ::CreateFileW(file.wc_str(), GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER len;
+    if (!::GetFileSizeEx(f, &len) || len.QuadPart == 0) { ::CloseHandle(f); return false; }
+
+    HANDLE m = ::CreateFileMappingW(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    ::CloseHandle(f);                   // the mapping keeps the file open
+    if (!m) return false;
+
+    m_handle = m;
+    m_length = uint64_t(len.QuadPart);
+    return true;
+#else
+    const int fd = ::open(file.fn_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return false; }
+
+    m_fd     = fd;
+    m_length = uint64_t(st.st_size);
+    return true;
+#endif
+}
+
+// Views hold their own reference to the file, so they outlive this
+void FileMapping::Close()
+{
+#ifdef __WXMSW__
+    if (m_handle) ::CloseHandle(static_cast<HANDLE>(m_handle));
+#else
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+    m_handle = NULL;
+    m_fd     = -1;
+    m_length = 0;
+}
+
+std::shared_ptr<const FileMapping::View> FileMapping::Map(uint64_t offset, uint64_t size) const
+{
+    if (!IsOpened() || offset >= m_length) return std::shared_ptr<const View>();
+    size = std::min(size, m_length - offset);
+    if (size == 0) return std::shared_ptr<const View>();
+
+    const uint64_t base = offset / Granularity() * Granularity();
+    const uint64_t span = offset - base + size;
+    if (span > SIZE_MAX) return std::shared_ptr<const View>();
+
+    std::shared_ptr<View> v(new View);
+#ifdef __WXMSW__
+    v->m_base = ::MapViewOfFile(static_cast<HANDLE>(m_handle), FILE_MAP_READ,
+                                DWORD(base >> 32), DWORD(base), SIZE_T(span));
+    if (!v->m_base) return std::shared_ptr<const View>();
+#else
+    void* p = ::mmap(NULL, size_t(span), PROT_READ, MAP_SHARED, m_fd, off_t(base));
+    if (p == MAP_FAILED) return std::shared_ptr<const View>();
+    v->m_base = p;
+#endif
+    v->m_baseSize = size_t(span);
+    v->m_data     = static_cast<const unsigned char*>(v->m_base) + (offset - base);
+    v->m_size     = size_t(size);
+    v->m_offset   = offset;
+    return v;
+}
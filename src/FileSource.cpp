@@ -0,0 +1,150 @@
+// -----------------------------------------------------------------------------
+//  FileSource.cpp – where a texture's bytes come from
+// -----------------------------------------------------------------------------
+#include "FileSource.h"
+#include "ZipArchive.h"
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/thread.h>
+#include <wx/wfstream.h>
+#include <wx/log.h>
+#include <list>
+
+namespace {
+
+const wxString MEMBER_SEP = "#zip:";
+
+struct OpenArchive
+{
+    wxString                    path;
+    uint64_t                    size;
+    int64_t                     mtime;
+    std::shared_ptr<ZipArchive> zip;
+};
+
+wxMutex&                s_lock()  { static wxMutex m; return m; }
+std::list<OpenArchive>& s_open()  { static std::list<OpenArchive> l; return l; }   // MRU first
+
+bool statFile(const wxString& path, uint64_t& size, int64_t& mtime)
+{
+    wxStructStat st;
+    if (wxStat(path, &st) != 0) return false;
+    size  = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+} // anon-ns
+
+bool FileSource::IsMember(const wxString& path)
+{
+    return path.find(MEMBER_SEP) != wxString::npos;
+}
+
+bool FileSource::SplitMember(const wxString& path, wxString& archive, wxString& member)
+{
+    const size_t at = path.find(MEMBER_SEP);
+    if (at == wxString::npos) return false;
+    archive = path.substr(0, at);
+    member  = path.substr(at + MEMBER_SEP.length());
+    return true;
+}
+
+wxString FileSource::MemberPath(const wxString& archive, const wxString& member)
+{
+    return archive + MEMBER_SEP + member;
+}
+
+bool FileSource::IsArchive(const wxString& path)
+{
+    const wxString ext = path.AfterLast('.').Lower();
+    return (ext == "zip" || ext == "pk3" || ext == "pk4") && !IsMember(path) &&
+           ZipArchive::LooksLikeZip(path);
+}
+
+std::shared_ptr<ZipArchive> FileSource::Archive(const wxString& path)
+{
+    uint64_t size;
+    int64_t  mtime;
+    if (!statFile(path, size, mtime)) return std::shared_ptr<ZipArchive>();
+
+    wxMutexLocker lock(s_lock());
+    std::list<OpenArchive>& open = s_open();
+    for (std::list<OpenArchive>::iterator it = open.begin(); it != open.end(); ++it) {
+        if (it->path != path) continue;
+        if (it->size == size && it->mtime == mtime) {
+            open.splice(open.begin(), open, it);
+            return it->zip;
+        }
+        open.erase(it);                 // rewritten since: map it again
+        break;
+    }
+
+    // Indexing the directory under the lock keeps two threads from doing it
+    // twice; it reads only the central directory
+    OpenArchive a;
+    a.path  = path.Clone();
+    a.size  = size;
+    a.mtime = mtime;
+    a.zip   = ZipArchive::Open(path);
+    if (!a.zip) return a.zip;
+
+    open.push_front(a);
+    if (open.size() > OPEN_ARCHIVES) open.pop_back();   // streams keep theirs
+    return a.zip;
+}
+
+wxInputStream* FileSource::Open(const wxString& path)
+{
+    wxString archive, member;
+    if (SplitMember(path, archive, member)) {
+        const std::shared_ptr<ZipArchive> zip = Archive(archive);
+        const ZipArchive::Member* m = zip ? zip->Find(member) : NULL;
+        return m ? zip->OpenMember(*m) : NULL;
+    }
+
+    wxLogNull quiet;
+    wxFileInputStream* in = new wxFileInputStream(path);
+    if (in->IsOk()) return in;
+    delete in;
+    return NULL;
+}
+
+bool FileSource::Stat(const wxString& path, uint64_t& size, int64_t& mtime)
+{
+    wxString archive, member;
+    if (!SplitMember(path, archive, member))
+        return statFile(path, size, mtime);
+
+    const std::shared_ptr<ZipArchive> zip = Archive(archive);
+    const ZipArchive::Member* m = zip ? zip->Find(member) : NULL;
+    if (!m || !statFile(archive, size, mtime)) return false;
+    size = m->size;
+    return true;
+}
+
+wxString FileSource::FolderOf(const wxString& path)
+{
+    wxString archive, member;
+    if (SplitMember(path, archive, member)) return archive;
+    return wxFileName(path).GetPath();
+}
+
+bool FileSource::ListArchive(const wxString& archive, std::vector<wxString>& out)
+{
+    out.clear();
+    const std::shared_ptr<ZipArchive> zip = Archive(archive);
+    if (!zip) return false;
+
+    std::vector<wxString> bct;
+    const std::vector<ZipArchive::Member>& members = zip->Members();
+    for (size_t i = 0; i < members.size(); ++i) {
+        if (!members[i].readable) continue;
+        const wxString ext = members[i].name.AfterLast('.').Lower();
+        if (ext == "dds")      out.push_back(MemberPath(archive, members[i].name));
+        else if (ext == "bct") bct.push_back(MemberPath(archive, members[i].name));
+    }
+    out.insert(out.end(), bct.begin(), bct.end());
+    return true;
+}
@@ -0,0 +1,193 @@
+// -----------------------------------------------------------------------------
+//  ImageCache.cpp – decoded images kept around for quick browsing
+// -----------------------------------------------------------------------------
+#include "ImageCache.h"
+#include "DirIndexer.h"
+#include "BCTImage.h"
+#include "DDSImage.h"
+#include "ImageProbe.h"
+#include "ThumbCache.h"
+
+#include <wx/filefn.h>
+#include <wx/log.h>
+#include <algorithm>
+
+ImageCache::ImageCache(size_t budgetBytes)
+: m_bytes(0), m_budget(budgetBytes)
+{
+}
+
+std::shared_ptr<ImageBase> ImageCache::Find(const wxString& path)
+{
+    const time_t mtime = ModTime(path);
+
+    wxMutexLocker lock(m_lock);
+    auto it = m_map.find(path);
+    if (it == m_map.end()) return std::shared_ptr<ImageBase>();
+
+    if (it->second->mtime != mtime) {              // changed on disk
+        m_bytes -= it->second->bytes;
+        m_lru.erase(it->second);
+        m_map.erase(it);
+        return std::shared_ptr<ImageBase>();
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->img;
+}
+
+bool ImageCache::Contains(const wxString& path) const
+{
+    wxMutexLocker lock(m_lock);
+    return m_map.find(path) != m_map.end();
+}
+
+void ImageCache::Insert(const wxString& path, const std::shared_ptr<ImageBase>& img)
+{
+    if (!img) return;
+
+    Entry e;
+    e.path  = path.Clone();                        // may come from a worker
+    e.img   = img;
+    e.mtime = ModTime(path);
+    e.bytes = Cost(*img);
+
+    wxMutexLocker lock(m_lock);
+    auto it = m_map.find(e.path);
+    if (it != m_map.end()) {
+        m_bytes -= it->second->bytes;
+        m_lru.erase(it->second);
+        m_map.erase(it);
+    }
+    m_lru.push_front(e);
+    m_map[e.path] = m_lru.begin();
+    m_bytes += e.bytes;
+    Trim();
+}
+
+void ImageCache::Erase(const wxString& path)
+{
+    wxMutexLocker lock(m_lock);
+    auto it = m_map.find(path);
+    if (it == m_map.end()) return;
+    m_bytes -= it->second->bytes;
+    m_lru.erase(it->second);
+    m_map.erase(it);
+}
+
+void ImageCache::Clear()
+{
+    wxMutexLocker lock(m_lock);
+    m_map.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+void ImageCache::Relieve()
+{
+    wxMutexLocker lock(m_lock);
+    Trim();
+}
+
+void ImageCache::SetBudget(size_t budgetBytes)
+{
+    wxMutexLocker lock(m_lock);
+    m_budget = budgetBytes;
+    Trim();
+}
+
+size_t ImageCache::Budget() const { wxMutexLocker lock(m_lock); return m_budget; }
+size_t ImageCache::Bytes()  const { wxMutexLocker lock(m_lock); return m_bytes;  }
+size_t ImageCache::Count()  const { wxMutexLocker lock(m_lock); return m_lru.size(); }
+
+// Oldest first; the newest entry always stays even if it alone is too big
+void ImageCache::Trim()
+{
+    while (m_bytes > m_budget && m_lru.size() > 1) {
+        m_bytes -= m_lru.back().bytes;
+        m_map.erase(m_lru.back().path);
+        m_lru.pop_back();
+    }
+
+    // Over the process budget only an image held by nobody else gives
+    // memory back; the one on screen or in the render worker is skipped
+    List::iterator it = m_lru.end();
+    while (MemoryBudget::Over() && it != m_lru.begin()) {
+        --it;
+        if (it == m_lru.begin()) break;
+        if (it->img.use_count() > 1) continue;
+        m_bytes -= it->bytes;
+        m_map.erase(it->path);
+        it = m_lru.erase(it);
+    }
+}
+
+time_t ImageCache::ModTime(const wxString& path)
+{
+    uint64_t size;
+    int64_t  mtime;
+    return ThumbCache::Stat(path, size, mtime) ? time_t(mtime) : time_t(-1);
+}
+
+size_t ImageCache::Cost(const ImageBase& img)
+{
+    return size_t(img.Width()) * img.Height() * 4 + img.BlockBytes();
+}
+
+int ImageCache::FitSide(const wxString& path)
+{
+    ImageMeta meta;
+    if (!ImageProbe::Probe(path, meta)) return 0;
+
+    // Decoded BGRA plus at most a byte per texel of blocks, per level
+    const size_t limit = MemoryBudget::SingleImageLimit();
+    int w = meta.width, h = meta.height, level = 0;
+    while (level + 1 < meta.mips && size_t(w) * h * 5 > limit) {
+        w = std::max(w >> 1, 1);
+        h = std::max(h >> 1, 1);
+        ++level;
+    }
+    return level ? std::max(w, h) : 0;
+}
+
+std::shared_ptr<ImageBase> ImageCache::ForSignature(uint32_t file4CC)
+{
+    std::shared_ptr<ImageBase> img;
+    if ((file4CC == 0x07010220) || ((file4CC & 0x00FFFF00) == 0x00010100))
+        img.reset(new BCTImage);
+    else if (file4CC == 0x44445320)
+        img.reset(new DDSImage);
+    return img;
+}
+
+std::shared_ptr<ImageBase> ImageCache::OpenFile(const wxString& path)
+{
+    uint32_t file4CC;
+    if (!DirIndexer::SniffSignature(path, file4CC))
+        return std::shared_ptr<ImageBase>();
+
+    std::shared_ptr<ImageBase> img = ForSignature(file4CC);
+    if (!img) return img;
+
+    wxLogNull quiet;
+    if (!img->LoadFromFile(path))
+        img.reset();
+    return img;
+}
+
+std::shared_ptr<ImageBase> ImageCache::LoadFile(const wxString& path,
+                                                const ImageBase::CancelFn& cancelled)
+{
+    uint32_t file4CC;
+    if (!DirIndexer::SniffSignature(path, file4CC))
+        return std::shared_ptr<ImageBase>();
+
+    std::shared_ptr<ImageBase> img = ForSignature(file4CC);
+    if (!img) return img;
+
+    wxLogNull quiet;
+    const int side = FitSide(path);
+    if (!(side ? img->LoadSmallMip(path, side) : img->LoadFromFile(path)) ||
+        (cancelled && cancelled()) || !img->EnsurePixels(cancelled))
+        img.reset();
+    return img;
+}
@@ -0,0 +1,99 @@
+// -----------------------------------------------------------------------------
+//  ImageProbe.cpp – header-only facts about a texture file
+// -----------------------------------------------------------------------------
+#include "ImageProbe.h"
+#include "ThumbCache.h"
+#include "BCTImage.h"
+#include "DDSImage.h"
+#include "FileSource.h"
+
+#include <wx/wfstream.h>
+#include <wx/log.h>
+#include <algorithm>
+
+#define FOURCC(a,b,c,d) ( unsigned(a) | (unsigned(b)<<8) | \
+                          (unsigned(c)<<16) | (unsigned(d)<<24) )
+
+bool ImageProbe::Probe(const wxString& path, ImageMeta& meta)
+{
+    wxLogNull quiet;                    // unreadable files are simply skipped
+    std::unique_ptr<wxInputStream> stream(FileSource::Open(path));
+    if (!stream) return false;
+    wxInputStream& in = *stream;
+
+    unsigned char sig[4];
+    if (in.Read(sig, sizeof(sig)).LastRead() != sizeof(sig)) return false;
+    const uint32_t file4CC = (sig[0] << 24) | (sig[1] << 16) | (sig[2] << 8) | sig[3];
+    if (in.SeekI(0) == wxInvalidOffset) return false;
+
+    meta = ImageMeta();
+    if ((file4CC == 0x07010220) || ((file4CC & 0x00FFFF00) == 0x00010100))
+        return BCTImage::Probe(in, meta);
+    if (file4CC == 0x44445320)
+        return DDSImage::Probe(in, meta);
+    return false;
+}
+
+bool ImageProbe::ProbeCached(const wxString& path, ThumbCache* thumbs, ImageMeta& meta)
+{
+    uint64_t size  = 0;
+    int64_t  mtime = 0;
+    const bool known = thumbs && ThumbCache::Stat(path, size, mtime);
+
+    // Records from the signature-only days carry a kind but no size
+    if (known && thumbs->Lookup(path, size, mtime, meta) &&
+        (meta.kind == ImageMeta::KIND_NONE || meta.width > 0))
+        return meta.kind != ImageMeta::KIND_NONE;
+
+    const bool ok = Probe(path, meta);
+    if (!ok) meta = ImageMeta();
+    if (known) thumbs->Put(path, size, mtime, meta);
+    return ok;
+}
+
+wxString ImageProbe::FormatName(const ImageMeta& meta)
+{
+    if (meta.kind == ImageMeta::KIND_DDS) {
+        switch (meta.format) {
+            case FOURCC('D','X','T','1'): return "DXT1";
+            case FOURCC('D','X','T','3'): return "DXT3";
+            case FOURCC('D','X','T','5'): return "DXT5";
+            case FOURCC('A','T','I','1'): return "ATI1";
+            case FOURCC('A','T','I','2'): return "ATI2";
+            case 0:                       return "RGBA8";
+            default:                      return "Unknown";
+        }
+    }
+    if (meta.kind == ImageMeta::KIND_BCT) {
+        switch (meta.format) {          // DXGI, as mapped by the loader
+            case 28: return "RGBA8";
+            case 71: return "DXT1";
+            case 77: return "DXT5";
+            case 80: return "ATI1";
+            case 83: return "ATI2";
+            case 95: return "BC6H";
+            case 98: return "BC7";
+            default: return "Unknown";
+        }
+    }
+    return wxEmptyString;
+}
+
+uint64_t ImageProbe::StoredBytes(const ImageMeta& meta)
+{
+    const wxString fmt = FormatName(meta);
+    int blockBytes = 0;                 // per 4x4 block; 0 = 4 bytes per pixel
+    if (fmt == "DXT1" || fmt == "ATI1")                      blockBytes = 8;
+    else if (fmt == "DXT3" || fmt == "DXT5" || fmt == "ATI2" ||
+             fmt == "BC6H" || fmt == "BC7")                  blockBytes = 16;
+    else if (fmt != "RGBA8")                                 return 0;
+
+    uint64_t total = 0;
+    for (int i = 0; i < std::max(meta.mips, 1); ++i) {
+        const uint64_t w = std::max(meta.width  >> i, 1);
+        const uint64_t h = std::max(meta.height >> i, 1);
+        total += blockBytes ? ((w + 3) / 4) * ((h + 3) / 4) * blockBytes : w * h * 4;
+        if (w == 1 && h == 1) break;
+    }
+    return total;
+}
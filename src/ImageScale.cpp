@@ -0,0 +1,156 @@
+// -----------------------------------------------------------------------------
+//  ImageScale.cpp – nearest and box-filter BGRA32 resamplers
+// -----------------------------------------------------------------------------
+#include "ImageScale.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+/* sRGB ↔ linear tables (generated once, like the 565 LUTs in the decoders) */
+struct GammaTables {
+    uint16_t      toLinear[256];      // sRGB byte    → linear 0..65535
+    unsigned char toSrgb[65536];      // linear 16-bit → sRGB byte
+    GammaTables() {
+        for (int i = 0; i < 256; ++i) {
+            const double c = i / 255.0;
+            const double l = (c <= 0.04045) ? c / 12.92
+                                            : std::pow((c + 0.055) / 1.055, 2.4);
+            toLinear[i] = static_cast<uint16_t>(l * 65535.0 + 0.5);
+        }
+        for (int i = 0; i < 65536; ++i) {
+            const double l = i / 65535.0;
+            const double c = (l <= 0.0031308) ? l * 12.92
+                                              : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            toSrgb[i] = static_cast<unsigned char>(c * 255.0 + 0.5);
+        }
+    }
+};
+static const GammaTables GAMMA;
+
+/* span table: output index i (from `first`) covers src [map[i], map[i+1]) */
+void BuildSpans(std::vector<int>& map, int srcLen, int dstLen, int first, int count)
+{
+    map.resize(count + 1);
+    for (int i = 0; i <= count; ++i)
+        map[i] = static_cast<int>((long long)(first + i) * srcLen / dstLen);
+}
+
+} // anon-ns
+
+namespace ImageScale {
+
+uint16_t SrgbToLinear16(unsigned char v)  { return GAMMA.toLinear[v]; }
+unsigned char Linear16ToSrgb(uint16_t v)  { return GAMMA.toSrgb[v]; }
+
+// -----------------------------------------------------------------------------
+void Nearest(const unsigned char* src, int sw, int sh, int srcPitch,
+             unsigned char* dst, int dw, int dh, int dstPitch)
+{
+    NearestRegion(src, sw, sh, srcPitch, dst, dstPitch, dw, dh, 0, 0, dw, dh);
+}
+
+void BoxShrink(const unsigned char* src, int sw, int sh, int srcPitch,
+               unsigned char* dst, int dw, int dh, int dstPitch,
+               bool linearLight)
+{
+    BoxShrinkRegion(src, sw, sh, srcPitch, dst, dstPitch, dw, dh,
+                    0, 0, dw, dh, linearLight);
+}
+
+// -----------------------------------------------------------------------------
+void NearestRegion(const unsigned char* src, int sw, int sh, int srcPitch,
+                   unsigned char* dst, int dstPitch, int dw, int dh,
+                   int rx, int ry, int rw, int rh)
+{
+    if (!src || !dst || sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) return;
+    if (rw <= 0 || rh <= 0 || rx < 0 || ry < 0 || rx + rw > dw || ry + rh > dh) return;
+
+    std::vector<int> xmap(rw);
+    for (int x = 0; x < rw; ++x)
+        xmap[x] = static_cast<int>((long long)(rx + x) * sw / dw) << 2;
+
+    for (int y = 0; y < rh; ++y) {
+        const unsigned char* row = src + size_t((long long)(ry + y) * sh / dh) * srcPitch;
+        unsigned char* out = dst + size_t(y) * dstPitch;
+        for (int x = 0; x < rw; ++x, out += 4) {
+            const unsigned char* p = row + xmap[x];
+            out[0] = p[0]; out[1] = p[1]; out[2] = p[2]; out[3] = p[3];
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  Box shrink – every source texel lands in exactly one output pixel.
+//  Rows of a band are accumulated into 64-bit sums so even a 16k → 1 shrink
+//  cannot overflow; the only divisions are one per output channel.
+// -----------------------------------------------------------------------------
+void BoxShrinkRegion(const unsigned char* src, int sw, int sh, int srcPitch,
+                     unsigned char* dst, int dstPitch, int dw, int dh,
+                     int rx, int ry, int rw, int rh, bool linearLight)
+{
+    if (!src || !dst || sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) return;
+    if (rw <= 0 || rh <= 0 || rx < 0 || ry < 0 || rx + rw > dw || ry + rh > dh) return;
+    if (dw > sw || dh > sh) {                  // not a shrink – fall back
+        NearestRegion(src, sw, sh, srcPitch, dst, dstPitch, dw, dh, rx, ry, rw, rh);
+        return;
+    }
+
+    std::vector<int> xs, ys;
+    BuildSpans(xs, sw, dw, rx, rw);
+    BuildSpans(ys, sh, dh, ry, rh);
+
+    std::vector<unsigned long long> acc(size_t(rw) * 4);
+    const uint16_t* lin = GAMMA.toLinear;
+
+    for (int y = 0; y < rh; ++y)
+    {
+        std::fill(acc.begin(), acc.end(), 0ULL);
+
+        for (int sy = ys[y]; sy < ys[y + 1]; ++sy)
+        {
+            const unsigned char* p = src + size_t(sy) * srcPitch + size_t(xs[0]) * 4;
+            unsigned long long* a = &acc[0];
+
+            if (linearLight) {
+                for (int x = 0; x < rw; ++x, a += 4) {
+                    unsigned b = 0, g = 0, r = 0, al = 0;
+                    for (int sx = xs[x]; sx < xs[x + 1]; ++sx, p += 4) {
+                        b += lin[p[0]]; g += lin[p[1]]; r += lin[p[2]]; al += p[3];
+                    }
+                    a[0] += b; a[1] += g; a[2] += r; a[3] += al;
+                }
+            } else {
+                for (int x = 0; x < rw; ++x, a += 4) {
+                    unsigned b = 0, g = 0, r = 0, al = 0;
+                    for (int sx = xs[x]; sx < xs[x + 1]; ++sx, p += 4) {
+                        b += p[0]; g += p[1]; r += p[2]; al += p[3];
+                    }
+                    a[0] += b; a[1] += g; a[2] += r; a[3] += al;
+                }
+            }
+        }
+
+        const unsigned long long rows = ys[y + 1] - ys[y];
+        const unsigned long long* a = &acc[0];
+        unsigned char* out = dst + size_t(y) * dstPitch;
+
+        for (int x = 0; x < rw; ++x, a += 4, out += 4) {
+            const unsigned long long n = rows * (xs[x + 1] - xs[x]);
+            const unsigned long long h = n >> 1;
+            if (linearLight) {
+                out[0] = GAMMA.toSrgb[(a[0] + h) / n];
+                out[1] = GAMMA.toSrgb[(a[1] + h) / n];
+                out[2] = GAMMA.toSrgb[(a[2] + h) / n];
+            } else {
+                out[0] = static_cast<unsigned char>((a[0] + h) / n);
+                out[1] = static_cast<unsigned char>((a[1] + h) / n);
+                out[2] = static_cast<unsigned char>((a[2] + h) / n);
+            }
+            out[3] = static_cast<unsigned char>((a[3] + h) / n);
+        }
+    }
+}
+
+} // namespace ImageScale
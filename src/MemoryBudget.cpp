@@ -0,0 +1,76 @@
+// -----------------------------------------------------------------------------
+//  MemoryBudget.cpp – per-category byte counts and the process-wide budget
+// -----------------------------------------------------------------------------
+#include "MemoryBudget.h"
+
+namespace {
+
+const char* const CATEGORY_NAMES[MemoryBudget::CATEGORIES] = {
+    "pixels", "blocks", "staging", "frames", "bitmaps", "thumbs", "pool"
+};
+
+std::atomic<size_t> s_bytes[MemoryBudget::CATEGORIES];   // zero-initialised
+std::atomic<size_t> s_total;
+std::atomic<size_t> s_peak;
+std::atomic<size_t> s_budget(size_t(512) << 20);
+
+void Adjust(int cat, size_t add, size_t sub)
+{
+    if (add == sub) return;
+    if (add > sub) {
+        s_bytes[cat].fetch_add(add - sub, std::memory_order_relaxed);
+        const size_t now = s_total.fetch_add(add - sub, std::memory_order_relaxed) + (add - sub);
+        size_t peak = s_peak.load(std::memory_order_relaxed);
+        while (now > peak && !s_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+            ;
+    } else {
+        s_bytes[cat].fetch_sub(sub - add, std::memory_order_relaxed);
+        s_total.fetch_sub(sub - add, std::memory_order_relaxed);
+    }
+}
+
+} // anon-ns
+
+void MemoryBudget::Charge::Set(size_t bytes)
+{
+    const size_t old = m_bytes.exchange(bytes, std::memory_order_relaxed);
+    Adjust(m_cat, bytes, old);
+}
+
+size_t MemoryBudget::Bytes(int cat)
+{
+    if (cat < 0 || cat >= CATEGORIES) return 0;
+    return s_bytes[cat].load(std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::Total() { return s_total.load(std::memory_order_relaxed); }
+size_t MemoryBudget::Peak()  { return s_peak.load(std::memory_order_relaxed); }
+
+void   MemoryBudget::SetBudget(size_t bytes) { s_budget.store(bytes, std::memory_order_relaxed); }
+size_t MemoryBudget::Budget() { return s_budget.load(std::memory_order_relaxed); }
+
+size_t MemoryBudget::Held()
+{
+    const size_t total = Total(), idle = Bytes(POOL);
+    return total > idle ? total - idle : 0;
+}
+
+bool MemoryBudget::Over(size_t extra)
+{
+    return Held() + extra > Budget();
+}
+
+bool MemoryBudget::Prefetchable()
+{
+    return Held() < Budget() / 100 * PREFETCH_PCT;
+}
+
+size_t MemoryBudget::SingleImageLimit()
+{
+    return Budget() / SINGLE_SHARE;
+}
+
+const char* MemoryBudget::CategoryName(int cat)
+{
+    return (cat >= 0 && cat < CATEGORIES) ? CATEGORY_NAMES[cat] : "";
+}
@@ -0,0 +1,159 @@
+// -----------------------------------------------------------------------------
+//  Prefetcher.cpp – latest-wins image loading into the ImageCache
+// -----------------------------------------------------------------------------
+#include "Prefetcher.h"
+#include "ImageCache.h"
+#include "ThumbCache.h"
+
+Prefetcher::Prefetcher(ImageCache& cache, wxEvtHandler* sink, int eventId,
+                       ThumbCache* thumbs, int workers)
+: m_cache(cache), m_sink(sink), m_eventId(eventId), m_thumbs(thumbs),
+  m_workerCount(workers > 0 ? workers : 1),
+  m_wake(m_lock), m_focusQueued(false), m_quit(false)
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+    {
+        wxMutexLocker lock(m_lock);
+        m_quit = true;
+        m_queue.clear();
+        m_wanted.clear();
+        m_wake.Broadcast();
+    }
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->Wait();
+        delete m_workers[i];
+    }
+}
+
+bool Prefetcher::Start()
+{
+    for (int i = 0; i < m_workerCount; ++i) {
+        Worker* w = new Worker(this);
+        if (w->Run() != wxTHREAD_NO_ERROR) {
+            delete w;
+            break;
+        }
+        m_workers.push_back(w);
+    }
+    return !m_workers.empty();
+}
+
+void Prefetcher::Submit(const std::vector<wxString>& paths, bool focusFirst)
+{
+    wxMutexLocker lock(m_lock);
+    m_queue.clear();                   // an old neighbourhood is not wanted now
+    m_wanted.clear();
+    for (size_t i = 0; i < paths.size(); ++i) {
+        m_queue.push_back(paths[i].Clone());
+        m_wanted.insert(m_queue.back());
+    }
+
+    m_focus.clear();
+    m_focusQueued = false;
+    if (focusFirst && !paths.empty()) {
+        m_focus = m_queue.front();
+        if (m_cache.Contains(m_focus)) {
+            // a worker finished it between the frame's lookup and now
+            PostResult(m_focus, m_cache.Find(m_focus));
+            m_focus.clear();
+        } else {
+            m_focusQueued = !m_inFlight.count(m_focus);
+        }
+    }
+    if (!m_queue.empty()) m_wake.Broadcast();
+}
+
+bool Prefetcher::Next(wxString& path)
+{
+    wxMutexLocker lock(m_lock);
+    for (;;)
+    {
+        while (m_queue.empty() && !m_quit)
+            m_wake.Wait();
+        if (m_quit) return false;
+
+        path = m_queue.front();
+        m_queue.pop_front();
+        if (path == m_focus) m_focusQueued = false;
+        if (m_inFlight.count(path) || m_cache.Contains(path))
+            continue;                  // another worker has it, or it is done
+        if (path != m_focus && !MemoryBudget::Prefetchable())
+            continue;                  // budget nearly used: only what is shown
+        m_inFlight.insert(path);
+        return true;
+    }
+}
+
+void Prefetcher::Finished(const wxString& path, const std::shared_ptr<ImageBase>& img,
+                          bool cancelled)
+{
+    wxMutexLocker lock(m_lock);
+    m_inFlight.erase(path);
+    if (m_focus.empty() || path != m_focus) return;
+
+    if (!img && cancelled) {
+        // dropped as a neighbour just before it became the focus – go again
+        m_queue.push_front(path);
+        m_focusQueued = true;
+        m_wake.Signal();
+        return;
+    }
+    PostResult(path, img);
+    m_focus.clear();
+}
+
+// Polled from the decode loops
+bool Prefetcher::Unwanted(const wxString& path)
+{
+    wxMutexLocker lock(m_lock);
+    if (m_quit || !m_wanted.count(path)) return true;
+    return m_focusQueued && path != m_focus;   // free a worker for the focus
+}
+
+void Prefetcher::PostResult(const wxString& path, const std::shared_ptr<ImageBase>& img)
+{
+    std::shared_ptr<LoadResult> res(new LoadResult);
+    res->path = path.Clone();
+    res->img  = img;
+
+    wxThreadEvent* ev = new wxThreadEvent(wxEVT_THREAD, m_eventId);
+    ev->SetPayload(res);
+    wxQueueEvent(m_sink, ev);
+}
+
+void Prefetcher::RecordThumb(const wxString& path, const ImageBase& img)
+{
+    uint64_t size;
+    int64_t  mtime;
+    if (!m_thumbs || !ThumbCache::Stat(path, size, mtime) ||
+        m_thumbs->HasThumb(path, size, mtime))
+        return;
+
+    std::vector<unsigned char> thumb;
+    int tw, th;
+    if (ThumbCache::MakeThumb(img, thumb, tw, th))
+        m_thumbs->Put(path, size, mtime, img.Meta(), &thumb[0], tw, th);
+}
+
+wxThread::ExitCode Prefetcher::Worker::Entry()
+{
+    wxString path;
+    while (m_owner->Next(path))
+    {
+        Prefetcher* owner     = m_owner;
+        bool        cancelled = false;
+        std::shared_ptr<ImageBase> img = ImageCache::LoadFile(path,
+            [owner, &path, &cancelled]() {
+                return cancelled || (cancelled = owner->Unwanted(path));
+            });
+        if (img) {
+            owner->m_cache.Insert(path, img);
+            owner->RecordThumb(path, *img);
+        }
+        owner->Finished(path, img, cancelled);
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// -----------------------------------------------------------------------------
+//  Profiler.cpp – lock-free stage event ring and its Chrome trace export
+// -----------------------------------------------------------------------------
+#include "Profiler.h"
+
+#include <wx/file.h>
+#include <wx/log.h>
+#include <wx/stopwatch.h>
+#include <wx/thread.h>
+#include <set>
+
+namespace {
+
+const char* const STAGE_NAMES[Profiler::STAGES] = {
+    "open", "header", "swap", "untile", "decode", "postprocess", "scale", "blit"
+};
+
+// One event.  seq is 2n+1 while event n is written and 2n+2 once it is
+// complete; a reader keeps a copy only if seq read the same, even and for
+// the event it expected, before and after it.
+struct Slot
+{
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> start;       // startUs << 8 | stage
+    std::atomic<uint64_t> info;        // durUs << 32 | thread
+};
+
+Slot                  s_ring[Profiler::RING];   // zero-initialised statics
+std::atomic<uint64_t> s_head;
+std::atomic<uint32_t> s_last[Profiler::STAGES];
+
+const wxStopWatch s_clock;             // started before main()
+
+uint32_t ThreadId()
+{
+    return static_cast<uint32_t>(wxThread::GetCurrentId());
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+void Profiler::Breakdown::Reset()
+{
+    for (int s = 0; s < STAGES; ++s)
+        m_us[s].store(0, std::memory_order_relaxed);
+}
+
+void Profiler::Breakdown::Add(int stage, uint32_t us)
+{
+    if (stage >= 0 && stage < STAGES)
+        m_us[stage].fetch_add(us, std::memory_order_relaxed);
+}
+
+double Profiler::Breakdown::Ms(int stage) const
+{
+    if (stage < 0 || stage >= STAGES) return 0;
+    return m_us[stage].load(std::memory_order_relaxed) / 1000.0;
+}
+
+Profiler::Scope::~Scope()
+{
+    const uint64_t end = NowUs();
+    Record(m_stage, m_start, end);
+    if (m_into) m_into->Add(m_stage, static_cast<uint32_t>(end - m_start));
+}
+
+// -----------------------------------------------------------------------------
+
+uint64_t Profiler::NowUs()
+{
+    return static_cast<uint64_t>(s_clock.TimeInMicro().GetValue());
+}
+
+void Profiler::Record(Stage stage, uint64_t startUs, uint64_t endUs)
+{
+    const uint64_t dur = endUs > startUs ? endUs - startUs : 0;
+    const uint32_t us  = dur > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<uint32_t>(dur);
+    s_last[stage].store(us, std::memory_order_relaxed);
+
+    const uint64_t n = s_head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = s_ring[n & (RING - 1)];
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.start.store(startUs << 8 | uint64_t(stage), std::memory_order_relaxed);
+    slot.info.store(uint64_t(us) << 32 | ThreadId(), std::memory_order_relaxed);
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+}
+
+double Profiler::LastMs(int stage)
+{
+    if (stage < 0 || stage >= STAGES) return 0;
+    return s_last[stage].load(std::memory_order_relaxed) / 1000.0;
+}
+
+void Profiler::Snapshot(std::vector<Event>& out)
+{
+    out.clear();
+    const uint64_t head  = s_head.load(std::memory_order_acquire);
+    const uint64_t first = head > RING ? head - RING : 0;
+    out.reserve(size_t(head - first));
+
+    for (uint64_t n = first; n < head; ++n)
+    {
+        const Slot& slot = s_ring[n & (RING - 1)];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * n + 2) continue;            // being written, or lapped
+        const uint64_t start = slot.start.load(std::memory_order_relaxed);
+        const uint64_t info  = slot.info.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+
+        Event e;
+        e.startUs = start >> 8;
+        e.stage   = int(start & 0xFF);
+        e.durUs   = uint32_t(info >> 32);
+        e.thread  = uint32_t(info);
+        out.push_back(e);
+    }
+}
+
+const char* Profiler::StageName(int stage)
+{
+    return (stage >= 0 && stage < STAGES) ? STAGE_NAMES[stage] : "";
+}
+
+// -----------------------------------------------------------------------------
+//  Chrome trace-event format: complete ("X") events, microsecond timestamps,
+//  one row per thread; the GUI thread is named so it stands out.
+// -----------------------------------------------------------------------------
+bool Profiler::WriteChromeTrace(const wxString& file)
+{
+    std::vector<Event> events;
+    Snapshot(events);
+
+    const uint32_t gui = static_cast<uint32_t>(wxThread::GetMainId());
+    std::set<uint32_t> threads;
+
+    wxString j = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& e = events[i];
+        threads.insert(e.thread);
+        j << "{\"name\":\"" << StageName(e.stage) << "\",\"cat\":\"bctv\",\"ph\":\"X\""
+          << ",\"pid\":1,\"tid\":" << (unsigned long)e.thread
+          << ",\"ts\":" << wxULongLong(e.startUs).ToString()
+          << ",\"dur\":" << (unsigned long)e.durUs << "},\n";
+    }
+    for (std::set<uint32_t>::const_iterator it = threads.begin(); it != threads.end(); ++it)
+        j << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (unsigned long)*it
+          << ",\"args\":{\"name\":\"" << (*it == gui ? "GUI" : "worker") << "\"}},\n";
+    j << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"bctv\"}}\n]}\n";
+
+    wxFile out;
+    const wxScopedCharBuffer utf8 = j.utf8_str();
+    if (!out.Create(file, true) || !out.Write(utf8.data(), utf8.length())) {
+        wxLogError("Cannot write %s", file);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,298 @@
+// -----------------------------------------------------------------------------
+//  RenderThread.cpp – worker that builds the canvas frames
+// -----------------------------------------------------------------------------
+#include "RenderThread.h"
+#include "ImageScale.h"
+#include "BlockPreview.h"
+
+#include <wx/rawbmp.h>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+inline unsigned char toUNorm(float v) {
+    return static_cast<unsigned char>( (v<0.f?0.f:(v>1.f?1.f:v))*255.f + 0.5f );
+}
+
+/* Normal-map rebuild on the scaled frame – same maths as the image classes'
+   ApplyNormal*, but on output pixels so the decoded image stays untouched. */
+void PostProcess(unsigned char* p, size_t count, int mode)
+{
+    for (size_t i = 0; i < count; ++i, p += 4)
+    {
+        float nx;
+        switch (mode) {
+            case 1:  nx = p[2]/127.5f - 1.f;                 break;   // RG
+            case 2:  nx = p[3]/127.5f - 1.f;                 break;   // AG
+            case 3:  nx = (p[3]*p[2]/255.f)/127.5f - 1.f;    break;   // ARG
+            default: return;
+        }
+        const float ny = p[1]/127.5f - 1.f;
+        const float nz = std::sqrt(std::max(0.f, 1.f - nx*nx - ny*ny));
+        if (mode != 1) p[2] = toUNorm((nx + 1.f) * 0.5f);
+        p[0] = toUNorm((nz + 1.f) * 0.5f);
+        p[3] = 255;
+    }
+}
+
+} // anon-ns
+
+RenderThread::RenderThread(wxEvtHandler* sink, int frameEventId, int tileEventId)
+: wxThread(wxTHREAD_JOINABLE),
+  m_sink(sink), m_frameEventId(frameEventId), m_tileEventId(tileEventId),
+  m_wake(m_lock), m_hasJob(false), m_quit(false)
+{
+}
+
+void RenderThread::Submit(const RenderJob& job)
+{
+    wxMutexLocker lock(m_lock);
+    m_job    = job;                 // latest wins – an unstarted job is dropped
+    m_hasJob = true;
+    m_wake.Signal();
+}
+
+void RenderThread::SubmitTiles(const std::vector<RenderJob>& tiles)
+{
+    wxMutexLocker lock(m_lock);
+    m_tiles.assign(tiles.begin(), tiles.end());   // off-screen tiles are dropped
+    if (!m_tiles.empty()) m_wake.Signal();
+}
+
+void RenderThread::Quit()
+{
+    wxMutexLocker lock(m_lock);
+    m_quit = true;
+    m_job  = RenderJob();           // release the image reference early
+    m_tiles.clear();
+    m_wake.Signal();
+}
+
+wxThread::ExitCode RenderThread::Entry()
+{
+    for (;;)
+    {
+        RenderJob job;
+        bool      isFrame;
+        {
+            wxMutexLocker lock(m_lock);
+            while (!m_hasJob && m_tiles.empty() && !m_quit)
+                m_wake.Wait();
+            if (m_quit) break;
+
+            isFrame = m_hasJob;             // whole frames go before tiles
+            if (isFrame) {
+                job      = m_job;
+                m_job    = RenderJob();
+                m_hasJob = false;
+            } else {
+                job = m_tiles.front();
+                m_tiles.pop_front();
+            }
+        }
+
+        if (isFrame) {
+            Buffer* back = ClaimBack();
+            back->serial = job.serial;
+            Render(job, m_preview, back->bgra, back->w, back->h);
+            back->bytes.Set(back->bgra.capacity());
+            back->state.store(BUF_READY, std::memory_order_release);
+
+            wxQueueEvent(m_sink, new wxThreadEvent(wxEVT_THREAD, m_frameEventId));
+        } else {
+            std::shared_ptr<RenderTile> tile(new RenderTile);
+            Render(job, m_preview, tile->bgra, tile->w, tile->h);
+            tile->bytes.Set(tile->bgra.capacity());
+            tile->job = job;
+
+            wxThreadEvent* ev = new wxThreadEvent(wxEVT_THREAD, m_tileEventId);
+            ev->SetPayload(tile);
+            wxQueueEvent(m_sink, ev);
+        }
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+//  Buffer hand-off – the GUI holds at most one buffer (READING), so the other
+//  is FREE or an unconsumed READY frame we are allowed to overwrite.
+// -----------------------------------------------------------------------------
+RenderThread::Buffer* RenderThread::ClaimBack()
+{
+    for (;;)
+    {
+        for (int i = 0; i < 2; ++i) {
+            int expect = BUF_FREE;
+            if (m_buf[i].state.compare_exchange_strong(expect, BUF_WRITING))
+                return &m_buf[i];
+        }
+        for (int i = 0; i < 2; ++i) {
+            int expect = BUF_READY;
+            if (m_buf[i].state.compare_exchange_strong(expect, BUF_WRITING))
+                return &m_buf[i];
+        }
+        wxThread::Yield();                  // GUI was mid-swap, try again
+    }
+}
+
+bool RenderThread::AcquireFrame(wxBitmap& out, unsigned* serial)
+{
+    // newest READY buffer first; the worker may steal one under our feet
+    int order[2] = { 0, 1 };
+    if (m_buf[1].serial > m_buf[0].serial) std::swap(order[0], order[1]);
+
+    Buffer* b = NULL;
+    for (int k = 0; k < 2 && !b; ++k) {
+        int expect = BUF_READY;
+        if (m_buf[order[k]].state.compare_exchange_strong(expect, BUF_READING))
+            b = &m_buf[order[k]];
+    }
+    if (!b) return false;
+
+    const bool ok = ToBitmap(b->w > 0 ? &b->bgra[0] : NULL, b->w, b->h, out);
+    if (ok && serial) *serial = b->serial;
+
+    b->state.store(BUF_FREE, std::memory_order_release);
+    return ok;
+}
+
+bool RenderThread::RenderNow(const RenderJob& job, wxBitmap& out)
+{
+    PooledBytes bgra;
+    Preview preview;
+    int w, h;
+    Render(job, preview, bgra, w, h);
+    return ToBitmap(w > 0 ? &bgra[0] : NULL, w, h, out);
+}
+
+bool RenderThread::ToBitmap(const unsigned char* src, int w, int h, wxBitmap& out)
+{
+    if (!src || w <= 0 || h <= 0) return false;
+    Profiler::Scope timed(Profiler::BLIT);
+
+    // The previous frame's bitmap is reused when nothing else shares it
+    const bool reuse = out.IsOk() && out.GetWidth() == w && out.GetHeight() == h &&
+                       out.GetDepth() == 32 && out.GetRefData()->GetRefCount() == 1;
+    wxBitmap fresh;
+    if (!reuse) {
+        fresh.Create(w, h, 32);
+#if wxCHECK_VERSION(3,1,0)
+        fresh.UseAlpha();
+#else
+        fresh.InitAlpha();
+#endif
+    }
+    wxBitmap& bmp = reuse ? out : fresh;
+    wxAlphaPixelData dst(bmp);
+    if (!dst) return false;
+
+    for (int y = 0; y < h; ++y) {
+        wxAlphaPixelData::Iterator p(dst);
+        p.MoveTo(dst, 0, y);
+        for (int x = 0; x < w; ++x, ++p, src += 4) {
+            p.Blue()  = src[0];
+            p.Green() = src[1];
+            p.Red()   = src[2];
+            p.Alpha() = src[3];
+        }
+    }
+    if (!reuse) out = fresh;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  The actual frame: resample, post-process, channel masks, alpha.
+//
+//  At 1/4 zoom or less a block-compressed image is resampled from its
+//  one-pixel-per-block preview instead, so it never has to be decoded.
+// -----------------------------------------------------------------------------
+void RenderThread::Render(const RenderJob& job, Preview& preview,
+                          PooledBytes& bgra, int& outW, int& outH)
+{
+    outW = outH = 0;
+
+    const ImageBase* img = job.img.get();
+    if (!img || job.w <= 0 || job.h <= 0) return;
+
+    const unsigned char* src = NULL;
+    int orig_w = img->Width(), orig_h = img->Height();
+
+    if (job.zoom <= 0.25 && img->GetBlockFormat() != ImageBase::BLK_NONE)
+    {
+        const bool same = !preview.img.expired() &&
+                          !preview.img.owner_before(job.img) &&
+                          !job.img.owner_before(preview.img) &&
+                          preview.linear == job.filtLinear;
+        if (!same) {
+            Profiler::Scope timed(Profiler::SCALE);
+            preview.img    = job.img;
+            preview.linear = job.filtLinear;
+            if (!BlockPreview::Build(img->Blocks(), orig_w, orig_h,
+                                     img->GetBlockFormat(), job.filtLinear,
+                                     preview.bgra, preview.w, preview.h))
+                preview.w = preview.h = 0;
+            preview.bytes.Set(preview.bgra.capacity());
+        }
+        if (preview.w > 0) {
+            src    = &preview.bgra[0];
+            orig_w = preview.w;
+            orig_h = preview.h;
+        }
+    }
+
+    if (!src) {
+        if (!img->EnsurePixels()) return;       // timed as the image's DECODE
+        src = img->Data();
+    }
+    if (!src) return;
+
+    // whole frame unless a tile rectangle was given
+    const int rx = job.rw ? job.rx : 0, ry = job.rw ? job.ry : 0;
+    const int rw = job.rw ? job.rw : job.w;
+    const int rh = job.rw ? job.rh : job.h;
+
+    const size_t count = size_t(rw) * rh;
+    bgra.resize(count * 4);
+    unsigned char* out = &bgra[0];
+
+    // Shrinking with the filter enabled averages every covered texel (in
+    // linear light if requested); everything else stays nearest-neighbour.
+    {
+        Profiler::Scope timed(Profiler::SCALE);
+        if (job.zoom < 1.0 && job.filtShr)
+            ImageScale::BoxShrinkRegion(src, orig_w, orig_h, orig_w * 4,
+                                        out, rw * 4, job.w, job.h,
+                                        rx, ry, rw, rh, job.filtLinear);
+        else
+            ImageScale::NearestRegion(src, orig_w, orig_h, orig_w * 4,
+                                      out, rw * 4, job.w, job.h, rx, ry, rw, rh);
+    }
+
+    Profiler::Scope timed(Profiler::POSTPROCESS);   // normal rebuild and masks
+    if (job.pp) PostProcess(out, count, job.pp);
+
+    for (size_t i = 0; i < count; ++i, out += 4)
+    {
+        unsigned char b = out[0], g = out[1], r = out[2], a = out[3];
+
+        // Apply channel toggles
+        if (!job.showB) b = 0;
+        if (!job.showG) g = 0;
+        if (!job.showR) r = 0;
+
+        // Handle alpha premultiplication
+        if (job.showA) {
+            r = static_cast<unsigned char>((r * a) / 255);
+            g = static_cast<unsigned char>((g * a) / 255);
+            b = static_cast<unsigned char>((b * a) / 255);
+        } else {
+            a = 255;
+        }
+
+        out[0] = b; out[1] = g; out[2] = r; out[3] = a;
+    }
+
+    outW = rw;
+    outH = rh;
+}
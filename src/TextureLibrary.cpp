@@ -0,0 +1,489 @@
+// -----------------------------------------------------------------------------
+//  TextureLibrary.cpp – header index of whole texture trees
+//
+//  File layout (little-endian):
+//      "BCTVLIBR" u32 version u32 count u32 check u32 0   – 24-byte header
+//      record*                                           – count of them
+//  record:
+//      u16 shared | u16 suffixLen | UTF-8 suffix | RecordBody (40 bytes)
+//  shared is the number of leading path bytes equal to the previous record's
+//  path, so the folders of a sorted tree are stored about once.  check is
+//  FNV-1a over all records.
+// -----------------------------------------------------------------------------
+#include "TextureLibrary.h"
+#include "ImageProbe.h"
+#include "ThumbCache.h"
+#include "FileSource.h"
+
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/stdpaths.h>
+#include <wx/thread.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+namespace {
+
+const char     FILE_MAGIC[8] = { 'B','C','T','V','L','I','B','R' };
+const uint32_t FILE_VERSION  = 1;
+const size_t   FILE_HEAD     = 24;
+const int      POLL_MS       = 100;
+
+enum { F_BIGENDIAN = 1 };
+
+struct RecordBody
+{
+    uint64_t fileSize;
+    int64_t  mtime;
+    uint32_t width, height;
+    uint32_t format;
+    uint32_t hash;
+    uint16_t mips;
+    uint8_t  kind;
+    uint8_t  flags;
+    uint32_t reserved;
+};
+static_assert(sizeof(RecordBody) == 40, "library record body must stay 40 bytes");
+
+uint32_t fnv1a(const unsigned char* p, size_t n, uint32_t h = 2166136261u)
+{
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+struct PathHash {
+    size_t operator()(const wxString& s) const {
+        return std::hash<std::wstring>()(s.ToStdWstring());
+    }
+};
+typedef std::unordered_map<wxString, const TextureLibrary::Entry*, PathHash> EntryMap;
+
+bool IsUnder(const wxString& path, const wxString& root)
+{
+    if (path.length() <= root.length() || !path.StartsWith(root)) return false;
+    return wxFileName::IsPathSeparator(root.Last()) ||       // a drive or "/"
+           wxFileName::IsPathSeparator(path[root.length()]);
+}
+
+// -----------------------------------------------------------------------------
+//  Walk – the shared folder queue of one Index() call
+// -----------------------------------------------------------------------------
+class Walk
+{
+public:
+    explicit Walk(const EntryMap& known)
+    : m_known(known), m_wake(m_lock), m_busy(0), m_stop(false),
+      m_dirs(0), m_files(0), m_probed(0) {}
+
+    void Push(const wxString& dir) {
+        wxMutexLocker lock(m_lock);
+        m_queue.push_back(dir.Clone());
+    }
+
+    // Worker body: folders until the queue is empty and nobody can refill it
+    void Run()
+    {
+        wxLogNull quiet;                // unreadable folders are skipped
+        for (;;)
+        {
+            wxString dir;
+            {
+                wxMutexLocker lock(m_lock);
+                while (m_queue.empty() && m_busy > 0 && !m_stop)
+                    m_wake.Wait();
+                if (m_stop || m_queue.empty()) {
+                    m_wake.Broadcast();
+                    return;
+                }
+                dir = m_queue.front();
+                m_queue.pop_front();
+                ++m_busy;
+            }
+
+            std::vector<wxString> subdirs;
+            std::vector<TextureLibrary::Entry> found;
+            ScanDir(dir, subdirs, found);
+
+            wxMutexLocker lock(m_lock);
+            for (size_t i = 0; i < subdirs.size(); ++i)
+                m_queue.push_back(subdirs[i]);
+            m_found.insert(m_found.end(), found.begin(), found.end());
+            --m_busy;
+            ++m_dirs;
+            m_wake.Broadcast();
+        }
+    }
+
+    // Caller side: true once the walk is over, after waiting at most ms
+    bool WaitDone(int ms)
+    {
+        wxMutexLocker lock(m_lock);
+        if (!Done()) m_wake.WaitTimeout(ms);
+        return Done();
+    }
+
+    void Stop() {
+        wxMutexLocker lock(m_lock);
+        m_stop = true;
+        m_wake.Broadcast();
+    }
+
+    TextureLibrary::Progress Counts() const {
+        TextureLibrary::Progress p = { m_dirs.load(), m_files.load(), m_probed.load() };
+        return p;
+    }
+
+    std::vector<TextureLibrary::Entry>& Found() { return m_found; }
+
+private:
+    bool Done() const { return m_stop || (m_queue.empty() && m_busy == 0); }
+
+    void ScanDir(const wxString& dir, std::vector<wxString>& subdirs,
+                 std::vector<TextureLibrary::Entry>& found)
+    {
+        wxDir d(dir);
+        if (!d.IsOpened()) return;
+
+        wxString name;
+        for (bool cont = d.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_HIDDEN | wxDIR_NO_FOLLOW);
+             cont; cont = d.GetNext(&name))
+            subdirs.push_back(dir + wxFILE_SEP_PATH + name);
+
+        for (bool cont = d.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN);
+             cont && !m_stop; cont = d.GetNext(&name))
+        {
+            const wxString path = dir + wxFILE_SEP_PATH + name;
+            if (!FileSource::IsArchive(path)) {
+                AddFile(path, found);
+                continue;
+            }
+            // archive members are indexed like files in a folder
+            std::vector<wxString> members;
+            FileSource::ListArchive(path, members);
+            for (size_t i = 0; i < members.size() && !m_stop; ++i)
+                AddFile(members[i], found);
+        }
+    }
+
+    void AddFile(const wxString& path, std::vector<TextureLibrary::Entry>& found)
+    {
+        const wxString ext = path.AfterLast('.').Lower();
+        if (ext != "dds" && ext != "bct") return;
+
+        TextureLibrary::Entry e;
+        e.path = path;
+        if (!ThumbCache::Stat(e.path, e.size, e.mtime)) return;
+
+        EntryMap::const_iterator old = m_known.find(e.path);
+        if (old != m_known.end() &&
+            old->second->size == e.size && old->second->mtime == e.mtime) {
+            e.meta = old->second->meta;
+        } else {
+            ++m_probed;
+            if (!ImageProbe::Probe(e.path, e.meta)) return;
+        }
+
+        // same rule as the browse list: the extension has to agree
+        if (e.meta.kind != (ext == "dds" ? ImageMeta::KIND_DDS : ImageMeta::KIND_BCT))
+            return;
+        found.push_back(e);
+        ++m_files;
+    }
+
+    const EntryMap&      m_known;       // previous entries under the root
+    mutable wxMutex      m_lock;        // guards the queue, m_busy, m_found
+    wxCondition          m_wake;
+    std::deque<wxString> m_queue;
+    int                  m_busy;        // folders being read right now
+    std::atomic<bool>    m_stop;
+    std::vector<TextureLibrary::Entry> m_found;
+
+    std::atomic<size_t>  m_dirs, m_files, m_probed;
+};
+
+class WalkThread : public wxThread
+{
+public:
+    explicit WalkThread(Walk& walk) : wxThread(wxTHREAD_JOINABLE), m_walk(walk) {}
+protected:
+    ExitCode Entry() override { m_walk.Run(); return 0; }
+private:
+    Walk& m_walk;
+};
+
+bool PathLess(const TextureLibrary::Entry& a, const TextureLibrary::Entry& b)
+{
+    return a.path.Cmp(b.path) < 0;
+}
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+wxString TextureLibrary::DefaultFile()
+{
+    const wxString dir = wxStandardPaths::Get().GetUserLocalDataDir();
+    if (!wxFileName::DirExists(dir))
+        wxFileName::Mkdir(dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    return dir + wxFILE_SEP_PATH + "library.index";
+}
+
+int TextureLibrary::DefaultJobs()
+{
+    const int cpus = std::max(1, wxThread::GetCPUCount());
+    return std::min<int>(MAX_JOBS, std::max(4, cpus * 2));
+}
+
+wxString TextureLibrary::NormalizeRoot(const wxString& root)
+{
+    wxFileName fn = wxFileName::DirName(root);
+    fn.MakeAbsolute();
+    wxString path = fn.GetPath();
+    while (path.length() > 1 && wxFileName::IsPathSeparator(path.Last()))
+        path.RemoveLast();
+    return path;
+}
+
+bool TextureLibrary::Index(const wxString& rootIn, int jobs,
+                           const ProgressFn& progress, const CancelFn& cancelled)
+{
+    const wxString root = NormalizeRoot(rootIn);
+    if (!wxFileName::DirExists(root)) {
+        wxLogError("Folder not found: %s", root);
+        return false;
+    }
+
+    EntryMap known;
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        if (IsUnder(m_entries[i].path, root))
+            known[m_entries[i].path] = &m_entries[i];
+
+    Walk walk(known);
+    walk.Push(root);
+
+    std::vector<WalkThread*> threads;
+    const int count = std::min<int>(MAX_JOBS, jobs > 0 ? jobs : DefaultJobs());
+    for (int i = 0; i < count; ++i) {
+        WalkThread* t = new WalkThread(walk);
+        if (t->Run() != wxTHREAD_NO_ERROR) {
+            delete t;
+            break;
+        }
+        threads.push_back(t);
+    }
+
+    bool stopped = false;
+    if (threads.empty()) {
+        walk.Run();                     // no thread: walk inline
+    } else {
+        while (!walk.WaitDone(POLL_MS)) {
+            if (progress) progress(walk.Counts());
+            if (cancelled && cancelled()) {
+                walk.Stop();
+                stopped = true;
+            }
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i]->Wait();
+            delete threads[i];
+        }
+    }
+    if (stopped) return false;
+    if (progress) progress(walk.Counts());
+
+    std::vector<Entry>& found = walk.Found();
+    std::vector<Entry> merged;
+    merged.reserve(m_entries.size() - known.size() + found.size());
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        if (!IsUnder(m_entries[i].path, root))
+            merged.push_back(m_entries[i]);
+    merged.insert(merged.end(), found.begin(), found.end());
+    std::sort(merged.begin(), merged.end(), PathLess);
+    m_entries.swap(merged);
+    return true;
+}
+
+void TextureLibrary::Find(const TextureQuery& query, std::vector<const Entry*>& out) const
+{
+    out.clear();
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        if (query.Matches(m_entries[i].path, m_entries[i].meta))
+            out.push_back(&m_entries[i]);
+
+    if (query.Sorted())
+        std::stable_sort(out.begin(), out.end(), [&query](const Entry* a, const Entry* b) {
+            return query.Less(a->path, a->meta, b->path, b->meta);
+        });
+}
+
+// -----------------------------------------------------------------------------
+//  On-disk form
+// -----------------------------------------------------------------------------
+bool TextureLibrary::Save(const wxString& file) const
+{
+    std::vector<unsigned char> buf(FILE_HEAD);
+    std::string prev;
+    uint32_t    records = 0;           // the header counts what is written
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& e = m_entries[i];
+        const wxScopedCharBuffer utf8 = e.path.utf8_str();
+        const std::string path(utf8.data(), utf8.length());
+
+        size_t shared = 0;
+        const size_t limit = std::min<size_t>(std::min(prev.size(), path.size()), 0xFFFF);
+        while (shared < limit && prev[shared] == path[shared]) ++shared;
+        const size_t suffix = path.size() - shared;
+        if (suffix > 0xFFFF) continue;  // no real path is this long
+
+        RecordBody body;
+        std::memset(&body, 0, sizeof(body));
+        body.fileSize = e.size;
+        body.mtime    = e.mtime;
+        body.width    = uint32_t(e.meta.width);
+        body.height   = uint32_t(e.meta.height);
+        body.format   = e.meta.format;
+        body.hash     = e.meta.hash;
+        body.mips     = uint16_t(e.meta.mips);
+        body.kind     = uint8_t(e.meta.kind);
+        body.flags    = e.meta.bigEndian ? F_BIGENDIAN : 0;
+
+        const uint16_t lens[2] = { uint16_t(shared), uint16_t(suffix) };
+        const size_t at = buf.size();
+        buf.resize(at + sizeof(lens) + suffix + sizeof(body));
+        std::memcpy(&buf[at], lens, sizeof(lens));
+        std::memcpy(&buf[at + sizeof(lens)], path.data() + shared, suffix);
+        std::memcpy(&buf[at + sizeof(lens) + suffix], &body, sizeof(body));
+        prev = path;
+        ++records;
+    }
+
+    const uint32_t head[4] = {
+        FILE_VERSION, records,
+        fnv1a(buf.data() + FILE_HEAD, buf.size() - FILE_HEAD), 0
+    };
+    std::memcpy(&buf[0], FILE_MAGIC, sizeof(FILE_MAGIC));
+    std::memcpy(&buf[8], head, sizeof(head));
+
+    // written aside and renamed over, so a crash never leaves half an index
+    const wxString tmp = file + ".tmp";
+    {
+        wxFile out;
+        if (!out.Create(tmp, true) || out.Write(buf.data(), buf.size()) != buf.size()) {
+            wxLogError("Cannot write library index %s", tmp);
+            return false;
+        }
+    }
+    if (!wxRenameFile(tmp, file, true)) {
+        wxLogError("Cannot replace library index %s", file);
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  LibraryIndexer
+// -----------------------------------------------------------------------------
+LibraryIndexer::LibraryIndexer(wxEvtHandler* sink, int eventId,
+                               const std::shared_ptr<const TextureLibrary>& base,
+                               const wxString& root, const wxString& file)
+: wxThread(wxTHREAD_JOINABLE), m_sink(sink), m_eventId(eventId), m_base(base),
+  m_root(root.Clone()), m_file(file.Clone()), m_cancel(false)
+{
+}
+
+void LibraryIndexer::Post(const TextureLibrary::Progress& counts, bool done,
+                          const std::shared_ptr<TextureLibrary>& library)
+{
+    std::shared_ptr<LibraryProgress> p(new LibraryProgress);
+    p->counts  = counts;
+    p->done    = done;
+    p->library = library;
+
+    wxThreadEvent* ev = new wxThreadEvent(wxEVT_THREAD, m_eventId);
+    ev->SetPayload(p);
+    wxQueueEvent(m_sink, ev);
+}
+
+wxThread::ExitCode LibraryIndexer::Entry()
+{
+    std::shared_ptr<TextureLibrary> lib(m_base ? new TextureLibrary(*m_base)
+                                               : new TextureLibrary);
+    TextureLibrary::Progress last = { 0, 0, 0 };
+    LibraryIndexer* self = this;
+
+    const bool ok = lib->Index(m_root, 0,
+        [self, &last](const TextureLibrary::Progress& p) {
+            last = p;
+            self->Post(p, false, std::shared_ptr<TextureLibrary>());
+        },
+        [self]() { return self->m_cancel.load(); });
+
+    if (!ok || !lib->Save(m_file)) lib.reset();
+    Post(last, true, lib);
+    return 0;
+}
+
+bool TextureLibrary::Load(const wxString& file)
+{
+    m_entries.clear();
+
+    wxLogNull quiet;                    // a missing index is simply empty
+    wxFile in(file);
+    if (!in.IsOpened()) return false;
+    const wxFileOffset len = in.Length();
+    if (len < wxFileOffset(FILE_HEAD)) return false;
+
+    std::vector<unsigned char> buf(static_cast<size_t>(len));
+    if (in.Read(buf.data(), buf.size()) != ssize_t(buf.size())) return false;
+
+    uint32_t head[4];
+    std::memcpy(head, &buf[8], sizeof(head));
+    if (std::memcmp(&buf[0], FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+        head[0] != FILE_VERSION ||
+        head[2] != fnv1a(buf.data() + FILE_HEAD, buf.size() - FILE_HEAD))
+        return false;
+
+    std::vector<Entry> entries;
+    entries.reserve(head[1]);
+    std::string path;
+    size_t at = FILE_HEAD;
+    for (uint32_t n = 0; n < head[1]; ++n)
+    {
+        uint16_t lens[2];
+        if (buf.size() - at < sizeof(lens)) return false;
+        std::memcpy(lens, &buf[at], sizeof(lens));
+        at += sizeof(lens);
+        if (lens[0] > path.size() || buf.size() - at < lens[1] + sizeof(RecordBody))
+            return false;
+
+        path.resize(lens[0]);
+        path.append(reinterpret_cast<const char*>(&buf[at]), lens[1]);
+        at += lens[1];
+
+        RecordBody body;
+        std::memcpy(&body, &buf[at], sizeof(body));
+        at += sizeof(body);
+
+        Entry e;
+        e.path           = wxString::FromUTF8(path.data(), path.size());
+        e.size           = body.fileSize;
+        e.mtime          = body.mtime;
+        e.meta.kind      = body.kind;
+        e.meta.width     = int(body.width);
+        e.meta.height    = int(body.height);
+        e.meta.mips      = body.mips;
+        e.meta.format    = body.format;
+        e.meta.hash      = body.hash;
+        e.meta.bigEndian = (body.flags & F_BIGENDIAN) != 0;
+        entries.push_back(e);
+    }
+    m_entries.swap(entries);
+    return true;
+}
@@ -0,0 +1,132 @@
+// -----------------------------------------------------------------------------
+//  TextureQuery.cpp – sort order and filter for the browse list
+// -----------------------------------------------------------------------------
+#include "TextureQuery.h"
+#include "ImageProbe.h"
+
+#include <wx/filename.h>
+#include <wx/filefn.h>
+#include <wx/tokenzr.h>
+#include <algorithm>
+
+bool TextureQuery::Matches(const wxString& path, const ImageMeta& meta) const
+{
+    if (!Filtered()) return true;
+    if (meta.kind == ImageMeta::KIND_NONE) return false;
+
+    const int side = std::max(meta.width, meta.height);
+    if (!format.IsEmpty() && ImageProbe::FormatName(meta) != format) return false;
+    if (minSide > 0 && side < minSide)                                 return false;
+    if (maxSide > 0 && side > maxSide)                                 return false;
+    if (minMips > 0 && meta.mips < minMips)                            return false;
+    if (maxMips > 0 && meta.mips > maxMips)                            return false;
+    if (minBytes > 0 && ImageProbe::StoredBytes(meta) < minBytes)      return false;
+    if (endian == ENDIAN_LITTLE && meta.bigEndian)                     return false;
+    if (endian == ENDIAN_BIG && !meta.bigEndian)                       return false;
+
+    if (!name.IsEmpty()) {
+        const bool whole = name.find_first_of("/\\") != wxString::npos;
+        const wxString subject = whole ? path : wxFileName(path).GetFullName();
+        if (!wxMatchWild(name.Lower(), subject.Lower(), false)) return false;
+    }
+    return true;
+}
+
+namespace {
+
+bool ParseCount(const wxString& s, uint64_t& out)
+{
+    wxString num = s;
+    uint64_t scale = 1;
+    const wxChar unit = s.IsEmpty() ? wxChar(0) : wxChar(wxToupper(s.Last()));
+    if (unit == 'K' || unit == 'M' || unit == 'G') {
+        scale = (unit == 'K') ? 1u << 10 : (unit == 'M') ? 1u << 20 : 1u << 30;
+        num.RemoveLast();
+    }
+    unsigned long long v;
+    if (!num.ToULongLong(&v)) return false;
+    out = v * scale;
+    return true;
+}
+
+} // anon-ns
+
+bool TextureQuery::Parse(const wxString& text, wxString* error)
+{
+    *this = TextureQuery();
+    wxStringTokenizer tok(text, " \t", wxTOKEN_STRTOK);
+    while (tok.HasMoreTokens())
+    {
+        const wxString token = tok.GetNextToken();
+        const wxString key   = token.BeforeFirst(':').Lower();
+        const wxString value = token.AfterFirst(':');
+        uint64_t n = 0, m = 0;
+        bool ok = true;
+
+        if (!token.Contains(":")) {
+            if (key == "desc") descending = true;
+            else               name = "*" + token + "*";
+        } else if (key == "format") {
+            format = value.Upper();
+        } else if (key == "min") {
+            ok = ParseCount(value, n);  minSide = int(n);
+        } else if (key == "max") {
+            ok = ParseCount(value, n);  maxSide = int(n);
+        } else if (key == "mips") {
+            ok = ParseCount(value.BeforeFirst('-'), n);
+            m  = n;
+            if (ok && value.Contains("-")) ok = ParseCount(value.AfterFirst('-'), m);
+            minMips = int(n);
+            maxMips = int(m);
+        } else if (key == "mem") {
+            ok = ParseCount(value, minBytes);
+        } else if (key == "platform") {
+            const wxString v = value.Lower();
+            ok = (v == "pc" || v == "x360" || v == "xbox360");
+            endian = (v == "pc") ? ENDIAN_LITTLE : ENDIAN_BIG;
+        } else if (key == "name") {
+            name = value;
+        } else if (key == "sort") {
+            const wxString v = value.Lower();
+            sort = (v == "name")   ? SORT_NAME   : (v == "dims") ? SORT_DIMENSIONS :
+                   (v == "format") ? SORT_FORMAT : (v == "mem")  ? SORT_BYTES : -1;
+            ok = (sort >= 0);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            if (error) *error = wxString::Format("Bad query term '%s'", token);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextureQuery::Less(const wxString& pathA, const ImageMeta& a,
+                        const wxString& pathB, const ImageMeta& b) const
+{
+    int c = 0;
+    switch (sort) {
+        case SORT_DIMENSIONS: {
+            const int64_t pa = int64_t(a.width) * a.height, pb = int64_t(b.width) * b.height;
+            c = (pa < pb) ? -1 : (pa > pb) ? 1 : (a.width < b.width) ? -1 : (a.width > b.width);
+            break;
+        }
+        case SORT_FORMAT:
+            c = ImageProbe::FormatName(a).Cmp(ImageProbe::FormatName(b));
+            break;
+        case SORT_BYTES: {
+            const uint64_t ba = ImageProbe::StoredBytes(a), bb = ImageProbe::StoredBytes(b);
+            c = (ba < bb) ? -1 : (ba > bb) ? 1 : 0;
+            break;
+        }
+        default:
+            break;
+    }
+    if (c == 0) {
+        c = wxFileName(pathA).GetFullName().CmpNoCase(wxFileName(pathB).GetFullName());
+        if (c == 0) c = pathA.Cmp(pathB);
+    }
+    return descending ? c > 0 : c < 0;
+}
@@ -0,0 +1,470 @@
+// -----------------------------------------------------------------------------
+//  ThumbCache.cpp – persistent header / thumbnail cache across sessions
+//
+//  File layout (little-endian):
+//      "BCTVTHMB" u32 version u32 0               – 16-byte file header
+//      record*                                    – 8-byte aligned
+//  record:
+//      RecordHead (56 bytes) | UTF-8 path | thumb BGRA | pad to 8
+// -----------------------------------------------------------------------------
+#include "ThumbCache.h"
+#include "BlockPreview.h"
+#include "ImageScale.h"
+#include "FileSource.h"
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/stdpaths.h>
+#include <wx/log.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char     FILE_MAGIC[8] = { 'B','C','T','V','T','H','M','B' };
+const uint32_t FILE_VERSION  = 1;
+const size_t   FILE_HEAD     = 16;
+const uint32_t REC_MAGIC     = 0x43455254;          // 'TREC'
+const size_t   FLUSH_AT      = 256 * 1024;
+const uint64_t WINDOW        = 4 << 20;             // mapped at a time
+
+enum { F_META = 1, F_THUMB = 2, F_BIGENDIAN = 4 };
+
+struct RecordHead
+{
+    uint32_t magic;
+    uint32_t length;            // whole record, padded
+    uint64_t fileSize;
+    int64_t  mtime;
+    uint32_t width, height;
+    uint32_t format;
+    uint32_t hash;
+    uint16_t mips;
+    uint8_t  kind;
+    uint8_t  flags;
+    uint16_t pathLen;
+    uint16_t thumbW, thumbH;
+    uint16_t reserved;
+    uint32_t check;             // FNV-1a of the record with this field zero
+};
+static_assert(sizeof(RecordHead) == 56, "cache record head must stay 56 bytes");
+
+uint32_t fnv1a(const unsigned char* p, size_t n, uint32_t h = 2166136261u)
+{
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+uint32_t recordCheck(const unsigned char* rec, size_t len)
+{
+    RecordHead head;
+    std::memcpy(&head, rec, sizeof(head));
+    head.check = 0;
+    const uint32_t h = fnv1a(reinterpret_cast<const unsigned char*>(&head), sizeof(head));
+    return fnv1a(rec + sizeof(head), len - sizeof(head), h);
+}
+
+typedef std::shared_ptr<const FileMapping::View> Window;
+
+bool covers(const Window& w, uint64_t at, uint64_t n)
+{
+    return w && at >= w->Offset() && n <= w->Size() && at - w->Offset() <= w->Size() - n;
+}
+
+// Slides w along the file so it holds [at, at + n); NULL if it cannot
+const unsigned char* windowAt(const FileMapping& file, Window& w, uint64_t at, uint64_t n)
+{
+    if (!covers(w, at, n)) {
+        w = file.Map(at, std::max(WINDOW, n));
+        if (!covers(w, at, n)) return NULL;
+    }
+    return w->Data() + (at - w->Offset());
+}
+
+} // anon-ns
+
+ThumbCache::ThumbCache()
+: m_ownedBytes(0), m_charge(MemoryBudget::THUMBS), m_end(0)
+{
+}
+
+ThumbCache::~ThumbCache()
+{
+    Flush();
+    m_out.Close();
+}
+
+wxString ThumbCache::DefaultFile()
+{
+    const wxString dir = wxStandardPaths::Get().GetUserLocalDataDir();
+    if (!wxFileName::DirExists(dir))
+        wxFileName::Mkdir(dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    return dir + wxFILE_SEP_PATH + "thumbs.cache";
+}
+
+bool ThumbCache::Stat(const wxString& path, uint64_t& size, int64_t& mtime)
+{
+    return FileSource::Stat(path, size, mtime);     // archive members too
+}
+
+// -----------------------------------------------------------------------------
+//  Open: index what is there, compact it if due, then append after the last
+//  good record
+// -----------------------------------------------------------------------------
+bool ThumbCache::Open(const wxString& cacheFile)
+{
+    wxMutexLocker lock(m_lock);
+    wxLogNull quiet;
+
+    m_path = cacheFile;
+    uint64_t validEnd = 0;
+    if (m_file.Open(cacheFile)) {
+        Window head = m_file.Map(0, FILE_HEAD);
+        uint32_t ver = 0;
+        if (covers(head, 0, FILE_HEAD)) std::memcpy(&ver, head->Data() + 8, sizeof(ver));
+        if (ver == FILE_VERSION && std::memcmp(head->Data(), FILE_MAGIC, sizeof(FILE_MAGIC)) == 0) {
+            validEnd = Scan();          // end of the last good record
+            if (!validEnd) {            // there, but no room to read it: leave it be
+                m_index.clear();
+                m_file.Close();
+                return false;
+            }
+        }
+    }
+    if (!validEnd) {                    // missing, foreign or old: start over
+        m_file.Close();
+        m_index.clear();
+    } else {
+        uint64_t live = 0;
+        for (auto it = m_index.begin(); it != m_index.end(); ++it)
+            live += it->second.recLen;
+        const uint64_t superseded = validEnd - FILE_HEAD - live;
+        if ((superseded >= COMPACT_MIN && superseded * 2 >= validEnd) || validEnd > MAX_FILE) {
+            const uint64_t end = Compact(cacheFile, live);
+            if (end) validEnd = end;
+        }
+    }
+
+    if (!m_out.Open(cacheFile, validEnd ? wxFile::read_write : wxFile::write))
+        return false;
+
+    if (validEnd) {
+        m_out.Seek(wxFileOffset(validEnd));   // overwrite a torn tail, if any
+        m_end = validEnd;
+    } else {
+        unsigned char head[FILE_HEAD] = { 0 };
+        std::memcpy(head, FILE_MAGIC, sizeof(FILE_MAGIC));
+        std::memcpy(head + 8, &FILE_VERSION, sizeof(FILE_VERSION));
+        m_out.Write(head, sizeof(head));
+        m_end = FILE_HEAD;
+    }
+    return true;
+}
+
+uint64_t ThumbCache::Scan()
+{
+    const uint64_t len = m_file.Length();
+    Window w;
+    uint64_t off = FILE_HEAD;
+    while (off + sizeof(RecordHead) <= len)
+    {
+        const unsigned char* at = windowAt(m_file, w, off, sizeof(RecordHead));
+        if (!at) return 0;
+        RecordHead h;
+        std::memcpy(&h, at, sizeof(h));
+
+        const size_t thumbBytes = size_t(h.thumbW) * h.thumbH * 4;
+        if (h.magic != REC_MAGIC || (h.length & 7) ||
+            h.length < sizeof(h) + h.pathLen + thumbBytes ||
+            h.length > len - off)
+            break;                      // torn or garbage: stop here
+
+        const unsigned char* rec = windowAt(m_file, w, off, h.length);
+        if (!rec) return 0;
+        if (recordCheck(rec, h.length) != h.check)
+            break;
+
+        Slot s;
+        s.size           = h.fileSize;
+        s.mtime          = h.mtime;
+        s.meta.kind      = h.kind;
+        s.meta.width     = h.width;
+        s.meta.height    = h.height;
+        s.meta.mips      = h.mips;
+        s.meta.format    = h.format;
+        s.meta.hash      = h.hash;
+        s.meta.bigEndian = (h.flags & F_BIGENDIAN) != 0;
+        s.thumbAt        = (h.flags & F_THUMB) ? off + sizeof(h) + h.pathLen : 0;
+        s.tw             = s.thumbAt ? h.thumbW : 0;
+        s.th             = s.thumbAt ? h.thumbH : 0;
+        s.recAt          = off;
+        s.recLen         = h.length;
+
+        const wxString path = wxString::FromUTF8(
+            reinterpret_cast<const char*>(rec + sizeof(h)), h.pathLen);
+        m_index[path] = s;              // later records win
+        off += h.length;
+    }
+    return off;
+}
+
+// The live records, oldest first, are copied verbatim to a file aside that
+// is renamed over the log, as TextureLibrary::Save does
+uint64_t ThumbCache::Compact(const wxString& cacheFile, uint64_t liveBytes)
+{
+    typedef decltype(m_index.begin()) Entry;
+    std::vector<Entry> live;
+    live.reserve(m_index.size());
+    for (auto it = m_index.begin(); it != m_index.end(); ++it)
+        if (it->second.recLen) live.push_back(it);
+    std::sort(live.begin(), live.end(), [](const Entry& a, const Entry& b) {
+        return a->second.recAt < b->second.recAt;
+    });
+
+    // Over the cap, the oldest go first, down to 3/4 of it
+    size_t first = 0;
+    if (FILE_HEAD + liveBytes > MAX_FILE)
+        while (first < live.size() && FILE_HEAD + liveBytes > uint64_t(MAX_FILE) / 4 * 3)
+            liveBytes -= live[first++]->second.recLen;
+
+    const wxString tmp = cacheFile + ".tmp";
+    std::vector<uint64_t> moved(live.size(), 0);
+    uint64_t end = FILE_HEAD;
+    {
+        wxFile out;
+        if (!out.Create(tmp, true)) return 0;
+
+        unsigned char head[FILE_HEAD] = { 0 };
+        std::memcpy(head, FILE_MAGIC, sizeof(FILE_MAGIC));
+        std::memcpy(head + 8, &FILE_VERSION, sizeof(FILE_VERSION));
+        bool ok = out.Write(head, sizeof(head)) == sizeof(head);
+
+        Window w;
+        for (size_t i = first; i < live.size() && ok; ++i) {
+            const Slot& s = live[i]->second;
+            const unsigned char* rec = windowAt(m_file, w, s.recAt, s.recLen);
+            ok = rec && out.Write(rec, s.recLen) == s.recLen;
+            moved[i] = end;
+            end += s.recLen;
+        }
+        if (!ok || !out.Close()) {
+            out.Close();
+            wxRemoveFile(tmp);
+            return 0;
+        }
+    }
+
+    // Windows will not rename over a mapped file
+    m_window.reset();
+    m_file.Close();
+    if (!wxRenameFile(tmp, cacheFile, true)) {
+        wxRemoveFile(tmp);
+        m_file.Open(cacheFile);
+        return 0;
+    }
+
+    for (size_t i = first; i < live.size(); ++i) {
+        Slot& s = live[i]->second;
+        if (s.thumbAt) s.thumbAt = moved[i] + (s.thumbAt - s.recAt);
+        s.recAt = moved[i];
+    }
+    for (size_t i = 0; i < first; ++i)
+        m_index.erase(live[i]);
+
+    m_file.Open(cacheFile);
+    return end;
+}
+
+const unsigned char* ThumbCache::ThumbBytes(const Slot& s) const
+{
+    if (!s.owned.empty()) return &s.owned[0];
+    if (!s.thumbAt) return NULL;
+    return windowAt(m_file, m_window, s.thumbAt, uint64_t(s.tw) * s.th * 4);
+}
+
+// -----------------------------------------------------------------------------
+//  Lookups
+// -----------------------------------------------------------------------------
+bool ThumbCache::Lookup(const wxString& path, uint64_t size, int64_t mtime,
+                        ImageMeta& meta) const
+{
+    wxMutexLocker lock(m_lock);
+    auto it = m_index.find(path);
+    if (it == m_index.end() || it->second.size != size || it->second.mtime != mtime)
+        return false;
+    meta = it->second.meta;
+    return true;
+}
+
+bool ThumbCache::Thumb(const wxString& path, uint64_t size, int64_t mtime,
+                       std::vector<unsigned char>& bgra, int& w, int& h) const
+{
+    wxMutexLocker lock(m_lock);
+    auto it = m_index.find(path);
+    if (it == m_index.end() || it->second.size != size ||
+        it->second.mtime != mtime || !it->second.HasThumb())
+        return false;
+
+    const Slot& s = it->second;
+    const unsigned char* thumb = ThumbBytes(s);
+    if (!thumb) return false;
+    bgra.assign(thumb, thumb + size_t(s.tw) * s.th * 4);
+    w = s.tw;
+    h = s.th;
+    return true;
+}
+
+bool ThumbCache::HasThumb(const wxString& path, uint64_t size, int64_t mtime) const
+{
+    wxMutexLocker lock(m_lock);
+    auto it = m_index.find(path);
+    return it != m_index.end() && it->second.size == size &&
+           it->second.mtime == mtime && it->second.HasThumb();
+}
+
+// -----------------------------------------------------------------------------
+//  Appends
+// -----------------------------------------------------------------------------
+void ThumbCache::Put(const wxString& path, uint64_t size, int64_t mtime,
+                     const ImageMeta& meta, const unsigned char* thumb, int tw, int th)
+{
+    if (!thumb || tw <= 0 || th <= 0 || tw > 0xFFFF || th > 0xFFFF) {
+        thumb = NULL;
+        tw = th = 0;
+    }
+    const wxScopedCharBuffer utf8 = path.utf8_str();
+    if (utf8.length() > 0xFFFF) return;
+
+    wxMutexLocker lock(m_lock);
+
+    auto it = m_index.find(path);
+    if (it != m_index.end() && it->second.size == size && it->second.mtime == mtime) {
+        const ImageMeta& old = it->second.meta;
+        if (!thumb && (it->second.HasThumb() ||
+                       (old.kind == meta.kind && (!meta.width || old.width == meta.width))))
+            return;                     // nothing new to say
+    }
+
+    const size_t thumbBytes = size_t(tw) * th * 4;
+    RecordHead h;
+    std::memset(&h, 0, sizeof(h));
+    h.magic    = REC_MAGIC;
+    h.length   = static_cast<uint32_t>((sizeof(h) + utf8.length() + thumbBytes + 7) & ~size_t(7));
+    h.fileSize = size;
+    h.mtime    = mtime;
+    h.width    = meta.width;
+    h.height   = meta.height;
+    h.format   = meta.format;
+    h.hash     = meta.hash;
+    h.mips     = static_cast<uint16_t>(meta.mips);
+    h.kind     = static_cast<uint8_t>(meta.kind);
+    h.flags    = F_META | (thumb ? F_THUMB : 0) | (meta.bigEndian ? F_BIGENDIAN : 0);
+    h.pathLen  = static_cast<uint16_t>(utf8.length());
+    h.thumbW   = static_cast<uint16_t>(tw);
+    h.thumbH   = static_cast<uint16_t>(th);
+
+    const size_t at = m_pending.size();
+    m_pending.resize(at + h.length, 0);
+    unsigned char* rec = &m_pending[at];
+    std::memcpy(rec + sizeof(h), utf8.data(), utf8.length());
+    if (thumb) std::memcpy(rec + sizeof(h) + utf8.length(), thumb, thumbBytes);
+    std::memcpy(rec, &h, sizeof(h));
+    h.check = recordCheck(rec, h.length);
+    std::memcpy(rec, &h, sizeof(h));
+
+    // The thumbnail is held until its record is on disk; a superseded
+    // slot's copy goes now
+    Slot& s = m_index[path.Clone()];
+    Disown(s);
+    s.size    = size;
+    s.mtime   = mtime;
+    s.meta    = meta;
+    s.thumbAt = 0;
+    s.tw = s.th = 0;
+    s.recAt   = m_end + at;
+    s.recLen  = 0;
+    if (thumb) {
+        s.owned.assign(thumb, thumb + thumbBytes);
+        m_ownedBytes += s.owned.capacity();
+        s.tw = tw;
+        s.th = th;
+    }
+    m_pendingRecs.push_back(std::make_pair(path.Clone(), s.recAt));
+
+    if (m_pending.size() >= FLUSH_AT)
+        WritePending();
+    m_charge.Set(m_ownedBytes + m_pending.capacity());
+}
+
+void ThumbCache::Flush()
+{
+    wxMutexLocker lock(m_lock);
+    if (m_pending.empty()) return;
+    WritePending();
+    if (m_out.IsOpened()) m_out.Flush();
+    m_charge.Set(m_ownedBytes + m_pending.capacity());
+}
+
+// Once the records are in the log, their thumbnails are read back from it
+// and the copies in memory let go; a write that failed keeps them
+void ThumbCache::WritePending()
+{
+    const uint64_t base = m_end;
+    if (m_out.IsOpened() && m_out.Write(&m_pending[0], m_pending.size()) == m_pending.size()) {
+        m_end += m_pending.size();
+        m_window.reset();
+        if (m_file.Open(m_path) && m_file.Length() >= m_end)
+            for (size_t i = 0; i < m_pendingRecs.size(); ++i) {
+                auto it = m_index.find(m_pendingRecs[i].first);
+                if (it == m_index.end() || it->second.recLen ||
+                    it->second.recAt != m_pendingRecs[i].second)
+                    continue;           // superseded by a later record
+                Slot& s = it->second;
+                RecordHead h;
+                std::memcpy(&h, &m_pending[size_t(s.recAt - base)], sizeof(h));
+                s.recLen = h.length;
+                if (!s.owned.empty()) {
+                    s.thumbAt = s.recAt + sizeof(h) + h.pathLen;
+                    Disown(s);
+                }
+            }
+    }
+    m_pending.clear();
+    m_pendingRecs.clear();
+}
+
+void ThumbCache::Disown(Slot& s)
+{
+    m_ownedBytes -= s.owned.capacity();
+    std::vector<unsigned char>().swap(s.owned);
+}
+
+// -----------------------------------------------------------------------------
+//  Thumbnail from a loaded image
+// -----------------------------------------------------------------------------
+bool ThumbCache::MakeThumb(const ImageBase& img, std::vector<unsigned char>& bgra,
+                           int& w, int& h)
+{
+    std::vector<unsigned char> preview;
+    const unsigned char* src = NULL;
+    int sw = 0, sh = 0;
+
+    if (img.GetBlockFormat() != ImageBase::BLK_NONE &&
+        BlockPreview::Build(img.Blocks(), img.Width(), img.Height(),
+                            img.GetBlockFormat(), false, preview, sw, sh))
+        src = &preview[0];
+    else if (img.Data()) {
+        src = img.Data();
+        sw  = img.Width();
+        sh  = img.Height();
+    }
+    if (!src || sw <= 0 || sh <= 0) return false;
+
+    const int longest = std::max(sw, sh);
+    w = longest > THUMB ? std::max(1, int(int64_t(sw) * THUMB / longest)) : sw;
+    h = longest > THUMB ? std::max(1, int(int64_t(sh) * THUMB / longest)) : sh;
+
+    bgra.resize(size_t(w) * h * 4);
+    ImageScale::BoxShrink(src, sw, sh, sw * 4, &bgra[0], w, h, w * 4, false);
+    return true;
+}
@@ -0,0 +1,285 @@
+// -----------------------------------------------------------------------------
+//  ThumbGrid.cpp – virtualized thumbnail grid / filmstrip over the browse list
+// -----------------------------------------------------------------------------
+#include "ThumbGrid.h"
+#include "ThumbLoader.h"
+#include "RenderThread.h"
+#include "BCTV.h"
+
+#include <wx/dcbuffer.h>
+#include <wx/settings.h>
+#include <algorithm>
+
+BEGIN_EVENT_TABLE(ThumbGrid, wxHVScrolledWindow)
+EVT_PAINT (ThumbGrid::OnPaint)
+EVT_ERASE_BACKGROUND(ThumbGrid::OnErase)
+EVT_SIZE (ThumbGrid::OnSize)
+EVT_LEFT_DOWN (ThumbGrid::OnLeftDown)
+EVT_LEFT_DCLICK (ThumbGrid::OnLeftDClick)
+EVT_THREAD(ID_THUMB_DONE, ThumbGrid::OnThumbDone)
+END_EVENT_TABLE()
+
+ThumbGrid::ThumbGrid(BCTVFrame* host, const FileList& files, ThumbCache* thumbs)
+: wxHVScrolledWindow(host, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+                     wxBORDER_NONE | wxWANTS_CHARS),
+  m_host(host), m_files(files), m_thumbs(thumbs), m_loader(NULL),
+  m_strip(false), m_cols(1), m_current(-1), m_bitmaps(MAX_BITMAPS, MemoryBudget::THUMBS),
+  m_reqFirst(-1), m_reqLast(-1)
+{
+    SetBackgroundStyle(wxBG_STYLE_PAINT);
+
+    // Leave a core for the GUI and the render worker
+    const int workers = std::max(1, std::min(4, wxThread::GetCPUCount() - 1));
+    m_loader = new ThumbLoader(thumbs, this, ID_THUMB_DONE, workers);
+    if (!m_loader->Start()) {
+        delete m_loader;
+        m_loader = NULL;               // RequestVisible loads inline instead
+    }
+    Relayout();
+}
+
+ThumbGrid::~ThumbGrid()
+{
+    delete m_loader;                   // joins its workers
+}
+
+void ThumbGrid::SetStrip(bool strip)
+{
+    if (m_strip == strip) return;
+    m_strip = strip;
+    Relayout();
+    SetCurrent(m_current);
+}
+
+int ThumbGrid::StripHeight() const
+{
+    return CELL + wxSystemSettings::GetMetric(wxSYS_HSCROLL_Y, this);
+}
+
+wxCoord ThumbGrid::OnGetRowHeight(size_t) const
+{
+    return m_strip ? CELL : CELL + LABEL;
+}
+
+wxCoord ThumbGrid::OnGetColumnWidth(size_t) const
+{
+    return CELL;
+}
+
+int ThumbGrid::Columns() const
+{
+    if (m_strip) return std::max<int>(1, m_files.GetCount());
+    return std::max(1, GetClientSize().GetWidth() / CELL);
+}
+
+// Row/column counts follow the list and, in grid mode, the width; the first
+// visible file stays in view across a re-flow.
+void ThumbGrid::Relayout()
+{
+    const int first = m_strip ? int(GetVisibleColumnsBegin())
+                              : int(GetVisibleRowsBegin()) * m_cols;
+    const int n = m_files.GetCount();
+
+    m_cols = Columns();
+    const int rows = m_strip ? 1 : (n + m_cols - 1) / m_cols;
+    SetRowColumnCount(rows, m_strip ? n : m_cols);
+
+    if (m_strip) ScrollToColumn(first);
+    else         ScrollToRow(first / m_cols);
+
+    m_reqFirst = m_reqLast = -1;       // re-request on the next paint
+    Refresh();
+}
+
+void ThumbGrid::SyncList()
+{
+    m_failed.clear();                  // files may have been fixed on disk
+    Relayout();
+}
+
+void ThumbGrid::Invalidate(const wxString& path)
+{
+    m_bitmaps.Erase(PathKey(path), 0, 0);
+    m_failed.erase(path);
+    m_reqFirst = m_reqLast = -1;
+    Refresh();
+}
+
+void ThumbGrid::SetCurrent(int idx)
+{
+    if (m_current >= 0) RefreshRect(CellRect(m_current));
+    m_current = idx;
+    if (idx < 0 || idx >= (int)m_files.GetCount()) return;
+
+    if (m_strip) {
+        // keep the current file centred in the strip
+        const int span = std::max(1, GetClientSize().GetWidth() / CELL);
+        ScrollToColumn(std::max(0, idx - span / 2));
+    } else {
+        const int row = idx / m_cols;
+        if (row < (int)GetVisibleRowsBegin() || row >= (int)GetVisibleRowsEnd())
+            ScrollToRow(row);
+    }
+    RefreshRect(CellRect(idx));
+}
+
+wxRect ThumbGrid::CellRect(int idx) const
+{
+    const int row = m_strip ? 0 : idx / m_cols;
+    const int col = m_strip ? idx : idx % m_cols;
+    const int h   = OnGetRowHeight(0);
+    return wxRect((col - int(GetVisibleColumnsBegin())) * CELL,
+                  (row - int(GetVisibleRowsBegin())) * h, CELL, h);
+}
+
+int ThumbGrid::HitTest(const wxPoint& pt) const
+{
+    const wxPosition pos = VirtualHitTest(pt);
+    if (pos.GetRow() < 0 || pos.GetColumn() < 0) return -1;
+    const int idx = m_strip ? pos.GetColumn() : pos.GetRow() * m_cols + pos.GetColumn();
+    return idx < (int)m_files.GetCount() ? idx : -1;
+}
+
+uint64_t ThumbGrid::PathKey(const wxString& path)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;            // FNV-1a
+    for (wxString::const_iterator it = path.begin(); it != path.end(); ++it) {
+        h ^= uint64_t(wxUint32(*it));
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Submits the visible files that have no bitmap yet.  Only called when the
+// visible range moves, so a result landing does not re-queue its neighbours.
+void ThumbGrid::RequestVisible(int first, int last)
+{
+    if (first == m_reqFirst && last == m_reqLast) return;
+    m_reqFirst = first;
+    m_reqLast  = last;
+
+    std::vector<wxString> paths;
+    for (int i = first; i < last; ++i) {
+        const wxString& path = m_files[i];
+        if (!m_bitmaps.Find(PathKey(path), 0, 0) && !m_failed.count(path))
+            paths.push_back(path);
+    }
+
+    if (m_loader) {
+        m_loader->Submit(paths);
+        return;
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::vector<unsigned char> bgra;
+        int w = 0, h = 0;
+        if (ThumbLoader::Load(paths[i], m_thumbs, bgra, w, h))
+            AddThumb(paths[i], &bgra[0], w, h);
+        else
+            m_failed.insert(paths[i]);
+    }
+}
+
+void ThumbGrid::AddThumb(const wxString& path, const unsigned char* bgra, int w, int h)
+{
+    wxBitmap bmp;
+    if (RenderThread::ToBitmap(bgra, w, h, bmp))
+        m_bitmaps.Insert(PathKey(path), 0, 0, bmp);
+}
+
+void ThumbGrid::OnThumbDone(wxThreadEvent& e)
+{
+    const std::shared_ptr<ThumbResult> res = e.GetPayload< std::shared_ptr<ThumbResult> >();
+    if (!res) return;
+    if (res->w > 0 && !res->bgra.empty())
+        AddThumb(res->path, &res->bgra[0], res->w, res->h);
+    else
+        m_failed.insert(res->path);
+
+    // repaint its cell if it is still on screen
+    const int idx = m_files.Find(res->path);
+    if (idx != wxNOT_FOUND && idx >= m_reqFirst && idx < m_reqLast)
+        RefreshRect(CellRect(idx));
+}
+
+void ThumbGrid::OnPaint(wxPaintEvent&)
+{
+    wxAutoBufferedPaintDC dc(this);
+    const wxColour bg = m_host->GetBackgroundColour();
+    dc.SetBackground(wxBrush(bg));
+    dc.Clear();
+
+    const int n = m_files.GetCount();
+    if (n == 0) return;
+
+    const int r0 = GetVisibleRowsBegin(),    r1 = GetVisibleRowsEnd();
+    const int c0 = GetVisibleColumnsBegin(), c1 = GetVisibleColumnsEnd();
+    const int first = m_strip ? c0 : r0 * m_cols + c0;
+    const int last  = std::min(n, m_strip ? c1 : (r1 - 1) * m_cols + c1);
+
+    dc.SetFont(wxSystemSettings::GetFont(wxSYS_DEFAULT_GUI_FONT));
+    dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
+    const wxColour slot = bg.ChangeLightness(90);
+
+    for (int r = r0; r < r1; ++r)
+    for (int c = c0; c < c1; ++c)
+    {
+        const int idx = m_strip ? c : r * m_cols + c;
+        if (idx >= n) break;
+
+        const wxRect cell = CellRect(idx);
+        const wxRect box(cell.x + PAD, cell.y + PAD, ThumbCache::THUMB, ThumbCache::THUMB);
+        if (idx == m_current) {
+            dc.SetPen(*wxTRANSPARENT_PEN);
+            dc.SetBrush(wxBrush(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHT)));
+            dc.DrawRectangle(cell);
+        }
+
+        const wxString& path = m_files[idx];
+        wxBitmap* bmp = m_bitmaps.Find(PathKey(path), 0, 0);
+        if (bmp) {
+            dc.DrawBitmap(*bmp, box.x + (box.width  - bmp->GetWidth())  / 2,
+                                box.y + (box.height - bmp->GetHeight()) / 2, true);
+        } else {
+            dc.SetPen(*wxTRANSPARENT_PEN);
+            dc.SetBrush(wxBrush(slot));
+            dc.DrawRectangle(box);
+            if (m_failed.count(path)) {
+                dc.SetPen(*wxRED_PEN);
+                dc.DrawLine(box.GetTopLeft(), box.GetBottomRight());
+                dc.DrawLine(box.GetTopRight(), box.GetBottomLeft());
+            }
+        }
+
+        if (!m_strip) {
+            const wxString name = wxControl::Ellipsize(m_files.Name(idx), dc,
+                                                       wxELLIPSIZE_MIDDLE, CELL - 2);
+            dc.DrawLabel(name, wxRect(cell.x + 1, cell.y + CELL, CELL - 2, LABEL),
+                         wxALIGN_CENTRE_HORIZONTAL | wxALIGN_TOP);
+        }
+    }
+
+    RequestVisible(first, last);
+}
+
+void ThumbGrid::OnSize(wxSizeEvent& e)
+{
+    if (!m_strip && Columns() != m_cols) Relayout();
+    e.Skip();                          // let the scroll helper update too
+}
+
+void ThumbGrid::OnLeftDown(wxMouseEvent& e)
+{
+    SetFocus();
+    const int idx = HitTest(e.GetPosition());
+    if (idx >= 0 && idx != m_current)
+        m_host->JumpImage(idx);
+}
+
+// Opening a file from the grid switches back to the single-image view
+void ThumbGrid::OnLeftDClick(wxMouseEvent& e)
+{
+    const int idx = HitTest(e.GetPosition());
+    if (idx < 0) return;
+    m_host->JumpImage(idx);
+    if (!m_strip) m_host->SetViewMode(BCTVFrame::VIEW_SINGLE);
+}
@@ -0,0 +1,130 @@
+// -----------------------------------------------------------------------------
+//  ThumbLoader.cpp – worker pool producing thumbnails for the browse grid
+// -----------------------------------------------------------------------------
+#include "ThumbLoader.h"
+#include "DirIndexer.h"
+#include "BCTImage.h"
+#include "DDSImage.h"
+
+#include <wx/log.h>
+#include <memory>
+
+ThumbLoader::ThumbLoader(ThumbCache* thumbs, wxEvtHandler* sink, int eventId,
+                         int workers)
+: m_thumbs(thumbs), m_sink(sink), m_eventId(eventId),
+  m_workerCount(workers > 0 ? workers : 1),
+  m_wake(m_lock), m_quit(false)
+{
+}
+
+ThumbLoader::~ThumbLoader()
+{
+    {
+        wxMutexLocker lock(m_lock);
+        m_quit = true;
+        m_queue.clear();
+        m_wake.Broadcast();
+    }
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->Wait();
+        delete m_workers[i];
+    }
+}
+
+bool ThumbLoader::Start()
+{
+    for (int i = 0; i < m_workerCount; ++i) {
+        Worker* w = new Worker(this);
+        if (w->Run() != wxTHREAD_NO_ERROR) {
+            delete w;
+            break;
+        }
+        m_workers.push_back(w);
+    }
+    return !m_workers.empty();
+}
+
+void ThumbLoader::Submit(const std::vector<wxString>& paths)
+{
+    wxMutexLocker lock(m_lock);
+    m_queue.clear();                   // scrolled past: not wanted any more
+    for (size_t i = 0; i < paths.size(); ++i)
+        m_queue.push_back(paths[i].Clone());
+    if (!m_queue.empty()) m_wake.Broadcast();
+}
+
+bool ThumbLoader::Next(wxString& path)
+{
+    wxMutexLocker lock(m_lock);
+    for (;;)
+    {
+        while (m_queue.empty() && !m_quit)
+            m_wake.Wait();
+        if (m_quit) return false;
+
+        path = m_queue.front();
+        m_queue.pop_front();
+        if (m_inFlight.count(path))
+            continue;                  // another worker has it
+        m_inFlight.insert(path);
+        return true;
+    }
+}
+
+void ThumbLoader::Finished(const wxString& path)
+{
+    wxMutexLocker lock(m_lock);
+    m_inFlight.erase(path);
+}
+
+bool ThumbLoader::Load(const wxString& path, ThumbCache* thumbs,
+                       std::vector<unsigned char>& bgra, int& w, int& h)
+{
+    uint64_t size  = 0;
+    int64_t  mtime = 0;
+    const bool stat = ThumbCache::Stat(path, size, mtime);
+    if (stat && thumbs && thumbs->Thumb(path, size, mtime, bgra, w, h))
+        return true;
+
+    uint32_t file4CC;
+    if (!DirIndexer::SniffSignature(path, file4CC))
+        return false;
+
+    std::unique_ptr<ImageBase> img;
+    if ((file4CC == 0x07010220) || ((file4CC & 0x00FFFF00) == 0x00010100))
+        img.reset(new BCTImage);
+    else if (file4CC == 0x44445320)
+        img.reset(new DDSImage);
+    else
+        return false;
+
+    wxLogNull quiet;
+    if (!img->LoadSmallMip(path, SOURCE_SIDE) ||
+        !ThumbCache::MakeThumb(*img, bgra, w, h))
+        return false;
+
+    if (stat && thumbs)
+        thumbs->Put(path, size, mtime, img->Meta(), &bgra[0], w, h);
+    return true;
+}
+
+wxThread::ExitCode ThumbLoader::Worker::Entry()
+{
+    wxString path;
+    while (m_owner->Next(path))
+    {
+        std::shared_ptr<ThumbResult> res(new ThumbResult);
+        res->path = path.Clone();
+        res->w = res->h = 0;
+        if (!Load(path, m_owner->m_thumbs, res->bgra, res->w, res->h)) {
+            res->bgra.clear();
+            res->w = res->h = 0;
+        }
+        m_owner->Finished(path);
+
+        wxThreadEvent* ev = new wxThreadEvent(wxEVT_THREAD, m_owner->m_eventId);
+        ev->SetPayload(res);
+        wxQueueEvent(m_owner->m_sink, ev);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+// -----------------------------------------------------------------------------
+//  TileCache.cpp – LRU of rendered canvas tiles
+// -----------------------------------------------------------------------------
+#include "TileCache.h"
+#include "RenderThread.h"
+#include <cstring>
+
+TileCache::TileCache(size_t maxTiles, MemoryBudget::Category cat)
+: m_max(maxTiles ? maxTiles : 1), m_floor(m_max), m_sum(0), m_charge(cat)
+{
+}
+
+// 32-bit DIBs / pixmaps with alpha
+size_t TileCache::BitmapBytes(const wxBitmap& bmp)
+{
+    return bmp.IsOk() ? size_t(bmp.GetWidth()) * bmp.GetHeight() * 4 : 0;
+}
+
+// FNV-1a over everything that changes the pixels of a tile
+uint64_t TileCache::ViewKey(const RenderJob& v)
+{
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](const void* p, size_t n) {
+        const unsigned char* b = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ULL; }
+    };
+
+    const void* img = v.img.get();
+    const int flags = (v.showR      ? 1  : 0) | (v.showG   ? 2  : 0) |
+                      (v.showB      ? 4  : 0) | (v.showA   ? 8  : 0) |
+                      (v.filtShr    ? 16 : 0) | (v.filtLinear ? 32 : 0);
+    mix(&img,    sizeof(img));
+    mix(&v.zoom, sizeof(v.zoom));
+    mix(&v.w,    sizeof(v.w));
+    mix(&v.h,    sizeof(v.h));
+    mix(&v.pp,   sizeof(v.pp));
+    mix(&flags,  sizeof(flags));
+    return h;
+}
+
+wxBitmap* TileCache::Find(uint64_t view, int tx, int ty)
+{
+    const Key k = { view, tx, ty };
+    auto it = m_map.find(k);
+    if (it == m_map.end()) return NULL;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);      // move to front
+    return &it->second->bmp;
+}
+
+void TileCache::Insert(uint64_t view, int tx, int ty, const wxBitmap& bmp)
+{
+    const Key k = { view, tx, ty };
+    auto it = m_map.find(k);
+    if (it != m_map.end()) {
+        m_sum -= it->second->bytes;
+        it->second->bmp   = bmp;
+        it->second->bytes = BitmapBytes(bmp);
+        m_sum += it->second->bytes;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        Trim();
+        return;
+    }
+    Entry e = { k, bmp, BitmapBytes(bmp) };
+    m_lru.push_front(e);
+    m_map[k] = m_lru.begin();
+    m_sum += e.bytes;
+    Trim();
+}
+
+void TileCache::Erase(uint64_t view, int tx, int ty)
+{
+    const Key k = { view, tx, ty };
+    auto it = m_map.find(k);
+    if (it == m_map.end()) return;
+    m_sum -= it->second->bytes;
+    m_lru.erase(it->second);
+    m_map.erase(it);
+    m_charge.Set(m_sum);
+}
+
+void TileCache::Clear()
+{
+    m_map.clear();
+    m_lru.clear();
+    m_sum = 0;
+    m_charge.Set(0);
+}
+
+void TileCache::SetCapacity(size_t maxTiles)
+{
+    m_max = maxTiles ? maxTiles : 1;
+    Trim();
+}
+
+void TileCache::SetFloor(size_t minTiles)
+{
+    m_floor = minTiles;
+    Trim();
+}
+
+void TileCache::PopOldest()
+{
+    m_sum -= m_lru.back().bytes;
+    m_map.erase(m_lru.back().key);
+    m_lru.pop_back();
+}
+
+void TileCache::Trim()
+{
+    while (m_lru.size() > m_max)
+        PopOldest();
+    m_charge.Set(m_sum);
+    while (m_lru.size() > m_floor && MemoryBudget::Over()) {
+        PopOldest();
+        m_charge.Set(m_sum);
+    }
+}
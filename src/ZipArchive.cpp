@@ -0,0 +1,377 @@
+// -----------------------------------------------------------------------------
+//  ZipArchive.cpp – textures read straight out of ZIP / pack archives
+//
+//  Records used (little-endian, PKWARE APPNOTE):
+//      end of central directory   0x06054b50, 22 bytes + comment
+//      ZIP64 EOCD locator         0x07064b50, 20 bytes before the EOCD
+//      ZIP64 EOCD record          0x06064b50
+//      central directory entry    0x02014b50, 46 bytes + name/extra/comment
+//      local file header          0x04034b50, 30 bytes + name/extra
+// -----------------------------------------------------------------------------
+#include "ZipArchive.h"
+
+#include <wx/file.h>
+#include <wx/log.h>
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const uint32_t SIG_LOCAL   = 0x04034b50;
+const uint32_t SIG_CENTRAL = 0x02014b50;
+const uint32_t SIG_EOCD    = 0x06054b50;
+const uint32_t SIG_EOCD64  = 0x06064b50;
+const uint32_t SIG_LOC64   = 0x07064b50;
+const size_t   EOCD_SIZE   = 22;
+const size_t   LOC64_SIZE  = 20;
+const size_t   EOCD64_SIZE = 56;
+const size_t   LOCAL_SIZE  = 30;
+const size_t   MAX_COMMENT = 0xFFFF;
+const size_t   MAX_LOCAL   = LOCAL_SIZE + 0xFFFF + 0xFFFF;   // header, name and extra at most
+
+enum { METHOD_STORED = 0, METHOD_DEFLATE = 8 };
+enum { FLAG_ENCRYPTED = 1, FLAG_UTF8 = 1 << 11 };
+
+inline uint16_t rd16(const unsigned char* p) { return uint16_t(p[0] | (p[1] << 8)); }
+inline uint32_t rd32(const unsigned char* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+inline uint64_t rd64(const unsigned char* p) { return rd32(p) | (uint64_t(rd32(p + 4)) << 32); }
+
+// -----------------------------------------------------------------------------
+//  Stored member: the window itself, kept alive by the stream
+// -----------------------------------------------------------------------------
+class StoredStream : public wxMemoryInputStream
+{
+public:
+    StoredStream(const std::shared_ptr<const FileMapping::View>& view, const unsigned char* data, size_t len)
+    : wxMemoryInputStream(data, len), m_view(view) {}
+private:
+    std::shared_ptr<const FileMapping::View> m_view;
+};
+
+// -----------------------------------------------------------------------------
+//  A span of the file read with positioned reads: for the member that has no
+//  room in the address space, and for the deflate input behind it
+// -----------------------------------------------------------------------------
+class RangeStream : public wxInputStream
+{
+public:
+    RangeStream(const wxString& path, uint64_t start, uint64_t len)
+    : m_start(start), m_len(len), m_pos(0)
+    {
+        wxLogNull quiet;
+        m_file.Open(path);
+    }
+
+    wxFileOffset GetLength() const override { return wxFileOffset(m_len); }
+    bool IsSeekable() const override        { return true; }
+
+protected:
+    size_t OnSysRead(void* buffer, size_t size) override
+    {
+        const size_t want = size_t(std::min<uint64_t>(size, m_len - m_pos));
+        if (want == 0) {
+            m_lasterror = wxSTREAM_EOF;
+            return 0;
+        }
+        if (!m_file.IsOpened() || m_file.Seek(wxFileOffset(m_start + m_pos)) == wxInvalidOffset) {
+            m_lasterror = wxSTREAM_READ_ERROR;
+            return 0;
+        }
+        const ssize_t got = m_file.Read(buffer, want);
+        if (got <= 0) {
+            m_lasterror = wxSTREAM_READ_ERROR;
+            return 0;
+        }
+        m_pos += uint64_t(got);
+        return size_t(got);
+    }
+
+    wxFileOffset OnSysSeek(wxFileOffset pos, wxSeekMode mode) override
+    {
+        wxFileOffset target = pos;
+        if (mode == wxFromCurrent) target += wxFileOffset(m_pos);
+        else if (mode == wxFromEnd) target += wxFileOffset(m_len);
+        if (target < 0 || uint64_t(target) > m_len) return wxInvalidOffset;
+        m_pos = uint64_t(target);
+        return target;
+    }
+
+    wxFileOffset OnSysTell() const override { return wxFileOffset(m_pos); }
+
+private:
+    wxFile   m_file;                   // a handle of its own: streams are used on many threads
+    uint64_t m_start, m_len, m_pos;
+};
+
+// -----------------------------------------------------------------------------
+//  Deflated member: inflated on read, seekable by position bookkeeping
+// -----------------------------------------------------------------------------
+class InflateStream : public wxInputStream
+{
+public:
+    typedef std::function<wxInputStream*()> SourceFn;   // the packed bytes, from the start
+
+    InflateStream(const SourceFn& source, uint64_t size)
+    : m_source(source), m_size(size), m_pos(0), m_inflated(0)
+    {
+        Restart();
+    }
+
+    wxFileOffset GetLength() const override { return wxFileOffset(m_size); }
+    bool IsSeekable() const override        { return true; }
+
+protected:
+    size_t OnSysRead(void* buffer, size_t size) override
+    {
+        if (m_pos < m_inflated) Restart();          // backwards: start over
+        if (!Skip(m_pos - m_inflated)) return 0;
+
+        const size_t want = size_t(std::min<uint64_t>(size, m_size - m_pos));
+        if (want == 0) {
+            m_lasterror = wxSTREAM_EOF;
+            return 0;
+        }
+        m_inflate->Read(buffer, want);
+        const size_t got = m_inflate->LastRead();
+        if (got == 0) m_lasterror = wxSTREAM_READ_ERROR;
+        m_pos      += got;
+        m_inflated += got;
+        return got;
+    }
+
+    // Only moves the read position; the next read catches up
+    wxFileOffset OnSysSeek(wxFileOffset pos, wxSeekMode mode) override
+    {
+        wxFileOffset target = pos;
+        if (mode == wxFromCurrent) target += wxFileOffset(m_pos);
+        else if (mode == wxFromEnd) target += wxFileOffset(m_size);
+        if (target < 0 || uint64_t(target) > m_size) return wxInvalidOffset;
+        m_pos = uint64_t(target);
+        return target;
+    }
+
+    wxFileOffset OnSysTell() const override { return wxFileOffset(m_pos); }
+
+private:
+    void Restart()
+    {
+        m_inflate.reset();
+        m_raw.reset(m_source());
+        m_inflate.reset(new wxZlibInputStream(*m_raw, wxZLIB_NO_HEADER));
+        m_inflated = 0;
+    }
+
+    bool Skip(uint64_t n)
+    {
+        unsigned char scratch[64 * 1024];
+        while (n > 0) {
+            m_inflate->Read(scratch, size_t(std::min<uint64_t>(n, sizeof(scratch))));
+            const size_t got = m_inflate->LastRead();
+            if (got == 0) {
+                m_lasterror = wxSTREAM_READ_ERROR;
+                return false;
+            }
+            n          -= got;
+            m_inflated += got;
+        }
+        return true;
+    }
+
+    SourceFn                             m_source;
+    uint64_t                             m_size;
+    uint64_t                             m_pos;        // logical read position
+    uint64_t                             m_inflated;   // produced by m_inflate
+    std::unique_ptr<wxInputStream>       m_raw;
+    std::unique_ptr<wxZlibInputStream>   m_inflate;
+};
+
+} // anon-ns
+
+// -----------------------------------------------------------------------------
+
+ZipArchive::ZipArchive()
+{
+}
+
+ZipArchive::~ZipArchive()
+{
+}
+
+std::shared_ptr<ZipArchive> ZipArchive::Open(const wxString& path)
+{
+    std::shared_ptr<ZipArchive> zip(new ZipArchive);
+    zip->m_path = path.Clone();
+
+    wxLogNull quiet;
+    if (!zip->m_file.Open(path) || !zip->ReadDirectory())
+        return std::shared_ptr<ZipArchive>();
+    return zip;
+}
+
+bool ZipArchive::LooksLikeZip(const wxString& path)
+{
+    wxLogNull quiet;
+    wxFile f(path);
+    unsigned char sig[4];
+    if (!f.IsOpened() || f.Read(sig, sizeof(sig)) != static_cast<ssize_t>(sizeof(sig)))
+        return false;
+    const uint32_t s = rd32(sig);
+    return s == SIG_LOCAL || s == SIG_EOCD;         // the latter: an empty archive
+}
+
+const ZipArchive::Member* ZipArchive::Find(const wxString& name) const
+{
+    const auto it = m_byName.find(name.ToStdWstring());
+    return it != m_byName.end() ? &m_members[it->second] : NULL;
+}
+
+// The central directory is read once, through windows over the tail and the
+// directory itself that are dropped again; nothing of the members is touched
+bool ZipArchive::ReadDirectory()
+{
+    const uint64_t len = m_file.Length();
+    if (len < EOCD_SIZE) return false;
+
+    // The EOCD is the last record, followed only by a comment; the ZIP64
+    // locator sits right before it
+    const uint64_t tailLen = std::min<uint64_t>(len, LOC64_SIZE + EOCD_SIZE + MAX_COMMENT);
+    const std::shared_ptr<const FileMapping::View> tail = m_file.Map(len - tailLen, tailLen);
+    if (!tail) return false;
+    const unsigned char* t = tail->Data();
+    const size_t tailSize  = tail->Size();
+
+    const size_t lowest = tailSize > EOCD_SIZE + MAX_COMMENT ? tailSize - EOCD_SIZE - MAX_COMMENT : 0;
+    size_t eocd = tailSize - EOCD_SIZE;
+    while (rd32(t + eocd) != SIG_EOCD) {
+        if (eocd == lowest) return false;
+        --eocd;
+    }
+    const unsigned char* e = t + eocd;
+    uint64_t count   = rd16(e + 10);
+    uint64_t cdSize  = rd32(e + 12);
+    uint64_t cdStart = rd32(e + 16);
+
+    if (eocd >= LOC64_SIZE && rd32(t + eocd - LOC64_SIZE) == SIG_LOC64) {
+        const uint64_t at = rd64(t + eocd - LOC64_SIZE + 8);
+        const std::shared_ptr<const FileMapping::View> z = m_file.Map(at, EOCD64_SIZE);
+        if (!z || z->Size() < EOCD64_SIZE || rd32(z->Data()) != SIG_EOCD64)
+            return false;
+        count   = rd64(z->Data() + 32);
+        cdSize  = rd64(z->Data() + 40);
+        cdStart = rd64(z->Data() + 48);
+    }
+    if (cdStart > len || cdSize > len - cdStart) return false;
+
+    std::shared_ptr<const FileMapping::View> cd;
+    if (cdSize && !(cd = m_file.Map(cdStart, cdSize))) return false;
+
+    m_members.reserve(size_t(std::min<uint64_t>(count, cdSize / 46)));
+    const unsigned char* p   = cd ? cd->Data() : NULL;
+    const unsigned char* end = p + (cd ? cd->Size() : 0);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        if (end - p < 46 || rd32(p) != SIG_CENTRAL) return false;
+        const uint16_t flags    = rd16(p + 8);
+        const size_t   nameLen  = rd16(p + 28);
+        const size_t   extraLen = rd16(p + 30);
+        const size_t   skipLen  = rd16(p + 32);
+        if (size_t(end - p) < 46 + nameLen + extraLen + skipLen) return false;
+
+        Member m;
+        m.method       = rd16(p + 10);
+        m.packedSize   = rd32(p + 20);
+        m.size         = rd32(p + 24);
+        m.headerOffset = rd32(p + 42);
+
+        const char* name = reinterpret_cast<const char*>(p + 46);
+        m.name = (flags & FLAG_UTF8) ? wxString::FromUTF8(name, nameLen)
+                                     : wxString(name, wxConvISO8859_1, nameLen);
+
+        // ZIP64 extra field: the full values of whichever fields overflowed
+        const unsigned char* x    = p + 46 + nameLen;
+        const unsigned char* xEnd = x + extraLen;
+        while (xEnd - x >= 4) {
+            const uint16_t id  = rd16(x);
+            const uint16_t len = rd16(x + 2);
+            if (xEnd - x - 4 < len) break;
+            if (id == 0x0001) {
+                const unsigned char* v = x + 4;
+                const unsigned char* vEnd = v + len;
+                if (m.size == 0xFFFFFFFF && vEnd - v >= 8)         { m.size = rd64(v); v += 8; }
+                if (m.packedSize == 0xFFFFFFFF && vEnd - v >= 8)   { m.packedSize = rd64(v); v += 8; }
+                if (m.headerOffset == 0xFFFFFFFF && vEnd - v >= 8) { m.headerOffset = rd64(v); }
+            }
+            x += 4 + len;
+        }
+
+        m.readable = !(flags & FLAG_ENCRYPTED) &&
+                     (m.method == METHOD_STORED || m.method == METHOD_DEFLATE) &&
+                     !m.name.EndsWith("/");
+        m_byName[m.name.ToStdWstring()] = m_members.size();
+        m_members.push_back(m);
+
+        p += 46 + nameLen + extraLen + skipLen;
+    }
+    return true;
+}
+
+bool ZipArchive::Locate(const Member& m, Window& w) const
+{
+    const uint64_t len = m_file.Length();
+    if (m.headerOffset > len || len - m.headerOffset < LOCAL_SIZE || m.packedSize > len)
+        return false;
+
+    // One window from the local header to the end of the packed bytes; as
+    // the header's name and extra are not known yet, room for the longest
+    unsigned char h[LOCAL_SIZE];
+    w.view = m_file.Map(m.headerOffset, MAX_LOCAL + m.packedSize);
+    if (w.view) {
+        std::memcpy(h, w.view->Data(), sizeof(h));
+    } else {
+        wxFile f(m_path);
+        if (!f.IsOpened() || f.Seek(wxFileOffset(m.headerOffset)) == wxInvalidOffset ||
+            f.Read(h, sizeof(h)) != static_cast<ssize_t>(sizeof(h)))
+            return false;
+    }
+    if (rd32(h) != SIG_LOCAL) return false;
+
+    w.dataAt = m.headerOffset + LOCAL_SIZE + rd16(h + 26) + rd16(h + 28);
+    if (w.dataAt > len || m.packedSize > len - w.dataAt) return false;
+    w.data = w.view ? w.view->Data() + (w.dataAt - m.headerOffset) : NULL;
+    return true;
+}
+
+wxInputStream* ZipArchive::OpenMember(const Member& m) const
+{
+    if (!m.readable) return NULL;
+    Window w;
+    {
+        wxLogNull quiet;
+        if (!Locate(m, w)) return NULL;
+    }
+
+    if (m.method == METHOD_STORED) {
+        const uint64_t len = std::min(m.size, m.packedSize);
+        if (w.view) return new StoredStream(w.view, w.data, size_t(len));
+        return new RangeStream(m_path, w.dataAt, len);
+    }
+
+    InflateStream::SourceFn source;
+    if (w.view) {
+        const std::shared_ptr<const FileMapping::View> view = w.view;
+        const unsigned char* data = w.data;
+        const size_t packed = size_t(m.packedSize);
+        source = [view, data, packed] { return new wxMemoryInputStream(data, packed); };
+    } else {
+        const wxString path = m_path.Clone();
+        const uint64_t at = w.dataAt, packed = m.packedSize;
+        source = [path, at, packed] { return new RangeStream(path, at, packed); };
+    }
+    return new InflateStream(source, m.size);
+}